@@ -0,0 +1,71 @@
+#ifndef WAYLAND_INPUT_WINDOW_APP_CLOCK_H
+#define WAYLAND_INPUT_WINDOW_APP_CLOCK_H
+
+#include <chrono>           // std::chrono::*
+#include <atomic>           // std::atomic
+
+
+/**
+ * The time of the app: the event loop, the timers of the coroutines, the frame pacing, the latency metrics, the flight
+ *   recorder and the logs all read it.
+ * It's std::chrono::steady_clock unless the virtual time is enabled (see $WAYLAND_INPUT_WINDOW_VIRTUAL_FRAME_MS):
+ *   then it stands still until advance() is called, so the same input produces the same frame schedule and the same
+ *   latencies on every run.
+ * The measurements of the hardware (the stall watchdog, the energy, the scheduling delays, the bandwidths and the
+ *   benchmarks) keep using the real time.
+ * Meets the Clock requirements, so it's used with std::chrono like the standard clocks. Lock-free and async-signal-safe.
+ */
+class AppClock
+{
+public:
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<AppClock>;
+    static constexpr bool is_steady = true;
+
+    // The virtual time starts here rather than at 0, so the moments before the start are still representable
+    static constexpr duration VIRTUAL_EPOCH = std::chrono::hours{ 1 };
+
+public:
+    [[nodiscard]] static time_point now() noexcept
+    {
+        if (getIsVirtual().load(std::memory_order_acquire))
+            return time_point{ duration{ getVirtualNs().load(std::memory_order_acquire) } };
+        return time_point{ std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()) };
+    }
+
+    /** Freezes the time at VIRTUAL_EPOCH ; must be called at the startup, before anything samples the time */
+    static void enableVirtualTime() noexcept
+    {
+        getVirtualNs().store(VIRTUAL_EPOCH.count(), std::memory_order_release);
+        getIsVirtual().store(true, std::memory_order_release);
+    }
+
+    /** Moves the virtual time forward ; does nothing if the time isn't virtual */
+    static void advance(const duration delta) noexcept
+    {
+        if ( !getIsVirtual().load(std::memory_order_acquire) || (delta.count() <= 0) )
+            return;
+        (void)getVirtualNs().fetch_add(delta.count(), std::memory_order_acq_rel);
+    }
+
+    [[nodiscard]] static bool isVirtual() noexcept { return getIsVirtual().load(std::memory_order_acquire); }
+
+private:
+    /** Checked by every now() ; a constant-initialized local keeps that hot path down to a single atomic load */
+    [[nodiscard]] static std::atomic<bool>& getIsVirtual() noexcept
+    {
+        static std::atomic<bool> isVirtual{ false };
+        return isVirtual;
+    }
+
+    [[nodiscard]] static std::atomic<rep>& getVirtualNs() noexcept
+    {
+        static std::atomic<rep> virtualNs{ 0 };
+        return virtualNs;
+    }
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_APP_CLOCK_H
@@ -0,0 +1,241 @@
+#ifndef WAYLAND_INPUT_WINDOW_BANDWIDTH_ROOFLINE_H
+#define WAYLAND_INPUT_WINDOW_BANDWIDTH_ROOFLINE_H
+
+#include "utilities.h"      // MY_LOG_*, SharedMemoryBuffer
+#include "latency_stats.h"  // LatencyMeter
+#include <vector>           // std::vector
+#include <thread>           // std::thread
+#include <latch>            // std::latch
+#include <chrono>           // std::chrono::*
+#include <algorithm>        // std::max, std::min
+#include <cstring>          // std::memset, std::memcpy
+#include <cstddef>          // std::byte, std::size_t
+#include <cstdint>          // std::uint64_t
+#include <string>           // std::string, std::to_string
+#if defined(__SSE2__)
+    #include <immintrin.h>  // _mm_stream_si128, _mm_sfence, _mm_set1_epi32
+#endif
+
+
+/**
+ * The peak bandwidths of writing a SharedMemoryBuffer mapping (like the surface buffers), measured by calibrate(),
+ *   and the bandwidths achieved by the stages of the frames relative to them ("the roofline").
+ * Three kernels are measured, single-threaded and by threadsCount threads (each one on its own slice):
+ *   - memset: the regular stores, which read the cache lines before writing them ;
+ *   - memcpy: half of the buffer into the other half, counting both the read and the written bytes ;
+ *   - streaming: the non-temporal stores bypassing the caches (SSE2 only ; otherwise not measured).
+ * The buffer should be several times larger than the last level cache, so the DRAM is measured rather than the caches.
+ * The write peak of a stage is the best of memset and streaming: it's what the stage could reach by changing how it
+ *   writes. Every stage is measured on the main thread, so its percentage of the single-threaded peak is the headroom
+ *   of the stage itself, while the one of the multi-threaded peak is the headroom left for parallelizing it.
+ */
+class BandwidthRoofline
+{
+public:
+    struct Peaks
+    {
+        double memsetBytesPerSec = 0;
+        double memcpyBytesPerSec = 0;
+        // 0 if the streaming stores aren't available
+        double streamingBytesPerSec = 0;
+
+    public: // getters
+        [[nodiscard]] double getWriteBytesPerSec() const noexcept { return std::max(memsetBytesPerSec, streamingBytesPerSec); }
+    };
+
+    // 4x the last level caches of the most of the desktop CPUs
+    static constexpr std::size_t DEFAULT_CALIBRATION_BUFFER_SIZE = std::size_t{256} << 20;
+    // The best of the passes is taken: the first ones pay for the page faults
+    static constexpr unsigned CALIBRATION_PASSES = 5;
+
+    static constexpr std::uint64_t REPORT_PERIOD_FRAMES = LatencyMeter::REPORT_PERIOD;
+
+public: // ctors/dtor
+    BandwidthRoofline() noexcept = default;
+
+    ~BandwidthRoofline() noexcept
+    {
+        report();
+    }
+
+public:
+    /** Blocks for about a second ; threadsCount should be the number of the threads rendering the frames */
+    void calibrate(const unsigned threadsCount, const std::size_t bufferSize = DEFAULT_CALIBRATION_BUFFER_SIZE)
+    {
+        auto buffer = SharedMemoryBuffer::allocate(bufferSize);
+        threadsCount_ = std::max(threadsCount, 1u);
+
+        MY_LOG_INFO("BandwidthRoofline: calibrating on a ", bufferSize >> 20, " MiB wl_shm mapping, 1 and ", threadsCount_, " thread(s)...");
+        singleThreaded_ = measurePeaks(buffer.getData(), buffer.getSize(), 1);
+        multiThreaded_ = measurePeaks(buffer.getData(), buffer.getSize(), threadsCount_);
+        isCalibrated_ = true;
+
+        logPeaks("1 thread", singleThreaded_);
+        logPeaks(std::to_string(threadsCount_) + " threads", multiThreaded_);
+    }
+
+    /** Accounts the bytes written into the wl_shm buffers or the composed frames by a stage of the frames */
+    void record(const char* const stage, const std::size_t bytes, const std::chrono::nanoseconds duration)
+    {
+        if (!isCalibrated_)
+            return;
+
+        for (auto& traffic : stages_)
+        {
+            if (traffic.name == stage)
+            {
+                traffic.bytes += bytes;
+                traffic.ns += static_cast<std::uint64_t>(duration.count());
+                return;
+            }
+        }
+        stages_.push_back({ stage, bytes, static_cast<std::uint64_t>(duration.count()) });
+    }
+
+    void onFrameEnd() noexcept
+    {
+        if (!isCalibrated_)
+            return;
+
+        if (++framesCount_ >= REPORT_PERIOD_FRAMES)
+        {
+            report();
+            for (auto& traffic : stages_)
+                traffic = { traffic.name, 0, 0 };
+            framesCount_ = 0;
+        }
+    }
+
+    void report() const noexcept
+    {
+        for (const auto& traffic : stages_)
+        {
+            if (traffic.ns == 0)
+                continue;
+            logAchieved(traffic.name, static_cast<double>(traffic.bytes) * 1e9 / static_cast<double>(traffic.ns));
+        }
+    }
+
+    /** E.g. for the benchmarks done once */
+    void logAchieved(const char* const name, const double bytesPerSec) const noexcept
+    {
+        if (!isCalibrated_)
+            return;
+
+        MY_LOG_INFO(
+            "BandwidthRoofline: ", name, ": ", bytesPerSec / 1e9, " GB/s, ",
+            100 * bytesPerSec / singleThreaded_.getWriteBytesPerSec(), "% of the 1-thread peak, ",
+            100 * bytesPerSec / multiThreaded_.getWriteBytesPerSec(), "% of the ", threadsCount_, "-threads peak."
+        );
+    }
+
+public: // getters
+    [[nodiscard]] bool isCalibrated() const noexcept { return isCalibrated_; }
+    [[nodiscard]] const Peaks& getSingleThreadedPeaks() const noexcept { return singleThreaded_; }
+    [[nodiscard]] const Peaks& getMultiThreadedPeaks() const noexcept { return multiThreaded_; }
+
+private:
+    struct StageTraffic
+    {
+        // A string literal
+        const char* name;
+        std::uint64_t bytes;
+        std::uint64_t ns;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static void streamFill(std::byte* const dst, const std::size_t size) noexcept
+    {
+#if defined(__SSE2__)
+        // The mappings are page-aligned and the slices are cache line-aligned
+        const __m128i value = _mm_set1_epi32(0x5A5A5A5A);
+        auto* const vectors = reinterpret_cast<__m128i*>(dst);
+        for (std::size_t i = 0; i < size / sizeof(__m128i); ++i)
+            _mm_stream_si128(vectors + i, value);
+        // The non-temporal stores aren't ordered with the rest ones
+        _mm_sfence();
+#else
+        (void)dst;
+        (void)size;
+#endif
+    }
+
+    /** The best bandwidth of the kernel over CALIBRATION_PASSES, run on slices of [data; data + size) */
+    template<typename Kernel>
+    [[nodiscard]] static double measureBest(
+        std::byte* const data,
+        const std::size_t size,
+        const unsigned threadsCount,
+        Kernel&& kernel
+    ) {
+        // Cache line-aligned slices
+        const std::size_t sliceSize = size / threadsCount / 64 * 64;
+
+        double best = 0;
+        for (unsigned pass = 0; pass < CALIBRATION_PASSES; ++pass)
+        {
+            // The threads are started up front, so their creation isn't measured
+            std::latch started{ threadsCount + 1 };
+            std::vector<std::thread> threads;
+            threads.reserve(threadsCount);
+            for (unsigned i = 0; i < threadsCount; ++i)
+            {
+                threads.emplace_back([&started, &kernel, slice = data + i * sliceSize, sliceSize] {
+                    started.arrive_and_wait();
+                    kernel(slice, sliceSize);
+                });
+            }
+
+            started.arrive_and_wait();
+            const auto startedAt = Clock::now();
+            for (auto& thread : threads)
+                thread.join();
+            const auto elapsedSec = std::chrono::duration<double>(Clock::now() - startedAt).count();
+
+            best = std::max(best, static_cast<double>(sliceSize * threadsCount) / elapsedSec);
+        }
+        return best;
+    }
+
+    [[nodiscard]] static Peaks measurePeaks(std::byte* const data, const std::size_t size, const unsigned threadsCount)
+    {
+        Peaks result;
+
+        result.memsetBytesPerSec = measureBest(data, size, threadsCount, [](std::byte* const slice, const std::size_t sliceSize) {
+            std::memset(slice, 0x5A, sliceSize);
+        });
+        // Each slice is copied from its first half into its second one, reading and writing half of its bytes
+        result.memcpyBytesPerSec = measureBest(data, size, threadsCount, [](std::byte* const slice, const std::size_t sliceSize) {
+            std::memcpy(slice + sliceSize / 2, slice, sliceSize / 2);
+        });
+#if defined(__SSE2__)
+        result.streamingBytesPerSec = measureBest(data, size, threadsCount, &streamFill);
+#endif
+
+        return result;
+    }
+
+    static void logPeaks(const std::string& threads, const Peaks& peaks)
+    {
+        MY_LOG_INFO(
+            "BandwidthRoofline: the peaks of ", threads, ": ",
+            "memset ", peaks.memsetBytesPerSec / 1e9, " GB/s, ",
+            "memcpy ", peaks.memcpyBytesPerSec / 1e9, " GB/s (read + written), ",
+            "streaming stores ", peaks.streamingBytesPerSec / 1e9, " GB/s (0 if unavailable)."
+        );
+    }
+
+private:
+    bool isCalibrated_ = false;
+    unsigned threadsCount_ = 1;
+    Peaks singleThreaded_;
+    Peaks multiThreaded_;
+
+    std::vector<StageTraffic> stages_;
+    std::uint64_t framesCount_ = 0;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_BANDWIDTH_ROOFLINE_H
@@ -0,0 +1,405 @@
+/**
+ * Measures the costs the frame loop of the app is made of, on the protocol level:
+ *   - the wl_display_roundtrip latency ;
+ *   - the time from wl_surface_commit to wl_callback::done of the frame callback ;
+ *   - the time from wl_surface_commit to wl_buffer::release of the committed buffer ;
+ *   - the cost of wl_shm_create_pool + wl_shm_pool_create_buffer of various sizes, on the client side only and with
+ *     the server side (i.e. up to a roundtrip).
+ * Runs against the compositor of $WAYLAND_DISPLAY, e.g. a headless weston:
+ *     weston --backend=headless -S wayland-bench & WAYLAND_DISPLAY=wayland-bench WaylandProtocolBench
+ *   or against StandInCompositor (--stand-in), which does nothing but the protocol. Comparing the two tells the costs
+ *   of the compositor apart from the ones of libwayland, of the kernel and of the client.
+ * Usage: WaylandProtocolBench [--stand-in] [--iterations=N]
+ */
+
+#include "utilities.h"              // MY_LOG_*, SharedMemoryBuffer
+#include "stand_in_compositor.h"    // StandInCompositor
+#include <wayland-client.h>         // wl_*
+#include <xdg-shell.h>              // xdg_*
+#include <vector>                   // std::vector
+#include <array>                    // std::array
+#include <string>                   // std::string, std::to_string
+#include <string_view>              // std::string_view
+#include <optional>                 // std::optional
+#include <algorithm>                // std::sort, std::min, std::max
+#include <chrono>                   // std::chrono::*
+#include <cmath>                    // std::ceil
+#include <cstdint>                  // std::uint32_t
+#include <cstdlib>                  // std::strtoul
+#include <utility>                  // std::move
+#include <system_error>             // std::system_error
+#include <stdexcept>                // std::runtime_error
+#include <cerrno>                   // errno
+#include <exception>                // std::exception
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /** The samples of a cost, reported as a distribution in microseconds */
+    class SampleDistribution
+    {
+    public: // ctors/dtor
+        explicit SampleDistribution(std::string name) noexcept
+            : name_{ std::move(name) }
+        {}
+
+    public:
+        void add(const Clock::duration sample)
+        {
+            samplesUs_.push_back(std::chrono::duration<double, std::micro>(sample).count());
+        }
+
+        void report()
+        {
+            if (samplesUs_.empty())
+            {
+                MY_LOG_INFO(name_, ": no samples.");
+                return;
+            }
+
+            std::sort(samplesUs_.begin(), samplesUs_.end());
+            double sum = 0;
+            for (const auto sample : samplesUs_)
+                sum += sample;
+
+            MY_LOG_INFO(
+                name_, " over ", samplesUs_.size(), " samples (us): ",
+                "min=", samplesUs_.front(), ", ",
+                "mean=", sum / static_cast<double>(samplesUs_.size()), ", ",
+                "p50=", getPercentile(0.5), ", ",
+                "p90=", getPercentile(0.9), ", ",
+                "p99=", getPercentile(0.99), ", ",
+                "p99.9=", getPercentile(0.999), ", ",
+                "max=", samplesUs_.back()
+            );
+        }
+
+    private:
+        /** samplesUs_ must be sorted */
+        [[nodiscard]] double getPercentile(const double fraction) const noexcept
+        {
+            const auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(samplesUs_.size())));
+            return samplesUs_[std::min(std::max<std::size_t>(rank, 1), samplesUs_.size()) - 1];
+        }
+
+    private:
+        std::string name_;
+        std::vector<double> samplesUs_;
+    };
+
+
+    struct BenchCtx
+    {
+        wl_display* display = nullptr;
+        wl_registry* registry = nullptr;
+        wl_compositor* compositor = nullptr;
+        wl_shm* shm = nullptr;
+        // Absent in StandInCompositor ; then the surfaces have no roles
+        xdg_wm_base* wmBase = nullptr;
+
+    public:
+        ~BenchCtx() noexcept
+        {
+            if (wmBase != nullptr)
+                MY_LOG_WLCALL_VALUELESS(xdg_wm_base_destroy(wmBase));
+            if (shm != nullptr)
+                MY_LOG_WLCALL_VALUELESS(wl_shm_destroy(shm));
+            if (compositor != nullptr)
+                MY_LOG_WLCALL_VALUELESS(wl_compositor_destroy(compositor));
+            if (registry != nullptr)
+                MY_LOG_WLCALL_VALUELESS(wl_registry_destroy(registry));
+            if (display != nullptr)
+                MY_LOG_WLCALL_VALUELESS(wl_display_disconnect(display));
+        }
+    };
+
+
+    void dispatchOrThrow(wl_display* const display)
+    {
+        if (MY_LOG_WLCALL(wl_display_dispatch(display)) < 0)
+            throw std::system_error{errno, std::system_category(), "wl_display_dispatch failed"};
+    }
+
+    void roundtripOrThrow(wl_display* const display)
+    {
+        if (MY_LOG_WLCALL(wl_display_roundtrip(display)) < 0)
+            throw std::system_error{errno, std::system_category(), "wl_display_roundtrip failed"};
+    }
+
+
+    void bindGlobals(BenchCtx& ctx)
+    {
+        static const wl_registry_listener registryListener = {
+            // global
+            [](void* const data, wl_registry* const registry, const std::uint32_t name, const char* const interface, const std::uint32_t version) {
+                auto& ctx = *static_cast<BenchCtx*>(data);
+                const std::string_view interfaceName{ interface };
+
+                if (interfaceName == wl_compositor_interface.name)
+                    ctx.compositor = static_cast<wl_compositor*>(MY_LOG_WLCALL(wl_registry_bind(registry, name, &wl_compositor_interface, std::min<std::uint32_t>(version, 4))));
+                else if (interfaceName == wl_shm_interface.name)
+                    ctx.shm = static_cast<wl_shm*>(MY_LOG_WLCALL(wl_registry_bind(registry, name, &wl_shm_interface, 1)));
+                else if (interfaceName == xdg_wm_base_interface.name)
+                    ctx.wmBase = static_cast<xdg_wm_base*>(MY_LOG_WLCALL(wl_registry_bind(registry, name, &xdg_wm_base_interface, 1)));
+            },
+            // global_remove
+            [](void*, wl_registry*, std::uint32_t) {}
+        };
+
+        ctx.registry = MY_LOG_WLCALL(wl_display_get_registry(ctx.display));
+        if (ctx.registry == nullptr)
+            throw std::system_error{errno, std::system_category(), "wl_display_get_registry failed"};
+        (void)MY_LOG_WLCALL(wl_registry_add_listener(ctx.registry, &registryListener, &ctx));
+        roundtripOrThrow(ctx.display);
+
+        if ( (ctx.compositor == nullptr) || (ctx.shm == nullptr) )
+            throw std::runtime_error{"The compositor doesn't provide wl_compositor or wl_shm"};
+
+        if (ctx.wmBase != nullptr)
+        {
+            static const xdg_wm_base_listener wmBaseListener = {
+                [](void*, xdg_wm_base* const wmBase, const std::uint32_t serial) { MY_LOG_WLCALL_VALUELESS(xdg_wm_base_pong(wmBase, serial)); }
+            };
+            (void)MY_LOG_WLCALL(xdg_wm_base_add_listener(ctx.wmBase, &wmBaseListener, nullptr));
+        }
+    }
+
+
+    void benchmarkRoundtrips(BenchCtx& ctx, const unsigned iterations)
+    {
+        SampleDistribution roundtrips{ "wl_display_roundtrip" };
+
+        // Warming up the connection and the caches
+        for (unsigned i = 0; i < 10; ++i)
+            roundtripOrThrow(ctx.display);
+
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            const auto startedAt = Clock::now();
+            roundtripOrThrow(ctx.display);
+            roundtrips.add(Clock::now() - startedAt);
+        }
+
+        roundtrips.report();
+    }
+
+
+    /** Presents a window via 2 buffers like the app does, waiting for the frame callback of each commit */
+    void benchmarkFrameLoop(BenchCtx& ctx, const unsigned iterations)
+    {
+        constexpr int WIDTH = 256;
+        constexpr int HEIGHT = 256;
+        constexpr int STRIDE = WIDTH * 4;
+        constexpr int BUFFER_SIZE = STRIDE * HEIGHT;
+
+        SampleDistribution commitToDone{ "wl_surface_commit -> wl_callback::done" };
+        SampleDistribution commitToRelease{ "wl_surface_commit -> wl_buffer::release" };
+
+        struct Buffer
+        {
+            wl_buffer* wlBuffer = nullptr;
+            bool isBusy = false;
+            Clock::time_point committedAt;
+            SampleDistribution* releases = nullptr;
+        };
+        std::array<Buffer, 2> buffers;
+
+        auto shmBuffer = SharedMemoryBuffer::allocate(BUFFER_SIZE * buffers.size());
+        auto* const pool = MY_LOG_WLCALL(wl_shm_create_pool(ctx.shm, shmBuffer.getFd(), static_cast<std::int32_t>(shmBuffer.getSize())));
+        if (pool == nullptr)
+            throw std::system_error{errno, std::system_category(), "wl_shm_create_pool failed"};
+
+        static const wl_buffer_listener bufferListener = {
+            [](void* const data, wl_buffer*) {
+                auto& buffer = *static_cast<Buffer*>(data);
+                buffer.releases->add(Clock::now() - buffer.committedAt);
+                buffer.isBusy = false;
+            }
+        };
+        for (std::size_t i = 0; i < buffers.size(); ++i)
+        {
+            buffers[i].wlBuffer = MY_LOG_WLCALL(wl_shm_pool_create_buffer(pool, static_cast<std::int32_t>(i) * BUFFER_SIZE, WIDTH, HEIGHT, STRIDE, WL_SHM_FORMAT_XRGB8888));
+            if (buffers[i].wlBuffer == nullptr)
+                throw std::system_error{errno, std::system_category(), "wl_shm_pool_create_buffer failed"};
+            buffers[i].releases = &commitToRelease;
+            (void)MY_LOG_WLCALL(wl_buffer_add_listener(buffers[i].wlBuffer, &bufferListener, &buffers[i]));
+        }
+
+        auto* const surface = MY_LOG_WLCALL(wl_compositor_create_surface(ctx.compositor));
+        if (surface == nullptr)
+            throw std::system_error{errno, std::system_category(), "wl_compositor_create_surface failed"};
+
+        // The compositors don't present the surfaces without roles, so a toplevel is mapped if possible
+        xdg_surface* xdgSurface = nullptr;
+        xdg_toplevel* xdgToplevel = nullptr;
+        if (ctx.wmBase != nullptr)
+        {
+            static const xdg_surface_listener xdgSurfaceListener = {
+                [](void* const data, xdg_surface* const xdgSurface, const std::uint32_t serial) {
+                    MY_LOG_WLCALL_VALUELESS(xdg_surface_ack_configure(xdgSurface, serial));
+                    *static_cast<bool*>(data) = true;
+                }
+            };
+            static const xdg_toplevel_listener xdgToplevelListener = [] {
+                xdg_toplevel_listener listener{};
+                listener.configure = [](void*, xdg_toplevel*, std::int32_t, std::int32_t, wl_array*) {};
+                listener.close = [](void*, xdg_toplevel*) {};
+                return listener;
+            }();
+
+            bool isConfigured = false;
+            xdgSurface = MY_LOG_WLCALL(xdg_wm_base_get_xdg_surface(ctx.wmBase, surface));
+            (void)MY_LOG_WLCALL(xdg_surface_add_listener(xdgSurface, &xdgSurfaceListener, &isConfigured));
+            xdgToplevel = MY_LOG_WLCALL(xdg_surface_get_toplevel(xdgSurface));
+            (void)MY_LOG_WLCALL(xdg_toplevel_add_listener(xdgToplevel, &xdgToplevelListener, nullptr));
+            MY_LOG_WLCALL_VALUELESS(xdg_toplevel_set_title(xdgToplevel, "WaylandProtocolBench"));
+            MY_LOG_WLCALL_VALUELESS(wl_surface_commit(surface));
+            while (!isConfigured)
+                dispatchOrThrow(ctx.display);
+        }
+
+        static const wl_callback_listener frameListener = {
+            [](void* const data, wl_callback*, std::uint32_t) {
+                *static_cast<std::optional<Clock::time_point>*>(data) = Clock::now();
+            }
+        };
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            auto& buffer = buffers[i % buffers.size()];
+            while (buffer.isBusy)
+                dispatchOrThrow(ctx.display);
+
+            std::optional<Clock::time_point> doneAt;
+            auto* const frameCallback = MY_LOG_WLCALL(wl_surface_frame(surface));
+            (void)MY_LOG_WLCALL(wl_callback_add_listener(frameCallback, &frameListener, &doneAt));
+
+            MY_LOG_WLCALL_VALUELESS(wl_surface_attach(surface, buffer.wlBuffer, 0, 0));
+            MY_LOG_WLCALL_VALUELESS(wl_surface_damage_buffer(surface, 0, 0, WIDTH, HEIGHT));
+            buffer.isBusy = true;
+            buffer.committedAt = Clock::now();
+            MY_LOG_WLCALL_VALUELESS(wl_surface_commit(surface));
+            (void)MY_LOG_WLCALL(wl_display_flush(ctx.display));
+
+            while (!doneAt.has_value())
+                dispatchOrThrow(ctx.display);
+            commitToDone.add(*doneAt - buffer.committedAt);
+            MY_LOG_WLCALL_VALUELESS(wl_callback_destroy(frameCallback));
+        }
+        // The releases of the last buffers
+        roundtripOrThrow(ctx.display);
+
+        if (xdgToplevel != nullptr)
+            MY_LOG_WLCALL_VALUELESS(xdg_toplevel_destroy(xdgToplevel));
+        if (xdgSurface != nullptr)
+            MY_LOG_WLCALL_VALUELESS(xdg_surface_destroy(xdgSurface));
+        MY_LOG_WLCALL_VALUELESS(wl_surface_destroy(surface));
+        for (auto& buffer : buffers)
+            MY_LOG_WLCALL_VALUELESS(wl_buffer_destroy(buffer.wlBuffer));
+        MY_LOG_WLCALL_VALUELESS(wl_shm_pool_destroy(pool));
+        roundtripOrThrow(ctx.display);
+
+        commitToDone.report();
+        commitToRelease.report();
+    }
+
+
+    /** The server side maps the pool at wl_shm_create_pool, so the roundtrip includes it */
+    void benchmarkBufferCreation(BenchCtx& ctx, const unsigned iterations)
+    {
+        struct Size
+        {
+            int width;
+            int height;
+        };
+        constexpr std::array<Size, 5> SIZES = {{ {64, 64}, {256, 256}, {1280, 720}, {1920, 1080}, {3840, 2160} }};
+
+        auto shmBuffer = SharedMemoryBuffer::allocate(static_cast<std::size_t>(SIZES.back().width) * SIZES.back().height * 4);
+
+        for (const auto& size : SIZES)
+        {
+            const auto prefix = "wl_shm_pool_create_buffer " + std::to_string(size.width) + "x" + std::to_string(size.height);
+            SampleDistribution clientSide{ prefix + " (client side)" };
+            SampleDistribution withServerSide{ prefix + " (up to a roundtrip)" };
+
+            const int stride = size.width * 4;
+            for (unsigned i = 0; i < iterations; ++i)
+            {
+                const auto startedAt = Clock::now();
+                auto* const pool = MY_LOG_WLCALL(wl_shm_create_pool(ctx.shm, shmBuffer.getFd(), stride * size.height));
+                auto* const buffer = MY_LOG_WLCALL(wl_shm_pool_create_buffer(pool, 0, size.width, size.height, stride, WL_SHM_FORMAT_XRGB8888));
+                const auto createdAt = Clock::now();
+                roundtripOrThrow(ctx.display);
+                const auto roundtripedAt = Clock::now();
+
+                if ( (pool == nullptr) || (buffer == nullptr) )
+                    throw std::system_error{errno, std::system_category(), "Failed to create a wl_shm_pool or a wl_buffer"};
+                clientSide.add(createdAt - startedAt);
+                withServerSide.add(roundtripedAt - startedAt);
+
+                MY_LOG_WLCALL_VALUELESS(wl_buffer_destroy(buffer));
+                MY_LOG_WLCALL_VALUELESS(wl_shm_pool_destroy(pool));
+            }
+
+            clientSide.report();
+            withServerSide.report();
+        }
+    }
+} // namespace
+
+
+int main(const int argc, char* argv[])
+{
+    bool useStandIn = false;
+    unsigned iterations = 1000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{ argv[i] };
+        if (arg == "--stand-in")
+            useStandIn = true;
+        else if (arg.rfind("--iterations=", 0) == 0)
+            iterations = static_cast<unsigned>(std::max(1ul, std::strtoul(argv[i] + std::string_view{"--iterations="}.size(), nullptr, 10)));
+        else
+        {
+            MY_LOG_ERROR("Unknown argument \"", arg, "\". Usage: ", argv[0], " [--stand-in] [--iterations=N]");
+            return 2;
+        }
+    }
+
+    try
+    {
+        // Declared first, so the connection is closed before the stand-in compositor is stopped
+        std::optional<StandInCompositor> standIn;
+        BenchCtx ctx;
+        if (useStandIn)
+        {
+            MY_LOG_INFO("Running against the in-process stand-in compositor...");
+            standIn.emplace();
+            ctx.display = MY_LOG_WLCALL(wl_display_connect_to_fd(standIn->takeClientFd()));
+        }
+        else
+        {
+            MY_LOG_INFO("Running against the compositor of $WAYLAND_DISPLAY...");
+            ctx.display = MY_LOG_WLCALL(wl_display_connect(nullptr));
+        }
+        if (ctx.display == nullptr)
+        {
+            MY_LOG_ERROR("Failed to connect to the compositor. Start a headless one, e.g. \"weston --backend=headless -S wayland-bench\", "
+                         "and set WAYLAND_DISPLAY=wayland-bench, or pass --stand-in.");
+            return 1;
+        }
+
+        bindGlobals(ctx);
+        benchmarkRoundtrips(ctx, iterations);
+        benchmarkFrameLoop(ctx, iterations);
+        benchmarkBufferCreation(ctx, std::max(iterations / 10, 10u));
+    }
+    catch (const std::exception& err)
+    {
+        MY_LOG_ERROR("Caught an exception: \"", err.what(), "\".");
+        return 1;
+    }
+
+    return 0;
+}
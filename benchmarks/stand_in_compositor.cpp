@@ -0,0 +1,262 @@
+#include "stand_in_compositor.h"
+#include <wayland-server.h>     // wl_display_*, wl_resource_*, wl_*_interface, wl_*_send_*
+#include <thread>               // std::thread
+#include <atomic>               // std::atomic
+#include <vector>               // std::vector
+#include <system_error>         // std::system_error
+#include <cerrno>               // errno
+#include <cstdint>              // std::uint32_t, std::uint64_t
+#include <ctime>                // clock_gettime, CLOCK_MONOTONIC
+#include <sys/socket.h>         // socketpair
+#include <sys/eventfd.h>        // eventfd
+#include <unistd.h>             // close, write
+
+
+namespace
+{
+    struct Surface;
+
+    // Standard layout, so the wl_listener* passed to notify is a pointer to it as well
+    struct BufferDestroyedListener
+    {
+        wl_listener listener;
+        Surface* surface;
+    };
+
+    struct Surface
+    {
+        wl_resource* resource = nullptr;
+
+        // Reset if the client destroys the buffer before committing it
+        wl_resource* pendingBuffer = nullptr;
+        BufferDestroyedListener pendingBufferDestroyed{ {}, this };
+
+        std::vector<wl_resource*> pendingFrameCallbacks;
+
+    public:
+        void setPendingBuffer(wl_resource* const buffer) noexcept
+        {
+            if (pendingBuffer != nullptr)
+                wl_list_remove(&pendingBufferDestroyed.listener.link);
+
+            pendingBuffer = buffer;
+            if (pendingBuffer != nullptr)
+            {
+                pendingBufferDestroyed.listener.notify = [](wl_listener* const listener, void*) {
+                    auto& self = *reinterpret_cast<BufferDestroyedListener*>(listener)->surface;
+                    wl_list_remove(&self.pendingBufferDestroyed.listener.link);
+                    self.pendingBuffer = nullptr;
+                };
+                wl_resource_add_destroy_listener(pendingBuffer, &pendingBufferDestroyed.listener);
+            }
+        }
+    };
+
+    [[nodiscard]] std::uint32_t nowMs() noexcept
+    {
+        timespec now{};
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint32_t>(static_cast<std::uint64_t>(now.tv_sec) * 1000 + static_cast<std::uint64_t>(now.tv_nsec) / 1'000'000);
+    }
+
+    void destroyResource(wl_client*, wl_resource* const resource)
+    {
+        wl_resource_destroy(resource);
+    }
+
+    // The interfaces are filled field by field: the newer libwayland versions add the requests of the newer versions
+    const struct wl_region_interface REGION_IMPL = [] {
+        struct wl_region_interface impl{};
+        impl.destroy = &destroyResource;
+        impl.add = [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {};
+        impl.subtract = [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {};
+        return impl;
+    }();
+
+    const struct wl_surface_interface SURFACE_IMPL = [] {
+        struct wl_surface_interface impl{};
+        impl.destroy = &destroyResource;
+        impl.attach = [](wl_client*, wl_resource* const resource, wl_resource* const buffer, int32_t, int32_t) {
+            static_cast<Surface*>(wl_resource_get_user_data(resource))->setPendingBuffer(buffer);
+        };
+        impl.damage = [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {};
+        impl.frame = [](wl_client* const client, wl_resource* const resource, const uint32_t callbackId) {
+            auto* const callback = wl_resource_create(client, &wl_callback_interface, 1, callbackId);
+            if (callback == nullptr)
+            {
+                wl_client_post_no_memory(client);
+                return;
+            }
+            wl_resource_set_implementation(callback, nullptr, nullptr, nullptr);
+            static_cast<Surface*>(wl_resource_get_user_data(resource))->pendingFrameCallbacks.push_back(callback);
+        };
+        impl.set_opaque_region = [](wl_client*, wl_resource*, wl_resource*) {};
+        impl.set_input_region = [](wl_client*, wl_resource*, wl_resource*) {};
+        // "Presents" the buffer right away
+        impl.commit = [](wl_client*, wl_resource* const resource) {
+            auto& surface = *static_cast<Surface*>(wl_resource_get_user_data(resource));
+
+            if (surface.pendingBuffer != nullptr)
+            {
+                wl_buffer_send_release(surface.pendingBuffer);
+                surface.setPendingBuffer(nullptr);
+            }
+
+            const auto timeMs = nowMs();
+            for (auto* const callback : surface.pendingFrameCallbacks)
+            {
+                wl_callback_send_done(callback, timeMs);
+                wl_resource_destroy(callback);
+            }
+            surface.pendingFrameCallbacks.clear();
+        };
+        impl.set_buffer_transform = [](wl_client*, wl_resource*, int32_t) {};
+        impl.set_buffer_scale = [](wl_client*, wl_resource*, int32_t) {};
+        impl.damage_buffer = [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {};
+        return impl;
+    }();
+
+    const struct wl_compositor_interface COMPOSITOR_IMPL = [] {
+        struct wl_compositor_interface impl{};
+        impl.create_surface = [](wl_client* const client, wl_resource* const resource, const uint32_t id) {
+            auto* const surfaceResource = wl_resource_create(client, &wl_surface_interface, wl_resource_get_version(resource), id);
+            if (surfaceResource == nullptr)
+            {
+                wl_client_post_no_memory(client);
+                return;
+            }
+            auto* const surface = new Surface{};
+            surface->resource = surfaceResource;
+            wl_resource_set_implementation(surfaceResource, &SURFACE_IMPL, surface, [](wl_resource* const resource) {
+                auto* const surface = static_cast<Surface*>(wl_resource_get_user_data(resource));
+                surface->setPendingBuffer(nullptr);
+                // The pending callbacks are destroyed by the client (or with it)
+                delete surface;
+            });
+        };
+        impl.create_region = [](wl_client* const client, wl_resource*, const uint32_t id) {
+            auto* const region = wl_resource_create(client, &wl_region_interface, 1, id);
+            if (region == nullptr)
+            {
+                wl_client_post_no_memory(client);
+                return;
+            }
+            wl_resource_set_implementation(region, &REGION_IMPL, nullptr, nullptr);
+        };
+        return impl;
+    }();
+} // namespace
+
+
+struct StandInCompositor::Impl
+{
+    wl_display* display = nullptr;
+    int clientFd = -1;
+    // Wakes the compositor thread up to stop it
+    int stopFd = -1;
+    std::atomic<bool> isStopping{ false };
+    std::thread thread;
+};
+
+
+StandInCompositor::StandInCompositor()
+    : impl_{ std::make_unique<Impl>() }
+{
+    auto& impl = *impl_;
+
+    impl.display = wl_display_create();
+    if (impl.display == nullptr)
+        throw std::system_error{errno, std::system_category(), "StandInCompositor: wl_display_create failed"};
+
+    if (wl_display_init_shm(impl.display) != 0)
+    {
+        const auto savedErrno = errno;
+        wl_display_destroy(impl.display);
+        throw std::system_error{savedErrno, std::system_category(), "StandInCompositor: wl_display_init_shm failed"};
+    }
+
+    const auto bindCompositor = [](wl_client* const client, void*, const uint32_t version, const uint32_t id) {
+        auto* const resource = wl_resource_create(client, &wl_compositor_interface, static_cast<int>(version), id);
+        if (resource == nullptr)
+        {
+            wl_client_post_no_memory(client);
+            return;
+        }
+        wl_resource_set_implementation(resource, &COMPOSITOR_IMPL, nullptr, nullptr);
+    };
+    // wl_surface v4 has damage_buffer, which is what the app uses
+    if (wl_global_create(impl.display, &wl_compositor_interface, 4, nullptr, bindCompositor) == nullptr)
+    {
+        const auto savedErrno = errno;
+        wl_display_destroy(impl.display);
+        throw std::system_error{savedErrno, std::system_category(), "StandInCompositor: wl_global_create failed"};
+    }
+
+    int fds[2] = { -1, -1 };
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+        const auto savedErrno = errno;
+        wl_display_destroy(impl.display);
+        throw std::system_error{savedErrno, std::system_category(), "StandInCompositor: socketpair failed"};
+    }
+    // Owns fds[0] from here on
+    if (wl_client_create(impl.display, fds[0]) == nullptr)
+    {
+        const auto savedErrno = errno;
+        (void)close(fds[0]);
+        (void)close(fds[1]);
+        wl_display_destroy(impl.display);
+        throw std::system_error{savedErrno, std::system_category(), "StandInCompositor: wl_client_create failed"};
+    }
+    impl.clientFd = fds[1];
+
+    impl.stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (impl.stopFd < 0)
+    {
+        const auto savedErrno = errno;
+        (void)close(impl.clientFd);
+        wl_display_destroy(impl.display);
+        throw std::system_error{savedErrno, std::system_category(), "StandInCompositor: eventfd failed"};
+    }
+    (void)wl_event_loop_add_fd(
+        wl_display_get_event_loop(impl.display),
+        impl.stopFd,
+        WL_EVENT_READABLE,
+        [](int, uint32_t, void* const data) {
+            static_cast<Impl*>(data)->isStopping = true;
+            return 0;
+        },
+        &impl
+    );
+
+    impl.thread = std::thread{ [&impl] {
+        auto* const eventLoop = wl_display_get_event_loop(impl.display);
+        while (!impl.isStopping)
+        {
+            wl_display_flush_clients(impl.display);
+            (void)wl_event_loop_dispatch(eventLoop, -1);
+        }
+    } };
+}
+
+StandInCompositor::~StandInCompositor() noexcept
+{
+    auto& impl = *impl_;
+
+    const std::uint64_t one = 1;
+    (void)write(impl.stopFd, &one, sizeof(one));
+    impl.thread.join();
+
+    // Destroys the client (if it's still connected) and all its resources
+    wl_display_destroy(impl.display);
+    (void)close(impl.stopFd);
+    if (impl.clientFd != -1)
+        (void)close(impl.clientFd);
+}
+
+int StandInCompositor::takeClientFd() noexcept
+{
+    const int result = impl_->clientFd;
+    impl_->clientFd = -1;
+    return result;
+}
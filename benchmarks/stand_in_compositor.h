@@ -0,0 +1,38 @@
+#ifndef WAYLAND_INPUT_WINDOW_STAND_IN_COMPOSITOR_H
+#define WAYLAND_INPUT_WINDOW_STAND_IN_COMPOSITOR_H
+
+#include <memory>               // std::unique_ptr
+
+
+/**
+ * A minimal compositor running in-process on its own thread, for the benchmarks: wl_compositor (the surfaces have
+ *   no roles) and wl_shm.
+ * It does nothing but the protocol: the committed buffers are released and the frame callbacks are done right at
+ *   wl_surface::commit, so the latencies measured against it are the costs of libwayland, of the kernel and of the
+ *   client only.
+ * It serves a single client, connected via a socket pair.
+ */
+class StandInCompositor
+{
+public: // ctors/dtor
+    /** @throws std::system_error */
+    StandInCompositor();
+
+    StandInCompositor(const StandInCompositor&) = delete;
+
+    ~StandInCompositor() noexcept;
+
+public: // assignments
+    StandInCompositor& operator=(const StandInCompositor&) = delete;
+
+public:
+    /** The client end of the connection (for wl_display_connect_to_fd, which takes the ownership) ; -1 once taken */
+    [[nodiscard]] int takeClientFd() noexcept;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_STAND_IN_COMPOSITOR_H
@@ -0,0 +1,145 @@
+#ifndef WAYLAND_INPUT_WINDOW_BLOCKED_IMAGE_H
+#define WAYLAND_INPUT_WINDOW_BLOCKED_IMAGE_H
+
+#include <vector>           // std::vector
+#include <algorithm>        // std::min
+#include <cstring>          // std::memcpy
+#include <cstddef>          // std::size_t, std::byte
+#include <cstdint>          // std::uint32_t, std::uintptr_t
+
+
+/**
+ * An XRGB8888 image stored in blocks of 8x8 pixels, the blocks row by row. A block is 256 bytes, i.e. 4 cache lines,
+ *   aligned to them.
+ * The pixels around any pixel are within a few cache lines whatever the direction, so walking the image along
+ *   a rotated line (see resampleAffineNearest) reads each block for ~8 pixels in a row, while a linear image would take
+ *   a new cache line (and soon a new page) for almost every pixel.
+ * The image is written by the row-oriented code (the tile decoders, the ink) via a linear band of up to 8 rows, which stays
+ *   in the caches and is then scattered into the blocks.
+ */
+class BlockedImage
+{
+public:
+    static constexpr std::size_t BLOCK_SIDE = 8;
+    static constexpr std::size_t BLOCK_PIXELS = BLOCK_SIDE * BLOCK_SIDE;
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+public:
+    /** The content is undefined afterwards ; the memory is kept for the next frames */
+    void resize(const std::size_t width, const std::size_t height)
+    {
+        width_ = width;
+        height_ = height;
+        blocksPerRow_ = (width + BLOCK_SIDE - 1) / BLOCK_SIDE;
+        const std::size_t blocksCount = blocksPerRow_ * ((height + BLOCK_SIDE - 1) / BLOCK_SIDE);
+
+        // Over-allocated, so the blocks can start at a cache line
+        storage_.resize(blocksCount * BLOCK_PIXELS + CACHE_LINE_SIZE / sizeof(std::uint32_t));
+        const auto misalignment = reinterpret_cast<std::uintptr_t>(storage_.data()) % CACHE_LINE_SIZE;
+        blocks_ = storage_.data() + ( (misalignment == 0) ? 0 : (CACHE_LINE_SIZE - misalignment) / sizeof(std::uint32_t) );
+    }
+
+    /** Releases the memory, e.g. under the memory pressure */
+    void clear() noexcept
+    {
+        storage_ = {};
+        band_ = {};
+        blocks_ = nullptr;
+        width_ = height_ = blocksPerRow_ = 0;
+    }
+
+    /**
+     * Writes the rect [x; x + width) x [y; y + height) via writeRows(rowsBegin, rowsCount, dst, dstStrideBytes),
+     *   which must write the rows [rowsBegin; rowsBegin + rowsCount) of the rect into dst as the linear ones
+     */
+    template<typename WriteRows>
+    void writeRect(const std::size_t x, const std::size_t y, const std::size_t width, const std::size_t height, WriteRows&& writeRows)
+    {
+        band_.resize(BLOCK_SIDE * width);
+
+        std::size_t rowsCount = 0;
+        for (std::size_t rowsBegin = 0; rowsBegin < height; rowsBegin += rowsCount)
+        {
+            // Up to the next row of the blocks
+            rowsCount = std::min(height - rowsBegin, BLOCK_SIDE - (y + rowsBegin) % BLOCK_SIDE);
+
+            writeRows(rowsBegin, rowsCount, reinterpret_cast<std::byte*>(band_.data()), width * sizeof(band_[0]));
+            storeBand(x, y + rowsBegin, width, rowsCount);
+        }
+    }
+
+    /** Passes all the rows to updateRows(rowsBegin, rowsCount, rows, strideBytes) as the linear ones and stores them back */
+    template<typename UpdateRows>
+    void updateRows(UpdateRows&& updateRows)
+    {
+        band_.resize(BLOCK_SIDE * width_);
+
+        for (std::size_t rowsBegin = 0; rowsBegin < height_; rowsBegin += BLOCK_SIDE)
+        {
+            const std::size_t rowsCount = std::min(height_ - rowsBegin, BLOCK_SIDE);
+
+            loadBand(0, rowsBegin, width_, rowsCount);
+            updateRows(rowsBegin, rowsCount, reinterpret_cast<std::byte*>(band_.data()), width_ * sizeof(band_[0]));
+            storeBand(0, rowsBegin, width_, rowsCount);
+        }
+    }
+
+public: // getters
+    [[nodiscard]] std::size_t getWidth() const noexcept { return width_; }
+    [[nodiscard]] std::size_t getHeight() const noexcept { return height_; }
+    [[nodiscard]] std::size_t getAllocatedBytes() const noexcept
+    {
+        return (storage_.capacity() + band_.capacity()) * sizeof(std::uint32_t);
+    }
+
+    [[nodiscard]] std::uint32_t at(const std::size_t x, const std::size_t y) const noexcept
+    {
+        return blocks_[getIndex(x, y)];
+    }
+
+private:
+    /** The rows of band_ (width pixels each) into [x; x + width) x [y; y + rowsCount) ; they're in a single row of the blocks */
+    void storeBand(const std::size_t x, const std::size_t y, const std::size_t width, const std::size_t rowsCount) noexcept
+    {
+        for (std::size_t row = 0; row < rowsCount; ++row)
+        {
+            const std::uint32_t* const src = band_.data() + row * width;
+            // Up to a block boundary at a time
+            for (std::size_t i = 0, n = 0; i < width; i += n)
+            {
+                n = std::min(width - i, BLOCK_SIDE - (x + i) % BLOCK_SIDE);
+                std::memcpy(blocks_ + getIndex(x + i, y + row), src + i, n * sizeof(*src));
+            }
+        }
+    }
+
+    void loadBand(const std::size_t x, const std::size_t y, const std::size_t width, const std::size_t rowsCount) noexcept
+    {
+        for (std::size_t row = 0; row < rowsCount; ++row)
+        {
+            std::uint32_t* const dst = band_.data() + row * width;
+            for (std::size_t i = 0, n = 0; i < width; i += n)
+            {
+                n = std::min(width - i, BLOCK_SIDE - (x + i) % BLOCK_SIDE);
+                std::memcpy(dst + i, blocks_ + getIndex(x + i, y + row), n * sizeof(*dst));
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t getIndex(const std::size_t x, const std::size_t y) const noexcept
+    {
+        return ( (y / BLOCK_SIDE) * blocksPerRow_ + x / BLOCK_SIDE ) * BLOCK_PIXELS + (y % BLOCK_SIDE) * BLOCK_SIDE + x % BLOCK_SIDE;
+    }
+
+private:
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::size_t blocksPerRow_ = 0;
+    std::vector<std::uint32_t> storage_;
+    std::uint32_t* blocks_ = nullptr;
+    // The linear rows being written into the blocks, up to BLOCK_SIDE of them
+    std::vector<std::uint32_t> band_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_BLOCKED_IMAGE_H
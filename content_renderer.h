@@ -0,0 +1,185 @@
+#ifndef WAYLAND_INPUT_WINDOW_CONTENT_RENDERER_H
+#define WAYLAND_INPUT_WINDOW_CONTENT_RENDERER_H
+
+#include "utilities.h"      // floorDiv
+#include "tile_cache.h"     // TileKey, PersistentTileStore, fillPixels
+#include "zoom_kernels.h"   // ZoomKernel
+#include <cstdint>          // std::uint*_t, std::int64_t
+#include <cstddef>          // std::size_t
+#include <cstring>          // std::memcpy
+#include <cmath>            // std::floor, std::abs
+#include <algorithm>        // std::min, std::find
+#include <vector>           // std::vector
+
+
+// Identifies the content rendered by renderContentTile. Must be changed whenever the output of the latter changes
+//   (otherwise the persistent tiles cache will keep serving the outdated tiles).
+inline constexpr std::uint64_t MAIN_WINDOW_CONTENT_ID = TileKey::makeContentId("chessboard;cell=60px;v2");
+
+// The chess board pattern
+inline constexpr std::int64_t CONTENT_CELL_SIDE = 60 /*px*/;
+inline constexpr std::uint32_t CONTENT_PURE_BLACK = 0xFF000000;
+inline constexpr std::uint32_t CONTENT_SILVER     = 0xFFC0C0C0;
+
+
+/** Renders count pixels of the content row srcY starting at the content point srcX (i.e. without any zoom) */
+inline void renderContentSpan(std::int64_t srcX, const std::int64_t srcY, std::size_t count, std::uint32_t* dst) noexcept
+{
+    const bool rowIsEven = ( (floorDiv(srcY, CONTENT_CELL_SIDE) % 2) == 0 );
+
+    // Filling cell by cell
+    while (count > 0)
+    {
+        const auto cell = floorDiv(srcX, CONTENT_CELL_SIDE);
+        const auto n = std::min<std::size_t>(count, static_cast<std::size_t>((cell + 1) * CONTENT_CELL_SIDE - srcX));
+        const bool columnIsEven = ( (cell % 2) == 0 );
+
+        fillPixels(dst, n, (columnIsEven == rowIsEven) ? CONTENT_PURE_BLACK : CONTENT_SILVER);
+
+        srcX += static_cast<std::int64_t>(n);
+        dst += n;
+        count -= n;
+    }
+}
+
+
+/**
+ * Renders the tile of the zoomed content space for an arbitrary zoom.
+ * The zoomed content pixel u shows the content point floor(u / zoom + 0.5).
+ */
+inline void renderContentTileGeneric(const TileKey& key, const double sideZoom, std::uint32_t* const dstPixels)
+{
+    constexpr std::size_t tileSide = PersistentTileStore::TILE_SIDE;
+
+    const auto toSource = [sideZoom](const std::int64_t zoomed) {
+        return static_cast<std::int64_t>(std::floor(static_cast<double>(zoomed) / sideZoom + 0.5));
+    };
+
+    // The pattern is separable, so the parities of the cells are computed once per column and once per row
+    bool columnIsEven[tileSide];
+    for (std::size_t x = 0; x < tileSide; ++x)
+    {
+        const auto srcXGlobal = toSource(static_cast<std::int64_t>(key.tileX) * static_cast<std::int64_t>(tileSide) + static_cast<std::int64_t>(x));
+        columnIsEven[x] = ( (floorDiv(srcXGlobal, CONTENT_CELL_SIDE) % 2) == 0 );
+    }
+
+    for (std::size_t y = 0; y < tileSide; ++y)
+    {
+        const auto srcYGlobal = toSource(static_cast<std::int64_t>(key.tileY) * static_cast<std::int64_t>(tileSide) + static_cast<std::int64_t>(y));
+        const bool rowIsEven = ( (floorDiv(srcYGlobal, CONTENT_CELL_SIDE) % 2) == 0 );
+
+        std::uint32_t* const dstRow = dstPixels + y * tileSide;
+        for (std::size_t x = 0; x < tileSide; ++x)
+            dstRow[x] = (columnIsEven[x] == rowIsEven) ? CONTENT_PURE_BLACK : CONTENT_SILVER;
+    }
+}
+
+
+/** Content rows of the same class are identical ; for the chess board it's the parity of the cells row */
+inline std::int64_t getContentRowClass(const std::int64_t srcY) noexcept
+{
+    return (floorDiv(srcY, CONTENT_CELL_SIDE) % 2 == 0) ? 0 : 1;
+}
+
+
+/**
+ * Renders the tile of the zoomed content space for the zoom ratio of Kernel.
+ * A content row is rendered at 1:1 and then resampled by the kernel only once per its class ; all the other zoomed
+ *   rows of the same class are just copied.
+ */
+template<typename Kernel>
+void renderContentTileVia(const TileKey& key, std::uint32_t* const dstPixels)
+{
+    constexpr std::size_t tileSide = PersistentTileStore::TILE_SIDE;
+
+    const auto u0 = static_cast<std::int64_t>(key.tileX) * static_cast<std::int64_t>(tileSide);
+    const auto srcX0 = Kernel::toSource(u0);
+    const auto srcCount = Kernel::getSourceCount(u0, tileSide);
+
+    // Reused by the tiles rendered by the same thread ; at most TILE_SIDE * Den + 1 pixels
+    static thread_local std::vector<std::uint32_t> srcRow;
+    srcRow.resize(srcCount);
+
+    // The zoomed rows already rendered by the class of their content rows
+    constexpr std::size_t maxRowClasses = 2;
+    std::int64_t renderedRowClasses[maxRowClasses] = {};
+    const std::uint32_t* renderedRows[maxRowClasses] = {};
+    std::size_t renderedRowsCount = 0;
+
+    for (std::size_t y = 0; y < tileSide; ++y)
+    {
+        std::uint32_t* const dstRow = dstPixels + y * tileSide;
+
+        const auto srcY = Kernel::toSource(static_cast<std::int64_t>(key.tileY) * static_cast<std::int64_t>(tileSide) + static_cast<std::int64_t>(y));
+        const auto rowClass = getContentRowClass(srcY);
+
+        const auto renderedRowIdx = static_cast<std::size_t>(
+            std::find(renderedRowClasses, renderedRowClasses + renderedRowsCount, rowClass) - renderedRowClasses
+        );
+        if (renderedRowIdx < renderedRowsCount)
+        {
+            std::memcpy(dstRow, renderedRows[renderedRowIdx], tileSide * sizeof(*dstRow));
+            continue;
+        }
+
+        renderContentSpan(srcX0, srcY, srcCount, srcRow.data());
+        Kernel::resampleRow(srcRow.data(), u0, dstRow, tileSide);
+
+        if (renderedRowsCount < maxRowClasses)
+        {
+            renderedRowClasses[renderedRowsCount] = rowClass;
+            renderedRows[renderedRowsCount] = dstRow;
+            ++renderedRowsCount;
+        }
+    }
+}
+
+
+using ContentTileRenderer = void (*)(const TileKey& key, std::uint32_t* dstPixels);
+
+/** The specialized renderer for exactly this zoom or nullptr (renderContentTileGeneric is the one then) */
+inline ContentTileRenderer findContentTileKernel(const double sideZoom) noexcept
+{
+    if (sideZoom == ZoomKernel<1, 1>::ZOOM)
+        return &renderContentTileVia< ZoomKernel<1, 1> >;
+    if (sideZoom == ZoomKernel<2, 1>::ZOOM)
+        return &renderContentTileVia< ZoomKernel<2, 1> >;
+    if (sideZoom == ZoomKernel<4, 1>::ZOOM)
+        return &renderContentTileVia< ZoomKernel<4, 1> >;
+    if (sideZoom == ZoomKernel<1, 2>::ZOOM)
+        return &renderContentTileVia< ZoomKernel<1, 2> >;
+    return nullptr;
+}
+
+
+// The relative distance within which a zoom is snapped to the one of a kernel: the error accumulated by the zoom
+//   steps is way below it, while a pinch just sticks to the preset for a moment
+inline constexpr double SIDE_ZOOM_SNAP_TOLERANCE = 0.02;
+
+/**
+ * The zoom of the kernel closest to sideZoom if it's within the tolerance, sideZoom itself otherwise.
+ * The zooms are snapped where they're changed (see ContentState), so the tiles are rendered, cached and composed
+ *   at the snapped zoom and the kernels are actually reached.
+ */
+inline double snapSideZoomToKernel(const double sideZoom, const double relativeTolerance = SIDE_ZOOM_SNAP_TOLERANCE) noexcept
+{
+    for (const double preset : { ZoomKernel<1, 1>::ZOOM, ZoomKernel<2, 1>::ZOOM, ZoomKernel<4, 1>::ZOOM, ZoomKernel<1, 2>::ZOOM })
+    {
+        if (std::abs(sideZoom - preset) <= preset * relativeTolerance)
+            return preset;
+    }
+    return sideZoom;
+}
+
+
+/** Renders the tile of the zoomed content space, using the specialized kernels for the common zoom presets */
+inline void renderContentTile(const TileKey& key, const double sideZoom, std::uint32_t* const dstPixels)
+{
+    if (const auto kernel = findContentTileKernel(sideZoom); kernel != nullptr)
+        return kernel(key, dstPixels);
+
+    return renderContentTileGeneric(key, sideZoom, dstPixels);
+}
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_CONTENT_RENDERER_H
@@ -0,0 +1,194 @@
+#ifndef WAYLAND_INPUT_WINDOW_CONTENT_STATE_H
+#define WAYLAND_INPUT_WINDOW_CONTENT_STATE_H
+
+#include "content_renderer.h"   // snapSideZoomToKernel
+#include <utility>              // std::pair
+#include <algorithm>            // std::clamp
+#include <cmath>                // std::sqrt, std::sin, std::cos, std::remainder
+#include <numbers>              // std::numbers::pi, std::numbers::sqrt2
+
+
+/**
+ * What part of the content a window shows: the pan, the zoom and the rotation of its viewport.
+ * The modifiers return the changed copies, so e.g. the state at the beginning of a gesture can be kept aside.
+ */
+struct ContentState
+{
+    double viewportOffsetX = 0;
+    double viewportOffsetY = 0;
+
+    // (0; +inf). 1.0 means normal zoom (100%), 0.5 - 50%, 2.0 - 200%, etc.
+    double viewportZoom = 1;
+    // The point is in the unrotated viewport local coordinate system (see toUnrotatedLocal), so it's within
+    //   the range [0; width) unless the viewport is rotated
+    double viewportZoomCenterLocalX = 0;
+    // Likewise, within the range [0; height) unless the viewport is rotated
+    double viewportZoomCenterLocalY = 0;
+
+    // (-pi; pi] radians, clockwise on the screen. The viewport shows the unrotated one (which the offset and the zoom
+    //   above apply to) rotated around the center, which is in the viewport local coordinate system
+    double viewportRotation = 0;
+    double viewportRotationCenterLocalX = 0;
+    double viewportRotationCenterLocalY = 0;
+
+public:
+    // Four steps double the side zoom, so the steps from 100% land on the zooms of the kernels (see snapSideZoomToKernel)
+    static constexpr double ZOOM_FACTOR = std::numbers::sqrt2;
+    static constexpr double MIN_ZOOM = 1.0 / 64;
+    static constexpr double MAX_ZOOM = 64;
+
+public: // modifiers
+    ContentState movedFor(double offsetX, double offsetY) const;
+
+    ContentState zoomedIn(double zoomFactor = ZOOM_FACTOR) const;
+    ContentState zoomedIn(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor = ZOOM_FACTOR) const;
+
+    ContentState zoomedOut(double zoomFactor = ZOOM_FACTOR) const;
+    ContentState zoomedOut(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor = ZOOM_FACTOR) const;
+
+    ContentState restoredZoom() const;
+
+    // Multiplies the zoom by zoomFactor keeping the content point under (zoomCenterX; zoomCenterY) in place
+    ContentState zoomedAround(double zoomCenterX, double zoomCenterY, double zoomFactor) const;
+
+    // Rotates the content by angle (radians, clockwise) keeping the content point under (centerX; centerY) in place
+    ContentState rotatedAround(double centerX, double centerY, double angle) const;
+
+public: // getters
+    // The point of the unrotated viewport shown at the viewport local point (x; y) ; (x; y) itself if not rotated
+    std::pair<double, double> toUnrotatedLocal(double x, double y) const noexcept;
+    // The inverse of toUnrotatedLocal
+    std::pair<double, double> toRotatedLocal(double x, double y) const noexcept;
+
+private:
+    // zoomedAround with the center in the unrotated viewport local coordinate system
+    ContentState zoomedAroundUnrotated(double zoomCenterX, double zoomCenterY, double zoomFactor) const;
+};
+
+bool operator==(const ContentState& lhs, const ContentState& rhs) noexcept;
+bool operator!=(const ContentState& lhs, const ContentState& rhs) noexcept;
+
+
+inline ContentState ContentState::movedFor(double offsetX, double offsetY) const
+{
+    // The offset is along the unrotated viewport
+    const double cosine = std::cos(viewportRotation);
+    const double sine = std::sin(viewportRotation);
+
+    ContentState result = *this;
+    result.viewportOffsetX += cosine * offsetX + sine * offsetY;
+    result.viewportOffsetY += cosine * offsetY - sine * offsetX;
+    return result;
+}
+
+inline ContentState ContentState::zoomedIn(double zoomFactor) const
+{
+    return zoomedAroundUnrotated(viewportZoomCenterLocalX, viewportZoomCenterLocalY, zoomFactor);
+}
+
+inline ContentState ContentState::zoomedIn(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor) const
+{
+    return zoomedAround(newZoomCenterX, newZoomCenterY, zoomFactor);
+}
+
+inline ContentState ContentState::zoomedOut(double zoomFactor) const
+{
+    return zoomedAroundUnrotated(viewportZoomCenterLocalX, viewportZoomCenterLocalY, 1 / zoomFactor);
+}
+
+inline ContentState ContentState::zoomedOut(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor) const
+{
+    return zoomedAround(newZoomCenterX, newZoomCenterY, 1 / zoomFactor);
+}
+
+inline ContentState ContentState::restoredZoom() const
+{
+    return zoomedAroundUnrotated(viewportZoomCenterLocalX, viewportZoomCenterLocalY, 1 / viewportZoom);
+}
+
+inline ContentState ContentState::zoomedAround(double zoomCenterX, double zoomCenterY, double zoomFactor) const
+{
+    const auto [unrotatedCenterX, unrotatedCenterY] = toUnrotatedLocal(zoomCenterX, zoomCenterY);
+    return zoomedAroundUnrotated(unrotatedCenterX, unrotatedCenterY, zoomFactor);
+}
+
+inline ContentState ContentState::zoomedAroundUnrotated(double zoomCenterX, double zoomCenterY, double zoomFactor) const
+{
+    // The local point c shows the content point viewportOffset + viewportZoomCenterLocal + (c - viewportZoomCenterLocal) / sideZoom,
+    //   so moving the zoom center there requires compensating the offset to keep that content point in place
+    const double sideZoom = std::sqrt(viewportZoom);
+
+    ContentState result = *this;
+    result.viewportOffsetX += (viewportZoomCenterLocalX - zoomCenterX) * (1 - 1 / sideZoom);
+    result.viewportOffsetY += (viewportZoomCenterLocalY - zoomCenterY) * (1 - 1 / sideZoom);
+    result.viewportZoom = std::clamp(viewportZoom * zoomFactor, MIN_ZOOM, MAX_ZOOM);
+    // The steps and the pinches near a kernel zoom land on it exactly ; the square root of an exact square is exact
+    if (const double newSideZoom = std::sqrt(result.viewportZoom), snapped = snapSideZoomToKernel(newSideZoom); snapped != newSideZoom)
+        result.viewportZoom = snapped * snapped;
+    result.viewportZoomCenterLocalX = zoomCenterX;
+    result.viewportZoomCenterLocalY = zoomCenterY;
+    return result;
+}
+
+inline ContentState ContentState::rotatedAround(double centerX, double centerY, double angle) const
+{
+    // Moving the rotation center to c shifts the whole unrotated viewport by
+    //   t = toUnrotatedLocal(c) - c = oldCenter + R(-rotation) * (c - oldCenter) - c,
+    //   which is compensated by the offset ; then the rotation around c keeps c in place
+    const auto [unrotatedCenterX, unrotatedCenterY] = toUnrotatedLocal(centerX, centerY);
+    const double sideZoom = std::sqrt(viewportZoom);
+
+    ContentState result = *this;
+    result.viewportOffsetX += (unrotatedCenterX - centerX) / sideZoom;
+    result.viewportOffsetY += (unrotatedCenterY - centerY) / sideZoom;
+    result.viewportRotation = std::remainder(viewportRotation + angle, 2 * std::numbers::pi);
+    result.viewportRotationCenterLocalX = centerX;
+    result.viewportRotationCenterLocalY = centerY;
+    return result;
+}
+
+inline std::pair<double, double> ContentState::toUnrotatedLocal(double x, double y) const noexcept
+{
+    if (viewportRotation == 0)
+        return { x, y };
+
+    const double cosine = std::cos(viewportRotation);
+    const double sine = std::sin(viewportRotation);
+    const double dx = x - viewportRotationCenterLocalX;
+    const double dy = y - viewportRotationCenterLocalY;
+
+    return { viewportRotationCenterLocalX + cosine * dx + sine * dy, viewportRotationCenterLocalY - sine * dx + cosine * dy };
+}
+
+inline std::pair<double, double> ContentState::toRotatedLocal(double x, double y) const noexcept
+{
+    if (viewportRotation == 0)
+        return { x, y };
+
+    const double cosine = std::cos(viewportRotation);
+    const double sine = std::sin(viewportRotation);
+    const double dx = x - viewportRotationCenterLocalX;
+    const double dy = y - viewportRotationCenterLocalY;
+
+    return { viewportRotationCenterLocalX + cosine * dx - sine * dy, viewportRotationCenterLocalY + sine * dx + cosine * dy };
+}
+
+inline bool operator==(const ContentState& lhs, const ContentState& rhs) noexcept
+{
+    return ( (lhs.viewportOffsetX == rhs.viewportOffsetX) &&
+             (lhs.viewportOffsetY == rhs.viewportOffsetY) &&
+             (lhs.viewportZoom == rhs.viewportZoom) &&
+             (lhs.viewportZoomCenterLocalX == rhs.viewportZoomCenterLocalX) &&
+             (lhs.viewportZoomCenterLocalY == rhs.viewportZoomCenterLocalY) &&
+             (lhs.viewportRotation == rhs.viewportRotation) &&
+             (lhs.viewportRotationCenterLocalX == rhs.viewportRotationCenterLocalX) &&
+             (lhs.viewportRotationCenterLocalY == rhs.viewportRotationCenterLocalY) );
+}
+
+inline bool operator!=(const ContentState& lhs, const ContentState& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_CONTENT_STATE_H
@@ -0,0 +1,708 @@
+#ifndef WAYLAND_INPUT_WINDOW_CORO_RUNTIME_H
+#define WAYLAND_INPUT_WINDOW_CORO_RUNTIME_H
+
+#include "utilities.h"          // MY_LOG_*
+#include "flight_recorder.h"    // FlightRecorder
+#include "event_loop.h"         // EventLoop
+#include "app_clock.h"          // AppClock
+#include <wayland-client.h>     // wl_callback*, wl_display_sync, wl_surface_frame
+#include <coroutine>            // std::coroutine_handle, std::suspend_always, std::noop_coroutine
+#include <exception>            // std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <optional>             // std::optional
+#include <functional>           // std::function
+#include <type_traits>          // std::invoke_result_t, std::is_void_v
+#include <utility>              // std::move, std::exchange
+#include <vector>               // std::vector
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex, std::lock_guard
+#include <chrono>               // std::chrono::*
+#include <algorithm>            // std::remove_if, std::find_if, std::min_element
+#include <cstdint>              // std::uint32_t, std::uint64_t
+#include <cerrno>               // errno
+#include <system_error>         // std::system_error
+#include <poll.h>               // POLLIN
+#include <sys/eventfd.h>        // eventfd
+#include <sys/timerfd.h>        // timerfd_*
+#include <unistd.h>             // read, write, close
+
+
+/**
+ * A lazily started coroutine producing a T.
+ * It starts when it's co_await-ed (or passed to CoroRuntime::spawn / CoroRuntime::blockOn) and resumes the awaiting
+ *   coroutine right when it finishes ; the exceptions are propagated to the awaiting one.
+ * Destroying a Task destroys its frame together with the awaitables it's suspended on, which unregister themselves.
+ */
+template<typename T = void>
+class Task;
+
+namespace coro_details
+{
+    template<typename T>
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<Promise> finished) const noexcept
+            {
+                const auto continuation = finished.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct TaskPromise : TaskPromiseBase<T>
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object() noexcept;
+        void return_value(T result) { value.emplace(std::move(result)); }
+
+        T takeResult()
+        {
+            if (this->error)
+                std::rethrow_exception(this->error);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct TaskPromise<void> : TaskPromiseBase<void>
+    {
+        Task<void> get_return_object() noexcept;
+        void return_void() const noexcept {}
+
+        void takeResult() const
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+} // namespace coro_details
+
+template<typename T>
+class Task
+{
+public:
+    using promise_type = coro_details::TaskPromise<T>;
+
+public: // ctors/dtor
+    Task() noexcept = default;
+
+    explicit Task(const std::coroutine_handle<promise_type> handle) noexcept
+        : handle_{ handle }
+    {}
+
+    Task(const Task&) = delete;
+    Task(Task&& src) noexcept
+        : handle_{ std::exchange(src.handle_, nullptr) }
+    {}
+
+    ~Task() noexcept
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+public: // assignments
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(rhs.handle_, nullptr);
+        }
+        return *this;
+    }
+
+public: // getters
+    [[nodiscard]] bool isDone() const noexcept { return ( !handle_ || handle_.done() ); }
+
+    /** Returns the result or rethrows the exception of the task ; must be called once it's done */
+    T takeResult() { return handle_.promise().takeResult(); }
+
+public:
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return ( !handle || handle.done() ); }
+
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) const noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() const { return handle.promise().takeResult(); }
+        };
+
+        return Awaiter{ handle_ };
+    }
+
+    /** co_await task.whenDone() waits for the task without taking its result */
+    auto whenDone() noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return ( !handle || handle.done() ); }
+
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) const noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter{ handle_ };
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template<typename T>
+Task<T> coro_details::TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{ std::coroutine_handle<TaskPromise<T>>::from_promise(*this) };
+}
+
+inline Task<void> coro_details::TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{ std::coroutine_handle<TaskPromise<void>>::from_promise(*this) };
+}
+
+
+/**
+ * A flag the coroutines can wait for ; set() resumes all the waiting ones right away.
+ * E.g. wl_buffer::release can't get a second listener, so its listener sets an AsyncEvent instead.
+ * Must be used from the event loop thread only.
+ */
+class AsyncEvent
+{
+public: // ctors/dtor
+    explicit AsyncEvent(const bool isSet = false) noexcept
+        : isSet_{ isSet }
+    {}
+
+    AsyncEvent(const AsyncEvent&) = delete;
+
+public: // assignments
+    AsyncEvent& operator=(const AsyncEvent&) = delete;
+
+public:
+    void set()
+    {
+        isSet_ = true;
+
+        // The resumed coroutines may wait for this event again
+        const auto waiters = std::exchange(waiters_, {});
+        for (const auto waiter : waiters)
+            waiter.resume();
+    }
+
+    void reset() noexcept { isSet_ = false; }
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter
+        {
+            AsyncEvent& event;
+
+            bool await_ready() const noexcept { return event.isSet_; }
+            void await_suspend(const std::coroutine_handle<> awaiting) { event.waiters_.push_back(awaiting); }
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter{ *this };
+    }
+
+public: // getters
+    [[nodiscard]] bool isSet() const noexcept { return isSet_; }
+
+private:
+    bool isSet_;
+    std::vector<std::coroutine_handle<>> waiters_;
+};
+
+
+/**
+ * Waits for wl_callback::done, e.g. of a wl_display::sync or a wl_surface::frame ; the result is the callback data.
+ * The callback is listened to right away, so it isn't missed even if it's done before being co_await-ed, e.g.
+ *     WLCallbackAwaitable frameDone{ wl_surface_frame(surface) };
+ *     wl_surface_commit(surface);
+ *     const auto presentedAtMs = co_await frameDone;
+ */
+class WLCallbackAwaitable
+{
+public: // ctors/dtor
+    explicit WLCallbackAwaitable(wl_callback* const callback)
+        : callback_{ callback }
+    {
+        if (callback_ == nullptr)
+            throw std::system_error(errno, std::system_category(), "WLCallbackAwaitable: failed to create a wl_callback");
+
+        if (const auto err = MY_LOG_WLCALL(wl_callback_add_listener(callback_, &wlHandler_, this)); err != 0)
+        {
+            MY_LOG_WLCALL_VALUELESS(wl_callback_destroy(callback_));
+            throw std::system_error(
+                errno,
+                std::system_category(),
+                "WLCallbackAwaitable: wl_callback_add_listener returned " + std::to_string(err)
+            );
+        }
+    }
+
+    WLCallbackAwaitable(const WLCallbackAwaitable&) = delete;
+    WLCallbackAwaitable(WLCallbackAwaitable&&) = delete;
+
+    ~WLCallbackAwaitable() noexcept
+    {
+        if (callback_ != nullptr)
+            MY_LOG_WLCALL_VALUELESS(wl_callback_destroy(callback_));
+    }
+
+public: // assignments
+    WLCallbackAwaitable& operator=(const WLCallbackAwaitable&) = delete;
+    WLCallbackAwaitable& operator=(WLCallbackAwaitable&&) = delete;
+
+public:
+    bool await_ready() const noexcept { return result_.has_value(); }
+    void await_suspend(const std::coroutine_handle<> awaiting) noexcept { awaiting_ = awaiting; }
+    std::uint32_t await_resume() const noexcept { return *result_; }
+
+private:
+    static void onDone(void * const selfP, wl_callback * const callback, const std::uint32_t data)
+    {
+        MY_LOG_TRACE("WLCallbackAwaitable::onDone(selfP=", selfP, ", callback=", callback, ", data=", data, ").");
+
+        // The runtime doesn't know the stages of the app, so the event only goes to the flight recorder
+        FlightRecorder::record(FlightRecorder::Kind::EVENT, "wl_callback::done", FlightRecorder::toArg(callback), data);
+
+        auto& self = *static_cast<WLCallbackAwaitable*>(selfP);
+        MY_LOG_WLCALL_VALUELESS(wl_callback_destroy(callback));
+        self.callback_ = nullptr;
+        self.result_ = data;
+
+        // The awaitable may be destroyed by the resumed coroutine
+        if (const auto awaiting = std::exchange(self.awaiting_, nullptr); awaiting)
+            awaiting.resume();
+    }
+
+private:
+    static constexpr wl_callback_listener wlHandler_ = { &onDone };
+
+    wl_callback* callback_;
+    std::optional<std::uint32_t> result_;
+    std::coroutine_handle<> awaiting_;
+};
+
+/** Completes once the server has processed all the requests sent before ; the non-blocking wl_display_roundtrip */
+[[nodiscard]] inline WLCallbackAwaitable awaitDisplaySync(wl_display* const connection)
+{
+    return WLCallbackAwaitable{ MY_LOG_WLCALL(wl_display_sync(connection)) };
+}
+
+/** Completes when it's a good time to draw the next frame of the surface ; the surface must be committed meanwhile */
+[[nodiscard]] inline WLCallbackAwaitable awaitSurfaceFrame(wl_surface* const surface)
+{
+    return WLCallbackAwaitable{ MY_LOG_WLCALL(wl_surface_frame(surface)) };
+}
+
+
+/**
+ * Runs the coroutines on top of an EventLoop: everything is resumed from EventLoop::runOnce() on the thread running
+ *   it, so the coroutines never need any synchronization with the listeners or with each other.
+ * Besides the Wayland awaitables above it provides the timers (timerfd) and the jobs offloaded to separate threads,
+ *   whose completions are delivered back via an eventfd.
+ * If AppClock is virtual the timers expire in the virtual time instead: resumeDueVirtualTimers() must be called after
+ *   advancing it.
+ */
+class CoroRuntime
+{
+public: // ctors/dtor
+    explicit CoroRuntime(EventLoop& eventLoop)
+        : eventLoop_{ eventLoop }
+        , completionsFd_{ eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) }
+    {
+        if (completionsFd_ < 0)
+            throw std::system_error(errno, std::system_category(), "CoroRuntime: eventfd failed");
+
+        completionsWatchId_ = eventLoop_.addFdWatch(completionsFd_, POLLIN, [this](short) { resumeCompleted(); });
+    }
+
+    CoroRuntime(const CoroRuntime&) = delete;
+    CoroRuntime(CoroRuntime&&) = delete;
+
+    /** The coroutines still suspended are destroyed ; the offloaded jobs are waited for before that */
+    ~CoroRuntime() noexcept
+    {
+        for (auto& job : offloadedJobs_)
+            job.thread.join();
+
+        for (auto& spawned : spawned_)
+            spawned.handle.destroy();
+
+        eventLoop_.removeFdWatch(completionsWatchId_);
+        (void)close(completionsFd_);
+    }
+
+public: // assignments
+    CoroRuntime& operator=(const CoroRuntime&) = delete;
+    CoroRuntime& operator=(CoroRuntime&&) = delete;
+
+public:
+    /** Starts the task right away ; it lives until it's done or until the runtime is destroyed. name is for the logs */
+    void spawn(Task<void> task, const char* const name)
+    {
+        reapSpawned();
+
+        auto root = runSpawned(std::move(task), name);
+        spawned_.push_back(root);
+        root.handle.resume();
+    }
+
+    /**
+     * Runs the event loop until the task is done ; for the startup steps which can't proceed without the result.
+     * The coroutines spawned before make progress meanwhile.
+     */
+    template<typename T>
+    T blockOn(Task<T> task)
+    {
+        bool isDone = false;
+        spawn(waitFor(task, isDone), "blockOn");
+
+        while (!isDone)
+        {
+            if (!eventLoop_.runOnce())
+                throw std::system_error(errno, std::system_category(), "CoroRuntime::blockOn: the Wayland connection has been broken");
+        }
+
+        return task.takeResult();
+    }
+
+    /** co_await sleepFor(...) resumes the coroutine after the duration (of AppClock) */
+    template<typename Rep, typename Period>
+    [[nodiscard]] auto sleepFor(const std::chrono::duration<Rep, Period> duration)
+    {
+        return TimerAwaitable{ *this, std::chrono::duration_cast<std::chrono::nanoseconds>(duration) };
+    }
+
+    /** Resumes the coroutines sleeping until the current virtual time or earlier, the earliest deadlines first */
+    void resumeDueVirtualTimers()
+    {
+        // The resumed coroutines may start new timers, including the ones due right away
+        while (true)
+        {
+            // The first one of the equal deadlines is the one started first
+            const auto dueIter = std::min_element(virtualTimers_.begin(), virtualTimers_.end(), [](const VirtualTimer& lhs, const VirtualTimer& rhs) {
+                return (lhs.deadline < rhs.deadline);
+            });
+            if ( (dueIter == virtualTimers_.end()) || (dueIter->deadline > AppClock::now()) )
+                return;
+
+            const auto awaiting = dueIter->awaiting;
+            virtualTimers_.erase(dueIter);
+            // Destroys the awaitable
+            awaiting.resume();
+        }
+    }
+
+    /** E.g. to know whether the virtual time has to be advanced for the coroutines to make progress */
+    [[nodiscard]] std::optional<AppClock::time_point> getNextVirtualDeadline() const noexcept
+    {
+        const auto nextIter = std::min_element(virtualTimers_.begin(), virtualTimers_.end(), [](const VirtualTimer& lhs, const VirtualTimer& rhs) {
+            return (lhs.deadline < rhs.deadline);
+        });
+        if (nextIter == virtualTimers_.end())
+            return std::nullopt;
+        return nextIter->deadline;
+    }
+
+    /**
+     * co_await offload(job) runs the job on a separate thread and resumes the coroutine with its result (or its
+     *   exception) on the event loop thread. For the blocking or heavy work which would stall the event loop:
+     *   file I/O, benchmarks, etc. The job must not touch anything the event loop thread uses meanwhile.
+     */
+    template<typename Job>
+    [[nodiscard]] auto offload(Job job)
+    {
+        return OffloadAwaitable<std::invoke_result_t<Job&>>{ *this, std::function<std::invoke_result_t<Job&>()>{ std::move(job) } };
+    }
+
+private:
+    struct SpawnedPromise;
+
+    struct Spawned
+    {
+        using promise_type = SpawnedPromise;
+        std::coroutine_handle<SpawnedPromise> handle;
+    };
+
+    struct SpawnedPromise
+    {
+        Spawned get_return_object() noexcept { return Spawned{ std::coroutine_handle<SpawnedPromise>::from_promise(*this) }; }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        // Reaped by spawn() or the destructor
+        std::suspend_always final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept {}
+    };
+
+    static Spawned runSpawned(Task<void> task, const char* const name)
+    {
+        try
+        {
+            co_await std::move(task);
+        }
+        catch (const std::exception& err)
+        {
+            MY_LOG_ERROR("CoroRuntime: the coroutine \"", name, "\" has thrown (\"", err.what(), "\").");
+        }
+        catch (...)
+        {
+            MY_LOG_ERROR("CoroRuntime: the coroutine \"", name, "\" has thrown an unknown exception.");
+        }
+    }
+
+    /** The result (or the exception) stays in the task, blockOn takes it from there */
+    template<typename T>
+    static Task<void> waitFor(Task<T>& task, bool& isDone)
+    {
+        co_await task.whenDone();
+        isDone = true;
+    }
+
+    void reapSpawned() noexcept
+    {
+        for (auto& spawned : spawned_)
+        {
+            if (spawned.handle.done())
+            {
+                spawned.handle.destroy();
+                spawned.handle = nullptr;
+            }
+        }
+        spawned_.erase(
+            std::remove_if(spawned_.begin(), spawned_.end(), [](const Spawned& spawned) { return !spawned.handle; }),
+            spawned_.end()
+        );
+    }
+
+    class TimerAwaitable
+    {
+    public: // ctors/dtor
+        TimerAwaitable(CoroRuntime& runtime, const std::chrono::nanoseconds duration) noexcept
+            : runtime_{ runtime }
+            , duration_{ duration }
+        {}
+
+        TimerAwaitable(const TimerAwaitable&) = delete;
+
+        ~TimerAwaitable() noexcept
+        {
+            // The coroutine may be destroyed while it's sleeping
+            runtime_.virtualTimers_.erase(
+                std::remove_if(runtime_.virtualTimers_.begin(), runtime_.virtualTimers_.end(), [this](const VirtualTimer& timer) { return (timer.awaitable == this); }),
+                runtime_.virtualTimers_.end()
+            );
+            if (watchId_.has_value())
+                runtime_.eventLoop_.removeFdWatch(*watchId_);
+            if (fd_ >= 0)
+                (void)close(fd_);
+        }
+
+    public: // assignments
+        TimerAwaitable& operator=(const TimerAwaitable&) = delete;
+
+    public:
+        bool await_ready() const noexcept { return (duration_.count() <= 0); }
+
+        void await_suspend(const std::coroutine_handle<> awaiting)
+        {
+            if (AppClock::isVirtual())
+            {
+                runtime_.virtualTimers_.push_back(VirtualTimer{ AppClock::now() + duration_, this, awaiting });
+                return;
+            }
+
+            fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+            if (fd_ < 0)
+                throw std::system_error(errno, std::system_category(), "CoroRuntime::sleepFor: timerfd_create failed");
+
+            itimerspec spec{};
+            spec.it_value.tv_sec = static_cast<time_t>(duration_.count() / 1'000'000'000);
+            spec.it_value.tv_nsec = static_cast<long>(duration_.count() % 1'000'000'000);
+            if (timerfd_settime(fd_, 0, &spec, nullptr) != 0)
+                throw std::system_error(errno, std::system_category(), "CoroRuntime::sleepFor: timerfd_settime failed");
+
+            watchId_ = runtime_.eventLoop_.addFdWatch(fd_, POLLIN, [this, awaiting](short) {
+                std::uint64_t expirations = 0;
+                (void)read(fd_, &expirations, sizeof(expirations));
+
+                runtime_.eventLoop_.removeFdWatch(*watchId_);
+                watchId_.reset();
+
+                // Destroys this awaitable
+                awaiting.resume();
+            });
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        CoroRuntime& runtime_;
+        const std::chrono::nanoseconds duration_;
+        int fd_ = -1;
+        std::optional<EventLoop::FdWatchId> watchId_;
+    };
+
+    template<typename T>
+    class OffloadAwaitable
+    {
+    public: // ctors/dtor
+        OffloadAwaitable(CoroRuntime& runtime, std::function<T()> job) noexcept
+            : runtime_{ runtime }
+            , job_{ std::move(job) }
+        {}
+
+        OffloadAwaitable(const OffloadAwaitable&) = delete;
+
+    public: // assignments
+        OffloadAwaitable& operator=(const OffloadAwaitable&) = delete;
+
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(const std::coroutine_handle<> awaiting)
+        {
+            runtime_.startOffloadedJob(awaiting, [this] {
+                try
+                {
+                    if constexpr (std::is_void_v<T>)
+                        job_();
+                    else
+                        result_.emplace(job_());
+                }
+                catch (...)
+                {
+                    error_ = std::current_exception();
+                }
+            });
+        }
+
+        T await_resume()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+            if constexpr (std::is_void_v<T>)
+                return;
+            else
+                return std::move(*result_);
+        }
+
+    private:
+        using Result = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+        CoroRuntime& runtime_;
+        std::function<T()> job_;
+        // Written by the job's thread, read after the completion has been delivered via the eventfd
+        std::optional<Result> result_;
+        std::exception_ptr error_;
+    };
+
+    struct OffloadedJob
+    {
+        std::thread thread;
+        std::coroutine_handle<> awaiting;
+        bool isCompleted;
+    };
+
+    void startOffloadedJob(const std::coroutine_handle<> awaiting, std::function<void()> job)
+    {
+        const std::lock_guard lock{ offloadedJobsMutex_ };
+
+        offloadedJobs_.push_back(OffloadedJob{ {}, awaiting, false });
+        offloadedJobs_.back().thread = std::thread{ [this, awaiting, job = std::move(job)] {
+            job();
+
+            {
+                const std::lock_guard lock{ offloadedJobsMutex_ };
+                const auto jobIter = std::find_if(offloadedJobs_.begin(), offloadedJobs_.end(), [awaiting](const OffloadedJob& j) { return (j.awaiting == awaiting); });
+                jobIter->isCompleted = true;
+            }
+
+            const std::uint64_t one = 1;
+            (void)write(completionsFd_, &one, sizeof(one));
+        } };
+    }
+
+    void resumeCompleted()
+    {
+        std::uint64_t completionsCount = 0;
+        (void)read(completionsFd_, &completionsCount, sizeof(completionsCount));
+
+        std::vector<std::coroutine_handle<>> toResume;
+        {
+            const std::lock_guard lock{ offloadedJobsMutex_ };
+            for (auto& job : offloadedJobs_)
+            {
+                if (job.isCompleted)
+                {
+                    job.thread.join();
+                    toResume.push_back(job.awaiting);
+                }
+            }
+            offloadedJobs_.erase(
+                std::remove_if(offloadedJobs_.begin(), offloadedJobs_.end(), [](const OffloadedJob& job) { return job.isCompleted; }),
+                offloadedJobs_.end()
+            );
+        }
+
+        // The resumed coroutines may offload more jobs
+        for (const auto awaiting : toResume)
+            awaiting.resume();
+    }
+
+private:
+    EventLoop& eventLoop_;
+    const int completionsFd_;
+    EventLoop::FdWatchId completionsWatchId_ = 0;
+
+    std::vector<Spawned> spawned_;
+
+    // The sleeping coroutines if AppClock is virtual ; in the order they've started sleeping
+    struct VirtualTimer
+    {
+        AppClock::time_point deadline;
+        const TimerAwaitable* awaitable;
+        std::coroutine_handle<> awaiting;
+    };
+    std::vector<VirtualTimer> virtualTimers_;
+
+    std::mutex offloadedJobsMutex_;
+    std::vector<OffloadedJob> offloadedJobs_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_CORO_RUNTIME_H
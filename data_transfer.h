@@ -0,0 +1,269 @@
+#ifndef WAYLAND_INPUT_WINDOW_DATA_TRANSFER_H
+#define WAYLAND_INPUT_WINDOW_DATA_TRANSFER_H
+
+#include "utilities.h"      // SharedMemoryBuffer, MY_LOG_*
+#include "event_loop.h"     // EventLoop
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint64_t
+#include <functional>       // std::function
+#include <memory>           // std::shared_ptr
+#include <optional>         // std::optional
+#include <unordered_map>    // std::unordered_map
+#include <algorithm>        // std::min
+#include <chrono>           // std::chrono::*
+#include <cerrno>           // errno, EAGAIN, EPIPE
+#include <system_error>     // std::system_error
+#include <fcntl.h>          // fcntl, splice, vmsplice, F_*, O_NONBLOCK, SPLICE_F_*
+#include <unistd.h>         // close
+#include <sys/mman.h>       // memfd_create, MFD_CLOEXEC
+#include <sys/uio.h>        // iovec
+#include <poll.h>           // POLLIN, POLLOUT, POLLERR, POLLHUP
+
+
+/**
+ * Moves the clipboard and drag-and-drop data through the pipes provided by wl_data_source::send and
+ *   wl_data_offer::receive without copying it through userspace buffers:
+ *   - the outgoing payloads are vmsplice'd right from their mappings into the pipes ;
+ *   - the incoming data is splice'd from the pipes into memfds, which are mapped once the transfers are complete.
+ * All the pipes are non-blocking and are driven by the EventLoop, so even huge transfers never block rendering.
+ */
+class DataTransfers
+{
+public:
+    // The pipes keep referencing the pages of a payload until the other side reads them, hence a payload must never
+    //   be modified once it's been passed to send()
+    using OutgoingPayload = std::shared_ptr<const SharedMemoryBuffer>;
+    // data.isValid() == false if the transfer has failed or nothing has been received
+    using IncomingCompletion = std::function<void(SharedMemoryBuffer data)>;
+
+    // The pipes are enlarged up to this (the default limit for unprivileged processes) to reduce the wakeups count
+    static constexpr int PIPE_SIZE_BYTES = 1024 * 1024;
+    // The number of bytes moved per a wakeup of a single transfer, so the others and rendering don't starve
+    static constexpr std::size_t MAX_BYTES_PER_WAKEUP = 16 * 1024 * 1024;
+
+public: // ctors/dtor
+    explicit DataTransfers(EventLoop& eventLoop) noexcept
+        : eventLoop_{eventLoop}
+    {}
+
+    DataTransfers(const DataTransfers&) = delete;
+    DataTransfers& operator=(const DataTransfers&) = delete;
+
+    ~DataTransfers() noexcept
+    {
+        for (auto& [id, transfer] : outgoing_)
+            dispose(transfer.pipeFd, transfer.watchId);
+        for (auto& [id, transfer] : incoming_)
+        {
+            dispose(transfer.pipeFd, transfer.watchId);
+            (void)close(transfer.memFd);
+        }
+    }
+
+public:
+    /** Writes the bytes [offset; offset + size) of the payload into the pipe. Takes the ownership of pipeFd. */
+    void send(const int pipeFd, OutgoingPayload payload, const std::size_t offset, const std::size_t size)
+    {
+        MY_LOG_INFO("DataTransfers::send(pipeFd=", pipeFd, ", size=", size, ").");
+
+        const auto id = nextTransferId_++;
+        auto& transfer = outgoing_.emplace(id, Outgoing{ pipeFd, std::nullopt, std::move(payload), offset, offset, offset + size, Clock::now() }).first->second;
+
+        preparePipe(pipeFd);
+        if (pumpOutgoing(id))
+            transfer.watchId = eventLoop_.addFdWatch(pipeFd, POLLOUT, [this, id](short revents) { onOutgoingReady(id, revents); });
+    }
+
+    /** Reads the pipe until its write end is closed. Takes the ownership of pipeFd. */
+    void receive(const int pipeFd, IncomingCompletion onCompleted)
+    {
+        MY_LOG_INFO("DataTransfers::receive(pipeFd=", pipeFd, ").");
+
+        const int memFd = memfd_create("WaylandInputWindow-incoming-data", MFD_CLOEXEC);
+        if (memFd == -1)
+        {
+            const auto savedErrno = errno;
+            (void)close(pipeFd);
+            throw std::system_error(savedErrno, std::system_category(), "DataTransfers::receive: memfd_create failed");
+        }
+
+        const auto id = nextTransferId_++;
+        auto& transfer = incoming_.emplace(id, Incoming{ pipeFd, std::nullopt, memFd, 0, std::move(onCompleted), Clock::now() }).first->second;
+
+        preparePipe(pipeFd);
+        transfer.watchId = eventLoop_.addFdWatch(pipeFd, POLLIN, [this, id](short revents) { onIncomingReady(id, revents); });
+    }
+
+public: // getters
+    [[nodiscard]] std::size_t getTransfersInFlightCount() const noexcept { return outgoing_.size() + incoming_.size(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using TransferId = std::uint64_t;
+
+    struct Outgoing
+    {
+        int pipeFd;
+        std::optional<EventLoop::FdWatchId> watchId;
+        OutgoingPayload payload;
+        std::size_t begin;
+        std::size_t position;
+        std::size_t end;
+        Clock::time_point startedAt;
+    };
+
+    struct Incoming
+    {
+        int pipeFd;
+        std::optional<EventLoop::FdWatchId> watchId;
+        int memFd;
+        std::size_t receivedBytes;
+        IncomingCompletion onCompleted;
+        Clock::time_point startedAt;
+    };
+
+private:
+    static void preparePipe(const int pipeFd) noexcept
+    {
+        if (const int flags = fcntl(pipeFd, F_GETFL); (flags == -1) || (fcntl(pipeFd, F_SETFL, flags | O_NONBLOCK) == -1))
+            MY_LOG_WARN("DataTransfers: failed to make the pipe fd=", pipeFd, " non-blocking (errno=", errno, ").");
+
+        // Best effort: the pipe may belong to a process with other limits
+        (void)fcntl(pipeFd, F_SETPIPE_SZ, PIPE_SIZE_BYTES);
+    }
+
+    void dispose(const int pipeFd, const std::optional<EventLoop::FdWatchId> watchId) noexcept
+    {
+        if (watchId.has_value())
+            eventLoop_.removeFdWatch(*watchId);
+        (void)close(pipeFd);
+    }
+
+    static double getMsSince(const Clock::time_point startedAt) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count();
+    }
+
+    /** @return true if the transfer is still in progress and has to wait for the pipe to become writable */
+    bool pumpOutgoing(const TransferId id)
+    {
+        auto& transfer = outgoing_.at(id);
+
+        std::size_t movedNow = 0;
+        while ( (transfer.position < transfer.end) && (movedNow < MAX_BYTES_PER_WAKEUP) )
+        {
+            iovec chunk{
+                const_cast<std::byte*>(transfer.payload->getData() + transfer.position),
+                std::min(transfer.end - transfer.position, MAX_BYTES_PER_WAKEUP - movedNow)
+            };
+
+            const auto moved = vmsplice(transfer.pipeFd, &chunk, 1, SPLICE_F_NONBLOCK);
+            if (moved < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN)
+                    return true;
+
+                // EPIPE means the receiver has lost interest
+                MY_LOG_WARN("DataTransfers: sending to the pipe fd=", transfer.pipeFd, " has failed at ", transfer.position - transfer.begin, " (errno=", errno, ").");
+                finishOutgoing(id);
+                return false;
+            }
+
+            transfer.position += static_cast<std::size_t>(moved);
+            movedNow += static_cast<std::size_t>(moved);
+        }
+
+        if (transfer.position < transfer.end)
+            return true;
+
+        MY_LOG_INFO("DataTransfers: sent ", transfer.end - transfer.begin, " bytes to the pipe fd=", transfer.pipeFd, " in ", getMsSince(transfer.startedAt), " ms.");
+        finishOutgoing(id);
+        return false;
+    }
+
+    void onOutgoingReady(const TransferId id, const short revents)
+    {
+        if (outgoing_.count(id) == 0)
+            return;
+
+        if ((revents & (POLLERR | POLLHUP)) != 0)
+        {
+            MY_LOG_WARN("DataTransfers: the pipe fd=", outgoing_.at(id).pipeFd, " has been closed by the receiver (revents=", revents, ").");
+            finishOutgoing(id);
+            return;
+        }
+
+        (void)pumpOutgoing(id);
+    }
+
+    void finishOutgoing(const TransferId id) noexcept
+    {
+        const auto iter = outgoing_.find(id);
+        dispose(iter->second.pipeFd, iter->second.watchId);
+        outgoing_.erase(iter);
+    }
+
+    void onIncomingReady(const TransferId id, short /*revents*/)
+    {
+        const auto iter = incoming_.find(id);
+        if (iter == incoming_.end())
+            return;
+        auto& transfer = iter->second;
+
+        // POLLHUP is handled by the splice below: it returns 0 once the pipe is drained
+        std::size_t movedNow = 0;
+        while (movedNow < MAX_BYTES_PER_WAKEUP)
+        {
+            const auto moved = splice(transfer.pipeFd, nullptr, transfer.memFd, nullptr, MAX_BYTES_PER_WAKEUP - movedNow, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved > 0)
+            {
+                transfer.receivedBytes += static_cast<std::size_t>(moved);
+                movedNow += static_cast<std::size_t>(moved);
+                continue;
+            }
+            if ( (moved < 0) && (errno == EINTR) )
+                continue;
+            if ( (moved < 0) && (errno == EAGAIN) )
+                return;
+
+            if (moved < 0)
+            {
+                MY_LOG_WARN("DataTransfers: receiving from the pipe fd=", transfer.pipeFd, " has failed at ", transfer.receivedBytes, " (errno=", errno, ").");
+            }
+            else
+            {
+                MY_LOG_INFO("DataTransfers: received ", transfer.receivedBytes, " bytes from the pipe fd=", transfer.pipeFd, " in ", getMsSince(transfer.startedAt), " ms.");
+            }
+
+            finishIncoming(iter, (moved == 0));
+            return;
+        }
+    }
+
+    void finishIncoming(const std::unordered_map<TransferId, Incoming>::iterator iter, const bool succeeded)
+    {
+        auto transfer = std::move(iter->second);
+        incoming_.erase(iter);
+        dispose(transfer.pipeFd, transfer.watchId);
+
+        SharedMemoryBuffer data;
+        if ( succeeded && (transfer.receivedBytes > 0) )
+            data = SharedMemoryBuffer::map(transfer.memFd, transfer.receivedBytes);
+        else
+            (void)close(transfer.memFd);
+
+        transfer.onCompleted(std::move(data));
+    }
+
+private:
+    EventLoop& eventLoop_;
+
+    TransferId nextTransferId_ = 0;
+    std::unordered_map<TransferId, Outgoing> outgoing_;
+    std::unordered_map<TransferId, Incoming> incoming_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_DATA_TRANSFER_H
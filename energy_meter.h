@@ -0,0 +1,308 @@
+#ifndef WAYLAND_INPUT_WINDOW_ENERGY_METER_H
+#define WAYLAND_INPUT_WINDOW_ENERGY_METER_H
+
+#include "utilities.h"          // MY_LOG_*
+#include "latency_stats.h"      // LatencyHistogram
+#include <vector>               // std::vector
+#include <string>               // std::string
+#include <filesystem>           // std::filesystem::directory_iterator
+#include <algorithm>            // std::count, std::sort
+#include <utility>              // std::move
+#include <cstdint>              // std::uint64_t
+#include <cstdlib>              // std::strtoull
+#include <cerrno>               // errno
+#include <ctime>                // clock_gettime, CLOCK_*
+#include <system_error>         // std::error_code, std::system_category
+#include <fcntl.h>              // open, O_RDONLY, O_CLOEXEC
+#include <unistd.h>             // pread, close
+
+
+/**
+ * The energy spent by the frames and while idle (waiting for the events).
+ * It's read from the powercap energy counters (/sys/class/powercap, i.e. RAPL): the platform (psys) one if there's
+ *   one, the sum of the packages otherwise. They are system-wide, so the energy of the other processes is attributed
+ *   too ; compare the runs on an otherwise idle machine.
+ * If the counters aren't readable (they are root-only on most of the distributions, and absent in the VMs) the CPU
+ *   time of the process (all its threads) is accounted instead, in milliseconds.
+ * The energy between the end of a frame and the next one, minus the idle time, is attributed to the latter, i.e. the
+ *   iterations of the event loop which haven't presented anything are added to the next frame.
+ */
+class EnergyMeter
+{
+public:
+    enum class Source
+    {
+        NONE,
+        POWERCAP,
+        CPU_TIME
+    };
+
+    static constexpr std::uint64_t REPORT_PERIOD_FRAMES = LatencyMeter::REPORT_PERIOD;
+
+public: // ctors/dtor
+    EnergyMeter() noexcept = default;
+
+    EnergyMeter(const EnergyMeter&) = delete;
+
+    ~EnergyMeter() noexcept
+    {
+        report();
+        for (const auto& zone : zones_)
+            (void)close(zone.fd);
+    }
+
+public: // assignments
+    EnergyMeter& operator=(const EnergyMeter&) = delete;
+
+public:
+    void open()
+    {
+        MY_LOG_INFO("EnergyMeter: looking for the powercap energy counters...");
+
+        openPowercapZones();
+        if (!zones_.empty())
+        {
+            source_ = Source::POWERCAP;
+            for (const auto& zone : zones_)
+                MY_LOG_INFO("    ", zone.name);
+        }
+        else
+        {
+            MY_LOG_WARN("EnergyMeter: no readable powercap energy counters, the CPU time is accounted instead.");
+            source_ = Source::CPU_TIME;
+        }
+
+        lastSample_ = sample();
+        lastSampleNs_ = nowNs();
+    }
+
+    [[nodiscard]] bool isEnabled() const noexcept { return (source_ != Source::NONE); }
+
+    /** Must be called right before the event loop blocks waiting for the events */
+    void onWaitBegin() noexcept
+    {
+        if (!isEnabled())
+            return;
+
+        const auto current = sample();
+        activeSinceFrameEnd_ += current - lastSample_;
+        lastSample_ = current;
+        lastSampleNs_ = nowNs();
+    }
+
+    /** Must be called right after the event loop has woken up */
+    void onWaitEnd() noexcept
+    {
+        if (!isEnabled())
+            return;
+
+        const auto current = sample();
+        const auto now = nowNs();
+        idleTotal_ += current - lastSample_;
+        idleNs_ += now - lastSampleNs_;
+        lastSample_ = current;
+        lastSampleNs_ = now;
+    }
+
+    /** Everything spent (except while idle) since the previous call makes up a frame */
+    void onFrameEnd() noexcept
+    {
+        if (!isEnabled())
+            return;
+
+        const auto current = sample();
+        activeSinceFrameEnd_ += current - lastSample_;
+        lastSample_ = current;
+        lastSampleNs_ = nowNs();
+
+        perFrame_.record(toReportedUnits(activeSinceFrameEnd_));
+        activeSinceFrameEnd_ = 0;
+
+        if (perFrame_.getCount() >= REPORT_PERIOD_FRAMES)
+        {
+            report();
+            perFrame_.reset();
+            idleTotal_ = 0;
+            idleNs_ = 0;
+        }
+    }
+
+    void report() const noexcept
+    {
+        if ( !isEnabled() || (perFrame_.getCount() == 0) )
+            return;
+
+        const char* const unit = (source_ == Source::POWERCAP) ? "mJ" : "CPU ms";
+        const double idleSeconds = static_cast<double>(idleNs_) / 1e9;
+        MY_LOG_INFO(
+            "Energy per frame over ", perFrame_.getCount(), " frames (", unit, "): ",
+            "min=", perFrame_.getMinMs(), ", ",
+            "mean=", perFrame_.getMeanMs(), ", ",
+            "p50=", perFrame_.getPercentileMs(0.5), ", ",
+            "p99=", perFrame_.getPercentileMs(0.99), ", ",
+            "max=", perFrame_.getMaxMs(), " ; ",
+            "idle: ", (idleSeconds > 0) ? toReportedUnits(idleTotal_) / idleSeconds : 0, ' ', unit, " per second over ", idleSeconds, " s"
+        );
+    }
+
+public: // getters
+    [[nodiscard]] Source getSource() const noexcept { return source_; }
+    /** In mJ or in CPU ms, depending on getSource() */
+    [[nodiscard]] const LatencyHistogram& getPerFrame() const noexcept { return perFrame_; }
+
+private:
+    struct Zone
+    {
+        std::string name;
+        int fd;
+        // The counter wraps around at this value
+        std::uint64_t maxEnergyUj;
+        std::uint64_t lastEnergyUj;
+        // The wrap-arounds so far, so the zone's energy keeps growing monotonically
+        std::uint64_t wrappedUj;
+    };
+
+private:
+    [[nodiscard]] static std::uint64_t nowNs() noexcept
+    {
+        timespec now{};
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+
+    /** @return false if the file can't be read or doesn't contain a number */
+    [[nodiscard]] static bool readUnsigned(const int fd, std::uint64_t& result) noexcept
+    {
+        char buffer[32];
+        const auto bytesRead = pread(fd, buffer, sizeof(buffer) - 1, 0);
+        if (bytesRead <= 0)
+            return false;
+        buffer[bytesRead] = '\0';
+
+        char* end = nullptr;
+        result = std::strtoull(buffer, &end, 10);
+        return (end != buffer);
+    }
+
+    [[nodiscard]] static bool readUnsigned(const std::string& path, std::uint64_t& result) noexcept
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        const bool isRead = readUnsigned(fd, result);
+        (void)close(fd);
+        return isRead;
+    }
+
+    [[nodiscard]] static std::string readName(const std::string& path)
+    {
+        std::string result(64, '\0');
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return {};
+        const auto bytesRead = pread(fd, result.data(), result.size(), 0);
+        (void)close(fd);
+
+        result.resize( (bytesRead > 0) ? static_cast<std::size_t>(bytesRead) : 0 );
+        while (!result.empty() && (result.back() == '\n'))
+            result.pop_back();
+        return result;
+    }
+
+    void openPowercapZones()
+    {
+        // Only the top level zones, e.g. intel-rapl:0 but not its subzone intel-rapl:0:0 (the cores of the package)
+        std::vector<std::string> zoneDirs;
+        std::error_code err;
+        for (const auto& entry : std::filesystem::directory_iterator{ "/sys/class/powercap", err })
+        {
+            const auto dirName = entry.path().filename().string();
+            if (std::count(dirName.begin(), dirName.end(), ':') == 1)
+                zoneDirs.push_back(entry.path().string());
+        }
+        if (err)
+        {
+            MY_LOG_INFO("EnergyMeter: failed to list /sys/class/powercap (", err, " \"", err.message(), "\").");
+            return;
+        }
+        std::sort(zoneDirs.begin(), zoneDirs.end());
+
+        for (const auto& dir : zoneDirs)
+        {
+            Zone zone{ readName(dir + "/name") + " (" + dir + ")", -1, 0, 0, 0 };
+            if (!readUnsigned(dir + "/max_energy_range_uj", zone.maxEnergyUj))
+                continue;
+
+            zone.fd = ::open((dir + "/energy_uj").c_str(), O_RDONLY | O_CLOEXEC);
+            if ( (zone.fd >= 0) && !readUnsigned(zone.fd, zone.lastEnergyUj) )
+            {
+                (void)close(zone.fd);
+                zone.fd = -1;
+            }
+            if (zone.fd < 0)
+            {
+                const std::error_code sysErr{errno, std::system_category()};
+                MY_LOG_INFO("EnergyMeter: can't read ", dir, "/energy_uj (errno=", sysErr, " \"", sysErr.message(), "\").");
+                continue;
+            }
+
+            // The platform zone covers the packages and the rest of the SoC, so it's the only one needed
+            if (zone.name.rfind("psys", 0) == 0)
+            {
+                for (const auto& other : zones_)
+                    (void)close(other.fd);
+                zones_.clear();
+                zones_.push_back(std::move(zone));
+                return;
+            }
+            zones_.push_back(std::move(zone));
+        }
+    }
+
+    /** The energy in µJ or the CPU time in ns since an arbitrary point */
+    [[nodiscard]] std::uint64_t sample() noexcept
+    {
+        if (source_ == Source::CPU_TIME)
+        {
+            timespec cpuTime{};
+            (void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuTime);
+            return static_cast<std::uint64_t>(cpuTime.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(cpuTime.tv_nsec);
+        }
+
+        std::uint64_t result = 0;
+        for (auto& zone : zones_)
+        {
+            std::uint64_t energyUj = 0;
+            if (readUnsigned(zone.fd, energyUj))
+            {
+                if (energyUj < zone.lastEnergyUj)
+                    zone.wrappedUj += zone.maxEnergyUj + 1;
+                zone.lastEnergyUj = energyUj;
+            }
+            result += zone.wrappedUj + zone.lastEnergyUj;
+        }
+        return result;
+    }
+
+    [[nodiscard]] double toReportedUnits(const std::uint64_t sampleDelta) const noexcept
+    {
+        // µJ -> mJ, ns -> ms
+        return static_cast<double>(sampleDelta) / ( (source_ == Source::POWERCAP) ? 1e3 : 1e6 );
+    }
+
+private:
+    Source source_ = Source::NONE;
+    std::vector<Zone> zones_;
+
+    std::uint64_t lastSample_ = 0;
+    std::uint64_t lastSampleNs_ = 0;
+    std::uint64_t activeSinceFrameEnd_ = 0;
+    std::uint64_t idleTotal_ = 0;
+    std::uint64_t idleNs_ = 0;
+
+    // The buckets are 0.25 mJ (or CPU ms) wide, like the ones of the frame latencies
+    LatencyHistogram perFrame_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_ENERGY_METER_H
@@ -0,0 +1,186 @@
+#ifndef WAYLAND_INPUT_WINDOW_EVENT_LOOP_H
+#define WAYLAND_INPUT_WINDOW_EVENT_LOOP_H
+
+#include "utilities.h"          // MY_LOG_*
+#include "app_clock.h"          // AppClock
+#include <wayland-client.h>     // wl_display, wl_display_*
+#include <functional>           // std::function
+#include <vector>               // std::vector
+#include <algorithm>            // std::remove_if
+#include <optional>             // std::optional
+#include <cstddef>              // std::size_t
+#include <cerrno>               // errno, EINTR, EAGAIN
+#include <system_error>         // std::system_error
+#include <poll.h>               // poll, pollfd, POLL*
+
+
+/**
+ * Waits for events on the Wayland connection and on any other file descriptors the app is interested in
+ *   (timers, pressure notifications, pipes, etc.), then dispatches them.
+ * The Wayland events are read with the wl_display_prepare_read / wl_display_read_events protocol, so the queue is
+ *   never read while other events are still pending.
+ */
+class EventLoop
+{
+public:
+    // The virtual time if it's enabled ; see AppClock
+    using Clock = AppClock;
+    using FdWatchId = std::size_t;
+    // Receives the revents reported by poll
+    using FdCallback = std::function<void(short revents)>;
+    // Invoked with true right before runOnce() blocks in poll and with false right after it wakes up
+    using WaitObserver = std::function<void(bool isWaiting)>;
+
+public:
+    explicit EventLoop(wl_display* const connection) noexcept
+        : connection_{connection}
+    {}
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+public:
+    /** The callback is invoked from runOnce() every time poll reports any of the events on the fd */
+    FdWatchId addFdWatch(const int fd, const short events, FdCallback callback)
+    {
+        MY_LOG_TRACE("EventLoop::addFdWatch(fd=", fd, ", events=", events, ").");
+
+        const auto id = nextWatchId_++;
+        fdWatches_.push_back(FdWatch{ id, fd, events, std::move(callback), false });
+        return id;
+    }
+
+    /** Can be called from within the callbacks */
+    void removeFdWatch(const FdWatchId id) noexcept
+    {
+        MY_LOG_TRACE("EventLoop::removeFdWatch(id=", id, ").");
+
+        for (auto& watch : fdWatches_)
+        {
+            if (watch.id == id)
+                watch.isRemoved = true;
+        }
+    }
+
+    /** E.g. to exclude the time spent idle from the measurements ; an empty observer removes the current one */
+    void setWaitObserver(WaitObserver observer) noexcept
+    {
+        waitObserver_ = std::move(observer);
+    }
+
+    /**
+     * Dispatches the already queued Wayland events, flushes the requests, then waits up to timeoutMs
+     *   (-1 means infinitely) for new events and dispatches them.
+     * @return false if the Wayland connection has been broken
+     */
+    [[nodiscard]] bool runOnce(const int timeoutMs = -1)
+    {
+        while (wl_display_prepare_read(connection_) != 0)
+        {
+            if (MY_LOG_WLCALL(wl_display_dispatch_pending(connection_)) < 0)
+                return false;
+        }
+
+        bool hasUnflushedRequests = false;
+        if (MY_LOG_WLCALL(wl_display_flush(connection_)) < 0)
+        {
+            if (errno != EAGAIN)
+            {
+                wl_display_cancel_read(connection_);
+                return false;
+            }
+            // The socket buffer is full, the rest will be flushed once it becomes writable
+            hasUnflushedRequests = true;
+        }
+
+        pollFds_.clear();
+        pollFds_.push_back(pollfd{ wl_display_get_fd(connection_), static_cast<short>(POLLIN | (hasUnflushedRequests ? POLLOUT : 0)), 0 });
+        for (const auto& watch : fdWatches_)
+            pollFds_.push_back(pollfd{ watch.fd, watch.events, 0 });
+
+        if (waitObserver_)
+            waitObserver_(true);
+
+        int pollResult = 0;
+        do
+        {
+            pollResult = poll(pollFds_.data(), pollFds_.size(), timeoutMs);
+        } while ( (pollResult < 0) && (errno == EINTR) );
+
+        if (waitObserver_)
+        {
+            const auto savedErrno = errno;
+            waitObserver_(false);
+            errno = savedErrno;
+        }
+
+        if (pollResult < 0)
+        {
+            const auto savedErrno = errno;
+            wl_display_cancel_read(connection_);
+            throw std::system_error(savedErrno, std::system_category(), "EventLoop::runOnce: poll failed");
+        }
+        lastWakeUpAt_ = Clock::now();
+
+        if ((pollFds_[0].revents & POLLIN) != 0)
+        {
+            if (MY_LOG_WLCALL(wl_display_read_events(connection_)) < 0)
+                return false;
+        }
+        else
+        {
+            wl_display_cancel_read(connection_);
+            if ((pollFds_[0].revents & (POLLERR | POLLHUP)) != 0)
+                return false;
+        }
+
+        if (MY_LOG_WLCALL(wl_display_dispatch_pending(connection_)) < 0)
+            return false;
+
+        // The watches added by the callbacks below aren't polled yet, so only the ones polled are iterated
+        const auto watchesPolled = pollFds_.size() - 1;
+        for (std::size_t i = 0; i < watchesPolled; ++i)
+        {
+            if ( (pollFds_[i + 1].revents != 0) && !fdWatches_[i].isRemoved )
+            {
+                // The callback may add new watches and hence reallocate fdWatches_
+                const auto callback = fdWatches_[i].callback;
+                callback(pollFds_[i + 1].revents);
+            }
+        }
+
+        fdWatches_.erase(
+            std::remove_if(fdWatches_.begin(), fdWatches_.end(), [](const FdWatch& watch) { return watch.isRemoved; }),
+            fdWatches_.end()
+        );
+
+        return true;
+    }
+
+public: // getters
+    /** When poll has returned last time, i.e. roughly when the events dispatched by the last runOnce() have arrived */
+    [[nodiscard]] std::optional<Clock::time_point> getLastWakeUpTime() const noexcept { return lastWakeUpAt_; }
+
+private:
+    struct FdWatch
+    {
+        FdWatchId id;
+        int fd;
+        short events;
+        FdCallback callback;
+        bool isRemoved;
+    };
+
+private:
+    wl_display* const connection_;
+
+    FdWatchId nextWatchId_ = 0;
+    std::vector<FdWatch> fdWatches_;
+    // Reused by every runOnce() ; pollFds_[0] is the Wayland connection, pollFds_[i + 1] corresponds to fdWatches_[i]
+    std::vector<pollfd> pollFds_;
+    std::optional<Clock::time_point> lastWakeUpAt_;
+    WaitObserver waitObserver_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_EVENT_LOOP_H
@@ -0,0 +1,377 @@
+#ifndef WAYLAND_INPUT_WINDOW_FLIGHT_RECORDER_H
+#define WAYLAND_INPUT_WINDOW_FLIGHT_RECORDER_H
+
+#include "app_clock.h"      // AppClock
+#include <array>            // std::array
+#include <atomic>           // std::atomic
+#include <bit>              // std::bit_cast
+#include <type_traits>      // std::is_pointer_v, std::is_integral_v, std::is_enum_v, std::is_same_v, std::make_unsigned_t, std::underlying_type_t
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint*_t, std::uintptr_t
+#include <cstdlib>          // std::getenv
+#include <cerrno>           // errno
+#include <cstring>          // std::strlen
+#include <csignal>          // sigaction, raise, SIG*
+#include <fcntl.h>          // open, O_*
+#include <unistd.h>         // write, close, getpid, gettid
+
+
+/**
+ * Always-on in-memory flight recorder: every thread has a fixed-size ring of binary events (Wayland calls, input
+ *   frames, render timings, etc.), which is dumped into a text file on the fatal errors so the post-mortems have the
+ *   context which TRACE logging would give without its cost.
+ * Recording is lock-free and never allocates: a timestamp plus a few stores into the thread's ring ; the event names
+ *   must be string literals (only the pointers are stored).
+ * Dumping is async-signal-safe (no allocations, no stdio), so it's done from the fatal signal handlers as well. The
+ *   rings of the other threads are read without synchronization, so an event being written meanwhile may be torn.
+ * An event is the time, the thread, the kind, the name and two 64-bit args, which the dump prints in hex as they are
+ *   stored (see toArg): the pointers as addresses, the integers and the enums zero-extended from their own width (so a
+ *   wl_fixed_t is its raw 24.8 bit pattern in the low 32 bits, e.g. 0xfffffe80 is -1.5), the doubles as their IEEE-754
+ *   bits.
+ */
+class FlightRecorder
+{
+public:
+    enum class Kind : std::uint32_t
+    {
+        MARK = 0,
+        WL_CALL,
+        // The entry points of the listeners of the Wayland events
+        EVENT,
+        RENDER,
+        ERROR
+    };
+
+    static constexpr std::size_t EVENTS_PER_THREAD = 4096;
+    static constexpr std::size_t MAX_THREADS = 32;
+
+    static_assert((EVENTS_PER_THREAD & (EVENTS_PER_THREAD - 1)) == 0, "EVENTS_PER_THREAD must be a power of 2");
+
+public:
+    FlightRecorder() = delete;
+
+public:
+    static void record(const Kind kind, const char* const what, const std::uint64_t arg0 = 0, const std::uint64_t arg1 = 0) noexcept
+    {
+        Ring* const ring = getThreadRing();
+        if (ring == nullptr)
+            return;
+
+        const auto head = ring->head.load(std::memory_order_relaxed);
+        auto& event = ring->events[head & (EVENTS_PER_THREAD - 1)];
+        event.timestampNs = nowNs();
+        event.what = what;
+        event.args[0] = arg0;
+        event.args[1] = arg1;
+        event.kind = kind;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Converts the results of the calls and the arguments of the events into the event args keeping their bits: the
+     *   signed values aren't sign-extended, so the dumped wl_fixed_t's can be decoded ; the other types (e.g. float)
+     *   don't compile rather than being recorded as 0
+     */
+    template<typename T>
+    [[nodiscard]] static std::uint64_t toArg(const T& value) noexcept
+    {
+        if constexpr (std::is_pointer_v<T>)
+            return reinterpret_cast<std::uintptr_t>(value);
+        else if constexpr (std::is_enum_v<T>)
+            return toArg(static_cast<std::underlying_type_t<T>>(value));
+        else if constexpr (std::is_same_v<T, bool>)
+            return value ? 1 : 0;
+        else if constexpr (std::is_integral_v<T>)
+            return static_cast<std::uint64_t>(static_cast<std::make_unsigned_t<T>>(value));
+        else if constexpr (std::is_same_v<T, double>)
+            return std::bit_cast<std::uint64_t>(value);
+        else
+            static_assert(sizeof(T) == 0, "FlightRecorder::toArg: the type has no defined record format");
+    }
+
+    /**
+     * Chooses the dump file and installs the handlers of SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT which dump the
+     *   rings and then re-raise the signal. Must be called once, at the beginning of main.
+     * The file is $WAYLAND_INPUT_WINDOW_FLIGHT_RECORDER_DIR (or $XDG_RUNTIME_DIR, or /tmp)/WaylandInputWindow-flight-<pid>.log
+     */
+    static void install() noexcept
+    {
+        const char* dir = std::getenv("WAYLAND_INPUT_WINDOW_FLIGHT_RECORDER_DIR");
+        if ( (dir == nullptr) || (dir[0] == '\0') )
+            dir = std::getenv("XDG_RUNTIME_DIR");
+        if ( (dir == nullptr) || (dir[0] == '\0') )
+            dir = "/tmp";
+
+        TextWriter path{ dumpPath_.data(), dumpPath_.size() - 1 };
+        path.append(dir);
+        path.append("/WaylandInputWindow-flight-");
+        path.appendDecimal(static_cast<std::uint64_t>(getpid()));
+        path.append(".log");
+        dumpPath_[path.getLength()] = '\0';
+
+        // A stack overflow leaves no stack for the handler
+        static std::array<std::byte, 64 * 1024> alternateStack;
+        stack_t stack{};
+        stack.ss_sp = alternateStack.data();
+        stack.ss_size = alternateStack.size();
+        (void)sigaltstack(&stack, nullptr);
+
+        struct sigaction action{};
+        action.sa_handler = &onFatalSignal;
+        action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (const int signal : { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT })
+            (void)sigaction(signal, &action, nullptr);
+    }
+
+    /**
+     * Writes all the rings, merged by time, into the dump file ; reason goes into its header.
+     * @return the path of the file or nullptr if it couldn't be written
+     */
+    static const char* dump(const char* const reason) noexcept
+    {
+        if (dumpPath_[0] == '\0')
+            return nullptr;
+
+        const int fd = open(dumpPath_.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return nullptr;
+
+        const bool isWritten = dumpTo(fd, reason);
+        return ( (close(fd) == 0) && isWritten ) ? dumpPath_.data() : nullptr;
+    }
+
+private:
+    struct Event
+    {
+        std::uint64_t timestampNs;
+        const char* what;
+        std::uint64_t args[2];
+        Kind kind;
+    };
+
+    struct Ring
+    {
+        // The number of the events ever recorded ; the last EVENTS_PER_THREAD of them are kept
+        std::atomic<std::uint64_t> head{ 0 };
+        std::atomic<bool> isOwned{ false };
+        pid_t tid = 0;
+        std::array<Event, EVENTS_PER_THREAD> events;
+    };
+
+    /** Releases the ring of a thread when it exits ; its events stay until another thread takes the ring */
+    struct RingOwnership
+    {
+        Ring* ring = nullptr;
+
+        ~RingOwnership()
+        {
+            if (ring != nullptr)
+                ring->isOwned.store(false, std::memory_order_release);
+        }
+    };
+
+    /** Formats the text into a fixed buffer without allocations ; the overflowing part is dropped */
+    class TextWriter
+    {
+    public:
+        TextWriter(char* const buffer, const std::size_t capacity) noexcept
+            : buffer_{ buffer }
+            , capacity_{ capacity }
+        {}
+
+        void append(const char* const str) noexcept
+        {
+            for (const char* c = (str == nullptr) ? "<null>" : str; (*c != '\0') && (length_ < capacity_); ++c)
+                buffer_[length_++] = *c;
+        }
+
+        void appendDecimal(std::uint64_t value) noexcept
+        {
+            char digits[20];
+            std::size_t count = 0;
+            do
+            {
+                digits[count++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value > 0);
+
+            while ( (count > 0) && (length_ < capacity_) )
+                buffer_[length_++] = digits[--count];
+        }
+
+        void appendHex(const std::uint64_t value) noexcept
+        {
+            append("0x");
+            bool isLeadingZero = true;
+            for (int shift = 60; shift >= 0; shift -= 4)
+            {
+                const auto digit = static_cast<unsigned>((value >> shift) & 0xF);
+                if ( isLeadingZero && (digit == 0) && (shift > 0) )
+                    continue;
+                isLeadingZero = false;
+                if (length_ < capacity_)
+                    buffer_[length_++] = "0123456789abcdef"[digit];
+            }
+        }
+
+        [[nodiscard]] std::size_t getLength() const noexcept { return length_; }
+        void clear() noexcept { length_ = 0; }
+
+    private:
+        char* const buffer_;
+        const std::size_t capacity_;
+        std::size_t length_ = 0;
+    };
+
+private:
+    /**
+     * The rings exist before main and are never destroyed, so the fatal signal handlers may dump them at any point:
+     *   the array is constant-initialized, hence there's no (non async-signal-safe) initialization guard
+     */
+    [[nodiscard]] static std::array<Ring, MAX_THREADS>& getRings() noexcept
+    {
+        static std::array<Ring, MAX_THREADS> rings;
+        return rings;
+    }
+
+    /** The virtual time if it's enabled, so the records of the deterministic runs match */
+    [[nodiscard]] static std::uint64_t nowNs() noexcept
+    {
+        return static_cast<std::uint64_t>(AppClock::now().time_since_epoch().count());
+    }
+
+    [[nodiscard]] static Ring* getThreadRing() noexcept
+    {
+        thread_local RingOwnership ownership;
+        if (ownership.ring != nullptr)
+            return ownership.ring;
+
+        // The rings never used go first, so the events of the threads which have exited are kept as long as possible
+        for (const bool wasUsed : { false, true })
+        {
+            for (auto& ring : getRings())
+            {
+                if ( ((ring.head.load(std::memory_order_relaxed) != 0) != wasUsed) || ring.isOwned.load(std::memory_order_relaxed) )
+                    continue;
+
+                bool expected = false;
+                if (ring.isOwned.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                {
+                    ring.tid = gettid();
+                    ownership.ring = &ring;
+                    return &ring;
+                }
+            }
+        }
+
+        // All the rings are taken, the events of this thread are dropped
+        return nullptr;
+    }
+
+    static bool dumpTo(const int fd, const char* const reason) noexcept
+    {
+        std::array<char, 1024> line;
+        TextWriter writer{ line.data(), line.size() - 1 };
+        bool isWritten = true;
+        const auto flushLine = [&] {
+            writer.append("\n");
+            const auto length = writer.getLength();
+            isWritten = isWritten && (write(fd, line.data(), length) == static_cast<ssize_t>(length));
+            writer.clear();
+        };
+
+        writer.append("WaylandInputWindow flight recorder dump: ");
+        writer.append(reason);
+        flushLine();
+        writer.append("now_ns=");
+        writer.appendDecimal(nowNs());
+        writer.append(" ; columns: time_ns tid kind what arg0 arg1");
+        flushLine();
+
+        // The rings are merged by time ; cursors[i] is the index of the next event of rings[i]
+        const auto& rings = getRings();
+        std::array<std::uint64_t, MAX_THREADS> cursors{};
+        std::array<std::uint64_t, MAX_THREADS> ends{};
+        for (std::size_t i = 0; i < MAX_THREADS; ++i)
+        {
+            ends[i] = rings[i].head.load(std::memory_order_acquire);
+            cursors[i] = (ends[i] > EVENTS_PER_THREAD) ? (ends[i] - EVENTS_PER_THREAD) : 0;
+        }
+
+        while (true)
+        {
+            std::size_t earliest = MAX_THREADS;
+            for (std::size_t i = 0; i < MAX_THREADS; ++i)
+            {
+                if (cursors[i] == ends[i])
+                    continue;
+                if ( (earliest == MAX_THREADS) ||
+                     (rings[i].events[cursors[i] & (EVENTS_PER_THREAD - 1)].timestampNs < rings[earliest].events[cursors[earliest] & (EVENTS_PER_THREAD - 1)].timestampNs) )
+                    earliest = i;
+            }
+            if (earliest == MAX_THREADS)
+                break;
+
+            const auto& ring = rings[earliest];
+            const auto& event = ring.events[(cursors[earliest]++) & (EVENTS_PER_THREAD - 1)];
+
+            writer.appendDecimal(event.timestampNs);
+            writer.append(" ");
+            writer.appendDecimal(static_cast<std::uint64_t>(ring.tid));
+            writer.append(" ");
+            writer.append(getKindName(event.kind));
+            writer.append(" ");
+            writer.append(event.what);
+            writer.append(" ");
+            writer.appendHex(event.args[0]);
+            writer.append(" ");
+            writer.appendHex(event.args[1]);
+            flushLine();
+        }
+
+        return isWritten;
+    }
+
+    [[nodiscard]] static const char* getKindName(const Kind kind) noexcept
+    {
+        switch (kind)
+        {
+            case Kind::MARK:    return "MARK";
+            case Kind::WL_CALL: return "WLCALL";
+            case Kind::EVENT:   return "EVENT";
+            case Kind::RENDER:  return "RENDER";
+            case Kind::ERROR:   return "ERROR";
+        }
+        return "?";
+    }
+
+    static void onFatalSignal(const int signal)
+    {
+        const int savedErrno = errno;
+
+        std::array<char, 64> reason;
+        TextWriter writer{ reason.data(), reason.size() - 1 };
+        writer.append("fatal signal ");
+        writer.appendDecimal(static_cast<std::uint64_t>(signal));
+        reason[writer.getLength()] = '\0';
+
+        if (const char* const path = dump(reason.data()); path != nullptr)
+        {
+            static constexpr char message[] = "The flight recorder has been dumped into ";
+            (void)write(STDERR_FILENO, message, sizeof(message) - 1);
+            (void)write(STDERR_FILENO, path, std::strlen(path));
+            (void)write(STDERR_FILENO, "\n", 1);
+        }
+
+        errno = savedErrno;
+        // The default action now, since the handler has been reset (SA_RESETHAND)
+        (void)raise(signal);
+    }
+
+private:
+    static inline std::array<char, 256> dumpPath_{};
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_FLIGHT_RECORDER_H
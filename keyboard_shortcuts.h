@@ -0,0 +1,165 @@
+#ifndef WAYLAND_INPUT_WINDOW_KEYBOARD_SHORTCUTS_H
+#define WAYLAND_INPUT_WINDOW_KEYBOARD_SHORTCUTS_H
+
+#include <xkbcommon/xkbcommon.h>    // xkb_*, XKB_KEY_*, XKB_MOD_NAME_*
+#include <array>                    // std::array
+#include <optional>                 // std::optional
+#include <stdexcept>                // std::logic_error
+#include <cstddef>                  // std::size_t
+#include <utility>                  // std::pair
+#include <cstdint>                  // std::uint8_t, std::uint32_t, std::uint64_t
+
+
+enum class ShortcutAction : std::uint8_t
+{
+    PAN_LEFT,
+    PAN_RIGHT,
+    PAN_UP,
+    PAN_DOWN,
+    ZOOM_IN,
+    ZOOM_OUT,
+    RESTORE_ZOOM,
+    QUIT
+};
+
+// The modifiers of the shortcuts ; independent of the keymaps, unlike the xkb modifier indices
+enum ShortcutModifiers : std::uint32_t
+{
+    SHORTCUT_MOD_NONE  = 0,
+    SHORTCUT_MOD_CTRL  = 1u << 0,
+    SHORTCUT_MOD_SHIFT = 1u << 1,
+    SHORTCUT_MOD_ALT   = 1u << 2,
+    SHORTCUT_MOD_LOGO  = 1u << 3
+};
+
+struct Shortcut
+{
+    xkb_keysym_t keysym;
+    // ShortcutModifiers ; must match exactly
+    std::uint32_t modifiers;
+    ShortcutAction action;
+};
+
+
+/**
+ * The shortcuts compiled into a perfect hash table: a key press is dispatched with one multiplication and one
+ *   comparison, without any allocation, no matter how many shortcuts there are.
+ * The seed of the hash function is searched for at compile time ; duplicate shortcuts make the table fail to compile.
+ */
+template<std::size_t N>
+class PerfectHashShortcutTable
+{
+public:
+    // At most half of the slots are occupied, so a seed is found in a few attempts
+    static constexpr std::size_t SLOTS_BITS = [] {
+        std::size_t bits = 1;
+        while ((std::size_t{1} << bits) < 2 * N)
+            ++bits;
+        return bits;
+    }();
+    static constexpr std::size_t SLOTS_COUNT = std::size_t{1} << SLOTS_BITS;
+    static constexpr std::uint64_t MAX_SEED_ATTEMPTS = 1u << 16;
+
+public: // ctors/dtor
+    constexpr explicit PerfectHashShortcutTable(const std::array<Shortcut, N>& shortcuts)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (shortcuts[i].keysym == XKB_KEY_NoSymbol)
+                throw std::logic_error{"PerfectHashShortcutTable: XKB_KEY_NoSymbol marks the empty slots"};
+            for (std::size_t j = i + 1; j < N; ++j)
+            {
+                if ( (shortcuts[i].keysym == shortcuts[j].keysym) && (shortcuts[i].modifiers == shortcuts[j].modifiers) )
+                    throw std::logic_error{"PerfectHashShortcutTable: duplicate shortcuts"};
+            }
+        }
+
+        for (std::uint64_t attempt = 0; attempt < MAX_SEED_ATTEMPTS; ++attempt)
+        {
+            seed_ = attempt * 0xBF58476D1CE4E5B9ull;
+            if (tryFill(shortcuts))
+                return;
+        }
+        throw std::logic_error{"PerfectHashShortcutTable: no perfect hash seed found"};
+    }
+
+public:
+    [[nodiscard]] constexpr std::optional<ShortcutAction> find(const xkb_keysym_t keysym, const std::uint32_t modifiers) const noexcept
+    {
+        const auto& slot = slots_[getSlotIdx(keysym, modifiers)];
+        if ( (slot.keysym == keysym) && (slot.modifiers == modifiers) && (keysym != XKB_KEY_NoSymbol) )
+            return slot.action;
+        return std::nullopt;
+    }
+
+private:
+    [[nodiscard]] constexpr std::size_t getSlotIdx(const xkb_keysym_t keysym, const std::uint32_t modifiers) const noexcept
+    {
+        const std::uint64_t key = static_cast<std::uint64_t>(keysym) | (static_cast<std::uint64_t>(modifiers) << 32);
+        return static_cast<std::size_t>( ((key ^ seed_) * 0x9E3779B97F4A7C15ull) >> (64 - SLOTS_BITS) );
+    }
+
+    [[nodiscard]] constexpr bool tryFill(const std::array<Shortcut, N>& shortcuts) noexcept
+    {
+        slots_ = {};
+        for (const auto& shortcut : shortcuts)
+        {
+            auto& slot = slots_[getSlotIdx(shortcut.keysym, shortcut.modifiers)];
+            if (slot.keysym != XKB_KEY_NoSymbol)
+                return false;
+            slot = shortcut;
+        }
+        return true;
+    }
+
+private:
+    std::uint64_t seed_ = 0;
+    std::array<Shortcut, SLOTS_COUNT> slots_{};
+};
+
+
+/** The app's shortcuts ; the pan and zoom ones apply to the window having the keyboard focus */
+inline constexpr PerfectHashShortcutTable KEYBOARD_SHORTCUTS{ std::array{
+    Shortcut{ XKB_KEY_Left,        SHORTCUT_MOD_NONE, ShortcutAction::PAN_LEFT },
+    Shortcut{ XKB_KEY_Right,       SHORTCUT_MOD_NONE, ShortcutAction::PAN_RIGHT },
+    Shortcut{ XKB_KEY_Up,          SHORTCUT_MOD_NONE, ShortcutAction::PAN_UP },
+    Shortcut{ XKB_KEY_Down,        SHORTCUT_MOD_NONE, ShortcutAction::PAN_DOWN },
+    // Shift+'=' on the US layouts ; Shift is consumed, see getShortcutModifiers
+    Shortcut{ XKB_KEY_plus,        SHORTCUT_MOD_CTRL, ShortcutAction::ZOOM_IN },
+    Shortcut{ XKB_KEY_equal,       SHORTCUT_MOD_CTRL, ShortcutAction::ZOOM_IN },
+    Shortcut{ XKB_KEY_KP_Add,      SHORTCUT_MOD_CTRL, ShortcutAction::ZOOM_IN },
+    Shortcut{ XKB_KEY_minus,       SHORTCUT_MOD_CTRL, ShortcutAction::ZOOM_OUT },
+    Shortcut{ XKB_KEY_KP_Subtract, SHORTCUT_MOD_CTRL, ShortcutAction::ZOOM_OUT },
+    Shortcut{ XKB_KEY_0,           SHORTCUT_MOD_CTRL, ShortcutAction::RESTORE_ZOOM },
+    Shortcut{ XKB_KEY_KP_0,        SHORTCUT_MOD_CTRL, ShortcutAction::RESTORE_ZOOM },
+    Shortcut{ XKB_KEY_q,           SHORTCUT_MOD_CTRL, ShortcutAction::QUIT }
+} };
+
+
+/**
+ * The ShortcutModifiers active for the key, except the ones consumed by the translation of the key into its keysym
+ *   (e.g. Shift of '+' on the US layouts).
+ */
+inline std::uint32_t getShortcutModifiers(xkb_keymap* const keymap, xkb_state* const state, const xkb_keycode_t key) noexcept
+{
+    static constexpr std::array<std::pair<const char*, ShortcutModifiers>, 4> MODIFIERS = {{
+        { XKB_MOD_NAME_CTRL,  SHORTCUT_MOD_CTRL },
+        { XKB_MOD_NAME_SHIFT, SHORTCUT_MOD_SHIFT },
+        { XKB_MOD_NAME_ALT,   SHORTCUT_MOD_ALT },
+        { XKB_MOD_NAME_LOGO,  SHORTCUT_MOD_LOGO }
+    }};
+
+    std::uint32_t result = SHORTCUT_MOD_NONE;
+    for (const auto& [name, modifier] : MODIFIERS)
+    {
+        const auto modIdx = xkb_keymap_mod_get_index(keymap, name);
+        if ( (modIdx != XKB_MOD_INVALID) &&
+             (xkb_state_mod_index_is_active(state, modIdx, XKB_STATE_MODS_EFFECTIVE) > 0) &&
+             (xkb_state_mod_index_is_consumed(state, key, modIdx) <= 0) )
+            result |= modifier;
+    }
+    return result;
+}
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_KEYBOARD_SHORTCUTS_H
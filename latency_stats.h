@@ -0,0 +1,131 @@
+#ifndef WAYLAND_INPUT_WINDOW_LATENCY_STATS_H
+#define WAYLAND_INPUT_WINDOW_LATENCY_STATS_H
+
+#include "utilities.h"      // MY_LOG_*
+#include <array>            // std::array
+#include <algorithm>        // std::min, std::max
+#include <limits>           // std::numeric_limits
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint64_t
+#include <cmath>            // std::floor, std::ceil
+
+
+/**
+ * The distribution of the latencies of some kind, in milliseconds.
+ * The buckets have a fixed width, so recording never allocates and the percentiles are precise up to BUCKET_WIDTH_MS ;
+ *   everything above the last bucket falls into it.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr double BUCKET_WIDTH_MS = 0.25;
+    static constexpr std::size_t BUCKETS_COUNT = 400;
+
+public:
+    void record(const double latencyMs) noexcept
+    {
+        const double clamped = std::max(0.0, latencyMs);
+        const auto bucketIdx = std::min<std::size_t>(static_cast<std::size_t>(std::floor(clamped / BUCKET_WIDTH_MS)), BUCKETS_COUNT - 1);
+
+        ++buckets_[bucketIdx];
+        ++count_;
+        sumMs_ += clamped;
+        minMs_ = std::min(minMs_, clamped);
+        maxMs_ = std::max(maxMs_, clamped);
+    }
+
+    void reset() noexcept
+    {
+        *this = LatencyHistogram{};
+    }
+
+public: // getters
+    [[nodiscard]] std::uint64_t getCount() const noexcept { return count_; }
+    [[nodiscard]] double getMinMs() const noexcept { return (count_ == 0) ? 0 : minMs_; }
+    [[nodiscard]] double getMaxMs() const noexcept { return maxMs_; }
+    [[nodiscard]] double getMeanMs() const noexcept { return (count_ == 0) ? 0 : sumMs_ / static_cast<double>(count_); }
+
+    /** The upper bound of the bucket containing the percentile ; fraction is in [0; 1] */
+    [[nodiscard]] double getPercentileMs(const double fraction) const noexcept
+    {
+        if (count_ == 0)
+            return 0;
+
+        const auto rank = static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(count_)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS_COUNT; ++i)
+        {
+            seen += buckets_[i];
+            // The last bucket has no upper bound
+            if ( (seen >= rank) && (seen > 0) )
+                return (i + 1 == BUCKETS_COUNT) ? maxMs_ : std::min(static_cast<double>(i + 1) * BUCKET_WIDTH_MS, maxMs_);
+        }
+        return maxMs_;
+    }
+
+private:
+    std::array<std::uint64_t, BUCKETS_COUNT> buckets_{};
+    std::uint64_t count_ = 0;
+    double sumMs_ = 0;
+    double minMs_ = std::numeric_limits<double>::max();
+    double maxMs_ = 0;
+};
+
+
+/** Collects a LatencyHistogram and logs its summary every REPORT_PERIOD samples and on destruction */
+class LatencyMeter
+{
+public:
+    static constexpr std::uint64_t REPORT_PERIOD = 600;
+
+public: // ctors/dtor
+    explicit LatencyMeter(const char* const name) noexcept
+        : name_{ name }
+    {}
+
+    LatencyMeter(const LatencyMeter&) = delete;
+
+    ~LatencyMeter() noexcept
+    {
+        report();
+    }
+
+public: // assignments
+    LatencyMeter& operator=(const LatencyMeter&) = delete;
+
+public:
+    void record(const double latencyMs) noexcept
+    {
+        histogram_.record(latencyMs);
+        if (histogram_.getCount() >= REPORT_PERIOD)
+        {
+            report();
+            histogram_.reset();
+        }
+    }
+
+    void report() const noexcept
+    {
+        if (histogram_.getCount() == 0)
+            return;
+
+        MY_LOG_INFO(
+            "Latency \"", name_, "\" over ", histogram_.getCount(), " frames (ms): ",
+            "min=", histogram_.getMinMs(), ", ",
+            "mean=", histogram_.getMeanMs(), ", ",
+            "p50=", histogram_.getPercentileMs(0.5), ", ",
+            "p99=", histogram_.getPercentileMs(0.99), ", ",
+            "max=", histogram_.getMaxMs()
+        );
+    }
+
+public: // getters
+    [[nodiscard]] const LatencyHistogram& getHistogram() const noexcept { return histogram_; }
+
+private:
+    const char* name_;
+    LatencyHistogram histogram_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_LATENCY_STATS_H
@@ -1,6 +1,33 @@
 #include "utilities.h"               // WLResourceWrapper, makeWLResourceWrapperChecked, logging::*, MY_LOG_*
+#include "tile_cache.h"              // TileKey, PersistentTileStore, CompressedTileCache
+#include "memory_budget.h"           // MemoryBudgetGovernor
+#include "event_loop.h"              // EventLoop
+#include "coro_runtime.h"            // CoroRuntime, Task, awaitDisplaySync
+#include "content_renderer.h"        // MAIN_WINDOW_CONTENT_ID, renderContentTile
+#include "content_state.h"           // ContentState
+#include "data_transfer.h"           // DataTransfers
+#include "pointer_cursor.h"          // PointerCursor, CursorTheme, CursorShape
+#include "touch_gestures.h"          // TouchContactTable, TouchGestureRecognizer
+#include "stroke_pipeline.h"         // InkLayer, StrokePipeline, StrokeSample
+#include "render_pool.h"             // RenderWorkerPool
+#include "latency_stats.h"           // LatencyMeter
+#include "pixel_formats.h"           // ShmPixelFormat, SHM_PIXEL_FORMATS, ShmFormatSelector
+#include "perf_counters.h"           // PerfCounters
+#include "stall_watchdog.h"          // StallWatchdog
+#include "energy_meter.h"            // EnergyMeter
+#include "thread_scheduling.h"       // ThreadScheduling
+#include "keyboard_shortcuts.h"      // KEYBOARD_SHORTCUTS, ShortcutAction, getShortcutModifiers
+#include "bandwidth_roofline.h"      // BandwidthRoofline
+#include "app_clock.h"               // AppClock
+#include "blocked_image.h"           // BlockedImage
+#include "zoom_kernels.h"            // resampleNearest, resampleAffineNearest, AffineSampling, LinearImageView
 #include <wayland-client.h>          // wl_*
 #include <xdg-shell.h>               // xdg_*
+#include <cursor-shape-v1.h>         // wp_cursor_shape_*
+#include <pointer-gestures-unstable-v1.h> // zwp_pointer_gesture*
+#include <tablet-unstable-v2.h>      // zwp_tablet_*
+#include <tearing-control-v1.h>      // wp_tearing_control_*
+#include <content-type-v1.h>         // wp_content_type_*
 #include <linux/input-event-codes.h> // BTN_*
 #include <xkbcommon/xkbcommon.h>     // xkb_*
 #include <sys/mman.h>                // mmap, munmap
@@ -11,10 +38,21 @@
 #include <optional>                  // std::optional
 #include <variant>                   // std::variant
 #include <vector>                    // std::vector
-#include <utility>                   // std::move
+#include <deque>                     // std::deque
+#include <utility>                   // std::move, std::pair
 #include <limits>                    // std::numeric_limits
 #include <bitset>                    // std::bitset
-#include <memory>                    // std::shared_ptr
+#include <memory>                    // std::shared_ptr, std::destroy_at, std::construct_at
+#include <poll.h>                    // POLLIN, POLLPRI
+#include <algorithm>                 // std::min, std::max, std::clamp, std::none_of
+#include <cmath>                     // std::round, std::sqrt, std::sin, std::cos, std::remainder
+#include <numbers>                   // std::numbers::pi
+#include <cstring>                   // std::memcpy
+#include <chrono>                    // std::chrono::duration
+#include <csignal>                   // std::signal, SIGPIPE, SIG_IGN
+#include <cerrno>                    // EPROTO
+#include <unistd.h>                  // pipe2, close
+#include <fcntl.h>                   // O_CLOEXEC
 
 
 namespace wl_pointer_event_frame_types
@@ -98,31 +136,114 @@ struct WLAppCtx
     WLResourceWrapper<wl_compositor*> compositor;
 
     WLResourceWrapper<wl_shm*> shmProvider;
+    // The formats advertised by shmProvider
+    ShmFormatSelector shmFormats;
 
     // The entry point to the XDG shell protocol, responsible for assigning window roles to wl_surface instances
     //   and making them able to be dragged, resized, maximized, etc
     WLResourceWrapper<xdg_wm_base*> xdgShell;
 
-    // The bridge to all input devices: mouses, keyboards, touchpads, touchscreens, etc.
-    WLResourceWrapper<wl_seat*> inputDevicesManager;
+    // Provides the server side cursors ; may be absent on the server
+    WLResourceWrapper<wp_cursor_shape_manager_v1*> cursorShapeManager;
+    // The images of the client side cursors shared by the pointers of all the seats ; only loaded (once, at startup)
+    //   if there's no cursorShapeManager
+    CursorTheme cursorTheme;
 
+    // Provides the touchpad gestures (pinch, swipe) ; may be absent on the server
+    WLResourceWrapper<zwp_pointer_gestures_v1*> pointerGestures;
+
+    // The entry point to the drawing tablets ; may be absent on the server
+    WLResourceWrapper<zwp_tablet_manager_v2*> tabletManager;
+
+    // The entry point to the clipboard and drag-and-drop ; may be absent on the server
+    WLResourceWrapper<wl_data_device_manager*> dataDeviceManager;
+
+    // $WAYLAND_INPUT_WINDOW_LATENCY_MODE=1: the windows are redrawn as soon as the input changes them instead of
+    //   once per wl_surface::frame, and the server is asked to present them right away even if that means tearing
+    bool isLatencyMode = false;
+    // Only bound in the latency mode ; may be absent on the server
+    WLResourceWrapper<wp_tearing_control_manager_v1*> tearingControlManager;
+    WLResourceWrapper<wp_content_type_manager_v1*> contentTypeManager;
+
+    // The pixel buffers of all the windows are slices of this single shared memory buffer, which is shared with
+    //   the server via a single wl_shm_pool ; that's 1 fd and 1 mapping in both processes whatever the number of
+    //   the windows
     struct
     {
+        SharedMemoryBuffer buffer;
+        WLResourceWrapper<wl_shm_pool*> pool;
+    } shmArena;
+
+    // A toplevel window showing the content ; all the windows share the connection, the globals, shmArena, the
+    //   tiles caches and the ink, but each one has its own surface and view of the content
+    using WindowId = std::uint32_t;
+    // $WAYLAND_INPUT_WINDOW_WINDOWS is clamped to it
+    static constexpr std::size_t MAX_WINDOWS = 64;
+    struct Window
+    {
+        // The index in windows
+        WindowId id = 0;
+
         const std::size_t width  = 800;
         const std::size_t height = 600;
-        // XRGB8888 is used
-        const std::size_t bytesPerPixel = 4;
-
-        SharedMemoryBuffer surfaceSharedBuffer;
-        WLResourceWrapper<wl_shm_pool*> surfaceBufferWLPool;
+        // The format of the buffers ; chosen before they're allocated
+        const ShmPixelFormat* shmFormat = &SHM_PIXEL_FORMATS[0];
+        std::size_t bytesPerPixel = 4;
+        // The frames are composed as XRGB8888 ; here if the buffers have another format, right in the pending buffer
+        //   otherwise. Keeps the frame committed last.
+        std::vector<std::uint32_t> composedFrame;
+
+        // The 2 pixel buffers of the window (for the double buffering), which are the slice of shmArena starting at
+        //   arenaOffset
+        std::byte* buffersData = nullptr;
+        std::size_t arenaOffset = 0;
         WLResourceWrapper<wl_buffer*> surfaceWLSideBuffer1;
         WLResourceWrapper<wl_buffer*> surfaceWLSideBuffer2;
         /* 0 for surfaceWLSideBuffer1, 1 for surfaceWLSideBuffer2 */
         unsigned pendingBufferIdx = 0;
+        // The server may read a buffer from its commit until wl_buffer::release ; indexed like pendingBufferIdx
+        bool isBufferBusy[2] = { false, false };
+        // The pages of the pending buffer have been returned to the system by the memory budget (a full frame is
+        //   composed over all the pixels, and the ink only frame copies the whole presented one first, so there's
+        //   nothing to lose) ; reset by the next commit
+        bool isPendingBufferReleased = false;
+
+        // A rect of the surface buffers, in pixels
+        struct BufferRect
+        {
+            std::size_t x;
+            std::size_t y;
+            std::size_t width;
+            std::size_t height;
+        };
+        // The rects the frame being composed differs from the presented one in ; damaged on commit
+        std::vector<BufferRect> frameDamage;
+        // The rects the frame committed last differs from the one before it in, i.e. the rects the pending buffer
+        //   lags behind the presented one in
+        std::vector<BufferRect> lastFrameDamage;
+        // The content rects of the ink tiles changed since the frame committed last ; if nothing else has changed,
+        //   only the parts of the frame showing them are recomposed (see renderWindowInk)
+        std::vector<InkLayer::Rect> inkDirtyRects;
+        // Beyond it the changed ink is recomposed as a full frame, which also bounds inkDirtyRects while the window
+        //   isn't redrawn
+        static constexpr std::size_t MAX_INK_DIRTY_RECTS = 256;
+
+        void setShmFormat(const ShmPixelFormat& format)
+        {
+            shmFormat = &format;
+            bytesPerPixel = format.bytesPerPixel;
+            composedFrame.assign( (format.convertRow == nullptr) ? 0 : width * height, 0 );
+        }
 
+        /** The size of the slice of shmArena needed by the window */
+        [[nodiscard]] std::size_t getBuffersSizeBytes() const noexcept
+        {
+            return 2 * getSurfaceBufferStrideBytes() * height;
+        }
+        /** The offset relative to buffersData */
         [[nodiscard]] std::size_t getSurfaceBufferOffsetForIdx(unsigned idx) const noexcept
         {
-            return idx * width * bytesPerPixel * height;
+            return idx * getSurfaceBufferStrideBytes() * height;
         }
         [[nodiscard]] std::size_t getSurfaceBufferPendingOffset() const noexcept
         {
@@ -132,6 +253,88 @@ struct WLAppCtx
         {
             return (pendingBufferIdx == 0) ? surfaceWLSideBuffer1.getResource() : surfaceWLSideBuffer2.getResource();
         }
+        /** The rows of the 3 bytes formats are padded to 4 bytes */
+        [[nodiscard]] std::size_t getSurfaceBufferStrideBytes() const noexcept
+        {
+            return (width * bytesPerPixel + 3) / 4 * 4;
+        }
+        /** The address of the pixel (x; y) in the pending buffer */
+        [[nodiscard]] std::byte* getPendingPixelAddress(const std::size_t x, const std::size_t y)
+        {
+            return &buffersData[getSurfaceBufferPendingOffset() + y * getSurfaceBufferStrideBytes() + x * bytesPerPixel];
+        }
+
+        /** The address of the XRGB8888 pixel (x; y) of the frame being composed */
+        [[nodiscard]] std::byte* getComposedPixelAddress(const std::size_t x, const std::size_t y)
+        {
+            if (composedFrame.empty())
+                return getPendingPixelAddress(x, y);
+            return reinterpret_cast<std::byte*>(&composedFrame[y * width + x]);
+        }
+        [[nodiscard]] std::size_t getComposedStrideBytes() const noexcept
+        {
+            return composedFrame.empty() ? getSurfaceBufferStrideBytes() : width * sizeof(composedFrame[0]);
+        }
+        /** Converts the composed frame into the pending buffer unless it's been composed right there */
+        void convertComposedFrame() noexcept
+        {
+            convertComposedRect(BufferRect{ 0, 0, width, height });
+        }
+        /** Same as convertComposedFrame, but only the rect */
+        void convertComposedRect(const BufferRect& rect) noexcept
+        {
+            if (composedFrame.empty())
+                return;
+
+            for (std::size_t y = rect.y; y < rect.y + rect.height; ++y)
+                shmFormat->convertRow(&composedFrame[y * width + rect.x], getPendingPixelAddress(rect.x, y), rect.width);
+        }
+        /**
+         * Brings the pending buffer up to the presented frame by copying the rects of lastFrameDamage from the
+         *   presented buffer (all of it if the pending one has been released), so a frame can be updated partially
+         */
+        void catchUpPendingBuffer() noexcept
+        {
+            const auto strideBytes = getSurfaceBufferStrideBytes();
+            const std::byte* const presented = buffersData + getSurfaceBufferOffsetForIdx((pendingBufferIdx + 1) % 2);
+            std::byte* const pending = buffersData + getSurfaceBufferPendingOffset();
+
+            if (isPendingBufferReleased)
+            {
+                std::memcpy(pending, presented, strideBytes * height);
+                return;
+            }
+
+            for (const auto& rect : lastFrameDamage)
+            {
+                for (std::size_t y = rect.y; y < rect.y + rect.height; ++y)
+                {
+                    const auto offset = y * strideBytes + rect.x * bytesPerPixel;
+                    std::memcpy(pending + offset, presented + offset, rect.width * bytesPerPixel);
+                }
+            }
+        }
+        /** Queues the changed ink tiles to be shown (see inkDirtyRects) */
+        void addInkDirtyRects(const std::vector<InkLayer::Rect>& rects)
+        {
+            if (isClosed || mustBeRedrawn)
+                return;
+
+            if (inkDirtyRects.size() + rects.size() > MAX_INK_DIRTY_RECTS)
+            {
+                inkDirtyRects.clear();
+                mustBeRedrawn = true;
+                return;
+            }
+            inkDirtyRects.insert(inkDirtyRects.end(), rects.begin(), rects.end());
+        }
+        /** The XRGB8888 pixels of the frame committed last, i.e. of the one presented ; the rows are tightly packed */
+        [[nodiscard]] const std::byte* getPresentedPixels() const noexcept
+        {
+            if (!composedFrame.empty())
+                return reinterpret_cast<const std::byte*>(composedFrame.data());
+            return buffersData + getSurfaceBufferOffsetForIdx((pendingBufferIdx + 1) % 2);
+        }
 
         template<typename Visitor>
         void drawVia(
@@ -141,7 +344,7 @@ struct WLAppCtx
             std::size_t rectWidth = std::numeric_limits<std::size_t>::max(),
             std::size_t rectHeight = std::numeric_limits<std::size_t>::max()
         ) {
-            MY_LOG_TRACE("mainWindow::drawVia: drawing into ", (pendingBufferIdx == 0) ? "1st" : "2nd", " buffer...");
+            MY_LOG_TRACE("window#", id, "::drawVia: drawing into the frame of ", (pendingBufferIdx == 0) ? "1st" : "2nd", " buffer...");
 
             if ( (rectX >= 0 + width) || (rectY >= 0 + height) )
             {
@@ -152,21 +355,17 @@ struct WLAppCtx
             const auto rectXMax = rectX + rectWidth;
             const auto rectYMax = rectY + rectHeight;
 
-            const auto bufferToWriteOffset = getSurfaceBufferPendingOffset();
-
             for (std::size_t y = rectY; y < rectYMax; ++y)
             {
-                const std::size_t rowOffset = bufferToWriteOffset + y * width * bytesPerPixel;
-
                 for (std::size_t x = rectX; x < rectXMax; ++x)
                 {
-                    const std::size_t pixelOffset = rowOffset + x * bytesPerPixel;
+                    std::byte* const pixel = getComposedPixelAddress(x, y);
 
                     // XRGB8888 format
-                    std::byte& b = surfaceSharedBuffer[pixelOffset + 0];
-                    std::byte& g = surfaceSharedBuffer[pixelOffset + 1];
-                    std::byte& r = surfaceSharedBuffer[pixelOffset + 2];
-                    std::byte& a = surfaceSharedBuffer[pixelOffset + 3];
+                    std::byte& b = pixel[0];
+                    std::byte& g = pixel[1];
+                    std::byte& r = pixel[2];
+                    std::byte& a = pixel[3];
 
                     std::forward<Visitor>(v)(x, y, b, g, r);
                     a = std::byte{ 0xFF };
@@ -179,81 +378,460 @@ struct WLAppCtx
         WLResourceWrapper<xdg_surface*> xdgSurface;
         WLResourceWrapper<xdg_toplevel*> xdgToplevel;
 
+        // The presentation hints of the latency mode
+        WLResourceWrapper<wp_tearing_control_v1*> tearingControl;
+        WLResourceWrapper<wp_content_type_v1*> contentType;
+
+        // The pending wl_surface::frame callback ; destroyed by the server once it's done
+        wl_callback* pendingFrameCallback = nullptr;
+        // When the input shown by the frame of pendingFrameCallback has arrived (if it's measured)
+        std::optional<EventLoop::Clock::time_point> pendingFrameInputAt;
+        // When the earliest input not committed yet has arrived
+        std::optional<EventLoop::Clock::time_point> uncommittedInputAt;
+
+        // The view of the content shown by the window
+        ContentState contentState;
+        ContentState lastRenderedState;
+        // The last frame rendered exactly, which the frames are transformed from while a pinch is in progress
+        std::vector<std::uint32_t> exactFrame;
+        ContentState exactFrameState;
+        bool presentedFrameIsExact = true;
+
         // Indicates explicit requests for re-rendering
         bool mustBeRedrawn = false;
         // The rendering requests are delayed until the flag is false
         bool readyToBeRedrawn = false;
-    } mainWindow;
+        // The window has been closed by the user and has no surface anymore
+        bool isClosed = false;
+
+
+        explicit Window(const WindowId id) noexcept
+            : id{ id }
+        {}
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
+        ~Window() noexcept
+        {
+            close();
+        }
+
+        /** Releases everything but the slice of shmArena, which stays reserved for the window */
+        void close() noexcept
+        {
+            // Keeping the correct order of the resources disposal
+
+            if (pendingFrameCallback != nullptr)
+            {
+                MY_LOG_WLCALL_VALUELESS(wl_callback_destroy(pendingFrameCallback));
+                pendingFrameCallback = nullptr;
+            }
+
+            contentType.reset();
+            tearingControl.reset();
+            xdgToplevel.reset();
+            xdgSurface.reset();
+            surface.reset();
+            surfaceWLSideBuffer2.reset();
+            surfaceWLSideBuffer1.reset();
+
+            exactFrame = {};
+            pendingFrameInputAt.reset();
+            uncommittedInputAt.reset();
+            mustBeRedrawn = false;
+            readyToBeRedrawn = false;
+            isClosed = true;
+        }
+    };
+    // Indexed by WindowId ; the closed windows stay in place, so the references to the windows are never invalidated
+    std::deque<Window> windows;
+
+    /** @return the first window satisfying the predicate or nullptr */
+    template<typename Predicate>
+    [[nodiscard]] Window* findWindow(Predicate&& predicate)
+    {
+        for (auto& window : windows)
+            if (predicate(window))
+                return &window;
+        return nullptr;
+    }
+
+    /** @return the window of the surface or nullptr if the surface isn't a window of the app */
+    [[nodiscard]] Window* findWindow(wl_surface* const surface)
+    {
+        if (surface == nullptr)
+            return nullptr;
+        return findWindow([surface](const Window& window) { return (surface == window.surface); });
+    }
 
-    // Input devices
+    /**
+     * Closes the window and forgets it everywhere it's referenced from (e.g. the input focus of the seats).
+     * @return true if it has been the last open window
+     */
+    bool closeWindow(Window& window) noexcept;
+
+    // Caches of the rendered content
+    struct
+    {
+        // Checked first ; the tiles are decoded right into the pending buffer
+        CompressedTileCache memoryCache;
+        // Survives restarts of the app ; isValid() == false if it couldn't be opened
+        PersistentTileStore persistentStore;
+        // The tiles of a frame missing from both caches and their pixels (TILE_PIXELS each), rendered by the workers
+        //   before the frame is composed
+        std::vector<TileKey> missingTiles;
+        std::vector<std::uint32_t> renderedTiles;
+        // A tile being rendered by the composing thread itself (if it's been evicted while composing the frame)
+        std::vector<std::uint32_t> scratchTile;
+        // The region of the zoomed content shown by a rotated viewport, composed before it's sampled along the rotated
+        //   rows ; the windows take turns to use it
+        BlockedImage rotatedRegion;
+    } tileCache;
+
+    // The strokes drawn over the content with the tablet tools
+    InkLayer ink;
+
+    // From the arrival of the input changing a window till its new frame is committed / its wl_surface::frame is done
+    //   (which is roughly when it's presented)
     struct
     {
-        WLResourceWrapper<wl_keyboard*> wlDevice;
+        LatencyMeter inputToCommit{ "input -> commit" };
+        LatencyMeter inputToFrameDone{ "input -> frame done" };
+    } latency;
+
+    // The performance counters of the stages of the frames ; opened only if $WAYLAND_INPUT_WINDOW_PERF_COUNTERS=1
+    PerfCounters perf;
+
+    // The energy (or the CPU time) per frame and per idle second ; sampled only if $WAYLAND_INPUT_WINDOW_ENERGY=1
+    EnergyMeter energy;
+
+    // The priorities and the CPUs of the main thread and the render workers ; see ThreadScheduling for the variables
+    ThreadScheduling scheduling;
+
+    // The bandwidths of the render and convert stages relative to the peak ones ; calibrated only if
+    //   $WAYLAND_INPUT_WINDOW_BANDWIDTH_CALIBRATION=1
+    BandwidthRoofline roofline;
+
+    // Reports the stages of the main thread running longer than $WAYLAND_INPUT_WINDOW_STALL_THRESHOLD_MS
+    StallWatchdog stallWatchdog;
+
+    // A stage of the main thread measured by the performance counters and watched by the stall watchdog
+    struct StageScope
+    {
+        PerfCounters::Scope perf;
+        StallWatchdog::Scope stall;
+    };
+
+    /** @param name must be a string literal */
+    [[nodiscard]] StageScope enterStage(const char* const name, const bool includesOtherThreads = false) noexcept
+    {
+        return StageScope{ perf.measure(name, includesOtherThreads), stallWatchdog.watch(name) };
+    }
+
+    /**
+     * Called at the entry of the listeners of the Wayland events ; the event is also recorded by the flight recorder.
+     * @param arg0, arg1 the most telling arguments of the event, stored as FlightRecorder::toArg encodes them (pass the
+     *                   wl_fixed_t's as they are, not converted)
+     */
+    template<typename Arg0 = std::uint64_t, typename Arg1 = std::uint64_t>
+    [[nodiscard]] StageScope enterListener(const char* const name, const Arg0 arg0 = {}, const Arg1 arg1 = {}) noexcept
+    {
+        FlightRecorder::record(FlightRecorder::Kind::EVENT, name, FlightRecorder::toArg(arg0), FlightRecorder::toArg(arg1));
+        return enterStage(name);
+    }
+
+    // Everything related to a wl_seat: the input devices, their state and the clipboard.
+    // The server may advertise several seats (e.g. a kiosk with several users), each one is bound and gets its own
+    //   state ; the events of all the seats are handled by the same listeners, which get the seat from the user data
+    //   of the object the event has come from (see SeatRoutes).
+    using SeatId = std::uint32_t;
+    struct Seat
+    {
+        // Unique for the lifetime of the app (the seats come and go, their slots are reused), so the asynchronous
+        //   operations can tell whether their seat is still there
+        SeatId id = 0;
+        // The name of the wl_seat global object
+        std::uint32_t globalName = 0;
+        // The bridge to all input devices: mouses, keyboards, touchpads, touchscreens, etc.
+        WLResourceWrapper<wl_seat*> wlSeat;
+        // As reported by wl_seat::name
+        std::string name;
 
-        // Currently the libxkbcommon is the only supported way to work with keyboard input
         struct
         {
-            std::shared_ptr<xkb_context> context;
-            std::shared_ptr<xkb_keymap> keymap;
-            std::shared_ptr<xkb_state> state;
-        } xkb;
+            WLResourceWrapper<wl_keyboard*> wlDevice;
 
-        struct
-        { // TODO: implement key repeating using this info
-            /// the rate of repeating keys in characters per second. Zero should disable any repeating
-            uint32_t rate = 0;
-            /// delay in milliseconds since key down until repeating starts
-            uint32_t delay = 0;
-        } repeatInfo;
+            // Currently the libxkbcommon is the only supported way to work with keyboard input
+            struct
+            {
+                std::shared_ptr<xkb_context> context;
+                std::shared_ptr<xkb_keymap> keymap;
+                std::shared_ptr<xkb_state> state;
+            } xkb;
+
+            struct
+            { // TODO: implement key repeating using this info
+                /// the rate of repeating keys in characters per second. Zero should disable any repeating
+                uint32_t rate = 0;
+                /// delay in milliseconds since key down until repeating starts
+                uint32_t delay = 0;
+            } repeatInfo;
+
+            uint32_t lastSerial = 0;
+
+            // The window having the keyboard focus or nullptr
+            Window* focusedWindow = nullptr;
+        } keyboard;
+
+        struct PointingDevice
+        {
+            WLResourceWrapper<wl_pointer*> wlDevice;
 
-        uint32_t lastSerial = 0;
-    } keyboard;
+            // isValid() == false if neither server side nor client side cursors are available
+            PointerCursor cursor;
 
-    struct PointingDevice
-    {
-        WLResourceWrapper<wl_pointer*> wlDevice;
+            // Obtained for wlDevice if pointerGestures is available
+            WLResourceWrapper<zwp_pointer_gesture_pinch_v1*> pinchGesture;
+            WLResourceWrapper<zwp_pointer_gesture_swipe_v1*> swipeGesture;
+
+            struct Pinch
+            {
+                // The window the gesture has begun over
+                Window* window;
+                ContentState stateAtBegin;
+                // The point of the window the content is zoomed around
+                double centerX;
+                double centerY;
+                // The movement of the fingers since the beginning
+                double panX;
+                double panY;
+                // The rotation of the fingers since the beginning (radians, clockwise)
+                double rotation;
+            };
+            // Empty if no pinch is in progress
+            std::optional<Pinch> pinch;
+
+            struct Swipe
+            {
+                // The window the gesture has begun over
+                Window* window;
+                ContentState stateAtBegin;
+            };
+            // Empty if no swipe is in progress
+            std::optional<Swipe> swipe;
+
+            struct PositionOnSurface
+            {
+                double x = 0;
+                double y = 0;
+            };
+            // The window the pointer is over or nullptr
+            Window* focusedWindow = nullptr;
+            // The empty optional means the pointer isn't over any window surface
+            std::optional<PositionOnSurface> positionOnWindowSurface;
+
+            // buttonsPressedState[i] is true if ith button is pressed
+            std::bitset<32> buttonsPressedState;
+            enum : std::uint8_t
+            {
+                IDX_LMB = 0,
+                IDX_RMB = 1,
+                // usually the wheel
+                IDX_MMB = 2,
+                IDX_OTHERS_BEGIN
+            };
 
 
-        struct PositionOnSurface
+            // Holds the accumulated data of all wl_pointer events until a wl_pointer::frame is received
+            struct EventFrame
+            {
+                wl_pointer* sourceDev;
+
+                std::variant<
+                    wl_pointer_event_frame_types::Enter,
+                    wl_pointer_event_frame_types::Leave,
+                    wl_pointer_event_frame_types::Motion,
+                    wl_pointer_event_frame_types::Button,
+                    wl_pointer_event_frame_types::Axes
+                > info;
+            };
+            std::optional<EventFrame> eventFrame;
+        } pointingDev;
+
+        struct
         {
-            double x = 0;
-            double y = 0;
+            WLResourceWrapper<wl_touch*> wlDevice;
+
+            // The window the current touch sequence has started on or nullptr ; all its contacts are applied to it
+            Window* focusedWindow = nullptr;
+            // The contacts on focusedWindow's surface
+            TouchContactTable contacts;
+            TouchGestureRecognizer gestureRecognizer;
+            // The content state of focusedWindow when the touch sequence has started, restored on wl_touch::cancel
+            ContentState stateAtBegin;
+        } touchScreen;
+
+        // The state of a tablet tool accumulated until zwp_tablet_tool_v2::frame
+        struct TabletToolState
+        {
+            bool isEraser = false;
+            // The window the tool is in proximity of or nullptr
+            Window* window = nullptr;
+            bool isDown = false;
+            // A stroke is being drawn by the tool
+            bool isDrawing = false;
+            // The window the last stroke has begun over ; the whole stroke is mapped via its view
+            Window* strokeWindow = nullptr;
+
+            double surfaceLocalX = 0;
+            double surfaceLocalY = 0;
+            // [0; 65535]
+            std::uint32_t pressure = 0;
+            double tiltX = 0;
+            double tiltY = 0;
         };
-        // The empty optional means the pointer isn't over the surface
-        std::optional<PositionOnSurface> positionOnMainWindowSurface;
-
-        // buttonsPressedState[i] is true if ith button is pressed
-        std::bitset<32> buttonsPressedState;
-        enum : std::uint8_t
+        // The objects announced via the groups of a pad ; the rings and the strips aren't used, but they must be
+        //   destroyed along with the pad
+        struct TabletPadParts
         {
-            IDX_LMB = 0,
-            IDX_RMB = 1,
-            // usually the wheel
-            IDX_MMB = 2,
-            IDX_OTHERS_BEGIN
+            std::vector<WLResourceWrapper<zwp_tablet_pad_group_v2*>> groups;
+            std::vector<WLResourceWrapper<zwp_tablet_pad_ring_v2*>> rings;
+            std::vector<WLResourceWrapper<zwp_tablet_pad_strip_v2*>> strips;
         };
 
+        // The drawing tablets of the seat
+        struct
+        {
+            WLResourceWrapper<zwp_tablet_seat_v2*> seat;
+
+            // The objects announced via the seat, until they're removed
+            std::unordered_map<zwp_tablet_v2*, WLResourceWrapper<zwp_tablet_v2*>> tablets;
+            std::unordered_map<zwp_tablet_tool_v2*, WLResourceWrapper<zwp_tablet_tool_v2*>> tools;
+            std::unordered_map<zwp_tablet_tool_v2*, TabletToolState> toolsStates;
+            std::unordered_map<zwp_tablet_pad_v2*, WLResourceWrapper<zwp_tablet_pad_v2*>> pads;
+            std::unordered_map<zwp_tablet_pad_v2*, TabletPadParts> padsParts;
+
+            // From the tools to the ink
+            StrokePipeline strokes;
+        } tablet;
 
-        // Holds the accumulated data of all wl_pointer events until a wl_pointer::frame is received
-        struct EventFrame
+        // Clipboard and drag-and-drop of the seat
+        struct
         {
-            wl_pointer* sourceDev;
-
-            std::variant<
-                wl_pointer_event_frame_types::Enter,
-                wl_pointer_event_frame_types::Leave,
-                wl_pointer_event_frame_types::Motion,
-                wl_pointer_event_frame_types::Button,
-                wl_pointer_event_frame_types::Axes
-            > info;
-        };
-        std::optional<EventFrame> eventFrame;
-    } pointingDev;
+            WLResourceWrapper<wl_data_device*> device;
+
+            // The MIME types listed by the offers introduced via wl_data_device::data_offer
+            std::unordered_map<wl_data_offer*, std::vector<std::string>> offersMimeTypes;
+            // The offer introduced last, until wl_data_device::enter or ::selection adopts it ; destroyed if neither
+            //   does by the next data_offer or leave
+            wl_data_offer* pendingOffer = nullptr;
+            // The current selection of the seat ; no resource means the clipboard is empty
+            WLResourceWrapper<wl_data_offer*> selectionOffer;
+            // The offer being dragged over a window
+            WLResourceWrapper<wl_data_offer*> dndOffer;
+            // The offer dropped onto a window, kept until its data is received
+            WLResourceWrapper<wl_data_offer*> droppedOffer;
+
+            // The sources provided by the app and their (immutable) content
+            WLResourceWrapper<wl_data_source*> selectionSource;
+            DataTransfers::OutgoingPayload selectionPayload;
+            WLResourceWrapper<wl_data_source*> dragSource;
+            DataTransfers::OutgoingPayload dragPayload;
+
+            // The data pasted or dropped last
+            SharedMemoryBuffer lastReceived;
+            std::string lastReceivedMimeType;
+        } dataExchange;
+
+
+        // A free slot
+        Seat() = default;
+
+        Seat(const Seat&) = delete;
+        Seat& operator=(const Seat&) = delete;
+
+        ~Seat() noexcept
+        {
+            // Keeping the correct order of the resources disposal
+
+            dataExchange.droppedOffer.reset();
+            dataExchange.dndOffer.reset();
+            dataExchange.selectionOffer.reset();
+            if (dataExchange.pendingOffer != nullptr)
+                MY_LOG_WLCALL_VALUELESS(wl_data_offer_destroy(std::exchange(dataExchange.pendingOffer, nullptr)));
+            dataExchange.offersMimeTypes.clear();
+            dataExchange.dragSource.reset();
+            dataExchange.dragPayload.reset();
+            dataExchange.selectionSource.reset();
+            dataExchange.selectionPayload.reset();
+            dataExchange.lastReceived.dispose();
+            dataExchange.device.reset();
+
+            tablet.padsParts.clear();
+            tablet.pads.clear();
+            tablet.toolsStates.clear();
+            tablet.tools.clear();
+            tablet.tablets.clear();
+            tablet.seat.reset();
+
+            touchScreen.wlDevice.reset();
+            pointingDev.swipeGesture.reset();
+            pointingDev.pinchGesture.reset();
+            pointingDev.cursor.dispose();
+            pointingDev.wlDevice.reset();
+
+            keyboard.wlDevice.reset();
+            keyboard.xkb.state.reset();
+            keyboard.xkb.keymap.reset();
+            keyboard.xkb.context.reset();
+
+            wlSeat.reset();
+        }
 
-    struct
+    public: // getters
+        [[nodiscard]] bool isBound() const noexcept { return wlSeat.hasResource(); }
+    };
+    // The most seats bound at once ; a removed seat frees its slot for the next one
+    static constexpr std::size_t MAX_SEATS = 8;
+    // The seat table indexed by the slots. It's never resized, so the seats never relocate and the user data of the
+    //   proxies of their devices can point to them (see SeatRoutes) ; the slots without a bound wl_seat are free
+    std::vector<Seat> seats = std::vector<Seat>(MAX_SEATS);
+    SeatId nextSeatId = 0;
+
+    /** @return nullptr if all the slots are taken */
+    [[nodiscard]] Seat* findFreeSeatSlot() noexcept
+    {
+        for (auto& seat : seats)
+            if (!seat.isBound())
+                return &seat;
+        return nullptr;
+    }
+
+    [[nodiscard]] std::size_t getSeatSlot(const Seat& seat) const noexcept
+    {
+        return static_cast<std::size_t>(&seat - seats.data());
+    }
+
+    /** Releases all the devices of the seat and resets its slot to a free one */
+    void releaseSeat(Seat& seat) noexcept
+    {
+        std::destroy_at(&seat);
+        std::construct_at(&seat);
+    }
+
+    /**
+     * @return the first bound seat satisfying the predicate or nullptr ; only for the lookups which have no proxy
+     *   to route them (e.g. a wl_seat global object removed by its name)
+     */
+    template<typename Predicate>
+    [[nodiscard]] Seat* findSeat(Predicate&& predicate)
     {
-        WLResourceWrapper<wl_touch*> wlDevice;
-    } touchScreen;
+        for (auto& seat : seats)
+            if (seat.isBound() && predicate(seat))
+                return &seat;
+        return nullptr;
+    }
 
 
     bool shouldExit = false;
@@ -263,24 +841,24 @@ struct WLAppCtx
     {
         // Keeping the correct order of the resources disposal
 
-        touchScreen.wlDevice.reset();
-        pointingDev.wlDevice.reset();
+        seats.clear();
 
-        keyboard.wlDevice.reset();
-        keyboard.xkb.state.reset();
-        keyboard.xkb.keymap.reset();
-        keyboard.xkb.context.reset();
+        windows.clear();
+        shmArena.pool.reset();
+        shmArena.buffer.dispose();
 
-        mainWindow.xdgToplevel.reset();
-        mainWindow.xdgSurface.reset();
-        mainWindow.surface.reset();
-        mainWindow.surfaceWLSideBuffer2.reset();
-        mainWindow.surfaceWLSideBuffer1.reset();
-        mainWindow.surfaceBufferWLPool.reset();
-        mainWindow.surfaceSharedBuffer.dispose();
+        tileCache.memoryCache.clear();
+        tileCache.persistentStore.dispose();
+        tileCache.rotatedRegion.clear();
 
         availableGlobalObjects.clear();
-        inputDevicesManager.reset();
+        contentTypeManager.reset();
+        tearingControlManager.reset();
+        dataDeviceManager.reset();
+        tabletManager.reset();
+        pointerGestures.reset();
+        cursorTheme.dispose();
+        cursorShapeManager.reset();
         xdgShell.reset();
         shmProvider.reset();
         compositor.reset();
@@ -289,47 +867,130 @@ struct WLAppCtx
     }
 };
 
-
-struct ContentState
+bool WLAppCtx::closeWindow(Window& window) noexcept
 {
-    double viewportOffsetX = 0;
-    double viewportOffsetY = 0;
+    MY_LOG_INFO("Closing the window #", window.id, "...");
+
+    for (auto& seat : seats)
+    {
+        if (seat.keyboard.focusedWindow == &window)
+            seat.keyboard.focusedWindow = nullptr;
+        if (seat.pointingDev.focusedWindow == &window)
+        {
+            seat.pointingDev.focusedWindow = nullptr;
+            seat.pointingDev.positionOnWindowSurface.reset();
+        }
+        if (seat.touchScreen.focusedWindow == &window)
+        {
+            seat.touchScreen.focusedWindow = nullptr;
+            seat.touchScreen.contacts.clear();
+            seat.touchScreen.gestureRecognizer.reset();
+        }
+    }
+
+    window.close();
+
+    return std::none_of(windows.begin(), windows.end(), [](const Window& w) { return !w.isClosed; });
+}
+
 
-    // (0; +inf). 1.0 means normal zoom (100%), 0.5 - 50%, 2.0 - 200%, etc.
-    double viewportZoom = 1;
-    // The point is in the viewport local coordinate system, so it must be within the range [0; width)
-    double viewportZoomCenterLocalX = 0;
-    // The point is in the viewport local coordinate system, so it must be within the range [0; height)
-    double viewportZoomCenterLocalY = 0;
+/**
+ * The user data of the proxies of the seats' devices handled by the listener: each route is the listener and a seat,
+ *   so an event gets to its seat without any lookup. There's a route per slot of WLAppCtx::seats, and as the seats
+ *   never relocate, neither do the routes.
+ */
+template<typename Listener>
+class SeatRoutes
+{
+public:
+    struct Route
+    {
+        Listener& listener;
+        WLAppCtx::Seat* const seat;
+    };
 
 public:
-    static constexpr double ZOOM_FACTOR = 1.25;
+    SeatRoutes(Listener& listener, WLAppCtx& appCtx)
+        : appCtx_{ appCtx }
+    {
+        routes_.reserve(appCtx.seats.size());
+        for (auto& seat : appCtx.seats)
+            routes_.push_back(Route{ listener, &seat });
+    }
 
-public: // modifiers
-    ContentState movedFor(double offsetX, double offsetY) const;
+    SeatRoutes(const SeatRoutes&) = delete;
+    SeatRoutes& operator=(const SeatRoutes&) = delete;
 
-    ContentState zoomedIn(double zoomFactor = ZOOM_FACTOR) const;
-    ContentState zoomedIn(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor = ZOOM_FACTOR) const;
+public:
+    /** @return the user data to set for the proxies of the seat's devices */
+    [[nodiscard]] void* to(const WLAppCtx::Seat& seat) noexcept
+    {
+        return &routes_[appCtx_.getSeatSlot(seat)];
+    }
 
-    ContentState zoomedOut(double zoomFactor = ZOOM_FACTOR) const;
-    ContentState zoomedOut(unsigned newZoomCenterX, unsigned newZoomCenterY, double zoomFactor = ZOOM_FACTOR) const;
+    /** @param userData as returned by to() */
+    [[nodiscard]] static const Route& resolve(void* const userData) noexcept
+    {
+        return *static_cast<const Route*>(userData);
+    }
 
-    ContentState restoredZoom() const;
+private:
+    WLAppCtx& appCtx_;
+    std::vector<Route> routes_;
 };
 
-bool operator==(const ContentState& lhs, const ContentState& rhs) noexcept;
-bool operator!=(const ContentState& lhs, const ContentState& rhs) noexcept;
 
+/**
+ * The unrotated viewport pixel (x; y) shows the zoomed content pixel (originX + x; originY + y),
+ *   the zoomed content pixel u shows the content point u / sideZoom ; see ContentState::toUnrotatedLocal
+ */
+struct ViewportMapping
+{
+    std::int64_t originX;
+    std::int64_t originY;
+    double sideZoom;
+};
 
-static void renderMainWindow(WLAppCtx& appCtx, ContentState contentState);
+static ViewportMapping computeViewportMapping(const ContentState& contentState);
+/** The tiles missing from the caches are rendered by the workers */
+static void renderWindow(WLAppCtx& appCtx, WLAppCtx::Window& window, RenderWorkerPool& renderWorkers);
+/**
+ * Updates the frame presented last with the changed ink (window.inkDirtyRects) by recomposing only the parts
+ *   showing it into window.frameDamage ; the viewport mustn't be rotated
+ */
+static void renderWindowInk(WLAppCtx& appCtx, WLAppCtx::Window& window, RenderWorkerPool& renderWorkers);
+/** Approximates the frame of targetState by resampling the frame rendered for frameState */
+static void transformWindowFrame(
+    WLAppCtx::Window& window,
+    const std::vector<std::uint32_t>& frame,
+    const ContentState& frameState,
+    const ContentState& targetState
+);
+/** The last presented frame of the window as a 32-bit BMP image */
+static DataTransfers::OutgoingPayload snapshotWindowAsBmp(const WLAppCtx::Window& window);
+/** Dumps the flight recorder and logs where to */
+static void dumpFlightRecorder(const char* reason) noexcept;
+/** Logs why the Wayland connection has failed, dumping the flight recorder on a protocol error ; @return the exit code */
+static int handleConnectionFailure(wl_display* connection) noexcept;
 
 
 int main(int, char*[])
 {
+    // $WAYLAND_INPUT_WINDOW_VIRTUAL_FRAME_MS=N: the time of the app is virtual and moves by N ms per frame of the event
+    //   loop, so the frame schedule and the latencies are the same on every run (e.g. for the performance tests).
+    //   Must be enabled before anything samples the time
+    const auto virtualFrameMs = getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_VIRTUAL_FRAME_MS");
+    if (virtualFrameMs.has_value())
+        AppClock::enableVirtualTime();
+
+    // The events are recorded from the very beginning, it's dumped on the fatal errors below
+    FlightRecorder::install();
+
     try
     {
         WLAppCtx appCtx;
-        ContentState contentState;
+        // Caches and pools register themselves here, so they can be shrunk when the memory gets tight
+        MemoryBudgetGovernor memoryBudget{ MemoryBudgetGovernor::Config::fromEnvironment() };
 
         // ========================== Step 1: make a connection to the Wayland server/compositor ======================
         appCtx.connection = makeWLResourceWrapperChecked(
@@ -402,6 +1063,7 @@ int main(int, char*[])
                 );
 
                 RegistryListener& self = *static_cast<RegistryListener*>(data);
+                const auto listenerScope = self.appCtx.enterListener("wl_registry::global", name, version);
                 const std::string_view interfaceSV = interface;
 
                 if (const auto [iter, inserted] =
@@ -429,6 +1091,7 @@ int main(int, char*[])
                 );
 
                 RegistryListener& self = *static_cast<RegistryListener*>(data);
+                const auto listenerScope = self.appCtx.enterListener("wl_registry::global_remove", name);
 
                 const auto globalObjIter = self.appCtx.availableGlobalObjects.find(name);
                 if (globalObjIter == self.appCtx.availableGlobalObjects.end()) {
@@ -513,7 +1176,53 @@ int main(int, char*[])
         });
         // ============================================== END of Step 3 ===============================================
 
-        // ============================== Step 4: creating a surface for the main window ==============================
+        // =============================== Step 4: creating the surfaces of the windows ===============================
+
+        // From here on the independent setup steps overlap via the coroutines driven by the event loop ; it also
+        //   drives the clipboard and drag-and-drop transfers later.
+        EventLoop eventLoop{ *appCtx.connection };
+        CoroRuntime coroRuntime{ eventLoop };
+
+        // The main thread is watched from here on ; the time it waits for the events isn't a stall
+        appCtx.stallWatchdog.start(std::chrono::milliseconds{
+            getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_STALL_THRESHOLD_MS").value_or(StallWatchdog::DEFAULT_THRESHOLD_MS)
+        });
+        eventLoop.setWaitObserver([&appCtx](const bool isWaiting) {
+            if (isWaiting)
+            {
+                appCtx.energy.onWaitBegin();
+                appCtx.stallWatchdog.onWaitBegin();
+            }
+            else
+            {
+                appCtx.stallWatchdog.onWaitEnd();
+                appCtx.energy.onWaitEnd();
+            }
+        });
+
+        // The rendered tiles are cached on disk, so the warm starts of the app don't have to render them again.
+        // Opening the cache touches the disk, so it's done on a separate thread ; the windows just render all the
+        //   tiles until it's opened.
+        coroRuntime.spawn(
+            [](WLAppCtx& appCtx, CoroRuntime& coroRuntime) -> Task<>
+            {
+                try
+                {
+                    appCtx.tileCache.persistentStore = co_await coroRuntime.offload([] {
+                        return PersistentTileStore::open(
+                            PersistentTileStore::getDefaultPath(),
+                            PersistentTileStore::DEFAULT_CAPACITY_TILES
+                        );
+                    });
+                    MY_LOG_INFO("The persistent tiles cache has been opened.");
+                }
+                catch (const std::exception& err)
+                {
+                    MY_LOG_WARN("Failed to open the persistent tiles cache (\"", err.what(), "\"). Running without it.");
+                }
+            }(appCtx, coroRuntime),
+            "opening the persistent tiles cache"
+        );
 
         // The surface will be using Wayland's shared memory buffers for holding the surface pixels.
         // This feature is provided by wl_shm global object(s). So firstly we have to bind to it.
@@ -550,75 +1259,242 @@ int main(int, char*[])
             return 5;
         }
 
+        // The server advertises the formats of the buffers it accepts right after wl_shm is bound ; the cheapest one
+        //   of them is chosen before the buffers are allocated because their sizes depend on it.
+        struct ShmFormatsListener
+        {
+            WLAppCtx& appCtx;
+            const wl_shm_listener wlHandler = { &onFormat };
+
+            static void onFormat(void * const self, wl_shm * const shm, const uint32_t format)
+            {
+                MY_LOG_TRACE("shmFormatsListener::onFormat(self=", self, ", shm=", shm, ", format=", format, ").");
+
+                const auto listenerScope = static_cast<ShmFormatsListener*>(self)->appCtx.enterListener("wl_shm::format", format);
+                static_cast<ShmFormatsListener*>(self)->appCtx.shmFormats.onFormatAdvertised(format);
+            }
+        } shmFormatsListener{ appCtx };
+        appCtx.shmFormats.reset();
+        if (const auto err = MY_LOG_WLCALL(wl_shm_add_listener(*appCtx.shmProvider, &shmFormatsListener.wlHandler, &shmFormatsListener)); err != 0)
+            throw std::system_error(
+                errno,
+                std::system_category(),
+                "Failed to set the wl_shm listener (wl_shm_add_listener returned " + std::to_string(err) + ")"
+            );
+
+        // RGB565 loses colors, so it has to be allowed explicitly
+        const bool allowLossyShmFormat = (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_SHM_ALLOW_LOSSY").value_or(0) != 0);
+        const bool benchmarkShmFormats = (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_SHM_FORMAT_BENCHMARK").value_or(0) != 0);
+        const bool calibrateBandwidth = (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_BANDWIDTH_CALIBRATION").value_or(0) != 0);
+        const auto& shmFormat = *coroRuntime.blockOn(
+            [](WLAppCtx& appCtx, CoroRuntime& coroRuntime, const bool allowLossy, const bool benchmark, const bool calibrate) -> Task<const ShmPixelFormat*>
+            {
+                // All the formats have been advertised once the server has processed the binding
+                co_await awaitDisplaySync(*appCtx.connection);
+
+                // Before the benchmark, so it's reported relative to the peaks too. The render workers don't exist
+                //   yet, so their count is taken from the same place ; the composing thread renders tiles as well
+                if (calibrate)
+                {
+                    co_await coroRuntime.offload([&roofline = appCtx.roofline] {
+                        roofline.calibrate(static_cast<unsigned>(RenderWorkerPool::getDefaultWorkersCount() + 1));
+                    });
+                }
+
+                if (benchmark)
+                {
+                    MY_LOG_INFO("Measuring the conversions into the advertised wl_shm formats...");
+                    // The copy is measured so the event loop thread doesn't share anything with the job
+                    appCtx.shmFormats = co_await coroRuntime.offload([selector = appCtx.shmFormats]() mutable {
+                        selector.benchmark(800 * 600);
+                        return selector;
+                    });
+                }
+
+                MY_LOG_INFO("wl_shm formats advertised: ", appCtx.shmFormats.getAdvertised().size(), ", the usable ones from the cheapest:");
+                appCtx.shmFormats.logCandidates(allowLossy);
+                // The bytes written by the measured conversions
+                for (const auto& candidate : appCtx.shmFormats.rankCandidates(allowLossy))
+                {
+                    if (candidate.isConversionMeasured)
+                        appCtx.roofline.logAchieved(candidate.format->name, static_cast<double>(candidate.format->bytesPerPixel) * 1e9 / candidate.conversionNsPerPixel);
+                }
+                co_return &appCtx.shmFormats.choose(allowLossy);
+            }(appCtx, coroRuntime, allowLossyShmFormat, benchmarkShmFormats, calibrateBandwidth)
+        );
+        MY_LOG_INFO("Chose the wl_shm format ", shmFormat.name, '.');
+
+        // The windows are cheap compared to the separate processes: everything but the surfaces, their pixels and
+        //   their views of the content is shared
+        const auto windowsCount = static_cast<std::size_t>(
+            std::clamp<unsigned long long>(getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_WINDOWS").value_or(1), 1, WLAppCtx::MAX_WINDOWS)
+        );
+        for (std::size_t i = 0; i < windowsCount; ++i)
+            appCtx.windows.emplace_back(static_cast<WLAppCtx::WindowId>(i)).setShmFormat(shmFormat);
+
         // Next, we have to allocate a shared memory buffer (POSIX's shm_* + mmap APIs).
         // We're going to write pixels into it, and then the server will read from it.
-        // The space is multiplied by 2 because the double buffering technique is going to be used to avoid
-        //   flickering issues.
-        // appCtx.mainWindow.currentlyUsedBufferIdx will be holding the index of the buffer which is currently being
-        //   read by the server.
-        appCtx.mainWindow.surfaceSharedBuffer = SharedMemoryBuffer::allocate(
-            appCtx.mainWindow.width * appCtx.mainWindow.bytesPerPixel * appCtx.mainWindow.height * 2
-        );
+        // Each window takes 2 frames of it because the double buffering technique is going to be used to avoid
+        //   flickering issues ; Window::pendingBufferIdx will be holding the index of the buffer which is going to
+        //   be drawn into next.
+        std::size_t arenaSize = 0;
+        for (auto& window : appCtx.windows)
+        {
+            window.arenaOffset = arenaSize;
+            arenaSize += window.getBuffersSizeBytes();
+        }
+        appCtx.shmArena.buffer = SharedMemoryBuffer::allocate(arenaSize);
 
         // Now, share the whole buffer with the server so it gets able to use it
-        appCtx.mainWindow.surfaceBufferWLPool = makeWLResourceWrapperChecked(
+        appCtx.shmArena.pool = makeWLResourceWrapperChecked(
             MY_LOG_WLCALL(wl_shm_create_pool(
                 *appCtx.shmProvider,
-                appCtx.mainWindow.surfaceSharedBuffer.getFd(),
-                appCtx.mainWindow.surfaceSharedBuffer.getSize()
+                appCtx.shmArena.buffer.getFd(),
+                appCtx.shmArena.buffer.getSize()
             )),
             nullptr,
             [](auto& shmPool) { MY_LOG_WLCALL(wl_shm_pool_destroy(shmPool)); shmPool = nullptr; }
         );
-        if (!appCtx.mainWindow.surfaceBufferWLPool.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create a wl_shm_pool for the main window");
-
-        // Separate the buffer into 2 Wayland sub-buffers (for the double-buffering)
-        appCtx.mainWindow.surfaceWLSideBuffer1 = makeWLResourceWrapperChecked(
-            MY_LOG_WLCALL(wl_shm_pool_create_buffer(
-                *appCtx.mainWindow.surfaceBufferWLPool,
-                appCtx.mainWindow.getSurfaceBufferOffsetForIdx(0),
-                appCtx.mainWindow.width,
-                appCtx.mainWindow.height,
-                appCtx.mainWindow.width * appCtx.mainWindow.bytesPerPixel,
-                WL_SHM_FORMAT_XRGB8888
-            )),
-            nullptr,
-            [](auto& buf) { MY_LOG_WLCALL(wl_buffer_destroy(buf)); buf = nullptr; }
-        );
-        if (!appCtx.mainWindow.surfaceWLSideBuffer1.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create 1st wl_buffer for the main window");
-
-        appCtx.mainWindow.surfaceWLSideBuffer2 = makeWLResourceWrapperChecked(
-            MY_LOG_WLCALL(wl_shm_pool_create_buffer(
-                *appCtx.mainWindow.surfaceBufferWLPool,
-                appCtx.mainWindow.getSurfaceBufferOffsetForIdx(1),
-                appCtx.mainWindow.width,
-                appCtx.mainWindow.height,
-                appCtx.mainWindow.width * appCtx.mainWindow.bytesPerPixel,
-                WL_SHM_FORMAT_XRGB8888
-            )),
-            nullptr,
-            [](auto& buf) { MY_LOG_WLCALL(wl_buffer_destroy(buf)); buf = nullptr; }
-        );
-        if (!appCtx.mainWindow.surfaceWLSideBuffer2.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create 2nd wl_buffer for the main window");
+        if (!appCtx.shmArena.pool.hasResource())
+            throw std::system_error(errno, std::system_category(), "Failed to create a wl_shm_pool for the windows");
 
-        // Creating a surface
-        appCtx.mainWindow.surface = makeWLResourceWrapperChecked(
-            MY_LOG_WLCALL(wl_compositor_create_surface(appCtx.compositor.getResource())),
-            nullptr,
-            [](auto& srf) { MY_LOG_WLCALL(wl_surface_destroy(srf)); srf = nullptr; }
-        );
-        if (!appCtx.mainWindow.surface.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create a wl_surface for the main window");
+        for (auto& window : appCtx.windows)
+        {
+            window.buffersData = appCtx.shmArena.buffer.getData() + window.arenaOffset;
+
+            // Separate the window's slice into 2 Wayland sub-buffers (for the double-buffering)
+            window.surfaceWLSideBuffer1 = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_shm_pool_create_buffer(
+                    *appCtx.shmArena.pool,
+                    window.arenaOffset + window.getSurfaceBufferOffsetForIdx(0),
+                    window.width,
+                    window.height,
+                    window.getSurfaceBufferStrideBytes(),
+                    window.shmFormat->wlFormat
+                )),
+                nullptr,
+                [](auto& buf) { MY_LOG_WLCALL(wl_buffer_destroy(buf)); buf = nullptr; }
+            );
+            if (!window.surfaceWLSideBuffer1.hasResource())
+                throw std::system_error(errno, std::system_category(), "Failed to create 1st wl_buffer for a window");
+
+            window.surfaceWLSideBuffer2 = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_shm_pool_create_buffer(
+                    *appCtx.shmArena.pool,
+                    window.arenaOffset + window.getSurfaceBufferOffsetForIdx(1),
+                    window.width,
+                    window.height,
+                    window.getSurfaceBufferStrideBytes(),
+                    window.shmFormat->wlFormat
+                )),
+                nullptr,
+                [](auto& buf) { MY_LOG_WLCALL(wl_buffer_destroy(buf)); buf = nullptr; }
+            );
+            if (!window.surfaceWLSideBuffer2.hasResource())
+                throw std::system_error(errno, std::system_category(), "Failed to create 2nd wl_buffer for a window");
+
+            // Creating a surface
+            window.surface = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_compositor_create_surface(appCtx.compositor.getResource())),
+                nullptr,
+                [](auto& srf) { MY_LOG_WLCALL(wl_surface_destroy(srf)); srf = nullptr; }
+            );
+            if (!window.surface.hasResource())
+                throw std::system_error(errno, std::system_category(), "Failed to create a wl_surface for a window");
+        }
+
+        appCtx.tileCache.scratchTile.resize(PersistentTileStore::TILE_PIXELS);
+
+        // The tiles missing from the caches are rendered by these threads ; the windows take turns to use them
+        RenderWorkerPool renderWorkers{ RenderWorkerPool::getDefaultWorkersCount() };
+
+        appCtx.scheduling.configureFromEnv();
+        appCtx.scheduling.applyToMainThread();
+        appCtx.scheduling.applyToRenderWorkers(renderWorkers.getWorkerThreadIds());
+
+        // The render stage is done by the workers too, so their counters are opened as well
+        if (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_PERF_COUNTERS").value_or(0) != 0)
+            (void)appCtx.perf.open(renderWorkers.getWorkerThreadIds());
+        if (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_ENERGY").value_or(0) != 0)
+            appCtx.energy.open();
+
+        // The compressed tiles are the cheapest to restore (from the persistent store), so they go first.
+        // The persistent store doesn't lose anything when shrunk: its pages are just unmapped and stay in the file.
+        memoryBudget.registerConsumer(MemoryBudgetGovernor::Consumer{
+            "compressed tiles cache",
+            0,
+            1,
+            [&appCtx] { return appCtx.tileCache.memoryCache.getUsedBytes(); },
+            [&appCtx](std::size_t bytesToFree) {
+                auto& memoryCache = appCtx.tileCache.memoryCache;
+                return memoryCache.trimTo(memoryCache.getUsedBytes() - std::min(bytesToFree, memoryCache.getUsedBytes()));
+            }
+        });
+        memoryBudget.registerConsumer(MemoryBudgetGovernor::Consumer{
+            "persistent tiles store",
+            0,
+            10,
+            [&appCtx] { return appCtx.tileCache.persistentStore.getResidentBytes(); },
+            [&appCtx](std::size_t bytesToFree) { return appCtx.tileCache.persistentStore.releaseResidentPages(bytesToFree); }
+        });
+        // Recomposed by every rotated frame anyway, so it's released before anything else
+        memoryBudget.registerConsumer(MemoryBudgetGovernor::Consumer{
+            "rotated region",
+            -1,
+            0,
+            [&appCtx] { return appCtx.tileCache.rotatedRegion.getAllocatedBytes(); },
+            [&appCtx](std::size_t) {
+                const auto freedBytes = appCtx.tileCache.rotatedRegion.getAllocatedBytes();
+                appCtx.tileCache.rotatedRegion.clear();
+                return freedBytes;
+            }
+        });
+        // Only the pending buffers of the windows can be released: the presented ones are still being read (or may be
+        //   read again) by the server. They're overwritten by the next frames anyway, which just page them in again.
+        const auto isPendingBufferReleasable = [](const WLAppCtx::Window& window) {
+            return ( !window.isPendingBufferReleased && !window.isBufferBusy[window.pendingBufferIdx] );
+        };
+        memoryBudget.registerConsumer(MemoryBudgetGovernor::Consumer{
+            "pending window buffers",
+            -1,
+            1,
+            [&appCtx, isPendingBufferReleasable] {
+                std::size_t result = 0;
+                for (const auto& window : appCtx.windows)
+                {
+                    if (isPendingBufferReleasable(window))
+                        result += window.getBuffersSizeBytes() / 2;
+                }
+                return result;
+            },
+            [&appCtx, isPendingBufferReleasable](std::size_t bytesToFree) {
+                std::size_t freedBytes = 0;
+                for (auto& window : appCtx.windows)
+                {
+                    if (freedBytes >= bytesToFree)
+                        break;
+                    if (!isPendingBufferReleasable(window))
+                        continue;
+
+                    freedBytes += appCtx.shmArena.buffer.releasePages(
+                        window.arenaOffset + window.getSurfaceBufferPendingOffset(),
+                        window.getBuffersSizeBytes() / 2
+                    );
+                    window.isPendingBufferReleased = true;
+                }
+                return freedBytes;
+            }
+        });
 
         // Will render the content right before the event loop below
-        appCtx.mainWindow.mustBeRedrawn = true;
-        appCtx.mainWindow.readyToBeRedrawn = true;
+        for (auto& window : appCtx.windows)
+        {
+            window.mustBeRedrawn = true;
+            window.readyToBeRedrawn = true;
+        }
         // ============================================== END of Step 4 ===============================================
 
-        // ============ Step 5: assigning the role to the main window surface using the XDG shell protocol ============
+        // ============= Step 5: assigning the role to the windows surfaces using the XDG shell protocol ==============
 
         // First, binding to the xdg_wm_base global object
         MY_LOG_INFO("Looking up a xdg_wm_base global object, the version supported by this client: ", xdg_wm_base_interface.version, "...");
@@ -650,65 +1526,135 @@ int main(int, char*[])
             }
         }
 
-        // Creating an xdg_surface from the main window's wl_surface
-        appCtx.mainWindow.xdgSurface = makeWLResourceWrapperChecked(
-            MY_LOG_WLCALL(xdg_wm_base_get_xdg_surface(*appCtx.xdgShell, *appCtx.mainWindow.surface)),
-            nullptr,
-            [](auto& xdgSurface) { MY_LOG_WLCALL(xdg_surface_destroy(xdgSurface)); xdgSurface = nullptr; }
-        );
-        if (!appCtx.mainWindow.xdgSurface.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create an xdg_surface for the main window");
+        for (auto& window : appCtx.windows)
+        {
+            // Creating an xdg_surface from the window's wl_surface
+            window.xdgSurface = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(xdg_wm_base_get_xdg_surface(*appCtx.xdgShell, *window.surface)),
+                nullptr,
+                [](auto& xdgSurface) { MY_LOG_WLCALL(xdg_surface_destroy(xdgSurface)); xdgSurface = nullptr; }
+            );
+            if (!window.xdgSurface.hasResource())
+                throw std::system_error(errno, std::system_category(), "Failed to create an xdg_surface for a window");
 
-        // Assigning the toplevel role to the main window via creating a xdg_toplevel from its xdg_surface
-        appCtx.mainWindow.xdgToplevel = makeWLResourceWrapperChecked(
-            MY_LOG_WLCALL(xdg_surface_get_toplevel(*appCtx.mainWindow.xdgSurface)),
-            nullptr,
-            [](auto& xdgToplevel) { MY_LOG_WLCALL(xdg_toplevel_destroy(xdgToplevel)); xdgToplevel = nullptr; }
-        );
-        if (!appCtx.mainWindow.xdgToplevel.hasResource())
-            throw std::system_error(errno, std::system_category(), "Failed to create an xdg_toplevel for the main window");
+            // Assigning the toplevel role to the window via creating a xdg_toplevel from its xdg_surface
+            window.xdgToplevel = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(xdg_surface_get_toplevel(*window.xdgSurface)),
+                nullptr,
+                [](auto& xdgToplevel) { MY_LOG_WLCALL(xdg_toplevel_destroy(xdgToplevel)); xdgToplevel = nullptr; }
+            );
+            if (!window.xdgToplevel.hasResource())
+                throw std::system_error(errno, std::system_category(), "Failed to create an xdg_toplevel for a window");
+
+            // Setting the window title
+            const auto title = (appCtx.windows.size() == 1)
+                ? std::string{ "WaylandInputWindow" }
+                : "WaylandInputWindow #" + std::to_string(window.id + 1);
+            MY_LOG_WLCALL_VALUELESS(xdg_toplevel_set_title(*window.xdgToplevel, title.c_str()));
+        }
 
-        // Setting the main window title
-        MY_LOG_WLCALL_VALUELESS(xdg_toplevel_set_title(*appCtx.mainWindow.xdgToplevel, "WaylandInputWindow"));
-
-        // ============================================== END of Step 5 ===============================================
-
-        // ================================ Step 6: Input: binding to a wl_seat global ================================
-        MY_LOG_INFO("Looking up a wl_seat global object and binding to it, the version supported by this client: ", wl_seat_interface.version, "...");
-        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
+        // The latency mode trades the tear-free presentation for the latency: the windows are marked as the ones
+        //   which may be presented asynchronously (wp_tearing_control_v1) and as interactive content
+        //   (wp_content_type_v1, which e.g. makes the servers keep VRR on) ; both are just hints, the server may
+        //   ignore them
+        appCtx.isLatencyMode = (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_LATENCY_MODE").value_or(0) != 0);
+        if (appCtx.isLatencyMode)
         {
-            if (objInfo.interface == wl_seat_interface.name)
+            MY_LOG_INFO("The latency mode is on. Looking up the wp_tearing_control_manager_v1 and wp_content_type_manager_v1 global objects...");
+            for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
             {
-                MY_LOG_INFO("    ... Found a wl_seat global object of version=", objInfo.version, " with name=", name);
+                if (objInfo.interface == wp_tearing_control_manager_v1_interface.name)
+                {
+                    const auto versionToBind = std::min<uint32_t>(wp_tearing_control_manager_v1_interface.version, objInfo.version);
+
+                    MY_LOG_INFO("    ... Found a wp_tearing_control_manager_v1 object with name=", name, ", binding to version ", versionToBind, "...");
+
+                    appCtx.tearingControlManager = makeWLResourceWrapperChecked(
+                        static_cast<wp_tearing_control_manager_v1*>(MY_LOG_WLCALL(wl_registry_bind(
+                            *appCtx.registry,
+                            name,
+                            &wp_tearing_control_manager_v1_interface,
+                            versionToBind
+                        ))),
+                        nullptr,
+                        [](auto& manager) { MY_LOG_WLCALL_VALUELESS(wp_tearing_control_manager_v1_destroy(manager)); manager = nullptr; }
+                    );
+                    if (!appCtx.tearingControlManager.hasResource())
+                        throw std::system_error(errno, std::system_category(), "Failed to bind to the wp_tearing_control_manager_v1");
 
-                const auto versionToBind = std::min<uint32_t>(wl_seat_interface.version, objInfo.version);
+                    objInfo.bindedVersion = versionToBind;
+                }
+                else if (objInfo.interface == wp_content_type_manager_v1_interface.name)
+                {
+                    const auto versionToBind = std::min<uint32_t>(wp_content_type_manager_v1_interface.version, objInfo.version);
+
+                    MY_LOG_INFO("    ... Found a wp_content_type_manager_v1 object with name=", name, ", binding to version ", versionToBind, "...");
+
+                    appCtx.contentTypeManager = makeWLResourceWrapperChecked(
+                        static_cast<wp_content_type_manager_v1*>(MY_LOG_WLCALL(wl_registry_bind(
+                            *appCtx.registry,
+                            name,
+                            &wp_content_type_manager_v1_interface,
+                            versionToBind
+                        ))),
+                        nullptr,
+                        [](auto& manager) { MY_LOG_WLCALL_VALUELESS(wp_content_type_manager_v1_destroy(manager)); manager = nullptr; }
+                    );
+                    if (!appCtx.contentTypeManager.hasResource())
+                        throw std::system_error(errno, std::system_category(), "Failed to bind to the wp_content_type_manager_v1");
 
-                appCtx.inputDevicesManager = makeWLResourceWrapperChecked(
-                    static_cast<wl_seat*>(MY_LOG_WLCALL(wl_registry_bind(
-                        *appCtx.registry,
-                        name,
-                        &wl_seat_interface,
-                        versionToBind
-                    ))),
-                    nullptr,
-                    [versionToBind](auto& seat) {
-                        if (versionToBind < 5)
-                            MY_LOG_WLCALL_VALUELESS(wl_seat_destroy(seat));
-                        else
-                            MY_LOG_WLCALL_VALUELESS(wl_seat_release(seat));
-                        seat = nullptr;
-                    }
-                );
-                if (!appCtx.inputDevicesManager.hasResource())
-                    throw std::system_error{errno, std::system_category(), "Failed to bind to the wl_seat using the version=" + std::to_string(versionToBind)};
+                    objInfo.bindedVersion = versionToBind;
+                }
+            }
+            if (!appCtx.tearingControlManager.hasResource())
+                MY_LOG_WARN("wp_tearing_control_manager_v1 isn't supported by the server. The frames will be presented on vblank.");
+            if (!appCtx.contentTypeManager.hasResource())
+                MY_LOG_WARN("wp_content_type_manager_v1 isn't supported by the server. The content type hints won't be provided.");
 
-                objInfo.bindedVersion = versionToBind;
+            for (auto& window : appCtx.windows)
+            {
+                if (appCtx.tearingControlManager.hasResource())
+                {
+                    window.tearingControl = makeWLResourceWrapperChecked(
+                        MY_LOG_WLCALL(wp_tearing_control_manager_v1_get_tearing_control(*appCtx.tearingControlManager, *window.surface)),
+                        nullptr,
+                        [](auto& control) { MY_LOG_WLCALL_VALUELESS(wp_tearing_control_v1_destroy(control)); control = nullptr; }
+                    );
+                    if (!window.tearingControl.hasResource())
+                        throw std::system_error(errno, std::system_category(), "Failed to create a wp_tearing_control_v1 for a window");
 
-                break;
+                    // Double-buffered, i.e. applied on the first commit
+                    MY_LOG_WLCALL_VALUELESS(wp_tearing_control_v1_set_presentation_hint(*window.tearingControl, WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC));
+                }
+
+                if (appCtx.contentTypeManager.hasResource())
+                {
+                    window.contentType = makeWLResourceWrapperChecked(
+                        MY_LOG_WLCALL(wp_content_type_manager_v1_get_surface_content_type(*appCtx.contentTypeManager, *window.surface)),
+                        nullptr,
+                        [](auto& contentType) { MY_LOG_WLCALL_VALUELESS(wp_content_type_v1_destroy(contentType)); contentType = nullptr; }
+                    );
+                    if (!window.contentType.hasResource())
+                        throw std::system_error(errno, std::system_category(), "Failed to create a wp_content_type_v1 for a window");
+
+                    // Double-buffered as well
+                    MY_LOG_WLCALL_VALUELESS(wp_content_type_v1_set_content_type(*window.contentType, WP_CONTENT_TYPE_V1_TYPE_GAME));
+                }
             }
         }
-        if (!appCtx.inputDevicesManager.hasResource())
+
+        // ============================================== END of Step 5 ===============================================
+
+        // ============================== Step 6: Input: looking up the wl_seat globals ===============================
+        // The seats are bound in Step 13, once the listeners of all their devices exist ; the server may also add and
+        //   remove them later
+        MY_LOG_INFO("Looking up the wl_seat global objects, the version supported by this client: ", wl_seat_interface.version, "...");
+        const auto seatsCount = std::count_if(appCtx.availableGlobalObjects.begin(), appCtx.availableGlobalObjects.end(), [](const auto& global) {
+            return (global.second.interface == wl_seat_interface.name);
+        });
+        if (seatsCount == 0)
             throw std::runtime_error{"Found no wl_seat objects"};
+        MY_LOG_INFO("    ... Found ", seatsCount, " seat(s).");
         // ============================================== END of Step 6 ===============================================
 
         // ======================== Step 7: Input: listening to the input devices availability ========================
@@ -720,19 +1666,21 @@ int main(int, char*[])
         {
             WLAppCtx& appCtx;
             const wl_seat_listener wlHandler = { &onCapabilities, &onName };
+            SeatRoutes<InputDevicesListenerBridge> seatRoutes{ *this, appCtx };
 
         public:
-            using KeyboardAttachedEventListener = std::function<void()>;
-            using KeyboardDetachedEventListener = std::function<void()>;
+            // All the listeners get the seat the device belongs to
+            using KeyboardAttachedEventListener = std::function<void(WLAppCtx::Seat&)>;
+            using KeyboardDetachedEventListener = std::function<void(WLAppCtx::Seat&)>;
 
-            using PointingDevAttachedEventListener = std::function<void()>;
-            using PointingDevDetachedEventListener = std::function<void()>;
+            using PointingDevAttachedEventListener = std::function<void(WLAppCtx::Seat&)>;
+            using PointingDevDetachedEventListener = std::function<void(WLAppCtx::Seat&)>;
 
-            using TouchscreenAttachedEventListener = std::function<void()>;
-            using TouchscreenDetachedEventListener = std::function<void()>;
+            using TouchscreenAttachedEventListener = std::function<void(WLAppCtx::Seat&)>;
+            using TouchscreenDetachedEventListener = std::function<void(WLAppCtx::Seat&)>;
 
         public:
-            InputDevicesListenerBridge(WLAppCtx& appCtx) noexcept
+            InputDevicesListenerBridge(WLAppCtx& appCtx)
                 : appCtx(appCtx)
             {}
 
@@ -761,74 +1709,117 @@ int main(int, char*[])
             std::vector<TouchscreenDetachedEventListener> tsDetachedListeners_;
 
         private:
-            static void onCapabilities(void * const selfP, wl_seat * const manager, const uint32_t capabilities)
+            static void onCapabilities(void * const routeP, wl_seat * const manager, const uint32_t capabilities)
             {
-                MY_LOG_TRACE("inputDevicesListener::onCapabilities(selfP=", selfP, ", manager=", manager, ", capabilities=", capabilities, ')');
+                MY_LOG_TRACE("inputDevicesListener::onCapabilities(routeP=", routeP, ", manager=", manager, ", capabilities=", capabilities, ')');
 
-                auto& self = *static_cast<InputDevicesListenerBridge*>(selfP);
+                const auto& [self, seat] = SeatRoutes<InputDevicesListenerBridge>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_seat::capabilities", manager, capabilities);
 
                 const bool thereIsKeyboard = ( (capabilities & wl_seat_capability::WL_SEAT_CAPABILITY_KEYBOARD) != 0 );
-                if ( thereIsKeyboard && !self.appCtx.keyboard.wlDevice.hasResource() )
+                if ( thereIsKeyboard && !seat->keyboard.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new keyboard device has got available.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new keyboard device has got available on the seat #", seat->id, '.');
                     for (const auto& l : self.kbAttachedListeners_)
-                        l();
+                        l(*seat);
                 }
-                else if ( !thereIsKeyboard && self.appCtx.keyboard.wlDevice.hasResource() )
+                else if ( !thereIsKeyboard && seat->keyboard.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the keyboard device has disappeared.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the keyboard device of the seat #", seat->id, " has disappeared.");
                     for (const auto& l : self.kbDetachedListeners_)
-                        l();
+                        l(*seat);
                 }
 
                 const bool thereIsPointingDev = ( (capabilities & wl_seat_capability::WL_SEAT_CAPABILITY_POINTER) != 0 );
-                if ( thereIsPointingDev && !self.appCtx.pointingDev.wlDevice.hasResource() )
+                if ( thereIsPointingDev && !seat->pointingDev.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new pointing device has got available.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new pointing device has got available on the seat #", seat->id, '.');
                     for (const auto& l : self.pdAttachedListeners_)
-                        l();
+                        l(*seat);
                 }
-                else if ( !thereIsPointingDev && self.appCtx.pointingDev.wlDevice.hasResource() )
+                else if ( !thereIsPointingDev && seat->pointingDev.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the pointing device has disappeared.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the pointing device of the seat #", seat->id, " has disappeared.");
                     for (const auto& l : self.pdDetachedListeners_)
-                        l();
+                        l(*seat);
                 }
 
                 const bool thereIsTouchscreen = ( (capabilities & wl_seat_capability::WL_SEAT_CAPABILITY_TOUCH) != 0 );
-                if ( thereIsTouchscreen && !self.appCtx.touchScreen.wlDevice.hasResource() )
+                if ( thereIsTouchscreen && !seat->touchScreen.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new touchscreen has got available.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: a new touchscreen has got available on the seat #", seat->id, '.');
                     for (const auto& l : self.tsAttachedListeners_)
-                        l();
+                        l(*seat);
                 }
-                else if ( !thereIsTouchscreen && self.appCtx.touchScreen.wlDevice.hasResource() )
+                else if ( !thereIsTouchscreen && seat->touchScreen.wlDevice.hasResource() )
                 {
-                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the touchscreen has disappeared.");
+                    MY_LOG_INFO("inputDevicesListener::onCapabilities: the touchscreen of the seat #", seat->id, " has disappeared.");
                     for (const auto& l : self.tsDetachedListeners_)
-                        l();
+                        l(*seat);
                 }
             }
 
-            static void onName(void * const /*self*/, wl_seat * const /*manager*/, const char* const /*nameUtf8*/)
-            { /*These events aren't interesting for now*/ }
+            static void onName(void * const routeP, wl_seat * const manager, const char* const nameUtf8)
+            {
+                MY_LOG_TRACE("inputDevicesListener::onName(routeP=", routeP, ", manager=", manager, ", nameUtf8=", nameUtf8, ')');
+
+                const auto& [self, seat] = SeatRoutes<InputDevicesListenerBridge>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_seat::name", manager);
+
+                seat->name = (nameUtf8 == nullptr) ? "" : nameUtf8;
+                MY_LOG_INFO("inputDevicesListener::onName: the seat #", seat->id, " is \"", seat->name, "\".");
+            }
         } inputDevicesListener{ appCtx };
 
-        if (const auto err = MY_LOG_WLCALL(wl_seat_add_listener(*appCtx.inputDevicesManager, &inputDevicesListener.wlHandler, &inputDevicesListener)); err != 0)
-            throw std::system_error(
-                errno,
-                std::system_category(),
-                "Failed to set the input devices listener (wl_seat_add_listener returned " + std::to_string(err) + ")"
-            );
         // ============================================== END of Step 7 ===============================================
 
         // ======================== Step 8: Input: handling pointing devices (mice, touchpads) ========================
 
+        // The cursor shapes are preferably provided by the server ; otherwise they're loaded from the cursor theme
+        MY_LOG_INFO("Looking up a wp_cursor_shape_manager_v1 global object, the version supported by this client: ", wp_cursor_shape_manager_v1_interface.version, "...");
+        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
+        {
+            if (objInfo.interface == wp_cursor_shape_manager_v1_interface.name)
+            {
+                const auto versionToBind = std::min<uint32_t>(wp_cursor_shape_manager_v1_interface.version, objInfo.version);
+
+                MY_LOG_INFO("    ... Found a wp_cursor_shape_manager_v1 object with name=", name, ", binding to version ", versionToBind, "...");
+
+                appCtx.cursorShapeManager = makeWLResourceWrapperChecked(
+                    static_cast<wp_cursor_shape_manager_v1*>(MY_LOG_WLCALL(wl_registry_bind(
+                        *appCtx.registry,
+                        name,
+                        &wp_cursor_shape_manager_v1_interface,
+                        versionToBind
+                    ))),
+                    nullptr,
+                    [](auto& manager) { MY_LOG_WLCALL_VALUELESS(wp_cursor_shape_manager_v1_destroy(manager)); manager = nullptr; }
+                );
+                if (!appCtx.cursorShapeManager.hasResource())
+                    throw std::system_error(errno, std::system_category(), "Failed to bind to the wp_cursor_shape_manager_v1");
+
+                objInfo.bindedVersion = versionToBind;
+
+                break;
+            }
+        }
+        // Otherwise the theme is loaded once here, all the seats' cursors show its images
+        if (!appCtx.cursorShapeManager.hasResource())
+        {
+            try
+            {
+                appCtx.cursorTheme = CursorTheme::load(*appCtx.shmProvider);
+            }
+            catch (const std::exception& err)
+            {
+                MY_LOG_WARN("Failed to load the client side cursors (\"", err.what(), "\"). The cursors will be left up to the server.");
+            }
+        }
+
         // Installing wl_pointer_listener
         struct PointingDeviceListener
         {
             WLAppCtx& appCtx;
-            ContentState& contentState;
 
             const wl_pointer_listener wlHandler = {
                 &onEnter,
@@ -846,56 +1837,68 @@ int main(int, char*[])
                 onAxisRelativeDirection
                 */
             };
+            SeatRoutes<PointingDeviceListener> seatRoutes{ *this, appCtx };
+
+        public:
+            // Receives the seat of the pointer, the Linux button code (BTN_*) and the serial of the wl_pointer::button event
+            using ButtonPressedEventListener = std::function<void(WLAppCtx::Seat& seat, std::uint32_t button, std::uint32_t evSerial)>;
+
+        public:
+            explicit PointingDeviceListener(WLAppCtx& appCtx)
+                : appCtx(appCtx)
+            {}
+
+        public:
+            void addButtonPressedEventListener(ButtonPressedEventListener listener)
+            { buttonPressedListeners_.emplace_back(std::move(listener)); }
+
+        private:
+            std::vector<ButtonPressedEventListener> buttonPressedListeners_;
 
         private: // wl_handler's callbacks
             // Indicates the end of a set of events that logically belong together.
             // A client is expected to accumulate the data in all events within the frame before proceeding
             static void onFrame(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onFrame(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onFrame(routeP=", routeP, ", ",
                                                              "pd=", pd,
                                                              ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::frame");
 
-                if (!self.appCtx.pointingDev.eventFrame.has_value())
+                if (!seat->pointingDev.eventFrame.has_value())
                 {
                     MY_LOG_WARN("An empty wl_pointer frame to handle. Discarding.");
                     return;
                 }
 
-                auto evFrame = std::move(*self.appCtx.pointingDev.eventFrame);
-                self.appCtx.pointingDev.eventFrame.reset();
+                auto evFrame = std::move(*seat->pointingDev.eventFrame);
+                seat->pointingDev.eventFrame.reset();
 
                 if (pd != evFrame.sourceDev)
                 {
                     MY_LOG_ERROR("The wl_pointer=", pd, " of the wl_pointer::frame event doesn't correspond to the wl_pointer=", evFrame.sourceDev, " initialized the frame. Discarding the frame.");
                     return;
                 }
-                if (evFrame.sourceDev != self.appCtx.pointingDev.wlDevice)
-                {
-                    auto * const wlDevice = self.appCtx.pointingDev.wlDevice.hasResource() ? &*self.appCtx.pointingDev.wlDevice : nullptr;
-                    MY_LOG_WARN("The wl_pointer=", evFrame.sourceDev, " of the wl_pointer frame isn't the current wl_pointer=", wlDevice, ". Discarding the frame.");
-                    return;
-                }
 
-                std::visit([&self](auto& frame) {
-                    self.handleFrame(std::move(frame));
+                std::visit([&self, seat](auto& frame) {
+                    self.handleFrame(*seat, std::move(frame));
                 }, evFrame.info);
             }
 
             // Notification that the pointer is focused on a certain surface
             static void onEnter(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evSerial,
                 wl_surface * const enteredSurface,
                 const wl_fixed_t surfaceLocalX,
                 const wl_fixed_t surfaceLocalY
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onEnter(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onEnter(routeP=", routeP, ", ",
                                                              "pd=", pd, ", ",
                                                              "evSerial=", evSerial, ", ",
                                                              "enteredSurface=", enteredSurface, ", ",
@@ -903,19 +1906,20 @@ int main(int, char*[])
                                                              "surfaceLocalY=", surfaceLocalY,
                                                              ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::enter", surfaceLocalX, surfaceLocalY);
 
-                if (self.appCtx.pointingDev.eventFrame.has_value())
+                if (seat->pointingDev.eventFrame.has_value())
                 {
-                    MY_LOG_ERROR("The wl_pointer frame already contains an event. Skipping this wl_pointer::enter.");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains an event. Skipping this wl_pointer::enter.");
                     return;
                 }
 
                 const auto xD = wl_fixed_to_double(surfaceLocalX);
                 const auto yD = wl_fixed_to_double(surfaceLocalY);
 
-                self.appCtx.pointingDev.eventFrame.emplace(
-                    WLAppCtx::PointingDevice::EventFrame{
+                seat->pointingDev.eventFrame.emplace(
+                    WLAppCtx::Seat::PointingDevice::EventFrame{
                         pd,
                         wl_pointer_event_frame_types::Enter{
                             evSerial, enteredSurface, xD, yD
@@ -926,27 +1930,28 @@ int main(int, char*[])
 
             // Notification that the pointer is no longer focused on a certain surface
             static void onLeave(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evSerial,
                 wl_surface * const surfaceLeft
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onLeave(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onLeave(routeP=", routeP, ", ",
                                                              "pd=", pd, ", ",
                                                              "evSerial=", evSerial, ", ",
                                                              "surfaceLeft=", surfaceLeft,
                                                              ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::leave", surfaceLeft);
 
-                if (self.appCtx.pointingDev.eventFrame.has_value())
+                if (seat->pointingDev.eventFrame.has_value())
                 {
-                    MY_LOG_ERROR("The wl_pointer frame already contains an event. Skipping this wl_pointer::leave.");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains an event. Skipping this wl_pointer::leave.");
                     return;
                 }
 
-                self.appCtx.pointingDev.eventFrame.emplace(
-                    WLAppCtx::PointingDevice::EventFrame{
+                seat->pointingDev.eventFrame.emplace(
+                    WLAppCtx::Seat::PointingDevice::EventFrame{
                         pd,
                         wl_pointer_event_frame_types::Leave{
                             evSerial, surfaceLeft
@@ -957,32 +1962,33 @@ int main(int, char*[])
 
             // Notification of pointer location change
             static void onMotion(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evTimestampMs,
                 const wl_fixed_t surfaceLocalX,
                 const wl_fixed_t surfaceLocalY
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onMotion(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onMotion(routeP=", routeP, ", ",
                                                               "pd=", pd, ", ",
                                                               "evTimestampMs=", evTimestampMs, ", ",
                                                               "surfaceLocalX=", surfaceLocalX, ", ",
                                                               "surfaceLocalY=", surfaceLocalY,
                                                               ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::motion", surfaceLocalX, surfaceLocalY);
 
-                if (self.appCtx.pointingDev.eventFrame.has_value())
+                if (seat->pointingDev.eventFrame.has_value())
                 {
-                    MY_LOG_ERROR("The wl_pointer frame already contains an event. Skipping this wl_pointer::motion.");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains an event. Skipping this wl_pointer::motion.");
                     return;
                 }
 
                 const auto xD = wl_fixed_to_double(surfaceLocalX);
                 const auto yD = wl_fixed_to_double(surfaceLocalY);
 
-                self.appCtx.pointingDev.eventFrame.emplace(
-                    WLAppCtx::PointingDevice::EventFrame{
+                seat->pointingDev.eventFrame.emplace(
+                    WLAppCtx::Seat::PointingDevice::EventFrame{
                         pd,
                         wl_pointer_event_frame_types::Motion{
                             evTimestampMs, xD, yD
@@ -993,14 +1999,14 @@ int main(int, char*[])
 
             // Mouse button click and release notifications
             static void onButton(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evSerial,
                 const uint32_t evTimestampMs,
                 const uint32_t button,
                 const uint32_t state
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onButton(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onButton(routeP=", routeP, ", ",
                                                               "pd=", pd, ", ",
                                                               "evSerial=", evSerial, ", ",
                                                               "evTimestampMs=", evTimestampMs, ", ",
@@ -1008,16 +2014,17 @@ int main(int, char*[])
                                                               "state=", state,
                                                               ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::button", button, state);
 
-                if (self.appCtx.pointingDev.eventFrame.has_value())
+                if (seat->pointingDev.eventFrame.has_value())
                 {
-                    MY_LOG_ERROR("The wl_pointer frame already contains an event. Skipping this wl_pointer::button.");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains an event. Skipping this wl_pointer::button.");
                     return;
                 }
 
-                self.appCtx.pointingDev.eventFrame.emplace(
-                    WLAppCtx::PointingDevice::EventFrame{
+                seat->pointingDev.eventFrame.emplace(
+                    WLAppCtx::Seat::PointingDevice::EventFrame{
                         pd,
                         wl_pointer_event_frame_types::Button{
                             evSerial, evTimestampMs, button, static_cast<wl_pointer_button_state>(state)
@@ -1028,7 +2035,7 @@ int main(int, char*[])
 
             // Scroll and other axis notifications
             static void onAxis(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evTimestampMs,
                 const uint32_t axisType,
@@ -1037,16 +2044,17 @@ int main(int, char*[])
                 //   representing a relative movement along the specified axis.
                 const wl_fixed_t value
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onAxis(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onAxis(routeP=", routeP, ", ",
                                                             "pd=", pd, ", ",
                                                             "evTimestampMs=", evTimestampMs, ", ",
                                                             "axisType=", axisType, ", ",
                                                             "value=", value,
                                                             ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::axis", axisType, value);
 
-                auto* const axesFrameP = self.getAxesFramePtrOrNull(pd, "wl_pointer::axis");
+                auto* const axesFrameP = self.getAxesFramePtrOrNull(*seat, pd, "wl_pointer::axis");
                 if (axesFrameP == nullptr) return;
                 auto& axesFrame = *axesFrameP;
 
@@ -1058,7 +2066,7 @@ int main(int, char*[])
                     axisToHandle.emplace(wl_pointer_event_frame_types::Axes::Axis{});
                 else if (axisToHandle->value.has_value())
                 {
-                    MY_LOG_ERROR(
+                    MY_LOG_ERROR_RATE_LIMITED(
                         "The wl_pointer frame already contains a ",
                         (axisType == wl_pointer_axis::WL_POINTER_AXIS_VERTICAL_SCROLL) ? "vertical" : "horizontal"
                         " axis event. Skipping this one."
@@ -1072,24 +2080,25 @@ int main(int, char*[])
 
             // Source information for scroll and other axes
             static void onAxisSource(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t axisSource
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onAxisSource(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onAxisSource(routeP=", routeP, ", ",
                                                                   "pd=", pd, ", ",
                                                                   "axisSource=", axisSource,
                                                                   ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::axis_source", axisSource);
 
-                auto* const axesFrameP = self.getAxesFramePtrOrNull(pd, "wl_pointer::axis_source");
+                auto* const axesFrameP = self.getAxesFramePtrOrNull(*seat, pd, "wl_pointer::axis_source");
                 if (axesFrameP == nullptr) return;
                 auto& axesFrame = *axesFrameP;
 
                 if (axesFrame.axisSource.has_value())
                 {
-                    MY_LOG_ERROR("The wl_pointer frame already contains an wl_pointer::axis_source event. Skipping this one.");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains an wl_pointer::axis_source event. Skipping this one.");
                     return;
                 }
                 axesFrame.axisSource = static_cast<wl_pointer_axis_source>(axisSource);
@@ -1101,20 +2110,21 @@ int main(int, char*[])
             // This enables the client to implement kinetic scrolling.
             // See the wl_pointer.axis_source documentation for information on when this event may be generated.
             static void onAxisStop(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t evTimestampMs,
                 const uint32_t axisStopped
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onAxisStop(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onAxisStop(routeP=", routeP, ", ",
                                                                 "pd=", pd, ", ",
                                                                 "evTimestampMs=", evTimestampMs, ", ",
                                                                 "axisStopped=", axisStopped,
                                                                 ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_pointer::axis_stop", axisStopped);
 
-                auto* const axesFrameP = self.getAxesFramePtrOrNull(pd, "wl_pointer::axis_stop");
+                auto* const axesFrameP = self.getAxesFramePtrOrNull(*seat, pd, "wl_pointer::axis_stop");
                 if (axesFrameP == nullptr) return;
                 auto& axesFrame = *axesFrameP;
 
@@ -1126,7 +2136,7 @@ int main(int, char*[])
                     axisToHandle.emplace(wl_pointer_event_frame_types::Axes::Axis{});
                 else if (axisToHandle->stoppedTimestampMs.has_value())
                 {
-                    MY_LOG_ERROR(
+                    MY_LOG_ERROR_RATE_LIMITED(
                         "The wl_pointer frame already contains a ",
                         (axisStopped == wl_pointer_axis::WL_POINTER_AXIS_VERTICAL_SCROLL) ? "vertical" : "horizontal"
                         " axis_stop event. Skipping this one."
@@ -1143,18 +2153,19 @@ int main(int, char*[])
             // This event is deprecated with wl_pointer version 8 - this event is not sent to clients supporting
             //   version 8 or later.
             static void onAxisDiscrete(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t axisType,
                 const int32_t discreteNumberOfSteps
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onAxisDiscrete(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onAxisDiscrete(routeP=", routeP, ", ",
                                                                     "pd=", pd, ", ",
                                                                     "axisType=", axisType, ", ",
                                                                     "discreteNumberOfSteps=", discreteNumberOfSteps,
                                                                     ')');
 
-                return (void)onAxisValue120(selfP, pd, axisType, discreteNumberOfSteps * 120);
+                const auto listenerScope = SeatRoutes<PointingDeviceListener>::resolve(routeP).listener.appCtx.enterListener("wl_pointer::axis_discrete", axisType, discreteNumberOfSteps);
+                return (void)onAxisValue120(routeP, pd, axisType, discreteNumberOfSteps * 120);
             }
 
             // Axis high-resolution scroll event
@@ -1162,20 +2173,20 @@ int main(int, char*[])
             // This event replaces the wl_pointer.axis_discrete event in clients supporting wl_pointer version 8
             //   or later.
             static void onAxisValue120(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t axisType,
                 const int32_t one120thFractionsOf1Step
             ) {
-                MY_LOG_TRACE("PointingDeviceListener::onAxisValue120(selfP=", selfP, ", ",
+                MY_LOG_TRACE("PointingDeviceListener::onAxisValue120(routeP=", routeP, ", ",
                                                                     "pd=", pd, ", ",
                                                                     "axisType=", axisType, ", ",
                                                                     "one120thFractionsOf1Step=", one120thFractionsOf1Step,
                                                                     ')');
 
-                auto& self = *static_cast<PointingDeviceListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<PointingDeviceListener>::resolve(routeP);
 
-                auto* const axesFrameP = self.getAxesFramePtrOrNull(pd, "wl_pointer::axis_discrete / axis_value120");
+                auto* const axesFrameP = self.getAxesFramePtrOrNull(*seat, pd, "wl_pointer::axis_discrete / axis_value120");
                 if (axesFrameP == nullptr) return;
                 auto& axesFrame = *axesFrameP;
 
@@ -1187,7 +2198,7 @@ int main(int, char*[])
                     axisToHandle.emplace(wl_pointer_event_frame_types::Axes::Axis{});
                 else if (axisToHandle->one120thFractionsOfWheelStep.has_value())
                 {
-                    MY_LOG_ERROR(
+                    MY_LOG_ERROR_RATE_LIMITED(
                         "The wl_pointer frame already contains a ",
                         (axisType == wl_pointer_axis::WL_POINTER_AXIS_VERTICAL_SCROLL) ? "vertical" : "horizontal"
                         " axis_discrete/axis_value120 event. Skipping this one."
@@ -1213,14 +2224,14 @@ int main(int, char*[])
             //   whether natural scrolling is active.
             // This event enables clients to match the scroll direction of a widget to the physical direction.
             static void onAxisRelativeDirection(
-                void * const selfP,
+                void * const routeP,
                 wl_pointer * const pd,
                 const uint32_t axisType,
                 const uint32_t relativeDirectionType
             );
 
         private: // onFrame helpers
-            void handleFrame(wl_pointer_event_frame_types::Enter enterFrame) const
+            void handleFrame(WLAppCtx::Seat& seat, wl_pointer_event_frame_types::Enter enterFrame) const
             {
                 MY_LOG_INFO(
                     "Handling wl_pointer::enter EVENT frame:\n",
@@ -1230,20 +2241,25 @@ int main(int, char*[])
                     "  surface       = ", enterFrame.surfaceEntered
                 );
 
-                if (enterFrame.surfaceEntered != appCtx.mainWindow.surface)
+                auto* const window = appCtx.findWindow(enterFrame.surfaceEntered);
+                if (window == nullptr)
                 {
-                    MY_LOG_WARN("wl_pointer::enter: the entered surface isn't the main window. Skipping the event frame.")
+                    MY_LOG_WARN("wl_pointer::enter: the entered surface isn't a window. Skipping the event frame.")
                     return;
                 }
 
-                appCtx.pointingDev.positionOnMainWindowSurface = WLAppCtx::PointingDevice::PositionOnSurface{
+                seat.pointingDev.focusedWindow = window;
+                seat.pointingDev.positionOnWindowSurface = WLAppCtx::Seat::PointingDevice::PositionOnSurface{
                     enterFrame.posX,
                     enterFrame.posY
                 };
-                appCtx.pointingDev.buttonsPressedState.reset();
+                seat.pointingDev.buttonsPressedState.reset();
+
+                // The content can be dragged anywhere within a window
+                seat.pointingDev.cursor.onEnter(enterFrame.evSerial, CursorShape::Grab);
             }
 
-            void handleFrame(wl_pointer_event_frame_types::Leave leaveFrame) const
+            void handleFrame(WLAppCtx::Seat& seat, wl_pointer_event_frame_types::Leave leaveFrame) const
             {
                 MY_LOG_INFO(
                     "Handling wl_pointer::leave EVENT frame:\n",
@@ -1251,36 +2267,41 @@ int main(int, char*[])
                     "  surface       = ", leaveFrame.surfaceLeft
                 );
 
-                if (leaveFrame.surfaceLeft != appCtx.mainWindow.surface)
+                // The window may have been closed meanwhile, then the focus is already reset
+                if ( (seat.pointingDev.focusedWindow == nullptr) || (leaveFrame.surfaceLeft != seat.pointingDev.focusedWindow->surface) )
                 {
-                    MY_LOG_WARN("wl_pointer::leave: the surface left isn't the main window. Skipping the event frame.")
+                    MY_LOG_WARN("wl_pointer::leave: the surface left isn't the focused window. Skipping the event frame.")
                     return;
                 }
 
-                appCtx.pointingDev.buttonsPressedState.reset();
-                appCtx.pointingDev.positionOnMainWindowSurface.reset();
+                seat.pointingDev.focusedWindow = nullptr;
+                seat.pointingDev.buttonsPressedState.reset();
+                seat.pointingDev.positionOnWindowSurface.reset();
+                seat.pointingDev.cursor.onLeave();
             }
 
-            void handleFrame(wl_pointer_event_frame_types::Motion motionFrame) const
+            void handleFrame(WLAppCtx::Seat& seat, wl_pointer_event_frame_types::Motion motionFrame) const
             {
-                MY_LOG_INFO(
+                MY_LOG_INFO_RATE_LIMITED(
                     "Handling wl_pointer::motion EVENT frame:\n",
                     "  x             = ", motionFrame.surfaceLocalX, '\n',
                     "  y             = ", motionFrame.surfaceLocalY, '\n',
                     "  timestamp     = ", motionFrame.evTimestampMs, " (ms)"
                 );
 
+                auto* const window = seat.pointingDev.focusedWindow;
                 if (
-                    appCtx.pointingDev.positionOnMainWindowSurface.has_value() &&
+                    (window != nullptr) &&
+                    seat.pointingDev.positionOnWindowSurface.has_value() &&
                     // only LMB is pressed
-                    appCtx.pointingDev.buttonsPressedState.test(WLAppCtx::PointingDevice::IDX_LMB) &&
-                    (appCtx.pointingDev.buttonsPressedState.count() == 1)
+                    seat.pointingDev.buttonsPressedState.test(WLAppCtx::Seat::PointingDevice::IDX_LMB) &&
+                    (seat.pointingDev.buttonsPressedState.count() == 1)
                    )
                 {
-                    const auto [currentX, currentY] = *appCtx.pointingDev.positionOnMainWindowSurface;
+                    const auto [currentX, currentY] = *seat.pointingDev.positionOnWindowSurface;
 
-                    MY_LOG_INFO("wl_pointer::motion: DRAG for x:", currentX, "->", motionFrame.surfaceLocalX, " ; ",
-                                                             "y:", currentY, "->", motionFrame.surfaceLocalY);
+                    MY_LOG_INFO_RATE_LIMITED("wl_pointer::motion: DRAG for x:", currentX, "->", motionFrame.surfaceLocalX, " ; ",
+                                                                          "y:", currentY, "->", motionFrame.surfaceLocalY);
 
                     const auto movingOffsetX = motionFrame.surfaceLocalX - currentX;
                     const auto movingOffsetY = motionFrame.surfaceLocalY - currentY;
@@ -1288,48 +2309,48 @@ int main(int, char*[])
                     if ((movingOffsetX != 0) || (movingOffsetY != 0))
                     {
                         // Subtracting is intended for the natural dragging effect
-                        contentState = contentState.movedFor(-movingOffsetX, -movingOffsetY);
-                        appCtx.mainWindow.mustBeRedrawn = true;
+                        window->contentState = window->contentState.movedFor(-movingOffsetX, -movingOffsetY);
+                        window->mustBeRedrawn = true;
                     }
                 }
 
-                appCtx.pointingDev.positionOnMainWindowSurface = WLAppCtx::PointingDevice::PositionOnSurface{
+                seat.pointingDev.positionOnWindowSurface = WLAppCtx::Seat::PointingDevice::PositionOnSurface{
                     motionFrame.surfaceLocalX,
                     motionFrame.surfaceLocalY
                 };
             }
 
-            void handleFrame(wl_pointer_event_frame_types::Button buttonFrame) const
+            void handleFrame(WLAppCtx::Seat& seat, wl_pointer_event_frame_types::Button buttonFrame) const
             {
                 const int buttonIdx = [linuxButton = buttonFrame.button]() -> int {
                     switch (linuxButton)
                     {
                         // BTN_MOUSE
-                        case BTN_LEFT:      return WLAppCtx::PointingDevice::IDX_LMB;
-                        case BTN_RIGHT:     return WLAppCtx::PointingDevice::IDX_RMB;
-                        case BTN_MIDDLE:    return WLAppCtx::PointingDevice::IDX_MMB;
-                        case BTN_SIDE:      return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 0;
-                        case BTN_EXTRA:     return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 1;
-                        case BTN_FORWARD:   return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 2;
-                        case BTN_BACK:      return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 3;
-                        case BTN_TASK:      return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 4;
+                        case BTN_LEFT:      return WLAppCtx::Seat::PointingDevice::IDX_LMB;
+                        case BTN_RIGHT:     return WLAppCtx::Seat::PointingDevice::IDX_RMB;
+                        case BTN_MIDDLE:    return WLAppCtx::Seat::PointingDevice::IDX_MMB;
+                        case BTN_SIDE:      return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 0;
+                        case BTN_EXTRA:     return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 1;
+                        case BTN_FORWARD:   return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 2;
+                        case BTN_BACK:      return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 3;
+                        case BTN_TASK:      return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 4;
 
                         // BTN_MISC
-                        case BTN_0:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 5;
-                        case BTN_1:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 6;
-                        case BTN_2:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 7;
-                        case BTN_3:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 8;
-                        case BTN_4:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 9;
-                        case BTN_5:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 10;
-                        case BTN_6:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 11;
-                        case BTN_7:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 12;
-                        case BTN_8:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 13;
-                        case BTN_9:         return WLAppCtx::PointingDevice::IDX_OTHERS_BEGIN + 14;
+                        case BTN_0:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 5;
+                        case BTN_1:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 6;
+                        case BTN_2:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 7;
+                        case BTN_3:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 8;
+                        case BTN_4:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 9;
+                        case BTN_5:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 10;
+                        case BTN_6:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 11;
+                        case BTN_7:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 12;
+                        case BTN_8:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 13;
+                        case BTN_9:         return WLAppCtx::Seat::PointingDevice::IDX_OTHERS_BEGIN + 14;
                     }
                     return -1;
                 }();
 
-                MY_LOG_INFO(
+                MY_LOG_INFO_RATE_LIMITED(
                     "Handling wl_pointer::button EVENT frame:\n",
                     "  state         = ", (buttonFrame.state == wl_pointer_button_state::WL_POINTER_BUTTON_STATE_PRESSED) ? "pressed" : "released", '\n',
                     "  button        = ", buttonFrame.button, '\n',
@@ -1337,26 +2358,36 @@ int main(int, char*[])
                     "  timestamp     = ", buttonFrame.evTimestampMs, " (ms)"
                 );
 
-                if ( (buttonIdx < 0) || (static_cast<unsigned>(buttonIdx) >= appCtx.pointingDev.buttonsPressedState.size()) )
+                if ( (buttonIdx < 0) || (static_cast<unsigned>(buttonIdx) >= seat.pointingDev.buttonsPressedState.size()) )
                 {
-                    MY_LOG_WARN("wl_pointer::button: an unsupported button #", buttonFrame.button, " has been pressed or released. Skipping the event frame.");
+                    MY_LOG_WARN_RATE_LIMITED("wl_pointer::button: an unsupported button #", buttonFrame.button, " has been pressed or released. Skipping the event frame.");
                     return;
                 }
 
-                appCtx.pointingDev.buttonsPressedState[buttonIdx] = (buttonFrame.state == wl_pointer_button_state::WL_POINTER_BUTTON_STATE_PRESSED);
-                MY_LOG_INFO(
+                seat.pointingDev.buttonsPressedState[buttonIdx] = (buttonFrame.state == wl_pointer_button_state::WL_POINTER_BUTTON_STATE_PRESSED);
+                MY_LOG_INFO_RATE_LIMITED(
                     "wl_pointer::button:\n"
-                    "  buttons state = ", appCtx.pointingDev.buttonsPressedState
+                    "  buttons state = ", seat.pointingDev.buttonsPressedState
                 );
+
+                seat.pointingDev.cursor.setShape(
+                    seat.pointingDev.buttonsPressedState.test(WLAppCtx::Seat::PointingDevice::IDX_LMB) ? CursorShape::Grabbing : CursorShape::Grab
+                );
+
+                if (buttonFrame.state == wl_pointer_button_state::WL_POINTER_BUTTON_STATE_PRESSED)
+                {
+                    for (const auto& l : buttonPressedListeners_)
+                        l(seat, buttonFrame.button, buttonFrame.evSerial);
+                }
             }
 
-            void handleFrame(wl_pointer_event_frame_types::Axes axesFrame) const
+            void handleFrame(WLAppCtx::Seat& seat, wl_pointer_event_frame_types::Axes axesFrame) const
             {
-                MY_LOG_INFO(
+                MY_LOG_INFO_RATE_LIMITED(
                     "Handling wl_pointer::axis EVENT frame:\n",
                     "  vaxis         = ", axesFrame.vertical.has_value() ? axesFrame.vertical.value().value.value_or(0.0) : 0.0, '\n',
                     "  haxis         = ", axesFrame.horizontal.has_value() ? axesFrame.horizontal.value().value.value_or(0.0) : 0.0
-                )
+                );
 
                 double movingOffsetX = 0;
                 double movingOffsetY = 0;
@@ -1367,24 +2398,25 @@ int main(int, char*[])
                 if (axesFrame.vertical.has_value())
                     movingOffsetY = axesFrame.vertical->value.value_or(0);
 
-                if ((movingOffsetX != 0) || (movingOffsetY != 0))
+                auto* const window = seat.pointingDev.focusedWindow;
+                if ( (window != nullptr) && ((movingOffsetX != 0) || (movingOffsetY != 0)) )
                 {
-                    contentState = contentState.movedFor(movingOffsetX, movingOffsetY);
-                    appCtx.mainWindow.mustBeRedrawn = true;
+                    window->contentState = window->contentState.movedFor(movingOffsetX, movingOffsetY);
+                    window->mustBeRedrawn = true;
                 }
             }
 
         private: // onAxis... helpers
-            wl_pointer_event_frame_types::Axes* getAxesFramePtrOrNull(wl_pointer * const pd, std::string_view eventName) const
+            static wl_pointer_event_frame_types::Axes* getAxesFramePtrOrNull(WLAppCtx::Seat& seat, wl_pointer * const pd, std::string_view eventName)
             {
                 wl_pointer_event_frame_types::Axes* result = nullptr;
 
-                if (appCtx.pointingDev.eventFrame.has_value())
-                    result = std::get_if<wl_pointer_event_frame_types::Axes>(&appCtx.pointingDev.eventFrame->info);
+                if (seat.pointingDev.eventFrame.has_value())
+                    result = std::get_if<wl_pointer_event_frame_types::Axes>(&seat.pointingDev.eventFrame->info);
                 else
                     result = std::get_if<wl_pointer_event_frame_types::Axes>(
-                        &appCtx.pointingDev.eventFrame.emplace(
-                            WLAppCtx::PointingDevice::EventFrame{
+                        &seat.pointingDev.eventFrame.emplace(
+                            WLAppCtx::Seat::PointingDevice::EventFrame{
                                 pd,
                                 wl_pointer_event_frame_types::Axes{}
                             }
@@ -1392,40 +2424,349 @@ int main(int, char*[])
                     );
 
                 if (result == nullptr)
-                    MY_LOG_ERROR("The wl_pointer frame already contains a non axis-like event. Skipping this ", eventName, ".");
+                    MY_LOG_ERROR_RATE_LIMITED("The wl_pointer frame already contains a non axis-like event. Skipping this ", eventName, ".");
 
                 return result;
             }
-        } pdListener{ appCtx, contentState };
+        } pdListener{ appCtx };
+
+        // Touchpad gestures: pinching zooms the content around the gesture center, swiping with 3+ fingers pans it
+        MY_LOG_INFO("Looking up a zwp_pointer_gestures_v1 global object, the version supported by this client: ", zwp_pointer_gestures_v1_interface.version, "...");
+        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
+        {
+            if (objInfo.interface == zwp_pointer_gestures_v1_interface.name)
+            {
+                const auto versionToBind = std::min<uint32_t>(zwp_pointer_gestures_v1_interface.version, objInfo.version);
+
+                MY_LOG_INFO("    ... Found a zwp_pointer_gestures_v1 object with name=", name, ", binding to version ", versionToBind, "...");
+
+                appCtx.pointerGestures = makeWLResourceWrapperChecked(
+                    static_cast<zwp_pointer_gestures_v1*>(MY_LOG_WLCALL(wl_registry_bind(
+                        *appCtx.registry,
+                        name,
+                        &zwp_pointer_gestures_v1_interface,
+                        versionToBind
+                    ))),
+                    nullptr,
+                    [](auto& gestures) {
+                        // The release request is only available since version 2
+                        if (MY_LOG_WLCALL(zwp_pointer_gestures_v1_get_version(gestures)) >= 2)
+                            MY_LOG_WLCALL_VALUELESS(zwp_pointer_gestures_v1_release(gestures));
+                        else
+                            MY_LOG_WLCALL_VALUELESS(zwp_pointer_gestures_v1_destroy(gestures));
+                        gestures = nullptr;
+                    }
+                );
+                if (!appCtx.pointerGestures.hasResource())
+                    throw std::system_error(errno, std::system_category(), "Failed to bind to the zwp_pointer_gestures_v1");
+
+                objInfo.bindedVersion = versionToBind;
+
+                break;
+            }
+        }
+        if (!appCtx.pointerGestures.hasResource())
+            MY_LOG_WARN("zwp_pointer_gestures_v1 isn't supported by the server. Touchpad gestures won't be available.");
+
+        // Installing zwp_pointer_gesture_pinch_v1_listener and zwp_pointer_gesture_swipe_v1_listener.
+        // While a pinch is in progress the frames are produced by transforming the last exactly rendered one
+        //   (see the event loop), so the content follows the fingers at the display rate no matter how expensive
+        //   its rendering is ; the exact frame is rendered once the pinch ends.
+        struct PointerGesturesListener
+        {
+            WLAppCtx& appCtx;
+
+            const zwp_pointer_gesture_pinch_v1_listener pinchWLHandler = {
+                &onPinchBegin,
+                &onPinchUpdate,
+                &onPinchEnd
+            };
+            const zwp_pointer_gesture_swipe_v1_listener swipeWLHandler = {
+                &onSwipeBegin,
+                &onSwipeUpdate,
+                &onSwipeEnd
+            };
+            SeatRoutes<PointerGesturesListener> seatRoutes{ *this, appCtx };
+
+        public:
+            explicit PointerGesturesListener(WLAppCtx& appCtx)
+                : appCtx(appCtx)
+            {}
+
+        public: // getters
+            /** @return true if a pinch of any seat is in progress over the window */
+            [[nodiscard]] bool isPinchInProgress(const WLAppCtx::Window& window) const noexcept
+            {
+                return std::any_of(appCtx.seats.begin(), appCtx.seats.end(), [&window](const WLAppCtx::Seat& seat) {
+                    return ( seat.pointingDev.pinch.has_value() && (seat.pointingDev.pinch->window == &window) );
+                });
+            }
+
+        private: // zwp_pointer_gesture_pinch_v1 callbacks
+            static void onPinchBegin(
+                void * const routeP,
+                zwp_pointer_gesture_pinch_v1 * const pinch,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                wl_surface * const surface,
+                const uint32_t fingers
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onPinchBegin(routeP=", routeP, ", ",
+                                                                   "pinch=", pinch, ", ",
+                                                                   "evSerial=", evSerial, ", ",
+                                                                   "evTimestampMs=", evTimestampMs, ", ",
+                                                                   "surface=", surface, ", ",
+                                                                   "fingers=", fingers,
+                                                                   ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_pinch_v1::begin", surface, fingers);
+
+                auto* const window = self.appCtx.findWindow(surface);
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("zwp_pointer_gesture_pinch_v1::begin: the surface isn't a window. Skipping the gesture.");
+                    return;
+                }
+
+                // The gesture happens under the pointer ; it's the center of the window if the position is unknown
+                const auto center = seat->pointingDev.positionOnWindowSurface.value_or(
+                    WLAppCtx::Seat::PointingDevice::PositionOnSurface{
+                        static_cast<double>(window->width) / 2,
+                        static_cast<double>(window->height) / 2
+                    }
+                );
+
+                seat->pointingDev.pinch = WLAppCtx::Seat::PointingDevice::Pinch{ window, window->contentState, center.x, center.y, 0, 0, 0 };
+            }
+
+            static void onPinchUpdate(
+                void * const routeP,
+                zwp_pointer_gesture_pinch_v1 * const pinch,
+                const uint32_t evTimestampMs,
+                const wl_fixed_t dx,
+                const wl_fixed_t dy,
+                const wl_fixed_t scale,
+                const wl_fixed_t rotation
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onPinchUpdate(routeP=", routeP, ", ",
+                                                                    "pinch=", pinch, ", ",
+                                                                    "evTimestampMs=", evTimestampMs, ", ",
+                                                                    "dx=", wl_fixed_to_double(dx), ", ",
+                                                                    "dy=", wl_fixed_to_double(dy), ", ",
+                                                                    "scale=", wl_fixed_to_double(scale), ", ",
+                                                                    "rotation=", wl_fixed_to_double(rotation),
+                                                                    ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_pinch_v1::update", scale, rotation);
+                if ( !seat->pointingDev.pinch.has_value() || seat->pointingDev.pinch->window->isClosed )
+                    return;
+                auto& pinchState = *seat->pointingDev.pinch;
+
+                // The scale is relative to the distance between the fingers at the beginning of the gesture,
+                //   so its square is the factor of viewportZoom
+                const double sideScale = wl_fixed_to_double(scale);
+                if (sideScale <= 0)
+                    return;
+
+                pinchState.panX += wl_fixed_to_double(dx);
+                pinchState.panY += wl_fixed_to_double(dy);
+                // Unlike the scale, the rotation is in degrees relative to the previous event
+                pinchState.rotation += wl_fixed_to_double(rotation) * std::numbers::pi / 180;
+
+                const auto zoomedState = pinchState.stateAtBegin
+                    .zoomedAround(pinchState.centerX, pinchState.centerY, sideScale * sideScale)
+                    .rotatedAround(pinchState.centerX, pinchState.centerY, pinchState.rotation);
+                const auto sideZoom = std::sqrt(zoomedState.viewportZoom);
+
+                // The content under the fingers moves along with them.
+                // The window isn't marked as mustBeRedrawn: the change of the content state is enough to get
+                //   a transformed frame.
+                pinchState.window->contentState = zoomedState.movedFor(-pinchState.panX / sideZoom, -pinchState.panY / sideZoom);
+
+                seat->pointingDev.cursor.setShape( (sideScale >= 1) ? CursorShape::ZoomIn : CursorShape::ZoomOut );
+            }
+
+            static void onPinchEnd(
+                void * const routeP,
+                zwp_pointer_gesture_pinch_v1 * const pinch,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                const int32_t cancelled
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onPinchEnd(routeP=", routeP, ", ",
+                                                                 "pinch=", pinch, ", ",
+                                                                 "evSerial=", evSerial, ", ",
+                                                                 "evTimestampMs=", evTimestampMs, ", ",
+                                                                 "cancelled=", cancelled,
+                                                                 ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_pinch_v1::end", cancelled);
+                if ( !seat->pointingDev.pinch.has_value() )
+                    return;
+
+                auto& window = *seat->pointingDev.pinch->window;
+                if (!window.isClosed)
+                {
+                    // E.g. the gesture has turned out to be something else
+                    if (cancelled != 0)
+                        window.contentState = seat->pointingDev.pinch->stateAtBegin;
+
+                    // The last frame has been a transformed one
+                    window.mustBeRedrawn = true;
+                }
+
+                seat->pointingDev.pinch.reset();
+                seat->pointingDev.cursor.setShape(CursorShape::Grab);
+            }
 
-        inputDevicesListener.addPointingDevAttachedEventListener([&appCtx, &pdListener] {
-            appCtx.pointingDev.wlDevice = makeWLResourceWrapperChecked(
-                MY_LOG_WLCALL(wl_seat_get_pointer(*appCtx.inputDevicesManager)),
+        private: // zwp_pointer_gesture_swipe_v1 callbacks
+            static void onSwipeBegin(
+                void * const routeP,
+                zwp_pointer_gesture_swipe_v1 * const swipe,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                wl_surface * const surface,
+                const uint32_t fingers
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onSwipeBegin(routeP=", routeP, ", ",
+                                                                   "swipe=", swipe, ", ",
+                                                                   "evSerial=", evSerial, ", ",
+                                                                   "evTimestampMs=", evTimestampMs, ", ",
+                                                                   "surface=", surface, ", ",
+                                                                   "fingers=", fingers,
+                                                                   ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_swipe_v1::begin", surface, fingers);
+
+                auto* const window = self.appCtx.findWindow(surface);
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("zwp_pointer_gesture_swipe_v1::begin: the surface isn't a window. Skipping the gesture.");
+                    return;
+                }
+
+                seat->pointingDev.swipe = WLAppCtx::Seat::PointingDevice::Swipe{ window, window->contentState };
+                seat->pointingDev.cursor.setShape(CursorShape::Grabbing);
+            }
+
+            static void onSwipeUpdate(
+                void * const routeP,
+                zwp_pointer_gesture_swipe_v1 * const swipe,
+                const uint32_t evTimestampMs,
+                const wl_fixed_t dx,
+                const wl_fixed_t dy
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onSwipeUpdate(routeP=", routeP, ", ",
+                                                                    "swipe=", swipe, ", ",
+                                                                    "evTimestampMs=", evTimestampMs, ", ",
+                                                                    "dx=", wl_fixed_to_double(dx), ", ",
+                                                                    "dy=", wl_fixed_to_double(dy),
+                                                                    ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_swipe_v1::update", dx, dy);
+                if ( !seat->pointingDev.swipe.has_value() || seat->pointingDev.swipe->window->isClosed )
+                    return;
+                auto& window = *seat->pointingDev.swipe->window;
+
+                // The same as dragging with LMB
+                window.contentState = window.contentState.movedFor(-wl_fixed_to_double(dx), -wl_fixed_to_double(dy));
+                window.mustBeRedrawn = true;
+            }
+
+            static void onSwipeEnd(
+                void * const routeP,
+                zwp_pointer_gesture_swipe_v1 * const swipe,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                const int32_t cancelled
+            ) {
+                MY_LOG_TRACE("PointerGesturesListener::onSwipeEnd(routeP=", routeP, ", ",
+                                                                 "swipe=", swipe, ", ",
+                                                                 "evSerial=", evSerial, ", ",
+                                                                 "evTimestampMs=", evTimestampMs, ", ",
+                                                                 "cancelled=", cancelled,
+                                                                 ')');
+
+                const auto& [self, seat] = SeatRoutes<PointerGesturesListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_pointer_gesture_swipe_v1::end", cancelled);
+                if ( !seat->pointingDev.swipe.has_value() )
+                    return;
+
+                if ( (cancelled != 0) && !seat->pointingDev.swipe->window->isClosed )
+                {
+                    seat->pointingDev.swipe->window->contentState = seat->pointingDev.swipe->stateAtBegin;
+                    seat->pointingDev.swipe->window->mustBeRedrawn = true;
+                }
+
+                seat->pointingDev.swipe.reset();
+                seat->pointingDev.cursor.setShape(CursorShape::Grab);
+            }
+        } gesturesListener{ appCtx };
+
+        inputDevicesListener.addPointingDevAttachedEventListener([&appCtx, &pdListener, &gesturesListener](WLAppCtx::Seat& seat) {
+            seat.pointingDev.wlDevice = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_seat_get_pointer(*seat.wlSeat)),
                 nullptr,
                 [](auto& pd) { MY_LOG_WLCALL_VALUELESS(wl_pointer_release(pd)); pd = nullptr; }
             );
-            if (!appCtx.pointingDev.wlDevice.hasResource())
+            if (!seat.pointingDev.wlDevice.hasResource())
                 throw std::system_error{errno, std::system_category(), "Failed to obtain a pointing device (wl_pointer), although it had been available"};
 
-            if (const auto err = MY_LOG_WLCALL(wl_pointer_add_listener(*appCtx.pointingDev.wlDevice, &pdListener.wlHandler, &pdListener)); err != 0)
+            seat.pointingDev.cursor.attachTo(*seat.pointingDev.wlDevice);
+
+            if (const auto err = MY_LOG_WLCALL(wl_pointer_add_listener(*seat.pointingDev.wlDevice, &pdListener.wlHandler, pdListener.seatRoutes.to(seat))); err != 0)
                 throw std::system_error{
                     errno,
                     std::system_category(),
                     "Failed to set the pointing device listener (wl_pointer_add_listener returned " + std::to_string(err) + ")"
                 };
+
+            if (!appCtx.pointerGestures.hasResource())
+                return;
+
+            seat.pointingDev.pinchGesture = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(zwp_pointer_gestures_v1_get_pinch_gesture(*appCtx.pointerGestures, *seat.pointingDev.wlDevice)),
+                nullptr,
+                [](auto& pinch) { MY_LOG_WLCALL_VALUELESS(zwp_pointer_gesture_pinch_v1_destroy(pinch)); pinch = nullptr; }
+            );
+            if (!seat.pointingDev.pinchGesture.hasResource())
+                throw std::system_error{errno, std::system_category(), "Failed to obtain a zwp_pointer_gesture_pinch_v1"};
+            if (const auto err = MY_LOG_WLCALL(zwp_pointer_gesture_pinch_v1_add_listener(*seat.pointingDev.pinchGesture, &gesturesListener.pinchWLHandler, gesturesListener.seatRoutes.to(seat))); err != 0)
+                throw std::system_error{
+                    errno,
+                    std::system_category(),
+                    "Failed to set the pinch gesture listener (zwp_pointer_gesture_pinch_v1_add_listener returned " + std::to_string(err) + ")"
+                };
+
+            seat.pointingDev.swipeGesture = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(zwp_pointer_gestures_v1_get_swipe_gesture(*appCtx.pointerGestures, *seat.pointingDev.wlDevice)),
+                nullptr,
+                [](auto& swipe) { MY_LOG_WLCALL_VALUELESS(zwp_pointer_gesture_swipe_v1_destroy(swipe)); swipe = nullptr; }
+            );
+            if (!seat.pointingDev.swipeGesture.hasResource())
+                throw std::system_error{errno, std::system_category(), "Failed to obtain a zwp_pointer_gesture_swipe_v1"};
+            if (const auto err = MY_LOG_WLCALL(zwp_pointer_gesture_swipe_v1_add_listener(*seat.pointingDev.swipeGesture, &gesturesListener.swipeWLHandler, gesturesListener.seatRoutes.to(seat))); err != 0)
+                throw std::system_error{
+                    errno,
+                    std::system_category(),
+                    "Failed to set the swipe gesture listener (zwp_pointer_gesture_swipe_v1_add_listener returned " + std::to_string(err) + ")"
+                };
         });
         // ============================================== END of Step 8 ===============================================
 
         // =========================== Step 9: handling keyboard input (excl. input methods) ==========================
-        { // initializing appCtx.keyboard.xkb.context
-            auto* xkbContext = MY_LOG_WLCALL(xkb_context_new(XKB_CONTEXT_NO_FLAGS));
-            if (xkbContext == nullptr)
-                throw std::system_error{errno, std::generic_category(), "Failed to create an xkb_context"};
-            appCtx.keyboard.xkb.context.reset(
-                xkbContext,
-                [](auto& xkbContext) { MY_LOG_WLCALL_VALUELESS(xkb_context_unref(xkbContext)); xkbContext = nullptr; }
-            );
-        }
+        // The keyboard.xkb.context of all the seats ; the keymaps of all the keyboards are compiled within the same one
+        const std::shared_ptr<xkb_context> sharedXkbContext{
+            MY_LOG_WLCALL(xkb_context_new(XKB_CONTEXT_NO_FLAGS)),
+            [](auto& xkbContext) { MY_LOG_WLCALL_VALUELESS(xkb_context_unref(xkbContext)); xkbContext = nullptr; }
+        };
+        if (sharedXkbContext == nullptr)
+            throw std::system_error{errno, std::generic_category(), "Failed to create an xkb_context"};
 
         struct KeyboardListener
         {
@@ -1439,28 +2780,94 @@ int main(int, char*[])
                 &onModifiers,
                 &onRepeatInfo
             };
+            SeatRoutes<KeyboardListener> seatRoutes{ *this, appCtx };
+
+        public:
+            // Receives the seat of the keyboard, the keysym and the serial of the wl_keyboard::key event
+            using KeyPressedEventListener = std::function<void(WLAppCtx::Seat& seat, xkb_keysym_t keysym, std::uint32_t evSerial)>;
+
+        public:
+            explicit KeyboardListener(WLAppCtx& appCtx)
+                : appCtx(appCtx)
+            {}
+
+        public:
+            void addKeyPressedEventListener(KeyPressedEventListener listener)
+            { keyPressedListeners_.emplace_back(std::move(listener)); }
+
+        private:
+            std::vector<KeyPressedEventListener> keyPressedListeners_;
+
+        private:
+            /** The pan and zoom shortcuts change the window having the keyboard focus of the seat */
+            void onShortcut(WLAppCtx::Seat& seat, const ShortcutAction action)
+            {
+                MY_LOG_INFO("kbListener: shortcut ", static_cast<int>(action), '.');
+
+                if (action == ShortcutAction::QUIT)
+                {
+                    appCtx.shouldExit = true;
+                    return;
+                }
+
+                auto* const window = seat.keyboard.focusedWindow;
+                if ( (window == nullptr) || window->isClosed )
+                    return;
+
+                // In the surface-local coordinates, i.e. the same on the screen at any zoom
+                constexpr double PAN_STEP = 40;
+                const double panStep = PAN_STEP / std::sqrt(window->contentState.viewportZoom);
+                switch (action)
+                {
+                    case ShortcutAction::PAN_LEFT:
+                        window->contentState = window->contentState.movedFor(-panStep, 0);
+                        break;
+                    case ShortcutAction::PAN_RIGHT:
+                        window->contentState = window->contentState.movedFor(panStep, 0);
+                        break;
+                    case ShortcutAction::PAN_UP:
+                        window->contentState = window->contentState.movedFor(0, -panStep);
+                        break;
+                    case ShortcutAction::PAN_DOWN:
+                        window->contentState = window->contentState.movedFor(0, panStep);
+                        break;
+                    case ShortcutAction::ZOOM_IN:
+                        window->contentState = window->contentState.zoomedIn();
+                        break;
+                    case ShortcutAction::ZOOM_OUT:
+                        window->contentState = window->contentState.zoomedOut();
+                        break;
+                    case ShortcutAction::RESTORE_ZOOM:
+                        window->contentState = window->contentState.restoredZoom();
+                        break;
+                    case ShortcutAction::QUIT:
+                        break;
+                }
+                window->mustBeRedrawn = true;
+            }
 
         private: // wlHandler's callbacks
             static void onKeymap(
-                void * const selfP,
+                void * const routeP,
                 wl_keyboard * const kb,
                 const uint32_t format,
                 const int32_t fd,
                 const uint32_t sizeBytes
             ) {
-                MY_LOG_TRACE("kbListener::onKeymap(selfP=", selfP, ", kb=", kb, ", format=", format, ", fd=", fd, ", size=", sizeBytes, ").");
+                MY_LOG_TRACE("kbListener::onKeymap(routeP=", routeP, ", kb=", kb, ", format=", format, ", fd=", fd, ", size=", sizeBytes, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::keymap", format, sizeBytes);
 
                 // wl_keyboard::keymap informs how hardware-dependent keyboard scancodes translate to virtual key codes and
                 //     which characters should be produced (if any).
                 // The keymap info isn't sent directly, but transferred through the file descriptor `fd`.
 
-                if (self.appCtx.keyboard.xkb.context == nullptr)
+                if (seat->keyboard.xkb.context == nullptr)
                     throw std::logic_error{"wl_keyboard::keymap: xkb_context is nullptr"};
 
-                self.appCtx.keyboard.xkb.state.reset();
-                self.appCtx.keyboard.xkb.keymap.reset();
+                seat->keyboard.xkb.state.reset();
+                seat->keyboard.xkb.keymap.reset();
 
                 if (format != wl_keyboard_keymap_format::WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1)
                 {
@@ -1479,7 +2886,7 @@ int main(int, char*[])
 
                 // WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1 means that the `fd` contains a libxkbcommon compatible, null-terminated string
                 auto* const newKeymap = xkb_keymap_new_from_string(
-                    self.appCtx.keyboard.xkb.context.get(),
+                    seat->keyboard.xkb.context.get(),
                     keymapData,
                     XKB_KEYMAP_FORMAT_TEXT_V1,
                     XKB_KEYMAP_COMPILE_NO_FLAGS
@@ -1494,7 +2901,7 @@ int main(int, char*[])
                     MY_LOG_ERROR("wl_keyboard::keymap: failed to create a new xkb_keymap.");
                     return;
                 }
-                self.appCtx.keyboard.xkb.keymap.reset(
+                seat->keyboard.xkb.keymap.reset(
                     newKeymap,
                     [](auto& keymap) { MY_LOG_WLCALL_VALUELESS(xkb_keymap_unref(keymap)); keymap = nullptr; }
                 );
@@ -1507,72 +2914,88 @@ int main(int, char*[])
                     MY_LOG_ERROR("wl_keyboard::keymap: failed to create a new xkb_state");
                     return;
                 }
-                self.appCtx.keyboard.xkb.state.reset(
+                seat->keyboard.xkb.state.reset(
                     newState,
                     [](auto& state) { MY_LOG_WLCALL_VALUELESS(xkb_state_unref(state)); state = nullptr; }
                 );
             }
 
             static void onEnter(
-                void * const selfP,
+                void * const routeP,
                 wl_keyboard * const kb,
                 const uint32_t serial,
                 wl_surface * const surface,
                 wl_array * const keys
             ) {
-                MY_LOG_TRACE("kbListener::onEnter(selfP=", selfP, ", kb=", kb, ", serial=", serial, ", surface=", surface, ", keys=", keys, ").");
+                MY_LOG_TRACE("kbListener::onEnter(routeP=", routeP, ", kb=", kb, ", serial=", serial, ", surface=", surface, ", keys=", keys, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
-                if (self.appCtx.mainWindow.surface != surface)
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::enter", surface, serial);
+                auto* const window = self.appCtx.findWindow(surface);
+                if (window == nullptr)
                 {
-                    MY_LOG_WARN("wl_keyboard::enter: unexpected wl_surface=", surface, " != ", self.appCtx.mainWindow.surface.getResource(), ". Skipped.");
+                    MY_LOG_WARN("wl_keyboard::enter: unexpected wl_surface=", surface, " isn't a window. Skipped.");
                     return;
                 }
-                self.appCtx.keyboard.lastSerial = serial;
+                seat->keyboard.focusedWindow = window;
+                seat->keyboard.lastSerial = serial;
             }
 
             static void onLeave(
-                void * const selfP,
+                void * const routeP,
                 wl_keyboard * const kb,
                 const uint32_t serial,
                 wl_surface * const surface
             ) {
-                MY_LOG_TRACE("kbListener::onLeave(selfP=", selfP, ", kb=", kb, ", serial=", serial, ", surface=", surface, ").");
+                MY_LOG_TRACE("kbListener::onLeave(routeP=", routeP, ", kb=", kb, ", serial=", serial, ", surface=", surface, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
-                if (self.appCtx.mainWindow.surface != surface)
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::leave", surface, serial);
+                // The window may have been closed meanwhile, then the focus is already reset
+                if ( (seat->keyboard.focusedWindow == nullptr) || (seat->keyboard.focusedWindow->surface != surface) )
                 {
-                    MY_LOG_WARN("wl_keyboard::enter: unexpected wl_surface=", surface, " != ", self.appCtx.mainWindow.surface.getResource(), ". Skipped.");
+                    MY_LOG_WARN("wl_keyboard::leave: unexpected wl_surface=", surface, " isn't the focused window. Skipped.");
                     return;
                 }
-                self.appCtx.keyboard.lastSerial = serial;
+                seat->keyboard.focusedWindow = nullptr;
+                seat->keyboard.lastSerial = serial;
             }
 
             static void onKey(
-                void * const selfP,
+                void * const routeP,
                 wl_keyboard * const kb,
                 const uint32_t serial,
                 const uint32_t time,
                 const uint32_t keyScancode,
                 const uint32_t state
             ) {
-                MY_LOG_TRACE("kbListener::onKey(selfP=", selfP, ", kb=", kb, ", serial=", serial, ", time=", time, ", keyScancode=", keyScancode, ", state=", state, ").");
+                MY_LOG_TRACE("kbListener::onKey(routeP=", routeP, ", kb=", kb, ", serial=", serial, ", time=", time, ", keyScancode=", keyScancode, ", state=", state, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
-                self.appCtx.keyboard.lastSerial = serial;
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::key", keyScancode, state);
+                seat->keyboard.lastSerial = serial;
 
                 // "to determine the xkb keycode, clients must add 8 to the key event keycode"
                 const xkb_keycode_t xkbKeycode = keyScancode + 8;
 
                 // TODO: log verbose information about key events
-                // TODO: modify the ContentState in response to key events
-                // TODO: make the app shut down in response to a key press
 
                 if (state == wl_keyboard_key_state::WL_KEYBOARD_KEY_STATE_PRESSED)
                 {
-                    const xkb_keysym_t xkbKeysym = MY_LOG_WLCALL(xkb_state_key_get_one_sym(self.appCtx.keyboard.xkb.state.get(), xkbKeycode));
+                    const xkb_keysym_t xkbKeysym = MY_LOG_WLCALL(xkb_state_key_get_one_sym(seat->keyboard.xkb.state.get(), xkbKeycode));
 
                     MY_LOG_INFO("wl_keyboard::key: key pressed (XKB keycode=", xkbKeycode, " , XKB keysym=", xkbKeysym, ").");
+
+                    // The shortcuts take precedence over the other listeners
+                    const auto modifiers = getShortcutModifiers(seat->keyboard.xkb.keymap.get(), seat->keyboard.xkb.state.get(), xkbKeycode);
+                    if (const auto action = KEYBOARD_SHORTCUTS.find(xkbKeysym, modifiers); action.has_value())
+                    {
+                        self.onShortcut(*seat, *action);
+                        return;
+                    }
+
+                    for (const auto& l : self.keyPressedListeners_)
+                        l(*seat, xkbKeysym, serial);
                 }
                 else if (state == wl_keyboard_key_state::WL_KEYBOARD_KEY_STATE_RELEASED)
                 {
@@ -1585,7 +3008,7 @@ int main(int, char*[])
             }
 
             static void onModifiers(
-                void * const selfP,
+                void * const routeP,
                 wl_keyboard * const kb,
                 const uint32_t serial,
                 const uint32_t modsDepressed,
@@ -1593,18 +3016,14 @@ int main(int, char*[])
                 const uint32_t modsLocked,
                 const uint32_t group
             ) {
-                MY_LOG_TRACE("kbListener::onModifiers(selfP=", selfP, ", kb=", kb, ", serial=", serial, ", modsDepressed=", modsDepressed, ", modsLatched=", modsLatched, ", modsLocked=", modsLocked, ", group=", group, ").");
+                MY_LOG_TRACE("kbListener::onModifiers(routeP=", routeP, ", kb=", kb, ", serial=", serial, ", modsDepressed=", modsDepressed, ", modsLatched=", modsLatched, ", modsLocked=", modsLocked, ", group=", group, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
-                if (self.appCtx.keyboard.wlDevice != kb)
-                {
-                    MY_LOG_WARN("wl_keyboard::modifiers: unexpected wl_keyboard=", kb, " != ", self.appCtx.keyboard.wlDevice.getResource(), ". Skipped.");
-                    return;
-                }
-                self.appCtx.keyboard.lastSerial = serial;
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::modifiers", modsDepressed, group);
+                seat->keyboard.lastSerial = serial;
 
                 const xkb_state_component state = MY_LOG_WLCALL(xkb_state_update_mask(
-                    self.appCtx.keyboard.xkb.state.get(),
+                    seat->keyboard.xkb.state.get(),
                     modsDepressed,
                     modsLatched,
                     modsLocked,
@@ -1618,85 +3037,1456 @@ int main(int, char*[])
             }
 
             static void onRepeatInfo(
-                [[maybe_unused]] void * const selfP,
+                [[maybe_unused]] void * const routeP,
                 [[maybe_unused]] wl_keyboard * const kb,
                 [[maybe_unused]] const int32_t rate,
                 [[maybe_unused]] const int32_t delay
             ) {
-                MY_LOG_TRACE("kbListener::onRepeatInfo(selfP=", selfP, ", kb=", kb, ", rate=", rate, ", delay=", delay, ").");
+                MY_LOG_TRACE("kbListener::onRepeatInfo(routeP=", routeP, ", kb=", kb, ", rate=", rate, ", delay=", delay, ").");
 
-                auto& self = *static_cast<KeyboardListener*>(selfP);
-                if (self.appCtx.keyboard.wlDevice != kb)
-                {
-                    MY_LOG_WARN("wl_keyboard::repeat_info: unexpected wl_keyboard=", kb, " != ", self.appCtx.keyboard.wlDevice.getResource(), ". Skipped.");
-                    return;
-                }
+                const auto& [self, seat] = SeatRoutes<KeyboardListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_keyboard::repeat_info", rate, delay);
 
-                self.appCtx.keyboard.repeatInfo.rate = rate;
-                self.appCtx.keyboard.repeatInfo.delay = delay;
+                seat->keyboard.repeatInfo.rate = rate;
+                seat->keyboard.repeatInfo.delay = delay;
             }
         } kbListener{ appCtx };
 
-        inputDevicesListener.addKeyboardAttachedEventListener([&appCtx, &kbListener] {
+        inputDevicesListener.addKeyboardAttachedEventListener([&kbListener](WLAppCtx::Seat& seat) {
             // TODO: handle the cases when a keyboard is dynamically attached/detached
 
-            appCtx.keyboard.wlDevice = makeWLResourceWrapperChecked(
-                MY_LOG_WLCALL(wl_seat_get_keyboard(*appCtx.inputDevicesManager)),
+            seat.keyboard.wlDevice = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_seat_get_keyboard(*seat.wlSeat)),
                 nullptr,
                 [](auto& kb) { MY_LOG_WLCALL_VALUELESS(wl_keyboard_release(kb)); kb = nullptr; }
             );
-            if (!appCtx.keyboard.wlDevice.hasResource())
+            if (!seat.keyboard.wlDevice.hasResource())
                 throw std::system_error{errno, std::system_category(), "Failed to obtain a keyboard (wl_keyboard), although it had been available"};
 
-            if (const auto err = MY_LOG_WLCALL(wl_keyboard_add_listener(*appCtx.keyboard.wlDevice, &kbListener.wlHandler, &kbListener)); err != 0)
+            if (const auto err = MY_LOG_WLCALL(wl_keyboard_add_listener(*seat.keyboard.wlDevice, &kbListener.wlHandler, kbListener.seatRoutes.to(seat))); err != 0)
                 throw std::system_error{
                     errno,
                     std::system_category(),
                     "Failed to set the keyboard listener (wl_keyboard_add_listener returned " + std::to_string(err) + ")"
                 };
 
-            appCtx.keyboard.repeatInfo.rate = 0;
-            appCtx.keyboard.repeatInfo.delay = 0;
+            seat.keyboard.repeatInfo.rate = 0;
+            seat.keyboard.repeatInfo.delay = 0;
         });
         // ============================================== END of Step 9 ===============================================
 
-        // === Step N: install listeners to all the Wayland objects (to handle errors and other important messages) ===
-
-        // 1. wl_display
-        struct ConnectionListener
-        {
-            WLAppCtx& appCtx;
-            const wl_display_listener wlHandler = { &onError, &onDeleteId };
+        // ===================== Step 10: clipboard and drag-and-drop via wl_data_device_manager ======================
 
-            static void onError(void* self, wl_display* /*connection*/, void* object_id, uint32_t code, const char* message)
-            {
-                MY_LOG_ERROR("A fatal wl_display error occurred: object_id=", object_id, " , code=", code, " , message=\"", message, "\"");
+        // The clipboard and drag-and-drop transfers are driven by the event loop (see Step 4)
+        DataTransfers dataTransfers{ eventLoop };
 
-                static_cast<ConnectionListener*>(self)->appCtx.shouldExit = true;
-            }
+        // Writing into a pipe closed by the receiver must just fail with EPIPE instead of killing the app
+        (void)std::signal(SIGPIPE, SIG_IGN);
 
-            static void onDeleteId(void* /*self*/, wl_display* /*connection*/, uint32_t /*id*/) {}
-        } connectionListener{ appCtx } ;
-        if (const auto err = MY_LOG_WLCALL(wl_display_add_listener(*appCtx.connection, &connectionListener.wlHandler, &connectionListener)); err != 0)
+        MY_LOG_INFO("Looking up a wl_data_device_manager global object, the version supported by this client: ", wl_data_device_manager_interface.version, "...");
+        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
         {
-            const std::error_code sysErr{errno, std::system_category()};
-            MY_LOG_ERROR("Failed to set the connection listener: wl_display_add_listener returned ", err, " (errno=", sysErr, " \"", sysErr.message(), "\").");
-        }
-
-        // 2. wl_compositor doesn't have events yet
+            if (objInfo.interface == wl_data_device_manager_interface.name)
+            {
+                // Version 3 introduced the drag-and-drop actions, nothing newer is needed
+                const auto versionToBind = std::min<uint32_t>(3, objInfo.version);
 
-        // 3. wl_shm only emits wl_shm_format events currently, which aren't interesting at the moment
+                MY_LOG_INFO("    ... Found a wl_data_device_manager object with name=", name, ", binding to version ", versionToBind, "...");
 
-        // 4. xdg_wm_base
-        struct XdgShellListener
-        {
-            WLAppCtx& appCtx;
+                appCtx.dataDeviceManager = makeWLResourceWrapperChecked(
+                    static_cast<wl_data_device_manager*>(MY_LOG_WLCALL(wl_registry_bind(
+                        *appCtx.registry,
+                        name,
+                        &wl_data_device_manager_interface,
+                        versionToBind
+                    ))),
+                    nullptr,
+                    [](auto& manager) { MY_LOG_WLCALL_VALUELESS(wl_data_device_manager_destroy(manager)); manager = nullptr; }
+                );
+                if (!appCtx.dataDeviceManager.hasResource())
+                    throw std::system_error(errno, std::system_category(), "Failed to bind to the wl_data_device_manager");
+
+                objInfo.bindedVersion = versionToBind;
+
+                break;
+            }
+        }
+
+        struct DataExchangeListener
+        {
+            WLAppCtx& appCtx;
+            DataTransfers& dataTransfers;
+
+            const wl_data_device_listener wlHandlerDevice = {
+                &onDataOffer,
+                &onEnter,
+                &onLeave,
+                &onMotion,
+                &onDrop,
+                &onSelection
+            };
+            const wl_data_offer_listener wlHandlerOffer = {
+                &onOfferMimeType,
+                &onOfferSourceActions,
+                &onOfferAction
+            };
+            const wl_data_source_listener wlHandlerSource = {
+                &onSourceTarget,
+                &onSourceSend,
+                &onSourceCancelled,
+                &onSourceDndDropPerformed,
+                &onSourceDndFinished,
+                &onSourceAction
+            };
+
+            // The snapshots of the view are offered as 32-bit BMP, which stores the pixels exactly like XRGB8888 does
+            const char * const viewMimeType = "image/bmp";
+
+            // The devices, the offers and the sources of a seat all carry the route to it
+            SeatRoutes<DataExchangeListener> seatRoutes{ *this, appCtx };
+
+        public:
+            void copyViewToClipboard(WLAppCtx::Seat& seat, const std::uint32_t evSerial)
+            {
+                MY_LOG_INFO("dataExchangeListener::copyViewToClipboard(seat=#", seat.id, ", evSerial=", evSerial, ").");
+
+                // The view of the window the keys have been pressed in
+                const auto* const window = seat.keyboard.focusedWindow;
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("dataExchangeListener::copyViewToClipboard: no window has the keyboard focus.");
+                    return;
+                }
+
+                auto source = createViewSource(seat);
+                if (!source.hasResource())
+                    return;
+
+                MY_LOG_WLCALL_VALUELESS(wl_data_device_set_selection(*seat.dataExchange.device, *source, evSerial));
+
+                seat.dataExchange.selectionSource = std::move(source);
+                seat.dataExchange.selectionPayload = snapshotWindowAsBmp(*window);
+            }
+
+            void pasteFromClipboard(WLAppCtx::Seat& seat)
+            {
+                MY_LOG_INFO("dataExchangeListener::pasteFromClipboard(seat=#", seat.id, ").");
+
+                if (!seat.dataExchange.selectionOffer.hasResource())
+                {
+                    MY_LOG_INFO("dataExchangeListener::pasteFromClipboard: the clipboard is empty.");
+                    return;
+                }
+
+                auto * const offer = *seat.dataExchange.selectionOffer;
+                const auto mimeType = chooseMimeType(seat, offer);
+                if (!mimeType.has_value())
+                {
+                    MY_LOG_WARN("dataExchangeListener::pasteFromClipboard: the clipboard content has no MIME types.");
+                    return;
+                }
+
+                receive(seat, offer, *mimeType, nullptr);
+            }
+
+            void startDraggingView(WLAppCtx::Seat& seat, const std::uint32_t evSerial)
+            {
+                MY_LOG_INFO("dataExchangeListener::startDraggingView(seat=#", seat.id, ", evSerial=", evSerial, ").");
+
+                // The drag starts from the window under the pointer
+                const auto* const window = seat.pointingDev.focusedWindow;
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("dataExchangeListener::startDraggingView: the pointer isn't over any window.");
+                    return;
+                }
+
+                auto source = createViewSource(seat);
+                if (!source.hasResource())
+                    return;
+
+                if (MY_LOG_WLCALL(wl_data_device_manager_get_version(*appCtx.dataDeviceManager)) >= 3)
+                    MY_LOG_WLCALL_VALUELESS(wl_data_source_set_actions(*source, WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY));
+
+                MY_LOG_WLCALL_VALUELESS(wl_data_device_start_drag(*seat.dataExchange.device, *source, *window->surface, nullptr, evSerial));
+
+                seat.dataExchange.dragSource = std::move(source);
+                seat.dataExchange.dragPayload = snapshotWindowAsBmp(*window);
+            }
+
+        private: // helpers
+            WLResourceWrapper<wl_data_source*> createViewSource(const WLAppCtx::Seat& seat)
+            {
+                if (!seat.dataExchange.device.hasResource())
+                {
+                    MY_LOG_WARN("dataExchangeListener: the clipboard and drag-and-drop aren't available.");
+                    return {};
+                }
+
+                auto source = makeWLResourceWrapperChecked(
+                    MY_LOG_WLCALL(wl_data_device_manager_create_data_source(*appCtx.dataDeviceManager)),
+                    nullptr,
+                    [](auto& source) { MY_LOG_WLCALL_VALUELESS(wl_data_source_destroy(source)); source = nullptr; }
+                );
+                if (!source.hasResource())
+                    throw std::system_error{errno, std::system_category(), "Failed to create a wl_data_source"};
+
+                if (const auto err = MY_LOG_WLCALL(wl_data_source_add_listener(*source, &wlHandlerSource, seatRoutes.to(seat))); err != 0)
+                    throw std::system_error{
+                        errno,
+                        std::system_category(),
+                        "Failed to set the data source listener (wl_data_source_add_listener returned " + std::to_string(err) + ")"
+                    };
+
+                MY_LOG_WLCALL_VALUELESS(wl_data_source_offer(*source, viewMimeType));
+
+                return source;
+            }
+
+            /** Prefers the images of the view, then plain text, then anything else the offer has */
+            std::optional<std::string> chooseMimeType(const WLAppCtx::Seat& seat, wl_data_offer * const offer) const
+            {
+                const auto mimeTypesIter = seat.dataExchange.offersMimeTypes.find(offer);
+                if ( (mimeTypesIter == seat.dataExchange.offersMimeTypes.end()) || mimeTypesIter->second.empty() )
+                    return std::nullopt;
+                const auto& mimeTypes = mimeTypesIter->second;
+
+                for (const std::string_view preferred : { std::string_view{ viewMimeType }, std::string_view{ "text/plain;charset=utf-8" }, std::string_view{ "text/plain" } })
+                {
+                    if (std::find(mimeTypes.begin(), mimeTypes.end(), preferred) != mimeTypes.end())
+                        return std::string{ preferred };
+                }
+                return mimeTypes.front();
+            }
+
+            /** Starts receiving the offer data asynchronously ; onReceived(seat) (if any) is invoked once it's done */
+            void receive(WLAppCtx::Seat& seat, wl_data_offer * const offer, const std::string& mimeType, std::function<void(WLAppCtx::Seat&)> onReceived)
+            {
+                int pipeFds[2] = { -1, -1 };
+                if (pipe2(pipeFds, O_CLOEXEC) != 0)
+                    throw std::system_error{errno, std::system_category(), "dataExchangeListener::receive: pipe2 failed"};
+
+                // libwayland duplicates the fd while marshalling the request, so the write end can be closed right away
+                MY_LOG_WLCALL_VALUELESS(wl_data_offer_receive(offer, mimeType.c_str(), pipeFds[1]));
+                (void)close(pipeFds[1]);
+
+                // The seat may be removed before the data arrives, so it's looked up again
+                dataTransfers.receive(pipeFds[0], [&appCtx = appCtx, seatId = seat.id, mimeType, onReceived = std::move(onReceived)](SharedMemoryBuffer data) {
+                    MY_LOG_INFO("dataExchangeListener: received ", data.getSize(), " bytes of \"", mimeType, "\".");
+
+                    auto* const seat = appCtx.findSeat([seatId](const WLAppCtx::Seat& seat) { return (seat.id == seatId); });
+                    if (seat == nullptr)
+                    {
+                        MY_LOG_WARN("dataExchangeListener: the seat #", seatId, " has been removed while receiving the data, dropping it.");
+                        return;
+                    }
+
+                    seat->dataExchange.lastReceived = std::move(data);
+                    seat->dataExchange.lastReceivedMimeType = mimeType;
+
+                    if (onReceived)
+                        onReceived(*seat);
+                });
+            }
+
+            static WLResourceWrapper<wl_data_offer*> wrapOffer(WLAppCtx::Seat& seat, wl_data_offer* offer)
+            {
+                return makeWLResourceWrapperChecked(
+                    std::move(offer),
+                    nullptr,
+                    [&offersMimeTypes = seat.dataExchange.offersMimeTypes](auto& offer) {
+                        offersMimeTypes.erase(offer);
+                        MY_LOG_WLCALL_VALUELESS(wl_data_offer_destroy(offer));
+                        offer = nullptr;
+                    }
+                );
+            }
+
+            /** Destroys the offer introduced last unless it's the adopted one */
+            static void dropPendingOffer(WLAppCtx::Seat& seat, wl_data_offer* const adoptedOffer = nullptr)
+            {
+                auto* const offer = std::exchange(seat.dataExchange.pendingOffer, nullptr);
+                if ( (offer == nullptr) || (offer == adoptedOffer) )
+                    return;
+
+                MY_LOG_WARN("dataExchangeListener: the wl_data_offer=", offer, " hasn't been adopted by wl_data_device::enter or ::selection, destroying it.");
+                seat.dataExchange.offersMimeTypes.erase(offer);
+                MY_LOG_WLCALL_VALUELESS(wl_data_offer_destroy(offer));
+            }
+
+        private: // wlHandlerDevice's callbacks
+            static void onDataOffer(void * const routeP, wl_data_device * const device, wl_data_offer * const offer)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onDataOffer(routeP=", routeP, ", device=", device, ", offer=", offer, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_device::data_offer", offer);
+
+                dropPendingOffer(*seat);
+                seat->dataExchange.pendingOffer = offer;
+
+                // The MIME types are announced right after this event, so the listener must be installed immediately
+                seat->dataExchange.offersMimeTypes[offer].clear();
+                if (const auto err = MY_LOG_WLCALL(wl_data_offer_add_listener(offer, &self.wlHandlerOffer, routeP)); err != 0)
+                    MY_LOG_ERROR("wl_data_device::data_offer: failed to set the data offer listener (wl_data_offer_add_listener returned ", err, ").");
+            }
+
+            static void onEnter(
+                void * const routeP,
+                wl_data_device * const device,
+                const uint32_t serial,
+                wl_surface * const surface,
+                const wl_fixed_t x,
+                const wl_fixed_t y,
+                wl_data_offer * const offer
+            ) {
+                MY_LOG_TRACE("dataExchangeListener::onEnter(routeP=", routeP, ", device=", device, ", serial=", serial, ", surface=", surface, ", x=", wl_fixed_to_double(x), ", y=", wl_fixed_to_double(y), ", offer=", offer, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_device::enter", offer, serial);
+
+                // A null offer means the drag carries no data (e.g. it's within another client)
+                dropPendingOffer(*seat, offer);
+                seat->dataExchange.dndOffer = wrapOffer(*seat, offer);
+                if ( (offer == nullptr) || (self.appCtx.findWindow(surface) == nullptr) )
+                    return;
+
+                const auto mimeType = self.chooseMimeType(*seat, offer);
+                MY_LOG_WLCALL_VALUELESS(wl_data_offer_accept(offer, serial, mimeType.has_value() ? mimeType->c_str() : nullptr));
+                if (MY_LOG_WLCALL(wl_data_offer_get_version(offer)) >= 3)
+                    MY_LOG_WLCALL_VALUELESS(wl_data_offer_set_actions(offer, WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY, WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY));
+            }
+
+            static void onLeave(void * const routeP, wl_data_device * const device)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onLeave(routeP=", routeP, ", device=", device, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_device::leave");
+                dropPendingOffer(*seat);
+                seat->dataExchange.dndOffer.reset();
+            }
+
+            static void onMotion(void * const routeP, wl_data_device * const /*device*/, const uint32_t /*timeMs*/, const wl_fixed_t x, const wl_fixed_t y)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_device::motion", x, y);
+                // Any window accepts drops anywhere, so the position doesn't matter
+            }
+
+            static void onDrop(void * const routeP, wl_data_device * const device)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onDrop(routeP=", routeP, ", device=", device, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_device::drop");
+                auto& dataExchange = seat->dataExchange;
+
+                if (!dataExchange.dndOffer.hasResource())
+                    return;
+
+                auto * const offer = *dataExchange.dndOffer;
+                const auto mimeType = self.chooseMimeType(*seat, offer);
+                if (!mimeType.has_value())
+                {
+                    dataExchange.dndOffer.reset();
+                    return;
+                }
+
+                dataExchange.droppedOffer = std::move(dataExchange.dndOffer);
+                self.receive(*seat, offer, *mimeType, [offer](WLAppCtx::Seat& seat) {
+                    auto& droppedOffer = seat.dataExchange.droppedOffer;
+                    if (droppedOffer != offer)
+                        return;
+
+                    // Lets the source know it may be destroyed
+                    if (MY_LOG_WLCALL(wl_data_offer_get_version(offer)) >= 3)
+                        MY_LOG_WLCALL_VALUELESS(wl_data_offer_finish(offer));
+                    droppedOffer.reset();
+                });
+            }
+
+            static void onSelection(void * const routeP, wl_data_device * const device, wl_data_offer * const offer)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onSelection(routeP=", routeP, ", device=", device, ", offer=", offer, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_device::selection", offer);
+
+                // The previous selection offer is no longer valid
+                dropPendingOffer(*seat, offer);
+                seat->dataExchange.selectionOffer = wrapOffer(*seat, offer);
+            }
+
+        private: // wlHandlerOffer's callbacks
+            static void onOfferMimeType(void * const routeP, wl_data_offer * const offer, const char * const mimeType)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onOfferMimeType(routeP=", routeP, ", offer=", offer, ", mimeType=\"", mimeType, "\").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_offer::offer", offer);
+                seat->dataExchange.offersMimeTypes[offer].emplace_back(mimeType);
+            }
+
+            static void onOfferSourceActions(void * const routeP, wl_data_offer * const offer, const uint32_t sourceActions)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_offer::source_actions", offer, sourceActions);
+                // Only copying is supported, which every source must support
+            }
+
+            static void onOfferAction(void * const routeP, wl_data_offer * const offer, const uint32_t dndAction)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_offer::action", offer, dndAction);
+                // Only copying is supported
+            }
+
+        private: // wlHandlerSource's callbacks
+            static void onSourceTarget(void * const routeP, wl_data_source * const source, const char * const /*mimeType*/)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_source::target", source);
+                // There's nothing to give feedback about: the drag has no icon
+            }
+
+            static void onSourceSend(void * const routeP, wl_data_source * const source, const char * const mimeType, const int32_t fd)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onSourceSend(routeP=", routeP, ", source=", source, ", mimeType=\"", mimeType, "\", fd=", fd, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_source::send", source, fd);
+                auto& dataExchange = seat->dataExchange;
+
+                DataTransfers::OutgoingPayload payload;
+                if (dataExchange.selectionSource == source)
+                    payload = dataExchange.selectionPayload;
+                else if (dataExchange.dragSource == source)
+                    payload = dataExchange.dragPayload;
+
+                if ( (payload == nullptr) || (std::string_view{ mimeType } != self.viewMimeType) )
+                {
+                    MY_LOG_WARN("wl_data_source::send: nothing to send for the source=", source, " and mimeType=\"", mimeType, "\".");
+                    (void)close(fd);
+                    return;
+                }
+
+                const auto payloadSize = payload->getSize();
+                self.dataTransfers.send(fd, std::move(payload), 0, payloadSize);
+            }
+
+            static void onSourceCancelled(void * const routeP, wl_data_source * const source)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onSourceCancelled(routeP=", routeP, ", source=", source, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_source::cancelled", source);
+                auto& dataExchange = seat->dataExchange;
+
+                // The transfers in flight hold their own references to the payloads
+                if (dataExchange.selectionSource == source)
+                {
+                    dataExchange.selectionSource.reset();
+                    dataExchange.selectionPayload.reset();
+                }
+                else if (dataExchange.dragSource == source)
+                {
+                    dataExchange.dragSource.reset();
+                    dataExchange.dragPayload.reset();
+                }
+            }
+
+            static void onSourceDndDropPerformed(void * const routeP, wl_data_source * const source)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_source::dnd_drop_performed", source);
+                // The data is still going to be requested via wl_data_source::send
+            }
+
+            static void onSourceDndFinished(void * const routeP, wl_data_source * const source)
+            {
+                MY_LOG_TRACE("dataExchangeListener::onSourceDndFinished(routeP=", routeP, ", source=", source, ").");
+
+                const auto& [self, seat] = SeatRoutes<DataExchangeListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_data_source::dnd_finished", source);
+                auto& dataExchange = seat->dataExchange;
+                if (dataExchange.dragSource == source)
+                {
+                    dataExchange.dragSource.reset();
+                    dataExchange.dragPayload.reset();
+                }
+            }
+
+            static void onSourceAction(void * const routeP, wl_data_source * const source, const uint32_t dndAction)
+            {
+                const auto listenerScope = SeatRoutes<DataExchangeListener>::resolve(routeP).listener.appCtx.enterListener("wl_data_source::action", source, dndAction);
+                // Only copying is supported
+            }
+        } dataExchangeListener{ appCtx, dataTransfers };
+
+        if (!appCtx.dataDeviceManager.hasResource())
+            MY_LOG_WARN("Couldn't find a wl_data_device_manager on the Wayland server, the clipboard and drag-and-drop won't be available.");
+
+        // Ctrl+C copies the view, Ctrl+V pastes ; dragging with the middle button drags the view out
+        kbListener.addKeyPressedEventListener([&dataExchangeListener](WLAppCtx::Seat& seat, const xkb_keysym_t keysym, const std::uint32_t evSerial) {
+            auto * const xkbState = seat.keyboard.xkb.state.get();
+            if ( (xkbState == nullptr) || (MY_LOG_WLCALL(xkb_state_mod_name_is_active(xkbState, XKB_MOD_NAME_CTRL, XKB_STATE_MODS_EFFECTIVE)) <= 0) )
+                return;
+
+            if (keysym == XKB_KEY_c)
+                dataExchangeListener.copyViewToClipboard(seat, evSerial);
+            else if (keysym == XKB_KEY_v)
+                dataExchangeListener.pasteFromClipboard(seat);
+        });
+        pdListener.addButtonPressedEventListener([&dataExchangeListener](WLAppCtx::Seat& seat, const std::uint32_t button, const std::uint32_t evSerial) {
+            if (button == BTN_MIDDLE)
+                dataExchangeListener.startDraggingView(seat, evSerial);
+        });
+        // ============================================== END of Step 10 ==============================================
+
+        // ================================== Step 11: Input: handling touchscreens ===================================
+
+        // Installing wl_touch_listener.
+        // The events of all the contacts are accumulated until wl_touch::frame, then the gesture recognizer turns them
+        //   into a single change of the content state per frame. Like with the touchpad pinch, the frames are transformed
+        //   from the last exactly rendered one while 2 fingers zoom the content.
+        struct TouchscreenListener
+        {
+            WLAppCtx& appCtx;
+
+            const wl_touch_listener wlHandler = {
+                &onDown,
+                &onUp,
+                &onMotion,
+                &onFrame,
+                &onCancel,
+                &onShape,
+                &onOrientation
+            };
+            SeatRoutes<TouchscreenListener> seatRoutes{ *this, appCtx };
+
+        public:
+            explicit TouchscreenListener(WLAppCtx& appCtx)
+                : appCtx(appCtx)
+            {}
+
+        public: // getters
+            /** @return true if there's a pinch of any seat over the window */
+            [[nodiscard]] bool isPinchInProgress(const WLAppCtx::Window& window) const noexcept
+            {
+                return std::any_of(appCtx.seats.begin(), appCtx.seats.end(), [&window](const WLAppCtx::Seat& seat) {
+                    return ( (seat.touchScreen.focusedWindow == &window) && isPinchInProgress(seat) );
+                });
+            }
+
+        private:
+            [[nodiscard]] static bool isPinchInProgress(const WLAppCtx::Seat& seat) noexcept
+            { return (seat.touchScreen.contacts.getActiveCount() >= 2); }
+
+        private: // wl_handler's callbacks
+            static void onDown(
+                void * const routeP,
+                wl_touch * const ts,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                wl_surface * const surface,
+                const int32_t id,
+                const wl_fixed_t surfaceLocalX,
+                const wl_fixed_t surfaceLocalY
+            ) {
+                MY_LOG_TRACE("TouchscreenListener::onDown(routeP=", routeP, ", ",
+                                                         "ts=", ts, ", ",
+                                                         "evSerial=", evSerial, ", ",
+                                                         "evTimestampMs=", evTimestampMs, ", ",
+                                                         "surface=", surface, ", ",
+                                                         "id=", id, ", ",
+                                                         "surfaceLocalX=", wl_fixed_to_double(surfaceLocalX), ", ",
+                                                         "surfaceLocalY=", wl_fixed_to_double(surfaceLocalY),
+                                                         ')');
+
+                const auto& [self, seat] = SeatRoutes<TouchscreenListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_touch::down", id, evTimestampMs);
+
+                auto* const window = self.appCtx.findWindow(surface);
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("wl_touch::down: the surface isn't a window. Skipping the contact #", id, '.');
+                    return;
+                }
+
+                // The gestures don't span several windows
+                auto& contacts = seat->touchScreen.contacts;
+                if (contacts.getActiveCount() == 0)
+                {
+                    seat->touchScreen.focusedWindow = window;
+                    seat->touchScreen.stateAtBegin = window->contentState;
+                }
+                else if (seat->touchScreen.focusedWindow != window)
+                {
+                    MY_LOG_WARN("wl_touch::down: the touch sequence has begun on another window. Skipping the contact #", id, '.');
+                    return;
+                }
+
+                if (!contacts.onDown(id, wl_fixed_to_double(surfaceLocalX), wl_fixed_to_double(surfaceLocalY)))
+                    MY_LOG_WARN("wl_touch::down: there are already ", TouchContactTable::MAX_CONTACTS, " contacts. Skipping the contact #", id, '.');
+            }
+
+            static void onUp(
+                void * const routeP,
+                wl_touch * const ts,
+                const uint32_t evSerial,
+                const uint32_t evTimestampMs,
+                const int32_t id
+            ) {
+                MY_LOG_TRACE("TouchscreenListener::onUp(routeP=", routeP, ", ",
+                                                       "ts=", ts, ", ",
+                                                       "evSerial=", evSerial, ", ",
+                                                       "evTimestampMs=", evTimestampMs, ", ",
+                                                       "id=", id,
+                                                       ')');
+
+                const auto& [self, seat] = SeatRoutes<TouchscreenListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_touch::up", id, evTimestampMs);
+
+                auto* const window = seat->touchScreen.focusedWindow;
+                if (window == nullptr)
+                    return;
+
+                const bool wasPinch = isPinchInProgress(*seat);
+                seat->touchScreen.contacts.onUp(id);
+
+                // The last frame may have been a transformed one
+                if (wasPinch && !isPinchInProgress(*seat))
+                    window->mustBeRedrawn = true;
+
+                if (seat->touchScreen.contacts.getActiveCount() == 0)
+                    seat->touchScreen.focusedWindow = nullptr;
+            }
+
+            static void onMotion(
+                void * const routeP,
+                wl_touch * const ts,
+                const uint32_t evTimestampMs,
+                const int32_t id,
+                const wl_fixed_t surfaceLocalX,
+                const wl_fixed_t surfaceLocalY
+            ) {
+                MY_LOG_TRACE("TouchscreenListener::onMotion(routeP=", routeP, ", ",
+                                                           "ts=", ts, ", ",
+                                                           "evTimestampMs=", evTimestampMs, ", ",
+                                                           "id=", id, ", ",
+                                                           "surfaceLocalX=", wl_fixed_to_double(surfaceLocalX), ", ",
+                                                           "surfaceLocalY=", wl_fixed_to_double(surfaceLocalY),
+                                                           ')');
+
+                const auto& [self, seat] = SeatRoutes<TouchscreenListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_touch::motion", id, evTimestampMs);
+                seat->touchScreen.contacts.onMotion(id, wl_fixed_to_double(surfaceLocalX), wl_fixed_to_double(surfaceLocalY));
+            }
+
+            static void onFrame(void * const routeP, wl_touch * const ts)
+            {
+                MY_LOG_TRACE("TouchscreenListener::onFrame(routeP=", routeP, ", ts=", ts, ')');
+
+                const auto& [self, seat] = SeatRoutes<TouchscreenListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_touch::frame");
+
+                const auto step = seat->touchScreen.gestureRecognizer.onFrame(seat->touchScreen.contacts);
+                auto* const window = seat->touchScreen.focusedWindow;
+                if ( !step.has_value() || (window == nullptr) )
+                    return;
+
+                MY_LOG_INFO_RATE_LIMITED(
+                    "Handling wl_touch::frame EVENT frame:\n",
+                    "  contacts      = ", step->contactsCount, '\n',
+                    "  pan           = (", step->panX, "; ", step->panY, ")\n",
+                    "  scale         = ", step->scale, '\n',
+                    "  rotation      = ", step->rotation, " (rad)"
+                );
+
+                // The content under the fingers moves along with them...
+                const auto sideZoom = std::sqrt(window->contentState.viewportZoom);
+                auto newState = window->contentState.movedFor(-step->panX / sideZoom, -step->panY / sideZoom);
+                // ... and is zoomed and rotated around their center
+                if (step->scale != 1)
+                    newState = newState.zoomedAround(step->centerX, step->centerY, step->scale * step->scale);
+                if (step->rotation != 0)
+                    newState = newState.rotatedAround(step->centerX, step->centerY, step->rotation);
+
+                window->contentState = newState;
+
+                // A single finger pans like LMB dragging ; the pinch is handled by the transformed frames
+                if (step->contactsCount == 1)
+                    window->mustBeRedrawn = true;
+            }
+
+            // The compositor has taken over the touch sequence (e.g. for its own gesture)
+            static void onCancel(void * const routeP, wl_touch * const ts)
+            {
+                MY_LOG_TRACE("TouchscreenListener::onCancel(routeP=", routeP, ", ts=", ts, ')');
+
+                const auto& [self, seat] = SeatRoutes<TouchscreenListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("wl_touch::cancel");
+
+                if (auto* const window = seat->touchScreen.focusedWindow; (window != nullptr) && (seat->touchScreen.contacts.getActiveCount() > 0))
+                {
+                    MY_LOG_INFO("wl_touch::cancel: reverting the content state to the one before the touch sequence.");
+                    window->contentState = seat->touchScreen.stateAtBegin;
+                    window->mustBeRedrawn = true;
+                }
+
+                seat->touchScreen.focusedWindow = nullptr;
+                seat->touchScreen.contacts.clear();
+                seat->touchScreen.gestureRecognizer.reset();
+            }
+
+            static void onShape(
+                void * const routeP,
+                wl_touch * const /*ts*/,
+                const int32_t id,
+                const wl_fixed_t major,
+                const wl_fixed_t /*minor*/
+            ) {
+                const auto listenerScope = SeatRoutes<TouchscreenListener>::resolve(routeP).listener.appCtx.enterListener("wl_touch::shape", id, major);
+                // These events aren't interesting for now
+            }
+
+            static void onOrientation(
+                void * const routeP,
+                wl_touch * const /*ts*/,
+                const int32_t id,
+                const wl_fixed_t orientation
+            ) {
+                const auto listenerScope = SeatRoutes<TouchscreenListener>::resolve(routeP).listener.appCtx.enterListener("wl_touch::orientation", id, orientation);
+                // These events aren't interesting for now
+            }
+        } tsListener{ appCtx };
+
+        inputDevicesListener.addTouchscreenAttachedEventListener([&tsListener](WLAppCtx::Seat& seat) {
+            seat.touchScreen.wlDevice = makeWLResourceWrapperChecked(
+                MY_LOG_WLCALL(wl_seat_get_touch(*seat.wlSeat)),
+                nullptr,
+                [](auto& ts) { MY_LOG_WLCALL_VALUELESS(wl_touch_release(ts)); ts = nullptr; }
+            );
+            if (!seat.touchScreen.wlDevice.hasResource())
+                throw std::system_error{errno, std::system_category(), "Failed to obtain a touchscreen (wl_touch), although it had been available"};
+
+            seat.touchScreen.contacts.clear();
+            seat.touchScreen.gestureRecognizer.reset();
+
+            if (const auto err = MY_LOG_WLCALL(wl_touch_add_listener(*seat.touchScreen.wlDevice, &tsListener.wlHandler, tsListener.seatRoutes.to(seat))); err != 0)
+                throw std::system_error{
+                    errno,
+                    std::system_category(),
+                    "Failed to set the touchscreen listener (wl_touch_add_listener returned " + std::to_string(err) + ")"
+                };
+        });
+        // ============================================== END of Step 11 ==============================================
+
+        // ================================= Step 12: Input: handling drawing tablets =================================
+        MY_LOG_INFO("Looking up a zwp_tablet_manager_v2 global object, the version supported by this client: ", zwp_tablet_manager_v2_interface.version, "...");
+        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
+        {
+            if (objInfo.interface == zwp_tablet_manager_v2_interface.name)
+            {
+                const auto versionToBind = std::min<uint32_t>(zwp_tablet_manager_v2_interface.version, objInfo.version);
+
+                MY_LOG_INFO("    ... Found a zwp_tablet_manager_v2 object with name=", name, ", binding to version ", versionToBind, "...");
+
+                appCtx.tabletManager = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_manager_v2*>(MY_LOG_WLCALL(wl_registry_bind(
+                        *appCtx.registry,
+                        name,
+                        &zwp_tablet_manager_v2_interface,
+                        versionToBind
+                    ))),
+                    nullptr,
+                    [](auto& manager) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_manager_v2_destroy(manager)); manager = nullptr; }
+                );
+                if (!appCtx.tabletManager.hasResource())
+                    throw std::system_error(errno, std::system_category(), "Failed to bind to the zwp_tablet_manager_v2");
+
+                objInfo.bindedVersion = versionToBind;
+
+                break;
+            }
+        }
+
+        // Installing the listeners of zwp_tablet_seat_v2 and of all the tablets, tools and pads it announces.
+        // The tools feed the stroke pipeline (one sample per zwp_tablet_tool_v2::frame), which is drained by the
+        //   event loop ; a pad button clears the ink.
+        struct TabletsListener
+        {
+            WLAppCtx& appCtx;
+
+            const zwp_tablet_seat_v2_listener seatWLHandler = {
+                &onTabletAdded,
+                &onToolAdded,
+                &onPadAdded
+            };
+            const zwp_tablet_v2_listener tabletWLHandler = {
+                &onTabletName,
+                &onTabletId,
+                &onTabletPath,
+                &onTabletDone,
+                &onTabletRemoved
+            };
+            const zwp_tablet_tool_v2_listener toolWLHandler = {
+                &onToolType,
+                &onToolHardwareSerial,
+                &onToolHardwareIdWacom,
+                &onToolCapability,
+                &onToolDone,
+                &onToolRemoved,
+                &onToolProximityIn,
+                &onToolProximityOut,
+                &onToolDown,
+                &onToolUp,
+                &onToolMotion,
+                &onToolPressure,
+                &onToolDistance,
+                &onToolTilt,
+                &onToolRotation,
+                &onToolSlider,
+                &onToolWheel,
+                &onToolButton,
+                &onToolFrame
+            };
+            const zwp_tablet_pad_v2_listener padWLHandler = {
+                &onPadGroup,
+                &onPadPath,
+                &onPadButtons,
+                &onPadDone,
+                &onPadButton,
+                &onPadEnter,
+                &onPadLeave,
+                &onPadRemoved
+            };
+            const zwp_tablet_pad_group_v2_listener padGroupWLHandler = {
+                &onPadGroupButtons,
+                &onPadGroupRing,
+                &onPadGroupStrip,
+                &onPadGroupModes,
+                &onPadGroupDone,
+                &onPadGroupModeSwitch
+            };
+            // The tablets, tools and pads are announced via the tablet seat of a wl_seat and carry the route to it too
+            SeatRoutes<TabletsListener> seatRoutes{ *this, appCtx };
+
+        public:
+            explicit TabletsListener(WLAppCtx& appCtx)
+                : appCtx(appCtx)
+            {}
+
+        private: // zwp_tablet_seat_v2 callbacks
+            static void onTabletAdded(void * const routeP, zwp_tablet_seat_v2 * const tabletSeat, zwp_tablet_v2 * const tablet)
+            {
+                MY_LOG_TRACE("TabletsListener::onTabletAdded(routeP=", routeP, ", tabletSeat=", tabletSeat, ", tablet=", tablet, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_seat_v2::tablet_added", tablet);
+
+                // The object has been created by the server, the client is only responsible for destroying it
+                seat->tablet.tablets[tablet] = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_v2*>(tablet),
+                    nullptr,
+                    [](auto& t) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_v2_destroy(t)); t = nullptr; }
+                );
+                if (const auto err = MY_LOG_WLCALL(zwp_tablet_v2_add_listener(tablet, &self.tabletWLHandler, routeP)); err != 0)
+                    MY_LOG_ERROR("Failed to set the tablet listener (zwp_tablet_v2_add_listener returned ", err, ").");
+            }
+
+            static void onToolAdded(void * const routeP, zwp_tablet_seat_v2 * const tabletSeat, zwp_tablet_tool_v2 * const tool)
+            {
+                MY_LOG_TRACE("TabletsListener::onToolAdded(routeP=", routeP, ", tabletSeat=", tabletSeat, ", tool=", tool, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_seat_v2::tool_added", tool);
+
+                seat->tablet.tools[tool] = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_tool_v2*>(tool),
+                    nullptr,
+                    [](auto& t) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_tool_v2_destroy(t)); t = nullptr; }
+                );
+                seat->tablet.toolsStates[tool] = WLAppCtx::Seat::TabletToolState{};
+                if (const auto err = MY_LOG_WLCALL(zwp_tablet_tool_v2_add_listener(tool, &self.toolWLHandler, routeP)); err != 0)
+                    MY_LOG_ERROR("Failed to set the tablet tool listener (zwp_tablet_tool_v2_add_listener returned ", err, ").");
+            }
+
+            static void onPadAdded(void * const routeP, zwp_tablet_seat_v2 * const tabletSeat, zwp_tablet_pad_v2 * const pad)
+            {
+                MY_LOG_TRACE("TabletsListener::onPadAdded(routeP=", routeP, ", tabletSeat=", tabletSeat, ", pad=", pad, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_seat_v2::pad_added", pad);
+
+                seat->tablet.pads[pad] = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_pad_v2*>(pad),
+                    nullptr,
+                    [](auto& p) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_pad_v2_destroy(p)); p = nullptr; }
+                );
+                if (const auto err = MY_LOG_WLCALL(zwp_tablet_pad_v2_add_listener(pad, &self.padWLHandler, routeP)); err != 0)
+                    MY_LOG_ERROR("Failed to set the tablet pad listener (zwp_tablet_pad_v2_add_listener returned ", err, ").");
+            }
+
+        private: // zwp_tablet_v2 callbacks
+            static void onTabletName(void * const routeP, zwp_tablet_v2 * const tablet, const char * const name)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_v2::name", tablet);
+                MY_LOG_INFO("zwp_tablet_v2::name: the tablet ", tablet, " is \"", (name == nullptr) ? "" : name, "\".");
+            }
+
+            static void onTabletId(void * const routeP, zwp_tablet_v2 * const /*tablet*/, const uint32_t vid, const uint32_t pid)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_v2::id", vid, pid);
+                // These events aren't interesting for now
+            }
+
+            static void onTabletPath(void * const routeP, zwp_tablet_v2 * const tablet, const char * const /*path*/)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_v2::path", tablet);
+                // These events aren't interesting for now
+            }
+
+            static void onTabletDone(void * const routeP, zwp_tablet_v2 * const tablet)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_v2::done", tablet);
+                // These events aren't interesting for now
+            }
+
+            static void onTabletRemoved(void * const routeP, zwp_tablet_v2 * const tablet)
+            {
+                MY_LOG_INFO("zwp_tablet_v2::removed: the tablet ", tablet, " has been removed.");
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_v2::removed", tablet);
+                seat->tablet.tablets.erase(tablet);
+            }
+
+        private: // zwp_tablet_tool_v2 callbacks
+            static void onToolType(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t toolType)
+            {
+                MY_LOG_INFO("zwp_tablet_tool_v2::type: the tool ", tool, " is of type ", toolType, '.');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::type", tool, toolType);
+                seat->tablet.toolsStates[tool].isEraser = (toolType == ZWP_TABLET_TOOL_V2_TYPE_ERASER);
+            }
+
+            static void onToolHardwareSerial(void * const routeP, zwp_tablet_tool_v2 * const /*tool*/, const uint32_t hi, const uint32_t lo)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::hardware_serial", hi, lo);
+                // These events aren't interesting for now
+            }
+
+            static void onToolHardwareIdWacom(void * const routeP, zwp_tablet_tool_v2 * const /*tool*/, const uint32_t hi, const uint32_t lo)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::hardware_id_wacom", hi, lo);
+                // These events aren't interesting for now
+            }
+
+            static void onToolCapability(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t capability)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::capability", tool, capability);
+                MY_LOG_INFO("zwp_tablet_tool_v2::capability: the tool ", tool, " has the capability ", capability, '.');
+            }
+
+            static void onToolDone(void * const routeP, zwp_tablet_tool_v2 * const tool)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::done", tool);
+                // These events aren't interesting for now
+            }
+
+            static void onToolRemoved(void * const routeP, zwp_tablet_tool_v2 * const tool)
+            {
+                MY_LOG_INFO("zwp_tablet_tool_v2::removed: the tool ", tool, " has been removed.");
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::removed", tool);
+
+                if (const auto iter = seat->tablet.toolsStates.find(tool); iter != seat->tablet.toolsStates.end())
+                {
+                    self.finishStroke(*seat, iter->second, 0);
+                    seat->tablet.toolsStates.erase(iter);
+                }
+                seat->tablet.tools.erase(tool);
+            }
+
+            static void onToolProximityIn(
+                void * const routeP,
+                zwp_tablet_tool_v2 * const tool,
+                const uint32_t evSerial,
+                zwp_tablet_v2 * const tablet,
+                wl_surface * const surface
+            ) {
+                MY_LOG_TRACE("TabletsListener::onToolProximityIn(routeP=", routeP, ", tool=", tool, ", evSerial=", evSerial, ", tablet=", tablet, ", surface=", surface, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::proximity_in", tool, surface);
+                seat->tablet.toolsStates[tool].window = self.appCtx.findWindow(surface);
+            }
+
+            static void onToolProximityOut(void * const routeP, zwp_tablet_tool_v2 * const tool)
+            {
+                MY_LOG_TRACE("TabletsListener::onToolProximityOut(routeP=", routeP, ", tool=", tool, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::proximity_out", tool);
+
+                auto& toolState = seat->tablet.toolsStates[tool];
+                toolState.window = nullptr;
+                toolState.isDown = false;
+            }
+
+            static void onToolDown(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t evSerial)
+            {
+                MY_LOG_TRACE("TabletsListener::onToolDown(routeP=", routeP, ", tool=", tool, ", evSerial=", evSerial, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::down", tool, evSerial);
+                seat->tablet.toolsStates[tool].isDown = true;
+            }
+
+            static void onToolUp(void * const routeP, zwp_tablet_tool_v2 * const tool)
+            {
+                MY_LOG_TRACE("TabletsListener::onToolUp(routeP=", routeP, ", tool=", tool, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::up", tool);
+                seat->tablet.toolsStates[tool].isDown = false;
+            }
+
+            static void onToolMotion(void * const routeP, zwp_tablet_tool_v2 * const tool, const wl_fixed_t surfaceLocalX, const wl_fixed_t surfaceLocalY)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::motion", surfaceLocalX, surfaceLocalY);
+
+                auto& toolState = seat->tablet.toolsStates[tool];
+                toolState.surfaceLocalX = wl_fixed_to_double(surfaceLocalX);
+                toolState.surfaceLocalY = wl_fixed_to_double(surfaceLocalY);
+            }
+
+            static void onToolPressure(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t pressure)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::pressure", tool, pressure);
+                seat->tablet.toolsStates[tool].pressure = pressure;
+            }
+
+            static void onToolDistance(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t distance)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::distance", tool, distance);
+                // These events aren't interesting for now
+            }
+
+            static void onToolTilt(void * const routeP, zwp_tablet_tool_v2 * const tool, const wl_fixed_t tiltX, const wl_fixed_t tiltY)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::tilt", tiltX, tiltY);
+
+                auto& toolState = seat->tablet.toolsStates[tool];
+                toolState.tiltX = wl_fixed_to_double(tiltX);
+                toolState.tiltY = wl_fixed_to_double(tiltY);
+            }
+
+            static void onToolRotation(void * const routeP, zwp_tablet_tool_v2 * const tool, const wl_fixed_t degrees)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::rotation", tool, degrees);
+                // These events aren't interesting for now
+            }
+
+            static void onToolSlider(void * const routeP, zwp_tablet_tool_v2 * const tool, const int32_t position)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::slider", tool, position);
+                // These events aren't interesting for now
+            }
+
+            static void onToolWheel(void * const routeP, zwp_tablet_tool_v2 * const /*tool*/, const wl_fixed_t degrees, const int32_t clicks)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::wheel", degrees, clicks);
+                // These events aren't interesting for now
+            }
+
+            static void onToolButton(
+                void * const routeP,
+                zwp_tablet_tool_v2 * const /*tool*/,
+                const uint32_t /*evSerial*/,
+                const uint32_t button,
+                const uint32_t state
+            ) {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_tool_v2::button", button, state);
+                // These events aren't interesting for now
+            }
+
+            static void onToolFrame(void * const routeP, zwp_tablet_tool_v2 * const tool, const uint32_t evTimestampMs)
+            {
+                MY_LOG_TRACE("TabletsListener::onToolFrame(routeP=", routeP, ", tool=", tool, ", evTimestampMs=", evTimestampMs, ')');
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_tool_v2::frame", evTimestampMs);
+                auto& toolState = seat->tablet.toolsStates[tool];
+
+                if ( toolState.isDown && (toolState.window != nullptr) && !toolState.window->isClosed )
+                {
+                    if (!toolState.isDrawing)
+                        toolState.strokeWindow = toolState.window;
+
+                    seat->tablet.strokes.push(self.makeSample(
+                        toolState,
+                        toolState.isDrawing ? StrokeSample::Phase::Continue : StrokeSample::Phase::Begin,
+                        evTimestampMs
+                    ));
+                    toolState.isDrawing = true;
+                }
+                else
+                {
+                    self.finishStroke(*seat, toolState, evTimestampMs);
+                }
+            }
+
+        private: // zwp_tablet_pad_v2 callbacks
+            static void onPadGroup(void * const routeP, zwp_tablet_pad_v2 * const pad, zwp_tablet_pad_group_v2 * const padGroup)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_pad_v2::group", pad, padGroup);
+
+                // The groups aren't used, but they announce the rings and the strips, which must be destroyed too
+                seat->tablet.padsParts[pad].groups.push_back(makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_pad_group_v2*>(padGroup),
+                    nullptr,
+                    [](auto& g) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_pad_group_v2_destroy(g)); g = nullptr; }
+                ));
+                if (const auto err = MY_LOG_WLCALL(zwp_tablet_pad_group_v2_add_listener(padGroup, &self.padGroupWLHandler, routeP)); err != 0)
+                    MY_LOG_ERROR("Failed to set the tablet pad group listener (zwp_tablet_pad_group_v2_add_listener returned ", err, ").");
+            }
+
+            static void onPadPath(void * const routeP, zwp_tablet_pad_v2 * const pad, const char * const /*path*/)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_v2::path", pad);
+                // These events aren't interesting for now
+            }
+
+            static void onPadButtons(void * const routeP, zwp_tablet_pad_v2 * const pad, const uint32_t buttonsCount)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_v2::buttons", pad, buttonsCount);
+                MY_LOG_INFO("zwp_tablet_pad_v2::buttons: the pad ", pad, " has ", buttonsCount, " button(s).");
+            }
+
+            static void onPadDone(void * const routeP, zwp_tablet_pad_v2 * const pad)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_v2::done", pad);
+                // These events aren't interesting for now
+            }
+
+            static void onPadButton(
+                void * const routeP,
+                zwp_tablet_pad_v2 * const pad,
+                const uint32_t evTimestampMs,
+                const uint32_t button,
+                const uint32_t state
+            ) {
+                MY_LOG_INFO("zwp_tablet_pad_v2::button: pad=", pad, ", button=", button, ", state=", state, ", timestamp=", evTimestampMs, " (ms).");
+
+                auto& self = SeatRoutes<TabletsListener>::resolve(routeP).listener;
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_pad_v2::button", button, state);
+
+                if ( (button == 0) && (state == ZWP_TABLET_PAD_V2_BUTTON_STATE_PRESSED) )
+                {
+                    // The windows pick up the cleared tiles like the drawn ones
+                    self.appCtx.ink.clear();
+                }
+            }
+
+            static void onPadEnter(
+                void * const routeP,
+                zwp_tablet_pad_v2 * const pad,
+                const uint32_t /*evSerial*/,
+                zwp_tablet_v2 * const /*tablet*/,
+                wl_surface * const surface
+            ) {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_v2::enter", pad, surface);
+                // These events aren't interesting for now
+            }
+
+            static void onPadLeave(void * const routeP, zwp_tablet_pad_v2 * const pad, const uint32_t /*evSerial*/, wl_surface * const surface)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_v2::leave", pad, surface);
+                // These events aren't interesting for now
+            }
+
+            static void onPadRemoved(void * const routeP, zwp_tablet_pad_v2 * const pad)
+            {
+                MY_LOG_INFO("zwp_tablet_pad_v2::removed: the pad ", pad, " has been removed.");
+
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_pad_v2::removed", pad);
+                seat->tablet.padsParts.erase(pad);
+                seat->tablet.pads.erase(pad);
+            }
+
+        private: // zwp_tablet_pad_group_v2 callbacks
+            static void onPadGroupButtons(void * const routeP, zwp_tablet_pad_group_v2 * const padGroup, wl_array * const /*buttons*/)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_group_v2::buttons", padGroup);
+                // These events aren't interesting for now
+            }
+
+            static void onPadGroupRing(void * const routeP, zwp_tablet_pad_group_v2 * const padGroup, zwp_tablet_pad_ring_v2 * const ring)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_pad_group_v2::ring", padGroup, ring);
+
+                auto wrapper = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_pad_ring_v2*>(ring),
+                    nullptr,
+                    [](auto& r) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_pad_ring_v2_destroy(r)); r = nullptr; }
+                );
+                if (auto* const padParts = findPadParts(*seat, padGroup); padParts != nullptr)
+                    padParts->rings.push_back(std::move(wrapper));
+            }
+
+            static void onPadGroupStrip(void * const routeP, zwp_tablet_pad_group_v2 * const padGroup, zwp_tablet_pad_strip_v2 * const strip)
+            {
+                const auto& [self, seat] = SeatRoutes<TabletsListener>::resolve(routeP);
+                const auto listenerScope = self.appCtx.enterListener("zwp_tablet_pad_group_v2::strip", padGroup, strip);
+
+                auto wrapper = makeWLResourceWrapperChecked(
+                    static_cast<zwp_tablet_pad_strip_v2*>(strip),
+                    nullptr,
+                    [](auto& s) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_pad_strip_v2_destroy(s)); s = nullptr; }
+                );
+                if (auto* const padParts = findPadParts(*seat, padGroup); padParts != nullptr)
+                    padParts->strips.push_back(std::move(wrapper));
+            }
+
+            static void onPadGroupModes(void * const routeP, zwp_tablet_pad_group_v2 * const padGroup, const uint32_t modes)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_group_v2::modes", padGroup, modes);
+                // These events aren't interesting for now
+            }
+
+            static void onPadGroupDone(void * const routeP, zwp_tablet_pad_group_v2 * const padGroup)
+            {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_group_v2::done", padGroup);
+                // These events aren't interesting for now
+            }
+
+            static void onPadGroupModeSwitch(
+                void * const routeP,
+                zwp_tablet_pad_group_v2 * const padGroup,
+                const uint32_t /*evTimestampMs*/,
+                const uint32_t /*evSerial*/,
+                const uint32_t mode
+            ) {
+                const auto listenerScope = SeatRoutes<TabletsListener>::resolve(routeP).listener.appCtx.enterListener("zwp_tablet_pad_group_v2::mode_switch", padGroup, mode);
+                // These events aren't interesting for now
+            }
+
+        private:
+            /** @return the parts of the pad the group belongs to ; nullptr (and the rings/strips are destroyed right away) if it's unknown */
+            static WLAppCtx::Seat::TabletPadParts* findPadParts(WLAppCtx::Seat& seat, zwp_tablet_pad_group_v2 * const padGroup)
+            {
+                for (auto& [pad, padParts] : seat.tablet.padsParts)
+                {
+                    if (std::find(padParts.groups.begin(), padParts.groups.end(), padGroup) != padParts.groups.end())
+                        return &padParts;
+                }
+                MY_LOG_WARN("TabletsListener: the zwp_tablet_pad_group_v2=", padGroup, " belongs to no pad of the seat #", seat.id, '.');
+                return nullptr;
+            }
+
+            StrokeSample makeSample(const WLAppCtx::Seat::TabletToolState& toolState, const StrokeSample::Phase phase, const std::uint32_t evTimestampMs) const
+            {
+                // The same mapping as the rendering uses: the surface point x shows the content point
+                //   (originX + toUnrotatedLocal(x)) / sideZoom
+                const auto& window = *toolState.strokeWindow;
+                const auto mapping = computeViewportMapping(window.contentState);
+                const auto [unrotatedX, unrotatedY] = window.contentState.toUnrotatedLocal(toolState.surfaceLocalX, toolState.surfaceLocalY);
+
+                return StrokeSample{
+                    (static_cast<double>(mapping.originX) + unrotatedX) / mapping.sideZoom,
+                    (static_cast<double>(mapping.originY) + unrotatedY) / mapping.sideZoom,
+                    static_cast<float>(toolState.pressure) / 65535.0f,
+                    static_cast<float>(toolState.tiltX),
+                    static_cast<float>(toolState.tiltY),
+                    static_cast<float>(1 / mapping.sideZoom),
+                    evTimestampMs,
+                    phase,
+                    toolState.isEraser
+                };
+            }
+
+            void finishStroke(WLAppCtx::Seat& seat, WLAppCtx::Seat::TabletToolState& toolState, const std::uint32_t evTimestampMs)
+            {
+                if (!toolState.isDrawing)
+                    return;
+
+                seat.tablet.strokes.push(makeSample(toolState, StrokeSample::Phase::End, evTimestampMs));
+                toolState.isDrawing = false;
+            }
+        } tabletsListener{ appCtx };
+
+        if (!appCtx.tabletManager.hasResource())
+            MY_LOG_WARN("zwp_tablet_manager_v2 isn't supported by the server. Drawing tablets won't be available.");
+        // ============================================== END of Step 12 ==============================================
+
+        // ===================== Step 13: Input: binding the wl_seat globals and setting up the seats =================
+        // Does everything per seat of Steps 7 - 12 ; the devices themselves are obtained once the seat announces them
+        //   via wl_seat::capabilities
+        const auto addSeat = [&](const std::uint32_t name, WLAppCtx::WLGlobalObjectInfo& objInfo) {
+            const auto versionToBind = std::min<uint32_t>(wl_seat_interface.version, objInfo.version);
+
+            auto* const seatP = appCtx.findFreeSeatSlot();
+            if (seatP == nullptr)
+            {
+                MY_LOG_WARN("All the ", WLAppCtx::MAX_SEATS, " seat slots are taken, ignoring the wl_seat global object with name=", name, '.');
+                return;
+            }
+            auto& seat = *seatP;
+            seat.id = appCtx.nextSeatId++;
+            seat.globalName = name;
+            seat.wlSeat = makeWLResourceWrapperChecked(
+                static_cast<wl_seat*>(MY_LOG_WLCALL(wl_registry_bind(
+                    *appCtx.registry,
+                    name,
+                    &wl_seat_interface,
+                    versionToBind
+                ))),
+                nullptr,
+                [versionToBind](auto& seat) {
+                    if (versionToBind < 5)
+                        MY_LOG_WLCALL_VALUELESS(wl_seat_destroy(seat));
+                    else
+                        MY_LOG_WLCALL_VALUELESS(wl_seat_release(seat));
+                    seat = nullptr;
+                }
+            );
+            if (!seat.wlSeat.hasResource())
+                throw std::system_error{errno, std::system_category(), "Failed to bind to the wl_seat using the version=" + std::to_string(versionToBind)};
+
+            objInfo.bindedVersion = versionToBind;
+
+            // All the seats share the same listener, so their events go through the same path ; the route tells the seat
+            if (const auto err = MY_LOG_WLCALL(wl_seat_add_listener(*seat.wlSeat, &inputDevicesListener.wlHandler, inputDevicesListener.seatRoutes.to(seat))); err != 0)
+                throw std::system_error(
+                    errno,
+                    std::system_category(),
+                    "Failed to set the input devices listener (wl_seat_add_listener returned " + std::to_string(err) + ")"
+                );
+
+            // Each seat has its own pointer, hence its own cursor
+            if (appCtx.cursorShapeManager.hasResource())
+            {
+                seat.pointingDev.cursor = PointerCursor::makeServerSide(*appCtx.cursorShapeManager);
+            }
+            else if (appCtx.cursorTheme.isValid())
+            {
+                try
+                {
+                    seat.pointingDev.cursor = PointerCursor::makeClientSide(appCtx.cursorTheme, *appCtx.compositor);
+                }
+                catch (const std::exception& err)
+                {
+                    MY_LOG_WARN("Failed to set up the client side cursor (\"", err.what(), "\"). The cursor of the seat #", seat.id, " will be left up to the server.");
+                }
+            }
+
+            seat.keyboard.xkb.context = sharedXkbContext;
+
+            // Every seat has its own clipboard and drags
+            if (appCtx.dataDeviceManager.hasResource())
+            {
+                const auto managerVersion = MY_LOG_WLCALL(wl_data_device_manager_get_version(*appCtx.dataDeviceManager));
+
+                seat.dataExchange.device = makeWLResourceWrapperChecked(
+                    MY_LOG_WLCALL(wl_data_device_manager_get_data_device(*appCtx.dataDeviceManager, *seat.wlSeat)),
+                    nullptr,
+                    [managerVersion](auto& device) {
+                        if (managerVersion < 2)
+                            MY_LOG_WLCALL_VALUELESS(wl_data_device_destroy(device));
+                        else
+                            MY_LOG_WLCALL_VALUELESS(wl_data_device_release(device));
+                        device = nullptr;
+                    }
+                );
+                if (!seat.dataExchange.device.hasResource())
+                    throw std::system_error{errno, std::system_category(), "Failed to obtain a wl_data_device for the wl_seat #" + std::to_string(seat.id)};
+
+                if (const auto err = MY_LOG_WLCALL(wl_data_device_add_listener(*seat.dataExchange.device, &dataExchangeListener.wlHandlerDevice, dataExchangeListener.seatRoutes.to(seat))); err != 0)
+                    throw std::system_error{
+                        errno,
+                        std::system_category(),
+                        "Failed to set the data device listener (wl_data_device_add_listener returned " + std::to_string(err) + ")"
+                    };
+            }
+
+            if (appCtx.tabletManager.hasResource())
+            {
+                seat.tablet.seat = makeWLResourceWrapperChecked(
+                    MY_LOG_WLCALL(zwp_tablet_manager_v2_get_tablet_seat(*appCtx.tabletManager, *seat.wlSeat)),
+                    nullptr,
+                    [](auto& tabletSeat) { MY_LOG_WLCALL_VALUELESS(zwp_tablet_seat_v2_destroy(tabletSeat)); tabletSeat = nullptr; }
+                );
+                if (!seat.tablet.seat.hasResource())
+                    throw std::system_error{errno, std::system_category(), "Failed to obtain a zwp_tablet_seat_v2 for the wl_seat #" + std::to_string(seat.id)};
+
+                if (const auto err = MY_LOG_WLCALL(zwp_tablet_seat_v2_add_listener(*seat.tablet.seat, &tabletsListener.seatWLHandler, tabletsListener.seatRoutes.to(seat))); err != 0)
+                    throw std::system_error{
+                        errno,
+                        std::system_category(),
+                        "Failed to set the tablet seat listener (zwp_tablet_seat_v2_add_listener returned " + std::to_string(err) + ")"
+                    };
+            }
+
+            MY_LOG_INFO("The wl_seat global object with name=", name, " has been bound to version ", versionToBind, " as the seat #", seat.id, '.');
+        };
+
+        for (auto& [name, objInfo] : appCtx.availableGlobalObjects)
+        {
+            if (objInfo.interface == wl_seat_interface.name)
+                addSeat(name, objInfo);
+        }
+
+        registryListener.addOnGlobalEventAppListener([&appCtx, &addSeat](uint32_t name, std::string_view interface, uint32_t version, const WLAppCtx&) {
+            if (interface != wl_seat_interface.name)
+                return;
+
+            MY_LOG_INFO("A new wl_seat object has dynamically become available ; name=", name, ", version=", version, '.');
+            addSeat(name, appCtx.availableGlobalObjects.at(name));
+        });
+        registryListener.addOnGlobalRemoveEventAppListener([&appCtx](uint32_t name, const WLAppCtx::WLGlobalObjectInfo& info, const WLAppCtx&) {
+            if (info.interface != wl_seat_interface.name)
+                return;
+
+            auto* const seat = appCtx.findSeat([name](const WLAppCtx::Seat& seat) { return (seat.globalName == name); });
+            if (seat == nullptr)
+            {
+                MY_LOG_WARN("The removed wl_seat global object with name=", name, " hasn't been bound. Ignoring it.");
+                return;
+            }
+
+            // Releasing the slot (see ~Seat) releases the data device, the tablet seat with its tablets, tools and pads, the touchscreen, the pointer
+            //   with its gestures and cursor, the keyboard and the wl_seat itself
+            MY_LOG_INFO("The wl_seat global object with name=", name, " has been removed from the server. Releasing the seat #", seat->id, " and its devices...");
+            appCtx.releaseSeat(*seat);
+        });
+        // ============================================== END of Step 13 ==============================================
+
+        // === Step N: install listeners to all the Wayland objects (to handle errors and other important messages) ===
+
+        // 1. wl_display is listened to by libwayland itself (wl_display_add_listener always fails) ; its errors are
+        //      picked up once the event loop fails (see handleConnectionFailure)
+
+        // 2. wl_compositor doesn't have events yet
+
+        // 3. wl_shm only emits wl_shm_format events currently, they're handled by shmFormatsListener (see Step 4)
+
+        // 4. xdg_wm_base
+        struct XdgShellListener
+        {
+            WLAppCtx& appCtx;
             const xdg_wm_base_listener wlHandler = { &onPing };
 
             static void onPing(void * const self, xdg_wm_base * const xdgShell, const uint32_t serial)
             {
                 MY_LOG_TRACE("xdgShellListener::onPing(self=", self, ", xdgShell=", xdgShell, ", serial=", serial, ").");
 
+                const auto listenerScope = static_cast<XdgShellListener*>(self)->appCtx.enterListener("xdg_wm_base::ping", serial);
                 if (*static_cast<XdgShellListener*>(self)->appCtx.xdgShell != xdgShell)
                 {
                     MY_LOG_ERROR("xdgShellListener::onPing: appCtx.xdgShell != xdgShell");
@@ -1715,10 +4505,45 @@ int main(int, char*[])
 
         // 5. wl_shm_pool doesn't have events yet
 
-        // 6. wl_buffer only emits wl_buffer_release events currently, which aren't interesting at the moment
+        // 6. wl_buffer::release tells when the server is done with the buffer, so it can be drawn into again
+        struct WindowsBuffersListener
+        {
+            WLAppCtx& appCtx;
+            const wl_buffer_listener wlHandler = { &onRelease };
+
+            static void onRelease(void * const selfP, wl_buffer * const buffer)
+            {
+                MY_LOG_TRACE("windowsBuffersListener::onRelease(selfP=", selfP, ", buffer=", buffer, ").");
+
+                auto& self = *static_cast<WindowsBuffersListener*>(selfP);
+                const auto listenerScope = self.appCtx.enterListener("wl_buffer::release", buffer);
+                auto* const window = self.appCtx.findWindow([buffer](const WLAppCtx::Window& window) {
+                    return (buffer == window.surfaceWLSideBuffer1) || (buffer == window.surfaceWLSideBuffer2);
+                });
+                if (window == nullptr)
+                    return;
+
+                if (buffer == window->surfaceWLSideBuffer1)
+                    window->isBufferBusy[0] = false;
+                else
+                    window->isBufferBusy[1] = false;
+            }
+        } windowsBuffersListener{ appCtx };
+        for (auto& window : appCtx.windows)
+        {
+            for (auto* const buffer : { *window.surfaceWLSideBuffer1, *window.surfaceWLSideBuffer2 })
+            {
+                if (const auto err = MY_LOG_WLCALL(wl_buffer_add_listener(buffer, &windowsBuffersListener.wlHandler, &windowsBuffersListener)); err != 0)
+                    throw std::system_error(
+                        errno,
+                        std::system_category(),
+                        "Failed to set a window buffer listener (wl_buffer_add_listener returned " + std::to_string(err) + ")"
+                    );
+            }
+        }
 
-        // 7. wl_surface + xdg_surface + xdg_toplevel (of the main window)
-        struct MainWindowSurfaceListener
+        // 7. wl_surface + xdg_surface + xdg_toplevel (of all the windows)
+        struct WindowsSurfaceListener
         {
             WLAppCtx& appCtx;
 
@@ -1733,18 +4558,22 @@ int main(int, char*[])
 
             static void onSurfaceEnterOutput(void * const self, wl_surface * const surface, wl_output * const output)
             {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onSurfaceEnterOutput(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onSurfaceEnterOutput(self=", self, ", ",
                                                                              "surface=", surface, ", ",
                                                                              "output=", output,
                                                                              ").");
+
+                const auto listenerScope = static_cast<WindowsSurfaceListener*>(self)->appCtx.enterListener("wl_surface::enter", surface, output);
             }
 
             static void onSurfaceLeaveOutput(void * const self, wl_surface * const surface, wl_output * const output)
             {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onSurfaceLeaveOutput(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onSurfaceLeaveOutput(self=", self, ", ",
                                                                              "surface=", surface, ", ",
                                                                              "output=", output,
                                                                              ").");
+
+                const auto listenerScope = static_cast<WindowsSurfaceListener*>(self)->appCtx.enterListener("wl_surface::leave", surface, output);
             }
 
             /* These are only supported since version 6 of the protocol
@@ -1757,11 +4586,13 @@ int main(int, char*[])
 
             static void onXdgSurfaceConfigure(void * const self, xdg_surface * const xdgSurface, const uint32_t serial)
             {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onXdgSurfaceConfigure(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onXdgSurfaceConfigure(self=", self, ", ",
                                                                               "xdgSurface=", xdgSurface, ", ",
                                                                               "serial=", serial,
                                                                               ").");
 
+                const auto listenerScope = static_cast<WindowsSurfaceListener*>(self)->appCtx.enterListener("xdg_surface::configure", xdgSurface, serial);
+
                 // TODO: handle all the kinds of configure events and send 'ack_configure' requests back
             }
 
@@ -1779,20 +4610,34 @@ int main(int, char*[])
                 const int32_t height,
                 wl_array * const states
             ) {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onXdgTopLevelConfigure(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onXdgTopLevelConfigure(self=", self, ", ",
                                                                                "xdgToplevel=", xdgToplevel, ", ",
                                                                                "width=", width, ", ",
                                                                                "height=", height, ", ",
                                                                                "states=", states,
                                                                                ").");
+
+                const auto listenerScope = static_cast<WindowsSurfaceListener*>(self)->appCtx.enterListener("xdg_toplevel::configure", width, height);
             }
 
             static void onXdgTopLevelClose(void * const self, xdg_toplevel * const xdgToplevel)
             {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onXdgTopLevelClose(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onXdgTopLevelClose(self=", self, ", ",
                                                                            "xdgToplevel=", xdgToplevel,
                                                                            ").");
-                static_cast<MainWindowSurfaceListener*>(self)->appCtx.shouldExit = true;
+
+                auto& appCtx = static_cast<WindowsSurfaceListener*>(self)->appCtx;
+                const auto listenerScope = appCtx.enterListener("xdg_toplevel::close", xdgToplevel);
+                auto* const window = appCtx.findWindow([xdgToplevel](const WLAppCtx::Window& window) { return (xdgToplevel == window.xdgToplevel); });
+                if (window == nullptr)
+                {
+                    MY_LOG_WARN("xdg_toplevel::close: the unknown xdg_toplevel=", xdgToplevel, ", ignoring it.");
+                    return;
+                }
+
+                // The app lives as long as any of its windows does
+                if (appCtx.closeWindow(*window))
+                    appCtx.shouldExit = true;
             }
 
             static void onXdgTopLevelConfigureBounds(
@@ -1801,112 +4646,281 @@ int main(int, char*[])
                 const int32_t width,
                 const int32_t height
             ) {
-                MY_LOG_TRACE("mainWindowSurfaceListener::onXdgTopLevelConfigureBounds(self=", self, ", ",
+                MY_LOG_TRACE("windowsSurfaceListener::onXdgTopLevelConfigureBounds(self=", self, ", ",
                                                                                      "xdgToplevel=", xdgToplevel, ", ",
                                                                                      "width=", width, ", ",
                                                                                      "height=", height,
                                                                                      ").");
+
+                const auto listenerScope = static_cast<WindowsSurfaceListener*>(self)->appCtx.enterListener("xdg_toplevel::configure_bounds", width, height);
             }
-        } mainWindowSurfaceListener{ appCtx };
-        if (const auto err = MY_LOG_WLCALL(wl_surface_add_listener(*appCtx.mainWindow.surface, &mainWindowSurfaceListener.wlHandlerSurface, &mainWindowSurfaceListener)); err != 0)
-            throw std::system_error(
-                errno,
-                std::system_category(),
-                "Failed to set the main window surface listener (wl_surface_add_listener returned " + std::to_string(err) + ")"
-            );
-        if (const auto err = MY_LOG_WLCALL(xdg_surface_add_listener(*appCtx.mainWindow.xdgSurface, &mainWindowSurfaceListener.wlHandlerXdgSurface, &mainWindowSurfaceListener)); err != 0)
-            throw std::system_error(
-                errno,
-                std::system_category(),
-                "Failed to set the main window XDG surface listener (xdg_surface_add_listener returned " + std::to_string(err) + ")"
-            );
-        if (const auto err = MY_LOG_WLCALL(xdg_toplevel_add_listener(*appCtx.mainWindow.xdgToplevel, &mainWindowSurfaceListener.wlHandlerXdgToplevel, &mainWindowSurfaceListener)); err != 0)
-            throw std::system_error(
-                errno,
-                std::system_category(),
-                "Failed to set the main window XDG surface listener (xdg_toplevel_add_listener returned " + std::to_string(err) + ")"
-            );
+        } windowsSurfaceListener{ appCtx };
+        for (auto& window : appCtx.windows)
+        {
+            if (const auto err = MY_LOG_WLCALL(wl_surface_add_listener(*window.surface, &windowsSurfaceListener.wlHandlerSurface, &windowsSurfaceListener)); err != 0)
+                throw std::system_error(
+                    errno,
+                    std::system_category(),
+                    "Failed to set a window surface listener (wl_surface_add_listener returned " + std::to_string(err) + ")"
+                );
+            if (const auto err = MY_LOG_WLCALL(xdg_surface_add_listener(*window.xdgSurface, &windowsSurfaceListener.wlHandlerXdgSurface, &windowsSurfaceListener)); err != 0)
+                throw std::system_error(
+                    errno,
+                    std::system_category(),
+                    "Failed to set a window XDG surface listener (xdg_surface_add_listener returned " + std::to_string(err) + ")"
+                );
+            if (const auto err = MY_LOG_WLCALL(xdg_toplevel_add_listener(*window.xdgToplevel, &windowsSurfaceListener.wlHandlerXdgToplevel, &windowsSurfaceListener)); err != 0)
+                throw std::system_error(
+                    errno,
+                    std::system_category(),
+                    "Failed to set a window XDG surface listener (xdg_toplevel_add_listener returned " + std::to_string(err) + ")"
+                );
+        }
 
         // The listener of wl_surface::frame callback
-        struct MainWindowRedrawHintListener
+        struct WindowsRedrawHintListener
         {
             WLAppCtx& appCtx;
             const wl_callback_listener wlHandler = { &onSurfaceFrame };
-            wl_callback* pendingCallback = nullptr;
 
-            static void onSurfaceFrame(void * const selfP, wl_callback * const callback, uint32_t /*timestampMs*/)
+            static void onSurfaceFrame(void * const selfP, wl_callback * const callback, uint32_t timestampMs)
             {
-                auto& self = *static_cast<MainWindowRedrawHintListener*>(selfP);
+                auto& self = *static_cast<WindowsRedrawHintListener*>(selfP);
+                const auto listenerScope = self.appCtx.enterListener("wl_surface::frame", callback, timestampMs);
 
-                if (callback == self.pendingCallback)
+                auto* const window = self.appCtx.findWindow([callback](const WLAppCtx::Window& window) { return (callback == window.pendingFrameCallback); });
+                if (window != nullptr)
                 {
                     // callback will be destroyed by the compositor
-                    self.appCtx.mainWindow.readyToBeRedrawn = true;
-                    self.pendingCallback = nullptr;
+                    window->readyToBeRedrawn = true;
+                    window->pendingFrameCallback = nullptr;
+
+                    if (window->pendingFrameInputAt.has_value())
+                    {
+                        self.appCtx.latency.inputToFrameDone.record(
+                            std::chrono::duration<double, std::milli>(EventLoop::Clock::now() - *window->pendingFrameInputAt).count()
+                        );
+                        window->pendingFrameInputAt.reset();
+                    }
                 }
             }
-        } mainWindowRedrawHintListener{ appCtx };
+        } windowsRedrawHintListener{ appCtx };
 
         // ============================================== END of Step N ===============================================
 
         // ========================================= Step N+1: the event loop =========================================
-        appCtx.mainWindow.pendingBufferIdx = 0;
+        if (const int fd = memoryBudget.getRssTimerFd(); fd != -1)
+            eventLoop.addFdWatch(fd, POLLIN, [&memoryBudget](short) { memoryBudget.onRssTimer(); });
+        if (const int fd = memoryBudget.getPressureFd(); fd != -1)
+            eventLoop.addFdWatch(fd, POLLPRI, [&memoryBudget](short) { memoryBudget.onPressure(); });
 
-        ContentState lastRenderedState = contentState;
+        const auto virtualFrameInterval = std::chrono::milliseconds{ std::max<unsigned long long>(virtualFrameMs.value_or(1), 1) };
+        if (AppClock::isVirtual())
+            MY_LOG_INFO("The time is virtual, ", virtualFrameInterval.count(), " ms per frame.");
 
         while (!appCtx.shouldExit)
         {
-            const bool contentHasChanged = (contentState != lastRenderedState);
-            if ( (appCtx.mainWindow.mustBeRedrawn || contentHasChanged) && appCtx.mainWindow.readyToBeRedrawn)
+            bool hasCommittedFrame = false;
+            // A window has been skipped because the server hasn't released its buffer yet
+            bool isWaitingForBuffer = false;
+
+            // The samples of the tablet tools of all the seats received since the previous iteration ; the ink is
+            //   shown by all the windows, which recompose only the parts showing the changed tiles
+            for (auto& seat : appCtx.seats)
+            {
+                if (seat.isBound())
+                    (void)seat.tablet.strokes.process(appCtx.ink);
+            }
+            if (const auto inkDirtyRects = appCtx.ink.takeDirtyRects(); !inkDirtyRects.empty())
             {
-                MY_LOG_TRACE("Redrawing the main window (appCtx.mainWindow.mustBeRedrawn=", appCtx.mainWindow.mustBeRedrawn, ", contentHasChanged=", contentHasChanged, ")...");
+                for (auto& window : appCtx.windows)
+                    window.addInkDirtyRects(inkDirtyRects);
+            }
+
+            for (auto& window : appCtx.windows)
+            {
+                const bool contentHasChanged = (window.contentState != window.lastRenderedState);
+                const bool inkHasChanged = !window.inkDirtyRects.empty();
+                if ( window.isClosed || !(window.mustBeRedrawn || contentHasChanged || inkHasChanged) )
+                    continue;
+
+                // The input has arrived when the event loop has woken up last time
+                if (!window.uncommittedInputAt.has_value())
+                    window.uncommittedInputAt = eventLoop.getLastWakeUpTime();
+
+                // The latency mode doesn't wait for wl_surface::frame, it only needs a buffer free to draw into ;
+                //   neither does the virtual time, whose frames are paced by the virtual clock rather than the server
+                const bool isPacedByBuffers = (appCtx.isLatencyMode || AppClock::isVirtual());
+                const bool canBeRedrawn = isPacedByBuffers
+                    ? !window.isBufferBusy[window.pendingBufferIdx]
+                    : window.readyToBeRedrawn;
+                if (!canBeRedrawn)
+                {
+                    isWaitingForBuffer = isWaitingForBuffer || isPacedByBuffers;
+                    continue;
+                }
 
-                appCtx.mainWindow.mustBeRedrawn = false;
+                MY_LOG_TRACE("Redrawing the window #", window.id, " (mustBeRedrawn=", window.mustBeRedrawn, ", contentHasChanged=", contentHasChanged, ", inkHasChanged=", inkHasChanged, ")...");
 
-                // Installing a new wl_surface::frame listener
-                appCtx.mainWindow.readyToBeRedrawn = false;
-                mainWindowRedrawHintListener.pendingCallback = MY_LOG_WLCALL(wl_surface_frame(*appCtx.mainWindow.surface));
-                if (mainWindowRedrawHintListener.pendingCallback == nullptr)
-                    throw std::system_error{errno, std::system_category(), "Failed to obtain a wl_surface::frame callback for the main window"};
-                if (const auto err = MY_LOG_WLCALL(wl_callback_add_listener(mainWindowRedrawHintListener.pendingCallback, &mainWindowRedrawHintListener.wlHandler, &mainWindowRedrawHintListener)); err != 0)
-                    throw std::system_error(
-                        errno,
-                        std::system_category(),
-                        "Failed to set the main window wl_surface::frame callback listener (wl_callback_add_listener returned " + std::to_string(err) + ")"
-                    );
+                const bool mustBeRedrawn = window.mustBeRedrawn;
+                window.mustBeRedrawn = false;
+
+                // Installing a new wl_surface::frame listener ; in the latency mode the frames may be committed
+                //   faster than they're presented, so only one of them is followed at a time
+                window.readyToBeRedrawn = false;
+                const bool isFrameFollowed = (window.pendingFrameCallback == nullptr);
+                if (isFrameFollowed)
+                {
+                    window.pendingFrameCallback = MY_LOG_WLCALL(wl_surface_frame(*window.surface));
+                    if (window.pendingFrameCallback == nullptr)
+                        throw std::system_error{errno, std::system_category(), "Failed to obtain a wl_surface::frame callback for a window"};
+                    if (const auto err = MY_LOG_WLCALL(wl_callback_add_listener(window.pendingFrameCallback, &windowsRedrawHintListener.wlHandler, &windowsRedrawHintListener)); err != 0)
+                        throw std::system_error(
+                            errno,
+                            std::system_category(),
+                            "Failed to set a window wl_surface::frame callback listener (wl_callback_add_listener returned " + std::to_string(err) + ")"
+                        );
+                }
 
-                // Rendering to the pending pixel buffer
-                renderMainWindow(appCtx, contentState);
+                // Composing the pending frame and converting it into the pending buffer ; the frame changed by the ink
+                //   only is updated partially unless it's been transformed or is rotated
+                const auto composingStartedAt = EventLoop::Clock::now();
+                const bool isInkOnlyFrame = ( !mustBeRedrawn && !contentHasChanged && window.presentedFrameIsExact && (window.contentState.viewportRotation == 0) );
+                const char* composingStage = "render";
+                if (isInkOnlyFrame)
+                {
+                    composingStage = "ink";
+                    const auto stageScope = appCtx.enterStage("ink", true);
+                    renderWindowInk(appCtx, window, renderWorkers);
+                }
+                else if ( (gesturesListener.isPinchInProgress(window) || tsListener.isPinchInProgress(window)) && !mustBeRedrawn && !inkHasChanged )
+                {
+                    composingStage = "transform";
+                    if (window.presentedFrameIsExact)
+                    {
+                        window.exactFrame.resize(window.width * window.height);
+                        std::memcpy(
+                            window.exactFrame.data(),
+                            window.getPresentedPixels(),
+                            window.exactFrame.size() * sizeof(window.exactFrame[0])
+                        );
+                        window.exactFrameState = window.lastRenderedState;
+                    }
+
+                    const auto stageScope = appCtx.enterStage("transform");
+                    transformWindowFrame(window, window.exactFrame, window.exactFrameState, window.contentState);
+                    window.presentedFrameIsExact = false;
+                }
+                else
+                {
+                    const auto stageScope = appCtx.enterStage("render", true);
+                    renderWindow(appCtx, window, renderWorkers);
+                    window.presentedFrameIsExact = true;
+                }
+                if (!isInkOnlyFrame)
+                    window.frameDamage.assign(1, WLAppCtx::Window::BufferRect{ 0, 0, window.width, window.height });
+                window.inkDirtyRects.clear();
+
+                const auto composedAt = EventLoop::Clock::now();
+                {
+                    const auto stageScope = appCtx.enterStage("convert");
+                    for (const auto& rect : window.frameDamage)
+                        window.convertComposedRect(rect);
+                }
+                // The composing stages write every XRGB8888 pixel of the damage once, and so does the conversion into
+                //   the buffer if there's one
+                std::size_t pixelsCount = 0;
+                for (const auto& rect : window.frameDamage)
+                    pixelsCount += rect.width * rect.height;
+                appCtx.roofline.record(
+                    composingStage,
+                    pixelsCount * sizeof(std::uint32_t),
+                    composedAt - composingStartedAt
+                );
+                if (!window.composedFrame.empty())
+                    appCtx.roofline.record("convert", pixelsCount * window.bytesPerPixel, EventLoop::Clock::now() - composedAt);
+                FlightRecorder::record(
+                    FlightRecorder::Kind::RENDER,
+                    composingStage,
+                    window.id,
+                    static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(EventLoop::Clock::now() - composingStartedAt).count())
+                );
                 // Attaching the pending pixel buffer to the surface
-                MY_LOG_WLCALL_VALUELESS(wl_surface_attach(*appCtx.mainWindow.surface, appCtx.mainWindow.getPendingWLSideBuffer(), 0, 0));
-                // Letting the server know that it should re-render the whole buffer
-                MY_LOG_WLCALL_VALUELESS(wl_surface_damage_buffer(*appCtx.mainWindow.surface, 0, 0, appCtx.mainWindow.width, appCtx.mainWindow.height));
-                // Commiting the current state of the main window (including the buffer content) so the server can now apply it
-                MY_LOG_WLCALL_VALUELESS(wl_surface_commit(*appCtx.mainWindow.surface));
+                MY_LOG_WLCALL_VALUELESS(wl_surface_attach(*window.surface, window.getPendingWLSideBuffer(), 0, 0));
+                // Letting the server know which parts of the buffer it should re-render
+                for (const auto& rect : window.frameDamage)
+                {
+                    MY_LOG_WLCALL_VALUELESS(wl_surface_damage_buffer(
+                        *window.surface,
+                        static_cast<std::int32_t>(rect.x), static_cast<std::int32_t>(rect.y),
+                        static_cast<std::int32_t>(rect.width), static_cast<std::int32_t>(rect.height)
+                    ));
+                }
+                // Commiting the current state of the window (including the buffer content) so the server can now apply it
+                MY_LOG_WLCALL_VALUELESS(wl_surface_commit(*window.surface));
+
+                window.isBufferBusy[window.pendingBufferIdx] = true;
+                window.pendingBufferIdx = (window.pendingBufferIdx + 1) % 2;
+                window.isPendingBufferReleased = false;
+                std::swap(window.lastFrameDamage, window.frameDamage);
+                hasCommittedFrame = true;
+
+                window.lastRenderedState = window.contentState;
+
+                if (window.uncommittedInputAt.has_value())
+                {
+                    appCtx.latency.inputToCommit.record(
+                        std::chrono::duration<double, std::milli>(EventLoop::Clock::now() - *window.uncommittedInputAt).count()
+                    );
+                    if (isFrameFollowed)
+                        window.pendingFrameInputAt = window.uncommittedInputAt;
+                    window.uncommittedInputAt.reset();
+                }
+            }
 
-                appCtx.mainWindow.pendingBufferIdx = (appCtx.mainWindow.pendingBufferIdx + 1) % 2;
+            // The counters of the iterations which haven't presented anything are added to the next frame
+            if (hasCommittedFrame)
+            {
+                appCtx.perf.onFrameEnd();
+                appCtx.energy.onFrameEnd();
+                appCtx.scheduling.onFrameEnd();
+                appCtx.roofline.onFrameEnd();
+            }
 
-                lastRenderedState = contentState;
+            // The virtual time moves by a frame once there's been anything to do at the current one. A window waiting
+            //   for its buffer repeats the frame at the same time instead, so the frames get the same times whenever
+            //   the server releases the buffers
+            int dispatchTimeoutMs = -1;
+            if ( AppClock::isVirtual() && !isWaitingForBuffer && (hasCommittedFrame || coroRuntime.getNextVirtualDeadline().has_value()) )
+            {
+                AppClock::advance(virtualFrameInterval);
+                coroRuntime.resumeDueVirtualTimers();
+                // The next frame is due right away
+                dispatchTimeoutMs = 0;
             }
 
-            appCtx.shouldExit = appCtx.shouldExit ||
-                (MY_LOG_WLCALL(wl_display_dispatch(*appCtx.connection)) == -1);
+            const auto stageScope = appCtx.enterStage("dispatch");
+            if (!eventLoop.runOnce(dispatchTimeoutMs))
+                return handleConnectionFailure(*appCtx.connection);
         }
         // ============================================= END of Step N+1 ==============================================
     }
     catch (const std::system_error& err)
     {
         MY_LOG_ERROR("Caught an std::system_error: \"", err.what(), "\" (code=", err.code(), "). Shutting down...");
+        dumpFlightRecorder("std::system_error caught in main");
         return 1;
     }
     catch (const std::exception& err)
     {
         MY_LOG_ERROR("Caught an std::exception: \"", err.what(), "\". Shutting down...");
+        dumpFlightRecorder("std::exception caught in main");
         return 2;
     }
     catch (...)
     {
         MY_LOG_ERROR("Caught an unknown exception. Shutting down...");
+        dumpFlightRecorder("unknown exception caught in main");
         return 3;
     }
 
@@ -1914,97 +4928,435 @@ int main(int, char*[])
 }
 
 
-ContentState ContentState::movedFor(double offsetX, double offsetY) const
+ViewportMapping computeViewportMapping(const ContentState& contentState)
 {
-    return ContentState{
-        viewportOffsetX + offsetX,
-        viewportOffsetY + offsetY,
-        viewportZoom,
-        viewportZoomCenterLocalX,
-        viewportZoomCenterLocalY
+    const int viewportOffsetXRound = static_cast<int>(std::round(contentState.viewportOffsetX));
+    const double xOffsetDiff = viewportOffsetXRound - contentState.viewportOffsetX;
+
+    const int viewportOffsetYRound = static_cast<int>(std::round(contentState.viewportOffsetY));
+    const double yOffsetDiff = viewportOffsetYRound - contentState.viewportOffsetY;
+
+    const auto sideZoom = std::sqrt(contentState.viewportZoom);
+
+    // Adjusting the zoom center with respect to the viewport position change ; it may be outside of the window
+    //   once the viewport is rotated
+    const auto zoomCenterLocalX = static_cast<std::int64_t>(std::round(contentState.viewportZoomCenterLocalX + xOffsetDiff));
+    const auto zoomCenterLocalY = static_cast<std::int64_t>(std::round(contentState.viewportZoomCenterLocalY + yOffsetDiff));
+
+    // The zoom center stays in place: it shows the content point (viewportOffsetXRound + zoomCenterLocalX; ...)
+    return ViewportMapping{
+        static_cast<std::int64_t>(std::round((viewportOffsetXRound + zoomCenterLocalX) * sideZoom)) - zoomCenterLocalX,
+        static_cast<std::int64_t>(std::round((viewportOffsetYRound + zoomCenterLocalY) * sideZoom)) - zoomCenterLocalY,
+        sideZoom
     };
 }
 
-bool operator==(const ContentState& lhs, const ContentState& rhs) noexcept
+
+/**
+ * Composes the rect [regionX; regionX + regionWidth) x [regionY; regionY + regionHeight) of the zoomed content from
+ *   the tiles via writeTileRect(tile, srcX, srcY, dstX, dstY, rectWidth, rectHeight), which must decode the rect of
+ *   the tile into the one of the region ; the tiles missing from the caches are rendered by the workers first
+ */
+template<typename WriteTileRect>
+static void composeZoomedRect(
+    WLAppCtx& appCtx,
+    RenderWorkerPool& renderWorkers,
+    const double viewportZoom,
+    const double sideZoom,
+    const std::int64_t regionX,
+    const std::int64_t regionY,
+    const std::int64_t regionWidth,
+    const std::int64_t regionHeight,
+    WriteTileRect&& writeTileRect
+) {
+    // The content is composed of the tiles of the zoomed content space, which are taken from the tiles caches or
+    //   rendered on a miss
+
+    constexpr auto tileSide = static_cast<std::int64_t>(PersistentTileStore::TILE_SIDE);
+
+    const auto tileXBegin = floorDiv(regionX, tileSide);
+    const auto tileXEnd   = floorDiv(regionX + regionWidth - 1, tileSide) + 1;
+    const auto tileYBegin = floorDiv(regionY, tileSide);
+    const auto tileYEnd   = floorDiv(regionY + regionHeight - 1, tileSide) + 1;
+
+    auto& tileCache = appCtx.tileCache;
+    TileKey tileKey{ MAIN_WINDOW_CONTENT_ID, TileKey::makeZoomBits(viewportZoom), 0, 0 };
+
+    // Rendering is the only expensive part and renderContentTile is pure, so the missing tiles are rendered in
+    //   parallel up front ; the caches aren't thread-safe and are only touched by this thread
+    tileCache.missingTiles.clear();
+    for (auto tileY = tileYBegin; tileY < tileYEnd; ++tileY)
+    {
+        for (auto tileX = tileXBegin; tileX < tileXEnd; ++tileX)
+        {
+            tileKey.tileX = static_cast<std::int32_t>(tileX);
+            tileKey.tileY = static_cast<std::int32_t>(tileY);
+
+            if ( !tileCache.memoryCache.contains(tileKey) && !tileCache.persistentStore.contains(tileKey) )
+                tileCache.missingTiles.push_back(tileKey);
+        }
+    }
+    tileCache.renderedTiles.resize(tileCache.missingTiles.size() * PersistentTileStore::TILE_PIXELS);
+    renderWorkers.parallelFor(tileCache.missingTiles.size(), [&tileCache, sideZoom](const std::size_t i) {
+        renderContentTile(tileCache.missingTiles[i], sideZoom, tileCache.renderedTiles.data() + i * PersistentTileStore::TILE_PIXELS);
+    });
+    // The missing tiles are met in the same order below
+    std::size_t nextMissingTileIdx = 0;
+
+    for (auto tileY = tileYBegin; tileY < tileYEnd; ++tileY)
+    {
+        // The tile's top-left corner in the region coordinates
+        const auto tileLocalY = tileY * tileSide - regionY;
+        const auto srcY = std::max<std::int64_t>(0, -tileLocalY);
+        const auto dstY = std::max<std::int64_t>(0, tileLocalY);
+        const auto rectHeight = std::min(tileSide - srcY, regionHeight - dstY);
+
+        for (auto tileX = tileXBegin; tileX < tileXEnd; ++tileX)
+        {
+            const auto tileLocalX = tileX * tileSide - regionX;
+            const auto srcX = std::max<std::int64_t>(0, -tileLocalX);
+            const auto dstX = std::max<std::int64_t>(0, tileLocalX);
+            const auto rectWidth = std::min(tileSide - srcX, regionWidth - dstX);
+
+            tileKey.tileX = static_cast<std::int32_t>(tileX);
+            tileKey.tileY = static_cast<std::int32_t>(tileY);
+
+            const bool isPreRendered = ( (nextMissingTileIdx < tileCache.missingTiles.size()) && (tileCache.missingTiles[nextMissingTileIdx] == tileKey) );
+
+            const CompressedTile* compressedTile = isPreRendered ? nullptr : tileCache.memoryCache.find(tileKey);
+            if (compressedTile == nullptr)
+            {
+                const std::uint32_t* tilePixels = isPreRendered ? nullptr : tileCache.persistentStore.find(tileKey);
+                if (tilePixels == nullptr)
+                {
+                    if (isPreRendered)
+                    {
+                        tilePixels = tileCache.renderedTiles.data() + (nextMissingTileIdx++) * PersistentTileStore::TILE_PIXELS;
+                    }
+                    else
+                    {
+                        // The tile has been evicted by the insertions of this very frame
+                        renderContentTile(tileKey, sideZoom, tileCache.scratchTile.data());
+                        tilePixels = tileCache.scratchTile.data();
+                    }
+                    tileCache.persistentStore.store(tileKey, tilePixels);
+                }
+                compressedTile = &tileCache.memoryCache.insert(tileKey, tilePixels);
+            }
+
+            writeTileRect(
+                *compressedTile,
+                static_cast<std::size_t>(srcX), static_cast<std::size_t>(srcY),
+                static_cast<std::size_t>(dstX), static_cast<std::size_t>(dstY),
+                static_cast<std::size_t>(rectWidth), static_cast<std::size_t>(rectHeight)
+            );
+        }
+    }
+}
+
+
+void renderWindow(WLAppCtx& appCtx, WLAppCtx::Window& window, RenderWorkerPool& renderWorkers)
 {
-    return ( (lhs.viewportOffsetX == rhs.viewportOffsetX) &&
-             (lhs.viewportOffsetY == rhs.viewportOffsetY) &&
-             (lhs.viewportZoom == rhs.viewportZoom) &&
-             (lhs.viewportZoomCenterLocalX == rhs.viewportZoomCenterLocalX) &&
-             (lhs.viewportZoomCenterLocalY == rhs.viewportZoomCenterLocalY) );
+    const auto& contentState = window.contentState;
+
+    //if (contentState.contentZoom <= 0)
+    //    throw std::range_error{ "contentState.contentZoom <= 0" };
+
+    const auto [originX, originY, sideZoom] = computeViewportMapping(contentState);
+
+    const auto viewportWidth  = static_cast<std::int64_t>(window.width);
+    const auto viewportHeight = static_cast<std::int64_t>(window.height);
+
+    if (contentState.viewportRotation == 0)
+    {
+        // The tiles are decoded right into the composed frame
+        composeZoomedRect(
+            appCtx, renderWorkers, contentState.viewportZoom, sideZoom,
+            originX, originY, viewportWidth, viewportHeight,
+            [&window](const CompressedTile& tile, const std::size_t srcX, const std::size_t srcY, const std::size_t dstX, const std::size_t dstY, const std::size_t rectWidth, const std::size_t rectHeight) {
+                tile.decodeRect(
+                    srcX, srcY,
+                    rectWidth, rectHeight,
+                    window.getComposedPixelAddress(dstX, dstY),
+                    window.getComposedStrideBytes()
+                );
+            }
+        );
+
+        // The strokes are over the content
+        appCtx.ink.composeOnto(
+            window.getComposedPixelAddress(0, 0), window.getComposedStrideBytes(),
+            originX, originY, sideZoom,
+            0, 0, viewportWidth, viewportHeight
+        );
+        return;
+    }
+
+    // The rotated viewport shows the region of the unrotated one bounding it, which is composed into the blocked
+    //   store the same way and then sampled along the rotated rows: the blocks keep the neighbours of a pixel within
+    //   a few cache lines whatever the angle is, so the rotation costs about one more pass over the pixels
+    double regionLeft = std::numeric_limits<double>::infinity();
+    double regionTop = std::numeric_limits<double>::infinity();
+    double regionRight = -std::numeric_limits<double>::infinity();
+    double regionBottom = -std::numeric_limits<double>::infinity();
+    const auto width = static_cast<double>(window.width);
+    const auto height = static_cast<double>(window.height);
+    const std::pair<double, double> corners[] = { { 0, 0 }, { width, 0 }, { 0, height }, { width, height } };
+    for (const auto& [cornerX, cornerY] : corners)
+    {
+        const auto [x, y] = contentState.toUnrotatedLocal(cornerX, cornerY);
+        regionLeft = std::min(regionLeft, x);
+        regionTop = std::min(regionTop, y);
+        regionRight = std::max(regionRight, x);
+        regionBottom = std::max(regionBottom, y);
+    }
+    const auto regionX = static_cast<std::int64_t>(std::floor(regionLeft));
+    const auto regionY = static_cast<std::int64_t>(std::floor(regionTop));
+    const auto regionWidth = static_cast<std::int64_t>(std::ceil(regionRight)) - regionX;
+    const auto regionHeight = static_cast<std::int64_t>(std::ceil(regionBottom)) - regionY;
+
+    auto& region = appCtx.tileCache.rotatedRegion;
+    region.resize(static_cast<std::size_t>(regionWidth), static_cast<std::size_t>(regionHeight));
+
+    composeZoomedRect(
+        appCtx, renderWorkers, contentState.viewportZoom, sideZoom,
+        originX + regionX, originY + regionY, regionWidth, regionHeight,
+        [&region](const CompressedTile& tile, const std::size_t srcX, const std::size_t srcY, const std::size_t dstX, const std::size_t dstY, const std::size_t rectWidth, const std::size_t rectHeight) {
+            region.writeRect(dstX, dstY, rectWidth, rectHeight, [&](const std::size_t rowsBegin, const std::size_t rowsCount, std::byte* const rows, const std::size_t strideBytes) {
+                tile.decodeRect(srcX, srcY + rowsBegin, rectWidth, rowsCount, rows, strideBytes);
+            });
+        }
+    );
+
+    if (!appCtx.ink.isEmpty())
+    {
+        region.updateRows([&appCtx, originX = originX + regionX, originY = originY + regionY, sideZoom = sideZoom, regionWidth](const std::size_t rowsBegin, const std::size_t rowsCount, std::byte* const rows, const std::size_t strideBytes) {
+            appCtx.ink.composeOnto(
+                rows, strideBytes,
+                originX, originY + static_cast<std::int64_t>(rowsBegin), sideZoom,
+                0, 0, regionWidth, static_cast<std::int64_t>(rowsCount)
+            );
+        });
+    }
+
+    // The center of the viewport pixel (x; y) shows the region pixel floor(toUnrotatedLocal(x + 0.5; y + 0.5) - region)
+    const auto [firstCenterX, firstCenterY] = contentState.toUnrotatedLocal(0.5, 0.5);
+    const double cosine = std::cos(contentState.viewportRotation);
+    const double sine = std::sin(contentState.viewportRotation);
+    const AffineSampling sampling{
+        firstCenterX - static_cast<double>(regionX),
+        firstCenterY - static_cast<double>(regionY),
+        cosine, -sine,
+        sine, cosine
+    };
+
+    // The rows are written linearly into the composed frame, split between the workers
+    constexpr std::size_t stripHeight = 32;
+    const std::size_t stripsCount = (window.height + stripHeight - 1) / stripHeight;
+    std::byte* const dst = window.getComposedPixelAddress(0, 0);
+    const std::size_t dstStrideBytes = window.getComposedStrideBytes();
+    // The pixels not covered by the region are only possible due to the rounding
+    constexpr std::uint32_t uncoveredPixel = 0xFF808080;
+
+    renderWorkers.parallelFor(stripsCount, [&region, &sampling, &window, dst, dstStrideBytes](const std::size_t i) {
+        resampleAffineNearest(
+            region, sampling,
+            dst, dstStrideBytes, window.width,
+            i * stripHeight, std::min((i + 1) * stripHeight, window.height),
+            uncoveredPixel
+        );
+    });
 }
 
-bool operator!=(const ContentState& lhs, const ContentState& rhs) noexcept
+
+void renderWindowInk(WLAppCtx& appCtx, WLAppCtx::Window& window, RenderWorkerPool& renderWorkers)
 {
-    return !(lhs == rhs);
+    const auto& contentState = window.contentState;
+    const auto [originX, originY, sideZoom] = computeViewportMapping(contentState);
+
+    const auto viewportWidth  = static_cast<std::int64_t>(window.width);
+    const auto viewportHeight = static_cast<std::int64_t>(window.height);
+
+    // The rest of the frame is the presented one
+    window.catchUpPendingBuffer();
+
+    window.frameDamage.clear();
+    for (const auto& contentRect : window.inkDirtyRects)
+    {
+        const auto rect = InkLayer::toViewport(contentRect, originX, originY, sideZoom);
+        const auto x0 = std::max<std::int64_t>(rect.x, 0);
+        const auto y0 = std::max<std::int64_t>(rect.y, 0);
+        const auto x1 = std::min(rect.x + rect.width, viewportWidth);
+        const auto y1 = std::min(rect.y + rect.height, viewportHeight);
+        if ( (x0 >= x1) || (y0 >= y1) )
+            continue;
+
+        composeZoomedRect(
+            appCtx, renderWorkers, contentState.viewportZoom, sideZoom,
+            originX + x0, originY + y0, x1 - x0, y1 - y0,
+            [&window, x0, y0](const CompressedTile& tile, const std::size_t srcX, const std::size_t srcY, const std::size_t dstX, const std::size_t dstY, const std::size_t rectWidth, const std::size_t rectHeight) {
+                tile.decodeRect(
+                    srcX, srcY,
+                    rectWidth, rectHeight,
+                    window.getComposedPixelAddress(static_cast<std::size_t>(x0) + dstX, static_cast<std::size_t>(y0) + dstY),
+                    window.getComposedStrideBytes()
+                );
+            }
+        );
+        appCtx.ink.composeOnto(
+            window.getComposedPixelAddress(0, 0), window.getComposedStrideBytes(),
+            originX, originY, sideZoom,
+            x0, y0, x1 - x0, y1 - y0
+        );
+
+        window.frameDamage.push_back(WLAppCtx::Window::BufferRect{
+            static_cast<std::size_t>(x0), static_cast<std::size_t>(y0),
+            static_cast<std::size_t>(x1 - x0), static_cast<std::size_t>(y1 - y0)
+        });
+    }
 }
 
 
-void renderMainWindow(WLAppCtx& appCtx, ContentState contentState)
+DataTransfers::OutgoingPayload snapshotWindowAsBmp(const WLAppCtx::Window& window)
 {
-    //if (contentState.contentZoom <= 0)
-    //    throw std::range_error{ "contentState.contentZoom <= 0" };
 
-    // Rendering the chess board pattern respecting the content's offsets and zoom
+    constexpr std::size_t fileHeaderSize = 14;
+    constexpr std::size_t infoHeaderSize = 40;
+    constexpr std::size_t headersSize = fileHeaderSize + infoHeaderSize;
 
-    constexpr auto cellSideBasicSize = 60 /*px*/;
+    // The presented pixels are XRGB8888 whatever the format of the buffers is
+    const auto strideBytes = window.width * sizeof(std::uint32_t);
+    const auto pixelsSize = strideBytes * window.height;
 
+    auto bmp = SharedMemoryBuffer::allocate(headersSize + pixelsSize);
 
-    const int viewportOffsetXRound = static_cast<int>(std::round(contentState.viewportOffsetX));
-    const double xOffsetDiff = viewportOffsetXRound - contentState.viewportOffsetX;
+    const auto putLE = [&bmp](const std::size_t offset, const std::uint32_t value, const std::size_t sizeBytes) {
+        for (std::size_t i = 0; i < sizeBytes; ++i)
+            bmp[offset + i] = static_cast<std::byte>((value >> (i * 8)) & 0xFF);
+    };
 
-    const int viewportOffsetYRound = static_cast<int>(std::round(contentState.viewportOffsetY));
-    const double yOffsetDiff = viewportOffsetYRound - contentState.viewportOffsetY;
+    // BITMAPFILEHEADER
+    putLE(0, 'B' | ('M' << 8), 2);
+    putLE(2, static_cast<std::uint32_t>(bmp.getSize()), 4);
+    putLE(6, 0, 4);
+    putLE(10, headersSize, 4);
+    // BITMAPINFOHEADER ; the negative height means the rows go top-down, like in the surface buffers
+    putLE(14, infoHeaderSize, 4);
+    putLE(18, static_cast<std::uint32_t>(window.width), 4);
+    putLE(22, static_cast<std::uint32_t>(-static_cast<std::int32_t>(window.height)), 4);
+    putLE(26, 1, 2);                                            // planes
+    putLE(28, 32, 2);                                           // bits per pixel: B, G, R, X - the same as XRGB8888
+    putLE(30, 0, 4);                                            // BI_RGB
+    putLE(34, static_cast<std::uint32_t>(pixelsSize), 4);
+    putLE(38, 2835, 4);                                         // 72 DPI
+    putLE(42, 2835, 4);
+    putLE(46, 0, 4);
+    putLE(50, 0, 4);
+
+    std::memcpy(bmp.getData() + headersSize, window.getPresentedPixels(), pixelsSize);
+
+    return std::make_shared<const SharedMemoryBuffer>(std::move(bmp));
+}
 
-    const auto sideZoom = std::sqrt(contentState.viewportZoom);
 
-    // Adjusting the zoom center with respect to the viewport position change
-    const unsigned zoomCenterLocalX = static_cast<unsigned>(
-        std::clamp<double>(
-            std::round(contentState.viewportZoomCenterLocalX + xOffsetDiff),
-            0,
-            appCtx.mainWindow.width - 1
-        )
-    );
-    const unsigned zoomCenterLocalY = static_cast<unsigned>(
-        std::clamp<double>(
-            std::round(contentState.viewportZoomCenterLocalY + yOffsetDiff),
-            0,
-            appCtx.mainWindow.height - 1
-        )
+void transformWindowFrame(
+    WLAppCtx::Window& window,
+    const std::vector<std::uint32_t>& frame,
+    const ContentState& frameState,
+    const ContentState& targetState
+) {
+    const auto source = computeViewportMapping(frameState);
+    const auto target = computeViewportMapping(targetState);
+
+    // The areas not covered by the frame are left neutral until the exact rendering
+    constexpr std::uint32_t uncoveredPixel = 0xFF808080;
+
+    if (frameState.viewportRotation != targetState.viewportRotation)
+    {
+        // The center of the target pixel p shows the content point
+        //   (target.originX + targetState.toUnrotatedLocal(p)) / target.sideZoom, which is at the point
+        //   frameState.toRotatedLocal(that * source.sideZoom - source.originX) of the frame ; the mapping is affine
+        const auto toFramePoint = [&](const double x, const double y) {
+            const auto [targetX, targetY] = targetState.toUnrotatedLocal(x, y);
+            const double ratio = source.sideZoom / target.sideZoom;
+            return frameState.toRotatedLocal(
+                (static_cast<double>(target.originX) + targetX) * ratio - static_cast<double>(source.originX),
+                (static_cast<double>(target.originY) + targetY) * ratio - static_cast<double>(source.originY)
+            );
+        };
+        const auto [u0, v0] = toFramePoint(0.5, 0.5);
+        const auto [u1, v1] = toFramePoint(1.5, 0.5);
+        const auto [u2, v2] = toFramePoint(0.5, 1.5);
+
+        resampleAffineNearest(
+            LinearImageView{ frame.data(), window.width, window.width, window.height },
+            AffineSampling{ u0, v0, u1 - u0, v1 - v0, u2 - u0, v2 - v0 },
+            window.getComposedPixelAddress(0, 0), window.getComposedStrideBytes(), window.width,
+            0, window.height,
+            uncoveredPixel
+        );
+        return;
+    }
+
+    // The viewport pixel x of the target shows the content point (target.originX + x) / target.sideZoom,
+    //   which is the pixel (target.originX + x) * source.sideZoom / target.sideZoom - source.originX of the frame
+    const double ratio = source.sideZoom / target.sideZoom;
+    const auto toSourceIndices = [ratio](const std::int64_t targetOrigin, const std::int64_t sourceOrigin, const std::size_t count, std::vector<std::int32_t>& result) {
+        result.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto sourceIdx = static_cast<std::int64_t>(std::floor(static_cast<double>(targetOrigin + static_cast<std::int64_t>(i)) * ratio + 0.5)) - sourceOrigin;
+            result[i] = ( (sourceIdx < 0) || (sourceIdx >= static_cast<std::int64_t>(count)) ) ? -1 : static_cast<std::int32_t>(sourceIdx);
+        }
+    };
+
+    std::vector<std::int32_t> sourceColumns;
+    std::vector<std::int32_t> sourceRows;
+    toSourceIndices(target.originX, source.originX, window.width, sourceColumns);
+    toSourceIndices(target.originY, source.originY, window.height, sourceRows);
+
+    resampleNearest(
+        frame.data(), window.width,
+        sourceColumns.data(), window.width,
+        sourceRows.data(), window.height,
+        window.getComposedPixelAddress(0, 0), window.getComposedStrideBytes(),
+        uncoveredPixel
     );
+}
 
-    appCtx.mainWindow.drawVia([viewportOffsetXRound, viewportOffsetYRound, zoom = sideZoom, zoomCenterLocalX, zoomCenterLocalY](std::size_t x, std::size_t y, std::byte& b, std::byte& g, std::byte& r) {
-        const auto xRelZoomCenter = (x > zoomCenterLocalX)
-                                    ? static_cast<int>(x - zoomCenterLocalX)
-                                    : -static_cast<int>(zoomCenterLocalX - x);
-        const auto srcXRelZoomCenter = static_cast< std::remove_cv_t<decltype(xRelZoomCenter)> >(std::round(xRelZoomCenter / zoom));
-        const auto srcXGlobal = static_cast<std::int64_t>(viewportOffsetXRound) +
-                                static_cast<std::int64_t>(zoomCenterLocalX) +
-                                static_cast<std::int64_t>(srcXRelZoomCenter);
-
-        const auto yRelZoomCenter = (y > zoomCenterLocalY)
-                                    ? static_cast<int>(y - zoomCenterLocalY)
-                                    : -static_cast<int>(zoomCenterLocalY - y);
-        const auto srcYRelZoomCenter = static_cast< std::remove_cv_t<decltype(yRelZoomCenter)> >(std::round(yRelZoomCenter / zoom));
-        const auto srcYGlobal = static_cast<std::int64_t>(viewportOffsetYRound) +
-                                static_cast<std::int64_t>(zoomCenterLocalY) +
-                                static_cast<std::int64_t>(srcYRelZoomCenter);
-
-        const auto srcCellColumn = (srcXGlobal > 0)
-                                   ? (srcXGlobal / cellSideBasicSize)
-                                   : -(1 + (-srcXGlobal / cellSideBasicSize));
-        const auto srcRowColumn = (srcYGlobal > 0)
-                                   ? (srcYGlobal / cellSideBasicSize)
-                                   : -(1 + (-srcYGlobal / cellSideBasicSize));
-
-        const bool columnIsEven = ( (srcCellColumn % 2) == 0 );
-        const bool rowIsEven    = ( (srcRowColumn % 2) == 0 );
-
-        if (columnIsEven == rowIsEven)
-            r = g = b = std::byte{0x00}; // pure black
-        else
-            r = g = b = std::byte{0xC0}; // silver
-    });
+
+int handleConnectionFailure(wl_display* const connection) noexcept
+{
+    const int err = wl_display_get_error(connection);
+    if (err != EPROTO)
+    {
+        const std::error_code sysErr{err, std::system_category()};
+        MY_LOG_ERROR("The Wayland connection has been broken (errno=", sysErr, " \"", sysErr.message(), "\"). Shutting down...");
+        return 4;
+    }
+
+    const wl_interface* interface = nullptr;
+    uint32_t objectId = 0;
+    const uint32_t code = wl_display_get_protocol_error(connection, &interface, &objectId);
+    const char* const interfaceName = (interface != nullptr) ? interface->name : "<unknown interface>";
+    MY_LOG_ERROR("A fatal wl_display error occurred: interface=", interfaceName, " , object_id=", objectId, " , code=", code, ". Shutting down...");
+
+    // The reason of the dump tells it's a wl_display::error, so the event carries the interface instead
+    FlightRecorder::record(FlightRecorder::Kind::ERROR, interfaceName, objectId, code);
+    dumpFlightRecorder("wl_display::error");
+    return 5;
 }
 
+
+void dumpFlightRecorder(const char* const reason) noexcept
+{
+    if (const char* const path = FlightRecorder::dump(reason); path != nullptr)
+    {
+        MY_LOG_ERROR("The flight recorder has been dumped into \"", path, "\".");
+    }
+    else
+    {
+        const std::error_code sysErr{errno, std::system_category()};
+        MY_LOG_ERROR("Failed to dump the flight recorder (errno=", sysErr, " \"", sysErr.message(), "\").");
+    }
+}
@@ -0,0 +1,326 @@
+#ifndef WAYLAND_INPUT_WINDOW_MEMORY_BUDGET_H
+#define WAYLAND_INPUT_WINDOW_MEMORY_BUDGET_H
+
+#include "utilities.h"      // getEnvAsUnsigned, MY_LOG_*
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint*_t
+#include <string>           // std::string, std::getline
+#include <string_view>      // std::string_view
+#include <functional>       // std::function
+#include <vector>           // std::vector
+#include <algorithm>        // std::sort, std::min, std::max, std::clamp
+#include <chrono>           // std::chrono::*
+#include <fstream>          // std::ifstream
+#include <utility>          // std::pair, std::move
+#include <system_error>     // std::system_error
+#include <fcntl.h>          // open, O_*
+#include <unistd.h>         // close, write, sysconf
+#include <sys/timerfd.h>    // timerfd_*
+
+
+/**
+ * The central memory budget of the app.
+ * Caches and buffer pools register themselves as consumers, and the governor shrinks them when:
+ *   - the RSS of the process exceeds the configured target (checked periodically via a timerfd) ;
+ *   - the cgroup the process belongs to reports memory pressure (via a PSI trigger on memory.pressure),
+ *     or its usage approaches memory.high.
+ * The consumers with the lowest priority are shrunk first ; within the same priority, the ones which are the
+ *   cheapest to rebuild go first.
+ */
+class MemoryBudgetGovernor
+{
+public:
+    struct Consumer
+    {
+        std::string name;
+        // The consumers with lower priorities are shrunk first
+        int priority = 0;
+        // The relative cost of rebuilding 1 byte of the evicted data (e.g. re-rendering vs re-reading from disk)
+        double evictionCostPerByte = 1;
+
+        std::function<std::size_t()> getUsageBytes;
+        // Frees (approximately) the requested number of bytes, returns the number of bytes actually freed
+        std::function<std::size_t(std::size_t bytesToFree)> shrink;
+    };
+    using ConsumerId = std::size_t;
+
+    struct Config
+    {
+        // 0 disables the RSS checks
+        std::size_t rssTargetBytes = 0;
+        std::chrono::milliseconds rssCheckPeriod{ 500 };
+
+        bool watchCgroupPressure = true;
+        // The PSI trigger: "some" tasks of the cgroup were stalled on memory for the threshold within the window.
+        // Unprivileged processes may only use windows which are multiples of 2 seconds.
+        std::chrono::microseconds psiStallThreshold{ 150'000 };
+        std::chrono::microseconds psiWindow{ 2'000'000 };
+        // The share of the registered usage released on a pressure notification
+        double psiReclaimRatio = 0.25;
+
+        /** WAYLAND_INPUT_WINDOW_RSS_TARGET_MB, WAYLAND_INPUT_WINDOW_WATCH_MEMORY_PRESSURE (0 or 1) */
+        [[nodiscard]] static Config fromEnvironment()
+        {
+            Config result;
+            if (const auto rssTargetMb = getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_RSS_TARGET_MB"); rssTargetMb.has_value())
+                result.rssTargetBytes = static_cast<std::size_t>(*rssTargetMb) * 1024 * 1024;
+            if (const auto watchPressure = getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_WATCH_MEMORY_PRESSURE"); watchPressure.has_value())
+                result.watchCgroupPressure = (*watchPressure != 0);
+            return result;
+        }
+    };
+
+public: // ctors/dtor
+    explicit MemoryBudgetGovernor(Config config) noexcept(false)
+        : config_(std::move(config))
+    {
+        if (config_.rssTargetBytes > 0)
+            armRssTimer();
+
+        if (config_.watchCgroupPressure)
+            openCgroupPressureTrigger();
+    }
+
+    MemoryBudgetGovernor(const MemoryBudgetGovernor&) = delete;
+    MemoryBudgetGovernor& operator=(const MemoryBudgetGovernor&) = delete;
+
+    ~MemoryBudgetGovernor() noexcept
+    {
+        if (rssTimerFd_ != -1)
+            (void)close(rssTimerFd_);
+        if (pressureFd_ != -1)
+            (void)close(pressureFd_);
+    }
+
+public: // consumers
+    ConsumerId registerConsumer(Consumer consumer)
+    {
+        MY_LOG_INFO("MemoryBudgetGovernor: registering the consumer \"", consumer.name, "\" (priority=", consumer.priority, ", evictionCostPerByte=", consumer.evictionCostPerByte, ").");
+
+        const auto id = nextConsumerId_++;
+        consumers_.push_back(RegisteredConsumer{ id, std::move(consumer) });
+        return id;
+    }
+
+    void unregisterConsumer(const ConsumerId id) noexcept
+    {
+        consumers_.erase(
+            std::remove_if(consumers_.begin(), consumers_.end(), [id](const RegisteredConsumer& c) { return c.id == id; }),
+            consumers_.end()
+        );
+    }
+
+    [[nodiscard]] std::size_t getTotalUsageBytes() const
+    {
+        std::size_t result = 0;
+        for (const auto& c : consumers_)
+            result += c.consumer.getUsageBytes();
+        return result;
+    }
+
+    /**
+     * Shrinks the consumers in the eviction order until bytesToFree are released or nothing is left to evict
+     * @return the number of bytes freed
+     */
+    std::size_t reclaim(const std::size_t bytesToFree)
+    {
+        std::vector<RegisteredConsumer*> evictionOrder;
+        evictionOrder.reserve(consumers_.size());
+        for (auto& c : consumers_)
+            evictionOrder.push_back(&c);
+        std::sort(evictionOrder.begin(), evictionOrder.end(), [](const RegisteredConsumer* lhs, const RegisteredConsumer* rhs) {
+            if (lhs->consumer.priority != rhs->consumer.priority)
+                return (lhs->consumer.priority < rhs->consumer.priority);
+            return (lhs->consumer.evictionCostPerByte < rhs->consumer.evictionCostPerByte);
+        });
+
+        std::size_t freed = 0;
+        for (auto* const c : evictionOrder)
+        {
+            if (freed >= bytesToFree)
+                break;
+
+            const auto usage = c->consumer.getUsageBytes();
+            if (usage == 0)
+                continue;
+
+            const auto freedByConsumer = c->consumer.shrink(std::min(usage, bytesToFree - freed));
+            MY_LOG_INFO("MemoryBudgetGovernor: \"", c->consumer.name, "\" has freed ", freedByConsumer, " bytes out of ", usage, '.');
+
+            freed += freedByConsumer;
+        }
+
+        return freed;
+    }
+
+public: // event sources
+    /** -1 if the RSS checks are disabled. Should be polled for POLLIN and then handled by onRssTimer(). */
+    [[nodiscard]] int getRssTimerFd() const noexcept { return rssTimerFd_; }
+    /** -1 if the pressure notifications are unavailable. Should be polled for POLLPRI and then handled by onPressure(). */
+    [[nodiscard]] int getPressureFd() const noexcept { return pressureFd_; }
+
+    /**
+     * When the consumers can't bring the RSS down to the target (e.g. it's mostly held by the code and the Wayland
+     *   buffers), a pass frees next to nothing ; then the checks back off exponentially, unless the RSS grows again.
+     */
+    void onRssTimer()
+    {
+        std::uint64_t expirations = 0;
+        (void)read(rssTimerFd_, &expirations, sizeof(expirations));
+
+        const auto rss = readSelfRssBytes();
+        if (rss <= config_.rssTargetBytes)
+        {
+            futileBackoffChecks_ = 0;
+            checksToSkip_ = 0;
+            return;
+        }
+
+        if ( (checksToSkip_ > 0) && (rss <= rssAfterFutileReclaim_ + RSS_GROWTH_TO_RETRY_BYTES) )
+        {
+            --checksToSkip_;
+            return;
+        }
+        checksToSkip_ = 0;
+
+        MY_LOG_WARN_RATE_LIMITED("MemoryBudgetGovernor: the RSS (", rss, " bytes) exceeds the target (", config_.rssTargetBytes, " bytes), reclaiming...");
+        const auto freed = reclaim(rss - config_.rssTargetBytes);
+        if (freed >= MIN_USEFUL_RECLAIM_BYTES)
+        {
+            futileBackoffChecks_ = 0;
+            return;
+        }
+
+        futileBackoffChecks_ = std::clamp<std::uint32_t>(futileBackoffChecks_ * 2, 1, MAX_BACKOFF_CHECKS);
+        checksToSkip_ = futileBackoffChecks_;
+        rssAfterFutileReclaim_ = readSelfRssBytes();
+        MY_LOG_INFO_RATE_LIMITED("MemoryBudgetGovernor: the reclaim has freed only ", freed, " bytes, skipping the next ", checksToSkip_, " RSS check(s) unless the RSS grows.");
+    }
+
+    void onPressure()
+    {
+        // The usage above 90% of memory.high is released entirely ; otherwise a share of the registered usage is
+        std::size_t bytesToFree = static_cast<std::size_t>(static_cast<double>(getTotalUsageBytes()) * config_.psiReclaimRatio);
+        if (const auto [current, high] = readCgroupMemoryCurrentAndHigh(); (high > 0) && (current > high / 10 * 9))
+            bytesToFree = std::max(bytesToFree, current - high / 10 * 9);
+
+        MY_LOG_WARN("MemoryBudgetGovernor: the cgroup is under memory pressure, reclaiming ", bytesToFree, " bytes...");
+        (void)reclaim(bytesToFree);
+    }
+
+public:
+    [[nodiscard]] static std::size_t readSelfRssBytes()
+    {
+        // /proc/self/statm: size resident shared text lib data dt (in pages)
+        std::ifstream statm{ "/proc/self/statm" };
+        std::size_t sizePages = 0, residentPages = 0;
+        if (!(statm >> sizePages >> residentPages))
+            return 0;
+        return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+private:
+    // A pass of the RSS checks freeing less is considered futile
+    static constexpr std::size_t MIN_USEFUL_RECLAIM_BYTES = 64 * 1024;
+    // After a futile pass the RSS checks are resumed as soon as the RSS grows by this much
+    static constexpr std::size_t RSS_GROWTH_TO_RETRY_BYTES = 4 * 1024 * 1024;
+    static constexpr std::uint32_t MAX_BACKOFF_CHECKS = 64;
+
+    struct RegisteredConsumer
+    {
+        ConsumerId id;
+        Consumer consumer;
+    };
+
+    void armRssTimer()
+    {
+        rssTimerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (rssTimerFd_ == -1)
+            throw std::system_error(errno, std::system_category(), "MemoryBudgetGovernor: timerfd_create failed");
+
+        const auto periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.rssCheckPeriod).count();
+        itimerspec spec{};
+        spec.it_interval.tv_sec = static_cast<time_t>(periodNs / 1'000'000'000);
+        spec.it_interval.tv_nsec = static_cast<long>(periodNs % 1'000'000'000);
+        spec.it_value = spec.it_interval;
+        if (timerfd_settime(rssTimerFd_, 0, &spec, nullptr) != 0)
+            throw std::system_error(errno, std::system_category(), "MemoryBudgetGovernor: timerfd_settime failed");
+    }
+
+    /** /sys/fs/cgroup/<the cgroup v2 path of the process> or an empty string */
+    [[nodiscard]] static std::string getCgroupDir()
+    {
+        // The cgroup v2 line looks like "0::/user.slice/user-1000.slice/session-2.scope"
+        std::ifstream cgroupFile{ "/proc/self/cgroup" };
+        for (std::string line; std::getline(cgroupFile, line); )
+        {
+            if (line.rfind("0::", 0) == 0)
+                return (line == "0::/") ? "/sys/fs/cgroup" : ("/sys/fs/cgroup" + line.substr(3));
+        }
+        return {};
+    }
+
+    void openCgroupPressureTrigger()
+    {
+        cgroupDir_ = getCgroupDir();
+        if (cgroupDir_.empty())
+        {
+            MY_LOG_WARN("MemoryBudgetGovernor: the process doesn't belong to a cgroup v2, the memory pressure won't be watched.");
+            return;
+        }
+
+        const auto pressureFilePath = cgroupDir_ + "/memory.pressure";
+        pressureFd_ = open(pressureFilePath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (pressureFd_ == -1)
+        {
+            MY_LOG_WARN("MemoryBudgetGovernor: failed to open \"", pressureFilePath, "\" (errno=", errno, "), the memory pressure won't be watched.");
+            return;
+        }
+
+        const std::string trigger = "some " + std::to_string(config_.psiStallThreshold.count()) + ' ' + std::to_string(config_.psiWindow.count());
+        // The trigger string must include the terminating null
+        if (write(pressureFd_, trigger.c_str(), trigger.size() + 1) < 0)
+        {
+            MY_LOG_WARN("MemoryBudgetGovernor: failed to set the PSI trigger \"", trigger, "\" (errno=", errno, "), the memory pressure won't be watched.");
+            (void)close(pressureFd_);
+            pressureFd_ = -1;
+            return;
+        }
+
+        MY_LOG_INFO("MemoryBudgetGovernor: watching \"", pressureFilePath, "\" with the trigger \"", trigger, "\".");
+    }
+
+    /** {memory.current, memory.high} of the cgroup ; high is 0 if it's unlimited or unknown */
+    [[nodiscard]] std::pair<std::size_t, std::size_t> readCgroupMemoryCurrentAndHigh() const
+    {
+        std::size_t current = 0;
+        std::size_t high = 0;
+        if (!cgroupDir_.empty())
+        {
+            std::ifstream currentFile{ cgroupDir_ + "/memory.current" };
+            currentFile >> current;
+            // "max" fails to be parsed and keeps 0
+            std::ifstream highFile{ cgroupDir_ + "/memory.high" };
+            highFile >> high;
+        }
+        return { current, high };
+    }
+
+private:
+    const Config config_;
+
+    ConsumerId nextConsumerId_ = 0;
+    std::vector<RegisteredConsumer> consumers_;
+
+    int rssTimerFd_ = -1;
+    // The number of the RSS checks skipped after the last futile pass, doubled by every futile pass in a row
+    std::uint32_t futileBackoffChecks_ = 0;
+    std::uint32_t checksToSkip_ = 0;
+    std::size_t rssAfterFutileReclaim_ = 0;
+
+    std::string cgroupDir_;
+    int pressureFd_ = -1;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_MEMORY_BUDGET_H
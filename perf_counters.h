@@ -0,0 +1,346 @@
+#ifndef WAYLAND_INPUT_WINDOW_PERF_COUNTERS_H
+#define WAYLAND_INPUT_WINDOW_PERF_COUNTERS_H
+
+#include "utilities.h"          // MY_LOG_*
+#include <array>                // std::array
+#include <vector>               // std::vector
+#include <string>               // std::string, std::to_string
+#include <string_view>          // std::string_view
+#include <utility>              // std::pair, std::move
+#include <cstddef>              // std::size_t
+#include <cstdint>              // std::uint64_t
+#include <cerrno>               // errno
+#include <system_error>         // std::error_code, std::system_category
+#include <linux/perf_event.h>   // perf_event_attr, PERF_*
+#include <sys/ioctl.h>          // ioctl
+#include <sys/syscall.h>        // SYS_perf_event_open
+#include <sys/types.h>          // pid_t
+#include <unistd.h>             // syscall, read, close
+
+
+/**
+ * The hardware and software performance counters (perf_event_open) of the app threads, aggregated per frame for
+ *   the stages of the frame: the dispatch of the events, the rendering, some listener callbacks, etc.
+ * Each thread gets its own counter group, so the counters of a group are always scheduled onto the PMU together and
+ *   their ratios (e.g. the instructions per cycle) are meaningful ; the counters are scaled if the PMU is multiplexed.
+ * Only the user space is counted, so it works with kernel.perf_event_paranoid=2. The counters the kernel or the
+ *   hardware doesn't provide (e.g. all the hardware ones inside most VMs) are reported as n/a.
+ */
+class PerfCounters
+{
+public:
+    enum Counter : std::size_t
+    {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        PAGE_FAULTS,
+        CONTEXT_SWITCHES,
+        COUNTERS_COUNT
+    };
+    using Values = std::array<std::uint64_t, COUNTERS_COUNT>;
+
+    // Every listener of the Wayland events is a stage as well
+    static constexpr std::size_t MAX_STAGES = 128;
+    static constexpr std::uint64_t REPORT_PERIOD_FRAMES = 600;
+
+    /** Measures a stage from its construction to its destruction ; does nothing if the counters are disabled */
+    class Scope
+    {
+    public: // ctors/dtor
+        Scope(PerfCounters* const counters, const std::size_t stageIdx) noexcept
+            : counters_{ counters }
+            , stageIdx_{ stageIdx }
+        {
+            if (counters_ != nullptr)
+                begin_ = counters_->read(counters_->stages_[stageIdx_].includesOtherThreads);
+        }
+
+        Scope(const Scope&) = delete;
+
+        ~Scope() noexcept
+        {
+            if (counters_ != nullptr)
+                counters_->onStageMeasured(stageIdx_, begin_);
+        }
+
+    public: // assignments
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        PerfCounters* const counters_;
+        const std::size_t stageIdx_;
+        Values begin_{};
+    };
+
+public: // ctors/dtor
+    PerfCounters() noexcept = default;
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    ~PerfCounters() noexcept
+    {
+        report();
+
+        for (auto& group : groups_)
+            for (const auto& member : group.members)
+                (void)close(member.fd);
+    }
+
+public: // assignments
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+public:
+    /**
+     * Opens the counters of the calling thread (it's the main one) and of otherThreads (e.g. the render workers).
+     * @return false if no counter could be opened, the measurements are disabled then
+     */
+    bool open(const std::vector<pid_t>& otherThreads)
+    {
+        MY_LOG_INFO("PerfCounters: opening the counters of ", otherThreads.size() + 1, " thread(s)...");
+
+        // 0 means the calling thread
+        openGroup(0);
+        if (groups_.empty())
+        {
+            MY_LOG_WARN("PerfCounters: no counters are available, the measurements are disabled.");
+            return false;
+        }
+        for (const auto tid : otherThreads)
+            openGroup(tid);
+
+        for (std::size_t i = 0; i < COUNTERS_COUNT; ++i)
+            MY_LOG_INFO("    ", COUNTER_NAMES[i], ": ", isAvailable_[i] ? "available" : "n/a");
+
+        return true;
+    }
+
+    [[nodiscard]] bool isEnabled() const noexcept { return !groups_.empty(); }
+
+    /**
+     * E.g. const auto perfScope = perfCounters.measure("render", true);
+     * @param name must be a string literal (or live as long as the counters do) ; the stages are found by it
+     * @param includesOtherThreads whether the stage is done by the other threads too (e.g. the render workers)
+     */
+    [[nodiscard]] Scope measure(const std::string_view name, const bool includesOtherThreads = false) noexcept
+    {
+        if (!isEnabled())
+            return Scope{ nullptr, 0 };
+
+        for (std::size_t i = 0; i < stagesCount_; ++i)
+        {
+            if (stages_[i].name == name)
+                return Scope{ this, i };
+        }
+        if (stagesCount_ == MAX_STAGES)
+            return Scope{ nullptr, 0 };
+
+        stages_[stagesCount_] = Stage{ name, includesOtherThreads, {}, {}, 0 };
+        return Scope{ this, stagesCount_++ };
+    }
+
+    /** The stages measured since the previous call make up a frame */
+    void onFrameEnd() noexcept
+    {
+        if (!isEnabled())
+            return;
+
+        for (std::size_t i = 0; i < stagesCount_; ++i)
+        {
+            auto& stage = stages_[i];
+            for (std::size_t c = 0; c < COUNTERS_COUNT; ++c)
+            {
+                stage.total[c] += stage.currentFrame[c];
+                stage.currentFrame[c] = 0;
+            }
+        }
+
+        if (++framesCount_ >= REPORT_PERIOD_FRAMES)
+        {
+            report();
+            for (std::size_t i = 0; i < stagesCount_; ++i)
+            {
+                stages_[i].total = {};
+                stages_[i].callsCount = 0;
+            }
+            framesCount_ = 0;
+        }
+    }
+
+    /** Logs the per frame means of each stage and whether it looks memory-bound or compute-bound */
+    void report() const noexcept
+    {
+        if (framesCount_ == 0)
+            return;
+
+        MY_LOG_INFO("PerfCounters over ", framesCount_, " frames (the means per frame):");
+        for (std::size_t i = 0; i < stagesCount_; ++i)
+        {
+            const auto& stage = stages_[i];
+            const auto perFrame = [this, &stage](const Counter counter) -> double {
+                return static_cast<double>(stage.total[counter]) / static_cast<double>(framesCount_);
+            };
+            const auto formatted = [this, &perFrame](const Counter counter) -> std::string {
+                return isAvailable_[counter] ? std::to_string(perFrame(counter)) : std::string{ "n/a" };
+            };
+
+            std::string verdict = "n/a";
+            if ( isAvailable_[CYCLES] && isAvailable_[INSTRUCTIONS] && isAvailable_[CACHE_MISSES] && (stage.total[CYCLES] > 0) && (stage.total[INSTRUCTIONS] > 0) )
+            {
+                const double ipc = perFrame(INSTRUCTIONS) / perFrame(CYCLES);
+                // The cache misses per 1000 instructions
+                const double mpki = perFrame(CACHE_MISSES) * 1000 / perFrame(INSTRUCTIONS);
+                verdict = "IPC=" + std::to_string(ipc) + ", MPKI=" + std::to_string(mpki) + ", "
+                        + ( ((ipc < LOW_IPC) || (mpki > HIGH_MPKI)) ? "memory-bound" : "compute-bound" );
+            }
+
+            MY_LOG_INFO(
+                "    \"", stage.name, "\" (", static_cast<double>(stage.callsCount) / static_cast<double>(framesCount_), " calls): ",
+                "cycles=", formatted(CYCLES), ", ",
+                "instructions=", formatted(INSTRUCTIONS), ", ",
+                "cache-misses=", formatted(CACHE_MISSES), ", ",
+                "branch-misses=", formatted(BRANCH_MISSES), ", ",
+                "page-faults=", formatted(PAGE_FAULTS), ", ",
+                "context-switches=", formatted(CONTEXT_SWITCHES), " ; ",
+                verdict
+            );
+        }
+    }
+
+private:
+    static constexpr std::array<const char*, COUNTERS_COUNT> COUNTER_NAMES = {
+        "cycles", "instructions", "cache-misses", "branch-misses", "page-faults", "context-switches"
+    };
+    // Below the IPC or above the MPKI the stage most likely waits for the memory
+    static constexpr double LOW_IPC = 1.0;
+    static constexpr double HIGH_MPKI = 10.0;
+
+    struct Group
+    {
+        struct Member
+        {
+            int fd;
+            Counter counter;
+        };
+        // members[0] is the leader
+        std::vector<Member> members;
+    };
+
+    struct Stage
+    {
+        std::string_view name;
+        bool includesOtherThreads;
+        Values currentFrame;
+        Values total;
+        std::uint64_t callsCount;
+    };
+
+private:
+    void openGroup(const pid_t tid)
+    {
+        static constexpr std::array<std::pair<std::uint32_t, std::uint64_t>, COUNTERS_COUNT> events = {{
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+        }};
+
+        Group group;
+        for (std::size_t i = 0; i < COUNTERS_COUNT; ++i)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // The group starts once it's complete
+            attr.disabled = group.members.empty() ? 1 : 0;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const int leaderFd = group.members.empty() ? -1 : group.members[0].fd;
+            const auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, leaderFd, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0)
+            {
+                // Typically ENOENT (no such counter) or EACCES (perf_event_paranoid) ; the first thread tells it
+                if (groups_.empty())
+                {
+                    const std::error_code sysErr{errno, std::system_category()};
+                    MY_LOG_INFO("PerfCounters: couldn't open ", COUNTER_NAMES[i], " (errno=", sysErr, " \"", sysErr.message(), "\").");
+                }
+                continue;
+            }
+
+            group.members.push_back(Group::Member{ fd, static_cast<Counter>(i) });
+            isAvailable_[i] = true;
+        }
+
+        if (group.members.empty())
+            return;
+
+        if (ioctl(group.members[0].fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+        {
+            const std::error_code sysErr{errno, std::system_category()};
+            MY_LOG_WARN("PerfCounters: failed to enable the counters of the thread ", tid, " (errno=", sysErr, " \"", sysErr.message(), "\").");
+            for (const auto& member : group.members)
+                (void)close(member.fd);
+            return;
+        }
+
+        groups_.push_back(std::move(group));
+    }
+
+    /** The sums of the counters of the main thread and optionally of the other ones */
+    [[nodiscard]] Values read(const bool includesOtherThreads) const noexcept
+    {
+        Values result{};
+
+        const std::size_t groupsToRead = includesOtherThreads ? groups_.size() : 1;
+        for (std::size_t g = 0; g < groupsToRead; ++g)
+        {
+            const auto& group = groups_[g];
+
+            // PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_*: nr, time_enabled, time_running, values[nr]
+            std::array<std::uint64_t, 3 + COUNTERS_COUNT> buffer{};
+            if (::read(group.members[0].fd, buffer.data(), sizeof(buffer)) <= 0)
+                continue;
+
+            const auto enabled = buffer[1];
+            const auto running = buffer[2];
+            for (std::size_t i = 0; (i < buffer[0]) && (i < group.members.size()); ++i)
+            {
+                auto value = buffer[3 + i];
+                // The PMU has been multiplexed between several groups
+                if ( (running > 0) && (running < enabled) )
+                    value = static_cast<std::uint64_t>(static_cast<double>(value) * static_cast<double>(enabled) / static_cast<double>(running));
+                result[group.members[i].counter] += value;
+            }
+        }
+
+        return result;
+    }
+
+    void onStageMeasured(const std::size_t stageIdx, const Values& begin) noexcept
+    {
+        auto& stage = stages_[stageIdx];
+        const auto end = read(stage.includesOtherThreads);
+        for (std::size_t c = 0; c < COUNTERS_COUNT; ++c)
+            stage.currentFrame[c] += (end[c] >= begin[c]) ? (end[c] - begin[c]) : 0;
+        ++stage.callsCount;
+    }
+
+private:
+    // groups_[0] is the main thread
+    std::vector<Group> groups_;
+    std::array<bool, COUNTERS_COUNT> isAvailable_{};
+
+    std::array<Stage, MAX_STAGES> stages_{};
+    std::size_t stagesCount_ = 0;
+    std::uint64_t framesCount_ = 0;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_PERF_COUNTERS_H
@@ -0,0 +1,249 @@
+#ifndef WAYLAND_INPUT_WINDOW_PIXEL_FORMATS_H
+#define WAYLAND_INPUT_WINDOW_PIXEL_FORMATS_H
+
+#include "utilities.h"          // MY_LOG_*
+#include <wayland-client.h>     // WL_SHM_FORMAT_*
+#include <array>                // std::array
+#include <vector>               // std::vector
+#include <algorithm>            // std::find, std::find_if, std::stable_sort
+#include <chrono>               // std::chrono::*
+#include <cstddef>              // std::size_t, std::byte
+#include <cstdint>              // std::uint32_t, std::uint16_t
+
+
+/**
+ * A wl_shm format the buffers of the windows may have.
+ * The frames are always composed as XRGB8888 (that's what the tiles, the ink and the kernels produce), then converted
+ *   into the buffers unless the format has the same layout.
+ */
+struct ShmPixelFormat
+{
+    using ConvertRow = void (*)(const std::uint32_t* src, std::byte* dst, std::size_t count) noexcept;
+
+    // enum wl_shm_format
+    std::uint32_t wlFormat;
+    const char* name;
+    std::size_t bytesPerPixel;
+    // The channels keep their order, so the conversion only drops or packs bits
+    bool isSwizzleFree;
+    // The servers can usually sample it as is (e.g. as a GL texture) instead of converting it on their side
+    bool isUploadedAsIs;
+    // The servers have to blend it with whatever is under the window
+    bool hasAlpha;
+    // Loses some of the colors of the content
+    bool isLossy;
+    // nullptr means the frames are composed right in the buffers
+    ConvertRow convertRow;
+};
+
+
+namespace shm_pixel_conversions
+{
+    /** XRGB8888 -> XBGR8888 */
+    inline void toXbgr8888(const std::uint32_t* const src, std::byte* const dst, const std::size_t count) noexcept
+    {
+        auto* const dstPixels = reinterpret_cast<std::uint32_t*>(dst);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto p = src[i];
+            dstPixels[i] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+        }
+    }
+
+    /** XRGB8888 -> RGB888, i.e. the bytes B, G, R */
+    inline void toRgb888(const std::uint32_t* const src, std::byte* const dst, const std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto p = src[i];
+            dst[i * 3 + 0] = static_cast<std::byte>(p & 0xFF);
+            dst[i * 3 + 1] = static_cast<std::byte>((p >> 8) & 0xFF);
+            dst[i * 3 + 2] = static_cast<std::byte>((p >> 16) & 0xFF);
+        }
+    }
+
+    /** XRGB8888 -> BGR888, i.e. the bytes R, G, B */
+    inline void toBgr888(const std::uint32_t* const src, std::byte* const dst, const std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto p = src[i];
+            dst[i * 3 + 0] = static_cast<std::byte>((p >> 16) & 0xFF);
+            dst[i * 3 + 1] = static_cast<std::byte>((p >> 8) & 0xFF);
+            dst[i * 3 + 2] = static_cast<std::byte>(p & 0xFF);
+        }
+    }
+
+    /** XRGB8888 -> RGB565 (little endian) */
+    inline void toRgb565(const std::uint32_t* const src, std::byte* const dst, const std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto p = src[i];
+            const auto packed = static_cast<std::uint16_t>( ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F) );
+            dst[i * 2 + 0] = static_cast<std::byte>(packed & 0xFF);
+            dst[i * 2 + 1] = static_cast<std::byte>(packed >> 8);
+        }
+    }
+} // namespace shm_pixel_conversions
+
+
+/** All the formats the app can produce ; XRGB8888 goes first and is the fallback */
+inline constexpr std::array<ShmPixelFormat, 6> SHM_PIXEL_FORMATS = {{
+    { WL_SHM_FORMAT_XRGB8888, "XRGB8888", 4, true,  true,  false, false, nullptr },
+    // The content is opaque, so the alpha channel is always 0xFF and the layout is the same
+    { WL_SHM_FORMAT_ARGB8888, "ARGB8888", 4, true,  true,  true,  false, nullptr },
+    { WL_SHM_FORMAT_XBGR8888, "XBGR8888", 4, false, true,  false, false, &shm_pixel_conversions::toXbgr8888 },
+    { WL_SHM_FORMAT_RGB888,   "RGB888",   3, true,  false, false, false, &shm_pixel_conversions::toRgb888 },
+    { WL_SHM_FORMAT_BGR888,   "BGR888",   3, false, false, false, false, &shm_pixel_conversions::toBgr888 },
+    { WL_SHM_FORMAT_RGB565,   "RGB565",   2, true,  true,  false, true,  &shm_pixel_conversions::toRgb565 }
+}};
+
+
+/**
+ * Collects the formats advertised via wl_shm::format and picks the cheapest one of SHM_PIXEL_FORMATS among them.
+ * The cost of a format is estimated in nanoseconds per pixel of a presented frame: writing and reading its bytes via
+ *   the shared memory, the conversion on the app side (estimated by the traits or measured by benchmark()) and the
+ *   conversion on the server side.
+ */
+class ShmFormatSelector
+{
+public:
+    // ~10 GB/s, paid twice: the app writes the buffer, the server reads it
+    static constexpr double TRANSFER_NS_PER_BYTE = 2 * 0.1;
+    // The conversion pass on the app side when it isn't measured
+    static constexpr double SWIZZLE_FREE_CONVERSION_NS_PER_PIXEL = 0.3;
+    static constexpr double SWIZZLE_CONVERSION_NS_PER_PIXEL = 0.6;
+    // The servers convert the formats they can't sample, typically on the CPU
+    static constexpr double SERVER_CONVERSION_NS_PER_PIXEL = 1.5;
+    // The servers blend the windows having an alpha channel
+    static constexpr double SERVER_BLENDING_NS_PER_PIXEL = 0.1;
+
+    struct Candidate
+    {
+        const ShmPixelFormat* format;
+        double conversionNsPerPixel;
+        bool isConversionMeasured;
+        double costNsPerPixel;
+    };
+
+public:
+    /** Must be called for each wl_shm::format event */
+    void onFormatAdvertised(const std::uint32_t wlFormat)
+    {
+        if (std::find(advertised_.begin(), advertised_.end(), wlFormat) == advertised_.end())
+            advertised_.push_back(wlFormat);
+    }
+
+    /** E.g. a new wl_shm has been bound, which advertises its formats again */
+    void reset() noexcept
+    {
+        advertised_.clear();
+        measured_.clear();
+    }
+
+    /** Measures the conversion of a frame of pixelsCount pixels into each of the advertised formats */
+    void benchmark(const std::size_t pixelsCount, const unsigned iterations = 20)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        std::vector<std::uint32_t> src(pixelsCount);
+        for (std::size_t i = 0; i < pixelsCount; ++i)
+            src[i] = 0xFF000000 | static_cast<std::uint32_t>(i * 2654435761u >> 8);
+        std::vector<std::byte> dst(pixelsCount * 4);
+
+        measured_.clear();
+        for (const auto& format : SHM_PIXEL_FORMATS)
+        {
+            if ( !isAdvertised(format.wlFormat) || (format.convertRow == nullptr) )
+                continue;
+
+            // The first pass warms the caches up
+            format.convertRow(src.data(), dst.data(), pixelsCount);
+
+            const auto startedAt = Clock::now();
+            for (unsigned i = 0; i < iterations; ++i)
+                format.convertRow(src.data(), dst.data(), pixelsCount);
+            const auto elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - startedAt).count();
+
+            measured_.push_back({ format.wlFormat, elapsedNs / static_cast<double>(iterations) / static_cast<double>(pixelsCount) });
+        }
+    }
+
+    /** The advertised formats from the cheapest to the most expensive one */
+    [[nodiscard]] std::vector<Candidate> rankCandidates(const bool allowLossy) const
+    {
+        std::vector<Candidate> result;
+        for (const auto& format : SHM_PIXEL_FORMATS)
+        {
+            if ( !isAdvertised(format.wlFormat) || (format.isLossy && !allowLossy) )
+                continue;
+
+            Candidate candidate{ &format, 0, false, 0 };
+            if (format.convertRow != nullptr)
+            {
+                const auto measuredIter = std::find_if(measured_.begin(), measured_.end(), [&format](const Measurement& m) { return (m.wlFormat == format.wlFormat); });
+                candidate.isConversionMeasured = (measuredIter != measured_.end());
+                candidate.conversionNsPerPixel = candidate.isConversionMeasured
+                    ? measuredIter->nsPerPixel
+                    : (format.isSwizzleFree ? SWIZZLE_FREE_CONVERSION_NS_PER_PIXEL : SWIZZLE_CONVERSION_NS_PER_PIXEL);
+            }
+
+            candidate.costNsPerPixel = static_cast<double>(format.bytesPerPixel) * TRANSFER_NS_PER_BYTE
+                                     + candidate.conversionNsPerPixel
+                                     + (format.isUploadedAsIs ? 0 : SERVER_CONVERSION_NS_PER_PIXEL)
+                                     + (format.hasAlpha ? SERVER_BLENDING_NS_PER_PIXEL : 0);
+            result.push_back(candidate);
+        }
+
+        // Stable, so the ties are resolved by the order of SHM_PIXEL_FORMATS
+        std::stable_sort(result.begin(), result.end(), [](const Candidate& lhs, const Candidate& rhs) {
+            return (lhs.costNsPerPixel < rhs.costNsPerPixel);
+        });
+        return result;
+    }
+
+    [[nodiscard]] const ShmPixelFormat& choose(const bool allowLossy) const
+    {
+        const auto candidates = rankCandidates(allowLossy);
+        return candidates.empty() ? SHM_PIXEL_FORMATS[0] : *candidates.front().format;
+    }
+
+    void logCandidates(const bool allowLossy) const
+    {
+        for (const auto& candidate : rankCandidates(allowLossy))
+        {
+            MY_LOG_INFO(
+                "    ", candidate.format->name, ": ",
+                candidate.format->bytesPerPixel, " bytes/pixel, ",
+                "conversion ", candidate.conversionNsPerPixel, " ns/pixel (",
+                    (candidate.format->convertRow == nullptr) ? "none" : (candidate.isConversionMeasured ? "measured" : "estimated"), "), ",
+                "total ", candidate.costNsPerPixel, " ns/pixel"
+            );
+        }
+    }
+
+public: // getters
+    [[nodiscard]] const std::vector<std::uint32_t>& getAdvertised() const noexcept { return advertised_; }
+
+    /** ARGB8888 and XRGB8888 are supported by all the servers even if they aren't advertised */
+    [[nodiscard]] bool isAdvertised(const std::uint32_t wlFormat) const noexcept
+    {
+        return ( (wlFormat == WL_SHM_FORMAT_ARGB8888) || (wlFormat == WL_SHM_FORMAT_XRGB8888) ||
+                 (std::find(advertised_.begin(), advertised_.end(), wlFormat) != advertised_.end()) );
+    }
+
+private:
+    struct Measurement
+    {
+        std::uint32_t wlFormat;
+        double nsPerPixel;
+    };
+
+private:
+    std::vector<std::uint32_t> advertised_;
+    std::vector<Measurement> measured_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_PIXEL_FORMATS_H
@@ -0,0 +1,340 @@
+#ifndef WAYLAND_INPUT_WINDOW_POINTER_CURSOR_H
+#define WAYLAND_INPUT_WINDOW_POINTER_CURSOR_H
+
+#include "utilities.h"          // WLResourceWrapper, makeWLResourceWrapperChecked, getEnvAsUnsigned, MY_LOG_*
+#include <wayland-client.h>     // wl_*
+#include <wayland-cursor.h>     // wl_cursor_*
+#include <cursor-shape-v1.h>    // wp_cursor_shape_*
+#include <array>                // std::array
+#include <memory>               // std::shared_ptr
+#include <optional>             // std::optional
+#include <cstdint>              // std::uint*_t, std::int32_t
+#include <cstddef>              // std::size_t
+#include <cstdlib>              // std::getenv
+#include <system_error>         // std::system_error
+#include <stdexcept>            // std::runtime_error
+
+
+enum class CursorShape : std::uint8_t
+{
+    Default,
+    // Over the content which can be dragged
+    Grab,
+    // While the content is being dragged
+    Grabbing,
+    ZoomIn,
+    ZoomOut,
+
+    COUNT
+};
+
+
+/**
+ * The images of all the cursor shapes, loaded from the cursor theme once for all the pointers. libwayland-cursor keeps
+ *   all the images of a theme in a single wl_shm_pool and caches their wl_buffers, which any number of cursor surfaces
+ *   can show at once.
+ */
+class CursorTheme
+{
+public:
+    struct Image
+    {
+        wl_buffer* buffer = nullptr;
+        std::int32_t width = 0;
+        std::int32_t height = 0;
+        std::int32_t hotspotX = 0;
+        std::int32_t hotspotY = 0;
+    };
+
+public: // ctors/dtor
+    /** Loads the images of the $XCURSOR_THEME theme of the $XCURSOR_SIZE size (24 by default) */
+    [[nodiscard]] static CursorTheme load(wl_shm* const shmProvider) noexcept(false)
+    {
+        const char* const themeName = std::getenv("XCURSOR_THEME");
+        const auto size = static_cast<int>(getEnvAsUnsigned("XCURSOR_SIZE").value_or(24));
+
+        MY_LOG_INFO("CursorTheme: loading the cursor theme \"", (themeName == nullptr) ? "default" : themeName, "\" of size ", size, "...");
+
+        CursorTheme result;
+
+        auto* const theme = MY_LOG_WLCALL(wl_cursor_theme_load(themeName, size, shmProvider));
+        if (theme == nullptr)
+            throw std::system_error{errno, std::system_category(), "CursorTheme: wl_cursor_theme_load failed"};
+        result.theme_.reset(theme, [](wl_cursor_theme* theme) { MY_LOG_WLCALL_VALUELESS(wl_cursor_theme_destroy(theme)); });
+
+        for (std::size_t shapeIdx = 0; shapeIdx < result.images_.size(); ++shapeIdx)
+        {
+            wl_cursor* cursor = nullptr;
+            for (const char* const name : THEME_CURSOR_NAMES[shapeIdx])
+            {
+                if (name == nullptr)
+                    break;
+                cursor = MY_LOG_WLCALL(wl_cursor_theme_get_cursor(theme, name));
+                if (cursor != nullptr)
+                    break;
+            }
+            if ( (cursor == nullptr) || (cursor->image_count == 0) )
+            {
+                MY_LOG_WARN("CursorTheme: the theme has no cursor for the shape #", shapeIdx, ", the default one will be used instead.");
+                continue;
+            }
+
+            // Animated cursors are shown by their first frame
+            auto* const image = cursor->images[0];
+            auto* const buffer = MY_LOG_WLCALL(wl_cursor_image_get_buffer(image));
+            if (buffer == nullptr)
+                throw std::system_error{errno, std::system_category(), "CursorTheme: wl_cursor_image_get_buffer failed"};
+
+            result.images_[shapeIdx] = Image{
+                buffer,
+                static_cast<std::int32_t>(image->width),
+                static_cast<std::int32_t>(image->height),
+                static_cast<std::int32_t>(image->hotspot_x),
+                static_cast<std::int32_t>(image->hotspot_y)
+            };
+        }
+
+        if (result.images_[static_cast<std::size_t>(CursorShape::Default)].buffer == nullptr)
+            throw std::runtime_error{"CursorTheme: the cursor theme has no default cursor"};
+
+        return result;
+    }
+
+    // isValid() == false
+    CursorTheme() noexcept = default;
+
+    CursorTheme(const CursorTheme&) = delete;
+    CursorTheme(CursorTheme&&) noexcept = default;
+
+public: // assignments
+    CursorTheme& operator=(const CursorTheme&) = delete;
+    CursorTheme& operator=(CursorTheme&&) noexcept = default;
+
+public: // getters
+    [[nodiscard]] bool isValid() const noexcept { return (theme_ != nullptr); }
+
+    /** The default shape's image stands in for the shapes the theme has no cursor for */
+    [[nodiscard]] const Image& getImage(const CursorShape shape) const noexcept
+    {
+        const auto& image = images_[static_cast<std::size_t>(shape)];
+        return (image.buffer != nullptr) ? image : images_[static_cast<std::size_t>(CursorShape::Default)];
+    }
+
+public:
+    /** The cursor surfaces showing the images must be destroyed first */
+    void dispose() noexcept
+    {
+        images_.fill(Image{});
+        theme_.reset();
+    }
+
+private:
+    // The names used by the cursor themes for each shape in the order of preference
+    static constexpr std::size_t MAX_THEME_CURSOR_NAMES = 3;
+    static constexpr std::array<std::array<const char*, MAX_THEME_CURSOR_NAMES>, static_cast<std::size_t>(CursorShape::COUNT)> THEME_CURSOR_NAMES = {{
+        { "default",  "left_ptr",   nullptr },  // CursorShape::Default
+        { "grab",     "openhand",   "hand1" },  // CursorShape::Grab
+        { "grabbing", "closedhand", "fleur" },  // CursorShape::Grabbing
+        { "zoom-in",  nullptr,      nullptr },  // CursorShape::ZoomIn
+        { "zoom-out", nullptr,      nullptr }   // CursorShape::ZoomOut
+    }};
+
+private:
+    // Owns the buffers of the images
+    std::shared_ptr<wl_cursor_theme> theme_;
+    std::array<Image, static_cast<std::size_t>(CursorShape::COUNT)> images_;
+};
+
+
+/**
+ * The cursor of a wl_pointer over the app surfaces.
+ * The server side cursor shapes (wp_cursor_shape_v1) are used where available. Otherwise the cursor has its own
+ *   surface showing the images of the CursorTheme shared by all the pointers, so a new pointer loads nothing, and
+ *   changing the shape just attaches another of the preloaded buffers: nothing is allocated or uploaded.
+ */
+class PointerCursor
+{
+public: // ctors/dtor
+    /** Uses the shapes provided by the server ; the manager must outlive the cursor */
+    [[nodiscard]] static PointerCursor makeServerSide(wp_cursor_shape_manager_v1* const shapeManager) noexcept
+    {
+        PointerCursor result;
+        result.shapeManager_ = shapeManager;
+        return result;
+    }
+
+    /** Shows the images of the theme, which must be valid and outlive the cursor */
+    [[nodiscard]] static PointerCursor makeClientSide(const CursorTheme& theme, wl_compositor* const compositor) noexcept(false)
+    {
+        PointerCursor result;
+
+        result.surface_ = makeWLResourceWrapperChecked(
+            MY_LOG_WLCALL(wl_compositor_create_surface(compositor)),
+            nullptr,
+            [](auto& srf) { MY_LOG_WLCALL(wl_surface_destroy(srf)); srf = nullptr; }
+        );
+        if (!result.surface_.hasResource())
+            throw std::system_error{errno, std::system_category(), "PointerCursor: failed to create a cursor wl_surface"};
+        result.theme_ = &theme;
+
+        return result;
+    }
+
+    // isValid() == false
+    PointerCursor() noexcept = default;
+
+    PointerCursor(const PointerCursor&) = delete;
+    PointerCursor(PointerCursor&&) = default;
+
+    ~PointerCursor() noexcept
+    {
+        dispose();
+    }
+
+public: // assignments
+    PointerCursor& operator=(const PointerCursor&) = delete;
+    PointerCursor& operator=(PointerCursor&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            dispose();
+
+            shapeManager_ = rhs.shapeManager_;
+            shapeDevice_ = std::move(rhs.shapeDevice_);
+            theme_ = rhs.theme_;
+            surface_ = std::move(rhs.surface_);
+            surfaceShape_ = rhs.surfaceShape_;
+            pointer_ = rhs.pointer_;
+            enterSerial_ = rhs.enterSerial_;
+            currentShape_ = rhs.currentShape_;
+
+            rhs.shapeManager_ = nullptr;
+            rhs.theme_ = nullptr;
+            rhs.surfaceShape_.reset();
+            rhs.pointer_ = nullptr;
+            rhs.enterSerial_.reset();
+        }
+
+        return *this;
+    }
+
+public: // getters
+    [[nodiscard]] bool isValid() const noexcept { return ( (shapeManager_ != nullptr) || (theme_ != nullptr) ); }
+    [[nodiscard]] bool isServerSide() const noexcept { return (shapeManager_ != nullptr); }
+
+public:
+    /** Must be called for every new wl_pointer */
+    void attachTo(wl_pointer* const pointer)
+    {
+        shapeDevice_.reset();
+        pointer_ = pointer;
+        enterSerial_.reset();
+
+        if (shapeManager_ == nullptr)
+            return;
+
+        shapeDevice_ = makeWLResourceWrapperChecked(
+            MY_LOG_WLCALL(wp_cursor_shape_manager_v1_get_pointer(shapeManager_, pointer)),
+            nullptr,
+            [](auto& device) { MY_LOG_WLCALL_VALUELESS(wp_cursor_shape_device_v1_destroy(device)); device = nullptr; }
+        );
+        if (!shapeDevice_.hasResource())
+            throw std::system_error{errno, std::system_category(), "PointerCursor: failed to get a wp_cursor_shape_device_v1"};
+    }
+
+    /** The cursor is undefined after wl_pointer::enter, hence it's set again using the serial of the event */
+    void onEnter(const std::uint32_t enterSerial, const CursorShape shape)
+    {
+        enterSerial_ = enterSerial;
+        apply(shape);
+    }
+
+    void onLeave() noexcept
+    {
+        enterSerial_.reset();
+    }
+
+    /** Does nothing if the shape is already set or the pointer is outside the app surfaces */
+    void setShape(const CursorShape shape)
+    {
+        if ( (shape == currentShape_) || !enterSerial_.has_value() )
+            return;
+        apply(shape);
+    }
+
+    void dispose() noexcept
+    {
+        shapeDevice_.reset();
+        surface_.reset();
+        surfaceShape_.reset();
+        theme_ = nullptr;
+
+        shapeManager_ = nullptr;
+        pointer_ = nullptr;
+        enterSerial_.reset();
+    }
+
+private:
+    static wp_cursor_shape_device_v1_shape toServerSideShape(const CursorShape shape) noexcept
+    {
+        switch (shape)
+        {
+            case CursorShape::Default:  return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_DEFAULT;
+            case CursorShape::Grab:     return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_GRAB;
+            case CursorShape::Grabbing: return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_GRABBING;
+            case CursorShape::ZoomIn:   return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_ZOOM_IN;
+            case CursorShape::ZoomOut:  return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_ZOOM_OUT;
+            case CursorShape::COUNT:    break;
+        }
+        return WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_DEFAULT;
+    }
+
+    void apply(const CursorShape shape)
+    {
+        currentShape_ = shape;
+
+        if (!enterSerial_.has_value())
+            return;
+
+        if (shapeDevice_.hasResource())
+        {
+            MY_LOG_WLCALL_VALUELESS(wp_cursor_shape_device_v1_set_shape(*shapeDevice_, *enterSerial_, toServerSideShape(shape)));
+            return;
+        }
+
+        if ( (pointer_ == nullptr) || (theme_ == nullptr) )
+            return;
+
+        const auto& image = theme_->getImage(shape);
+
+        // The surface keeps the image until the shape changes
+        if (surfaceShape_ != shape)
+        {
+            MY_LOG_WLCALL_VALUELESS(wl_surface_attach(*surface_, image.buffer, 0, 0));
+            MY_LOG_WLCALL_VALUELESS(wl_surface_damage_buffer(*surface_, 0, 0, image.width, image.height));
+            MY_LOG_WLCALL_VALUELESS(wl_surface_commit(*surface_));
+            surfaceShape_ = shape;
+        }
+
+        MY_LOG_WLCALL_VALUELESS(wl_pointer_set_cursor(pointer_, *enterSerial_, *surface_, image.hotspotX, image.hotspotY));
+    }
+
+private:
+    // Server side cursors
+    wp_cursor_shape_manager_v1* shapeManager_ = nullptr;
+    WLResourceWrapper<wp_cursor_shape_device_v1*> shapeDevice_;
+
+    // Client side cursors ; the theme owns the buffers
+    const CursorTheme* theme_ = nullptr;
+    WLResourceWrapper<wl_surface*> surface_;
+    // The shape whose image the surface has been committed with last
+    std::optional<CursorShape> surfaceShape_;
+
+    wl_pointer* pointer_ = nullptr;
+    // Empty if the pointer is outside the app surfaces
+    std::optional<std::uint32_t> enterSerial_;
+    CursorShape currentShape_ = CursorShape::Default;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_POINTER_CURSOR_H
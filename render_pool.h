@@ -0,0 +1,166 @@
+#ifndef WAYLAND_INPUT_WINDOW_RENDER_POOL_H
+#define WAYLAND_INPUT_WINDOW_RENDER_POOL_H
+
+#include "utilities.h"          // getEnvAsUnsigned, MY_LOG_*
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex, std::unique_lock
+#include <condition_variable>   // std::condition_variable
+#include <atomic>               // std::atomic
+#include <functional>           // std::function
+#include <vector>               // std::vector
+#include <algorithm>            // std::min
+#include <cstddef>              // std::size_t
+#include <cstdint>              // std::uint64_t
+#include <sys/types.h>          // pid_t
+#include <unistd.h>             // gettid
+
+
+/**
+ * A fixed set of threads executing the batches of independent jobs, shared by all the windows.
+ * The thread submitting a batch executes the jobs too and returns once the whole batch is done, so the callers
+ *   never deal with synchronization: everything the jobs write is visible to them afterwards.
+ * The jobs are claimed one by one via an atomic counter, so the uneven ones balance out by themselves.
+ */
+class RenderWorkerPool
+{
+public:
+    static constexpr std::size_t MAX_WORKERS = 16;
+
+    /** $WAYLAND_INPUT_WINDOW_RENDER_WORKERS or all the hardware threads except the calling one */
+    [[nodiscard]] static std::size_t getDefaultWorkersCount() noexcept
+    {
+        if (const auto workers = getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_RENDER_WORKERS"); workers.has_value())
+            return std::min<std::size_t>(*workers, MAX_WORKERS);
+
+        const auto hardwareThreads = std::thread::hardware_concurrency();
+        return (hardwareThreads <= 1) ? 0 : std::min<std::size_t>(hardwareThreads - 1, MAX_WORKERS);
+    }
+
+public: // ctors/dtor
+    /** 0 workers means the jobs are executed by the submitting thread only */
+    explicit RenderWorkerPool(const std::size_t workersCount)
+    {
+        MY_LOG_INFO("RenderWorkerPool: starting ", workersCount, " worker(s)...");
+
+        workers_.reserve(workersCount);
+        for (std::size_t i = 0; i < workersCount; ++i)
+            workers_.emplace_back([this] { workerLoop(); });
+
+        // So the thread ids are known right away
+        std::unique_lock lock{ mutex_ };
+        batchFinished_.wait(lock, [this] { return (workerThreadIds_.size() == workers_.size()); });
+    }
+
+    RenderWorkerPool(const RenderWorkerPool&) = delete;
+    RenderWorkerPool(RenderWorkerPool&&) = delete;
+
+    ~RenderWorkerPool() noexcept
+    {
+        {
+            const std::unique_lock lock{ mutex_ };
+            isStopping_ = true;
+        }
+        batchStarted_.notify_all();
+
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+public: // assignments
+    RenderWorkerPool& operator=(const RenderWorkerPool&) = delete;
+    RenderWorkerPool& operator=(RenderWorkerPool&&) = delete;
+
+public: // getters
+    [[nodiscard]] std::size_t getWorkersCount() const noexcept { return workers_.size(); }
+    /** E.g. for the per-thread performance counters */
+    [[nodiscard]] const std::vector<pid_t>& getWorkerThreadIds() const noexcept { return workerThreadIds_; }
+
+public:
+    /**
+     * Executes job(0), ..., job(jobsCount - 1) and waits until all of them are done.
+     * The jobs must not throw. Must not be called from the jobs themselves.
+     */
+    void parallelFor(const std::size_t jobsCount, const std::function<void(std::size_t)>& job)
+    {
+        if (jobsCount == 0)
+            return;
+
+        // Waking the workers up costs more than a single job
+        if ( workers_.empty() || (jobsCount == 1) )
+        {
+            for (std::size_t i = 0; i < jobsCount; ++i)
+                job(i);
+            return;
+        }
+
+        {
+            const std::unique_lock lock{ mutex_ };
+            job_ = &job;
+            jobsCount_ = jobsCount;
+            nextJobIdx_.store(0, std::memory_order_relaxed);
+            busyWorkers_ = workers_.size();
+            ++batchGeneration_;
+        }
+        batchStarted_.notify_all();
+
+        runJobs(job, jobsCount);
+
+        std::unique_lock lock{ mutex_ };
+        batchFinished_.wait(lock, [this] { return (busyWorkers_ == 0); });
+        job_ = nullptr;
+    }
+
+private:
+    void runJobs(const std::function<void(std::size_t)>& job, const std::size_t jobsCount) noexcept
+    {
+        for (auto i = nextJobIdx_.fetch_add(1, std::memory_order_relaxed); i < jobsCount; i = nextJobIdx_.fetch_add(1, std::memory_order_relaxed))
+            job(i);
+    }
+
+    void workerLoop() noexcept
+    {
+        std::uint64_t seenGeneration = 0;
+
+        std::unique_lock lock{ mutex_ };
+        workerThreadIds_.push_back(gettid());
+        batchFinished_.notify_one();
+
+        while (true)
+        {
+            batchStarted_.wait(lock, [this, seenGeneration] { return ( isStopping_ || (batchGeneration_ != seenGeneration) ); });
+            if (isStopping_)
+                return;
+            seenGeneration = batchGeneration_;
+
+            const auto* const job = job_;
+            const auto jobsCount = jobsCount_;
+
+            lock.unlock();
+            runJobs(*job, jobsCount);
+            lock.lock();
+
+            if (--busyWorkers_ == 0)
+                batchFinished_.notify_one();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    // Filled by the workers once they've started
+    std::vector<pid_t> workerThreadIds_;
+
+    std::mutex mutex_;
+    std::condition_variable batchStarted_;
+    std::condition_variable batchFinished_;
+
+    // The current batch ; guarded by mutex_ except for nextJobIdx_
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::size_t jobsCount_ = 0;
+    std::atomic<std::size_t> nextJobIdx_{ 0 };
+    std::size_t busyWorkers_ = 0;
+    std::uint64_t batchGeneration_ = 0;
+    bool isStopping_ = false;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_RENDER_POOL_H
@@ -0,0 +1,328 @@
+#ifndef WAYLAND_INPUT_WINDOW_STALL_WATCHDOG_H
+#define WAYLAND_INPUT_WINDOW_STALL_WATCHDOG_H
+
+#include "utilities.h"          // MY_LOG_*, FlightRecorder
+#include "latency_stats.h"      // LatencyMeter
+#include <array>                // std::array
+#include <atomic>               // std::atomic
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex, std::unique_lock
+#include <condition_variable>   // std::condition_variable
+#include <chrono>               // std::chrono::*
+#include <optional>             // std::optional
+#include <algorithm>            // std::min
+#include <cstddef>              // std::size_t
+#include <cstdint>              // std::uint64_t
+#include <cstdlib>              // std::free
+#include <cerrno>               // errno
+#include <system_error>         // std::error_code, std::system_category
+#include <ctime>                // clock_gettime, CLOCK_MONOTONIC
+#include <csignal>              // sigaction, SIGRTMIN
+#include <pthread.h>            // pthread_t, pthread_self, pthread_kill, pthread_equal
+#include <execinfo.h>           // backtrace, backtrace_symbols
+
+
+/**
+ * Detects the stalls of the main thread: it marks the stages it goes through (the event loop stages, the listener
+ *   callbacks) via watch(), and a separate thread checks that no stage runs longer than the threshold.
+ * A stall is reported once: the stage, the current (innermost) one, e.g. a listener, and a stack sample taken by
+ *   signaling the stalled thread go to the log and to the flight recorder ; its total duration is added to the
+ *   "stalls" metric once it's over.
+ * The time spent waiting for the events (see EventLoop::setWaitObserver) doesn't count.
+ */
+class StallWatchdog
+{
+public:
+    static constexpr unsigned long long DEFAULT_THRESHOLD_MS = 200;
+    static constexpr std::size_t MAX_DEPTH = 8;
+    static constexpr std::size_t MAX_STACK_FRAMES = 32;
+
+    /** Marks a stage from its construction to its destruction ; does nothing on the threads other than the watched one */
+    class Scope
+    {
+    public: // ctors/dtor
+        Scope(StallWatchdog* const watchdog, const char* const name) noexcept
+            : watchdog_{ ( (watchdog != nullptr) && watchdog->isWatchedThread() ) ? watchdog : nullptr }
+        {
+            if (watchdog_ != nullptr)
+                watchdog_->enter(name);
+        }
+
+        Scope(const Scope&) = delete;
+
+        ~Scope() noexcept
+        {
+            if (watchdog_ != nullptr)
+                watchdog_->leave();
+        }
+
+    public: // assignments
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StallWatchdog* const watchdog_;
+    };
+
+public: // ctors/dtor
+    StallWatchdog() noexcept = default;
+
+    StallWatchdog(const StallWatchdog&) = delete;
+
+    ~StallWatchdog() noexcept
+    {
+        stop();
+    }
+
+public: // assignments
+    StallWatchdog& operator=(const StallWatchdog&) = delete;
+
+public:
+    /** The calling thread becomes the watched one. A zero threshold leaves the watchdog disabled */
+    void start(const std::chrono::milliseconds threshold)
+    {
+        if ( (threshold.count() <= 0) || thread_.joinable() )
+            return;
+
+        MY_LOG_INFO("StallWatchdog: watching the stages longer than ", threshold.count(), " ms...");
+
+        thresholdNs_ = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count());
+        watchedThread_ = pthread_self();
+        isStarted_.store(true, std::memory_order_release);
+
+        // The first call of backtrace() may allocate (it loads libgcc), which isn't allowed in the signal handler
+        std::array<void*, MAX_STACK_FRAMES> warmUp;
+        (void)backtrace(warmUp.data(), static_cast<int>(warmUp.size()));
+
+        struct sigaction action{};
+        action.sa_handler = &onSampleSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(getSampleSignal(), &action, nullptr) != 0)
+        {
+            const std::error_code sysErr{errno, std::system_category()};
+            MY_LOG_WARN("StallWatchdog: failed to install the stack sampling handler (errno=", sysErr, " \"", sysErr.message(), "\"). The stalls will be reported without the stacks.");
+        }
+
+        thread_ = std::thread{ [this] { watchLoop(); } };
+    }
+
+    void stop() noexcept
+    {
+        if (!thread_.joinable())
+            return;
+
+        {
+            const std::unique_lock lock{ mutex_ };
+            isStopping_ = true;
+        }
+        stopRequested_.notify_one();
+        thread_.join();
+    }
+
+    /** E.g. const auto stallScope = watchdog.watch("wl_pointer::motion"); the name must be a string literal */
+    [[nodiscard]] Scope watch(const char* const name) noexcept
+    {
+        return Scope{ this, name };
+    }
+
+    /** Must be called by the watched thread right before it blocks waiting for the events */
+    void onWaitBegin() noexcept
+    {
+        if (isWatchedThread())
+            enter(nullptr);
+    }
+
+    /** The stages interrupted by the waiting are considered to (re)start right after it */
+    void onWaitEnd() noexcept
+    {
+        if (!isWatchedThread())
+            return;
+
+        leave();
+        const auto depth = depth_.load(std::memory_order_relaxed);
+        const auto now = nowNs();
+        for (std::size_t i = 0; (i < depth) && (i < MAX_DEPTH); ++i)
+            stack_[i].startedAtNs.store(now, std::memory_order_relaxed);
+        generation_.store(generation_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    struct Slot
+    {
+        // nullptr means waiting for the events
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<std::uint64_t> startedAtNs{ 0 };
+    };
+
+    struct Snapshot
+    {
+        std::uint64_t generation;
+        const char* outermost;
+        const char* innermost;
+        std::uint64_t startedAtNs;
+    };
+
+private:
+    [[nodiscard]] static std::uint64_t nowNs() noexcept
+    {
+        timespec now{};
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+
+    /** The real-time signals are never sent by the system, so the handler doesn't conflict with anything */
+    [[nodiscard]] static int getSampleSignal() noexcept { return SIGRTMIN + 1; }
+
+    [[nodiscard]] bool isWatchedThread() const noexcept
+    {
+        return ( isStarted_.load(std::memory_order_acquire) && pthread_equal(watchedThread_, pthread_self()) );
+    }
+
+    void enter(const char* const name) noexcept
+    {
+        const auto depth = depth_.load(std::memory_order_relaxed);
+        if (depth < MAX_DEPTH)
+        {
+            stack_[depth].name.store(name, std::memory_order_relaxed);
+            stack_[depth].startedAtNs.store(nowNs(), std::memory_order_relaxed);
+        }
+        depth_.store(depth + 1, std::memory_order_relaxed);
+        generation_.store(generation_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void leave() noexcept
+    {
+        depth_.store(depth_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        generation_.store(generation_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** @return false if the watched thread has changed the stages meanwhile or isn't in any stage */
+    [[nodiscard]] bool takeSnapshot(Snapshot& result) const noexcept
+    {
+        result.generation = generation_.load(std::memory_order_acquire);
+        const auto depth = std::min(depth_.load(std::memory_order_relaxed), MAX_DEPTH);
+        if (depth == 0)
+            return false;
+
+        result.outermost = stack_[0].name.load(std::memory_order_relaxed);
+        result.innermost = stack_[depth - 1].name.load(std::memory_order_relaxed);
+        result.startedAtNs = stack_[0].startedAtNs.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (generation_.load(std::memory_order_relaxed) == result.generation);
+    }
+
+    void watchLoop()
+    {
+        const auto checkPeriod = std::chrono::nanoseconds{ thresholdNs_ / 4 };
+
+        // The stall being reported: the outermost stage doesn't change until it's over
+        std::optional<Snapshot> stall;
+
+        std::unique_lock lock{ mutex_ };
+        while (!stopRequested_.wait_for(lock, checkPeriod, [this] { return isStopping_; }))
+        {
+            Snapshot snapshot{};
+            const bool isConsistent = takeSnapshot(snapshot);
+
+            if (stall.has_value())
+            {
+                if ( isConsistent && (snapshot.outermost == stall->outermost) && (snapshot.startedAtNs == stall->startedAtNs) )
+                    continue;
+
+                // It's over ; the end is known up to checkPeriod
+                const double durationMs = static_cast<double>(nowNs() - stall->startedAtNs) / 1e6;
+                MY_LOG_WARN("StallWatchdog: the stall in \"", stall->outermost, "\" is over after ~", durationMs, " ms.");
+                stalls_.record(durationMs);
+                stall.reset();
+            }
+
+            if ( !isConsistent || (snapshot.innermost == nullptr) || (nowNs() - snapshot.startedAtNs < thresholdNs_) )
+                continue;
+
+            stall = snapshot;
+            reportStall(snapshot);
+        }
+    }
+
+    void reportStall(const Snapshot& snapshot)
+    {
+        const auto durationMs = (nowNs() - snapshot.startedAtNs) / 1'000'000;
+
+        MY_LOG_WARN(
+            "StallWatchdog: the main thread has been in \"", snapshot.outermost, "\" for ", durationMs, " ms",
+            (snapshot.innermost != snapshot.outermost) ? ", currently in \"" : "",
+            (snapshot.innermost != snapshot.outermost) ? snapshot.innermost : "",
+            (snapshot.innermost != snapshot.outermost) ? "\"" : "",
+            ". The stack sample:"
+        );
+        FlightRecorder::record(FlightRecorder::Kind::ERROR, snapshot.outermost, durationMs);
+        if (snapshot.innermost != snapshot.outermost)
+            FlightRecorder::record(FlightRecorder::Kind::ERROR, snapshot.innermost, durationMs);
+
+        sampleFramesCount_.store(-1, std::memory_order_relaxed);
+        if (pthread_kill(watchedThread_, getSampleSignal()) != 0)
+            return;
+
+        // The handler takes microseconds unless the thread is blocked in the kernel with the signal masked
+        for (int i = 0; (i < 100) && (sampleFramesCount_.load(std::memory_order_acquire) < 0); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+
+        const int framesCount = sampleFramesCount_.load(std::memory_order_acquire);
+        if (framesCount <= 0)
+        {
+            MY_LOG_WARN("    <the stack sample isn't available>");
+            return;
+        }
+
+        char** const symbols = backtrace_symbols(sampleFrames_.data(), framesCount);
+        // The frames 0 and 1 are the signal handler and the signal trampoline
+        for (int i = 2; i < framesCount; ++i)
+        {
+            if (symbols != nullptr)
+            {
+                MY_LOG_WARN("    #", i - 2, ' ', symbols[i]);
+            }
+            else
+            {
+                MY_LOG_WARN("    #", i - 2, " [", sampleFrames_[i], ']');
+            }
+            FlightRecorder::record(FlightRecorder::Kind::ERROR, "stall stack frame", FlightRecorder::toArg(sampleFrames_[i]));
+        }
+        std::free(symbols);
+    }
+
+    /** Runs on the stalled thread */
+    static void onSampleSignal(int)
+    {
+        const int savedErrno = errno;
+        const int framesCount = backtrace(sampleFrames_.data(), static_cast<int>(sampleFrames_.size()));
+        sampleFramesCount_.store(framesCount, std::memory_order_release);
+        errno = savedErrno;
+    }
+
+private:
+    std::uint64_t thresholdNs_ = 0;
+    pthread_t watchedThread_{};
+    std::atomic<bool> isStarted_{ false };
+
+    // Written by the watched thread only ; generation_ changes with every enter/leave
+    std::array<Slot, MAX_DEPTH> stack_;
+    std::atomic<std::size_t> depth_{ 0 };
+    std::atomic<std::uint64_t> generation_{ 0 };
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stopRequested_;
+    bool isStopping_ = false;
+
+    // The durations of the stalls ; used by the watchdog thread only
+    LatencyMeter stalls_{ "stalls" };
+
+    // Filled by onSampleSignal ; -1 until it's done
+    static inline std::array<void*, MAX_STACK_FRAMES> sampleFrames_{};
+    static inline std::atomic<int> sampleFramesCount_{ -1 };
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_STALL_WATCHDOG_H
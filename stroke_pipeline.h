@@ -0,0 +1,436 @@
+#ifndef WAYLAND_INPUT_WINDOW_STROKE_PIPELINE_H
+#define WAYLAND_INPUT_WINDOW_STROKE_PIPELINE_H
+
+#include "utilities.h"      // floorDiv, MY_LOG_*
+#include <atomic>           // std::atomic, std::memory_order_*
+#include <memory>           // std::unique_ptr, std::make_unique
+#include <unordered_map>    // std::unordered_map
+#include <unordered_set>    // std::unordered_set
+#include <optional>         // std::optional
+#include <vector>           // std::vector
+#include <type_traits>      // std::is_trivially_copyable_v
+#include <utility>          // std::pair
+#include <algorithm>        // std::min, std::max, std::clamp
+#include <cmath>            // std::floor, std::ceil, std::cos, std::hypot
+#include <numbers>          // std::numbers::pi
+#include <cstddef>          // std::size_t, std::byte
+#include <cstdint>          // std::uint*_t, std::int*_t
+#include <stdexcept>        // std::invalid_argument
+
+
+/**
+ * A single-producer single-consumer lock-free queue of a fixed capacity.
+ * The producer and the consumer only ever write their own index, so neither of them can block the other.
+ */
+template<typename T>
+class SpscRing
+{
+    static_assert(std::is_trivially_copyable_v<T>, "The items are copied in and out of the ring");
+
+public: // ctors/dtor
+    /** @param capacity must be a power of 2 */
+    explicit SpscRing(const std::size_t capacity)
+        : items_{ std::make_unique<T[]>(capacity) }
+        , mask_{ capacity - 1 }
+    {
+        if ( (capacity == 0) || ((capacity & mask_) != 0) )
+            throw std::invalid_argument{"SpscRing: the capacity must be a power of 2"};
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+public:
+    /** The producer side. @return false if the ring is full */
+    bool tryPush(const T& item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_)
+            return false;
+
+        items_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** The consumer side. @return false if the ring is empty */
+    bool tryPop(T& item) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+
+        item = items_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::unique_ptr<T[]> items_;
+    const std::size_t mask_;
+
+    // Keeping the indices on separate cache lines, so the producer and the consumer don't invalidate each other's
+    alignas(64) std::atomic<std::size_t> head_{ 0 };
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };
+};
+
+
+/** A sample of a tablet tool, already in the content coordinates */
+struct StrokeSample
+{
+    enum class Phase : std::uint8_t
+    {
+        Begin,
+        Continue,
+        End
+    };
+
+    double x;
+    double y;
+    // [0; 1]
+    float pressure;
+    // In degrees, [-90; 90]
+    float tiltX;
+    float tiltY;
+    // The size of a surface pixel in the content coordinates, so the strokes keep their on-screen width at any zoom
+    float contentPerSurfacePixel;
+    std::uint32_t timestampMs;
+    Phase phase;
+    bool erases;
+};
+
+
+/**
+ * The strokes drawn over the content: a sparse set of tiles of the content space holding the ink coverage.
+ * Rasterizing a segment touches only the tiles intersecting its bounding box ; the tiles changed are collected, so
+ *   the viewports only have to recompose the parts showing them.
+ */
+class InkLayer
+{
+public:
+    static constexpr std::int64_t TILE_SIDE = 64;
+    // XRGB8888
+    static constexpr std::uint32_t INK_COLOR = 0xFF1E50C8;
+
+    struct Point
+    {
+        double x;
+        double y;
+        double radius;
+    };
+
+    // A rect of the content space or of a viewport, in pixels
+    struct Rect
+    {
+        std::int64_t x;
+        std::int64_t y;
+        std::int64_t width;
+        std::int64_t height;
+    };
+
+public:
+    /**
+     * Draws (or erases) a capsule from a to b whose radius changes linearly along it.
+     * The coverage only grows while drawing (and only decreases while erasing), so the overlapping segments of a
+     *   stroke don't accumulate.
+     */
+    void rasterizeSegment(const Point& a, const Point& b, const bool erases)
+    {
+        const double maxRadius = std::max(a.radius, b.radius) + 1;
+        const auto minX = static_cast<std::int64_t>(std::floor(std::min(a.x, b.x) - maxRadius));
+        const auto minY = static_cast<std::int64_t>(std::floor(std::min(a.y, b.y) - maxRadius));
+        const auto maxX = static_cast<std::int64_t>(std::ceil(std::max(a.x, b.x) + maxRadius));
+        const auto maxY = static_cast<std::int64_t>(std::ceil(std::max(a.y, b.y) + maxRadius));
+
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double lengthSquared = dx * dx + dy * dy;
+
+        for (auto tileY = floorDiv(minY, TILE_SIDE); tileY <= floorDiv(maxY, TILE_SIDE); ++tileY)
+        {
+            for (auto tileX = floorDiv(minX, TILE_SIDE); tileX <= floorDiv(maxX, TILE_SIDE); ++tileX)
+            {
+                const auto key = makeTileKey(tileX, tileY);
+                auto iter = tiles_.find(key);
+                if (iter == tiles_.end())
+                {
+                    // Nothing to erase there
+                    if (erases)
+                        continue;
+                    iter = tiles_.emplace(key, std::make_unique<Tile>()).first;
+                }
+                Tile& tile = *iter->second;
+
+                const auto x0 = std::max(minX, tileX * TILE_SIDE);
+                const auto x1 = std::min(maxX, tileX * TILE_SIDE + TILE_SIDE - 1);
+                const auto y0 = std::max(minY, tileY * TILE_SIDE);
+                const auto y1 = std::min(maxY, tileY * TILE_SIDE + TILE_SIDE - 1);
+
+                bool isTouched = false;
+                for (auto y = y0; y <= y1; ++y)
+                {
+                    std::uint8_t* const row = tile.coverage + (y - tileY * TILE_SIDE) * TILE_SIDE;
+                    const double py = static_cast<double>(y) + 0.5;
+
+                    for (auto x = x0; x <= x1; ++x)
+                    {
+                        const double px = static_cast<double>(x) + 0.5;
+
+                        // The closest point of the segment
+                        const double t = (lengthSquared > 0) ? std::clamp(((px - a.x) * dx + (py - a.y) * dy) / lengthSquared, 0.0, 1.0) : 0.0;
+                        const double distance = std::hypot(px - (a.x + t * dx), py - (a.y + t * dy));
+                        const double radius = a.radius + t * (b.radius - a.radius);
+
+                        // 1 pixel wide antialiasing
+                        const auto coverage = static_cast<std::uint8_t>(std::clamp(radius - distance + 0.5, 0.0, 1.0) * 255);
+                        if (coverage == 0)
+                            continue;
+
+                        std::uint8_t& dst = row[x - tileX * TILE_SIDE];
+                        const std::uint8_t updated = erases ? std::min(dst, static_cast<std::uint8_t>(255 - coverage)) : std::max(dst, coverage);
+                        isTouched = isTouched || (updated != dst);
+                        dst = updated;
+                    }
+                }
+
+                if (isTouched)
+                    dirtyTiles_.insert(key);
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (const auto& [key, tile] : tiles_)
+            dirtyTiles_.insert(key);
+        tiles_.clear();
+    }
+
+    /**
+     * Blends the ink over the viewport.
+     * The viewport pixel (x; y) shows the zoomed content pixel (originX + x; originY + y), which shows the content
+     *   point floor(u / sideZoom + 0.5) (the same as the rendered content tiles) ; only the pixels within
+     *   [rectX; rectX + rectWidth) x [rectY; rectY + rectHeight) are touched.
+     */
+    void composeOnto(
+        std::byte* const viewport, const std::size_t strideBytes,
+        const std::int64_t originX, const std::int64_t originY, const double sideZoom,
+        const std::int64_t rectX, const std::int64_t rectY, const std::int64_t rectWidth, const std::int64_t rectHeight
+    ) const {
+        // The coverage columns of the viewport columns of a tile
+        std::vector<std::uint8_t> srcColumns;
+
+        for (const auto& [key, tile] : tiles_)
+        {
+            const auto [tileX, tileY] = splitTileKey(key);
+
+            const auto x0 = std::max(toZoomed(tileX * TILE_SIDE, sideZoom) - originX, rectX);
+            const auto x1 = std::min(toZoomed(tileX * TILE_SIDE + TILE_SIDE, sideZoom) - originX, rectX + rectWidth);
+            const auto y0 = std::max(toZoomed(tileY * TILE_SIDE, sideZoom) - originY, rectY);
+            const auto y1 = std::min(toZoomed(tileY * TILE_SIDE + TILE_SIDE, sideZoom) - originY, rectY + rectHeight);
+            if ( (x0 >= x1) || (y0 >= y1) )
+                continue;
+
+            srcColumns.resize(static_cast<std::size_t>(x1 - x0));
+            for (auto x = x0; x < x1; ++x)
+                srcColumns[static_cast<std::size_t>(x - x0)] = static_cast<std::uint8_t>(
+                    std::clamp<std::int64_t>(toContent(originX + x, sideZoom) - tileX * TILE_SIDE, 0, TILE_SIDE - 1)
+                );
+
+            for (auto y = y0; y < y1; ++y)
+            {
+                const auto srcY = std::clamp<std::int64_t>(toContent(originY + y, sideZoom) - tileY * TILE_SIDE, 0, TILE_SIDE - 1);
+                const std::uint8_t* const srcRow = tile->coverage + srcY * TILE_SIDE;
+                auto* const dstRow = reinterpret_cast<std::uint32_t*>(viewport + static_cast<std::size_t>(y) * strideBytes) + x0;
+
+                for (std::size_t i = 0; i < srcColumns.size(); ++i)
+                {
+                    const std::uint32_t alpha = srcRow[srcColumns[i]];
+                    if (alpha != 0)
+                        dstRow[i] = blend(dstRow[i], alpha);
+                }
+            }
+        }
+    }
+
+    /**
+     * The rect of the viewport showing the content rect, the same way composeOnto maps them ; the adjacent content
+     *   rects are shown by the adjacent viewport rects, which don't overlap
+     */
+    [[nodiscard]] static Rect toViewport(const Rect& content, const std::int64_t originX, const std::int64_t originY, const double sideZoom) noexcept
+    {
+        const auto x0 = toZoomed(content.x, sideZoom) - originX;
+        const auto y0 = toZoomed(content.y, sideZoom) - originY;
+        return Rect{
+            x0,
+            y0,
+            toZoomed(content.x + content.width, sideZoom) - originX - x0,
+            toZoomed(content.y + content.height, sideZoom) - originY - y0
+        };
+    }
+
+    /** The content rects of the tiles changed (drawn, erased or cleared) since the previous call, each one once */
+    [[nodiscard]] std::vector<Rect> takeDirtyRects()
+    {
+        std::vector<Rect> result;
+        result.reserve(dirtyTiles_.size());
+        for (const auto key : dirtyTiles_)
+        {
+            const auto [tileX, tileY] = splitTileKey(key);
+            result.push_back(Rect{ tileX * TILE_SIDE, tileY * TILE_SIDE, TILE_SIDE, TILE_SIDE });
+        }
+        dirtyTiles_.clear();
+        return result;
+    }
+
+public: // getters
+    [[nodiscard]] bool isEmpty() const noexcept { return tiles_.empty(); }
+    [[nodiscard]] std::size_t getTilesCount() const noexcept { return tiles_.size(); }
+    [[nodiscard]] std::size_t getMemoryUsage() const noexcept { return tiles_.size() * sizeof(Tile); }
+    [[nodiscard]] std::size_t getDirtyTilesCount() const noexcept { return dirtyTiles_.size(); }
+
+private:
+    struct Tile
+    {
+        std::uint8_t coverage[TILE_SIDE * TILE_SIDE] = {};
+    };
+
+    static std::uint64_t makeTileKey(const std::int64_t tileX, const std::int64_t tileY) noexcept
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(tileX)) << 32) | static_cast<std::uint32_t>(tileY);
+    }
+
+    static std::pair<std::int64_t, std::int64_t> splitTileKey(const std::uint64_t key) noexcept
+    {
+        return { static_cast<std::int32_t>(key >> 32), static_cast<std::int32_t>(key & 0xFFFFFFFF) };
+    }
+
+    /** The first zoomed pixel showing the content pixel c ; the content range [c0; c1) is shown by [toZoomed(c0); toZoomed(c1)) */
+    static std::int64_t toZoomed(const std::int64_t c, const double sideZoom) noexcept
+    {
+        return static_cast<std::int64_t>(std::ceil((static_cast<double>(c) - 0.5) * sideZoom));
+    }
+
+    static std::int64_t toContent(const std::int64_t zoomed, const double sideZoom) noexcept
+    {
+        return static_cast<std::int64_t>(std::floor(static_cast<double>(zoomed) / sideZoom + 0.5));
+    }
+
+    static std::uint32_t blend(const std::uint32_t pixel, const std::uint32_t alpha) noexcept
+    {
+        std::uint32_t result = 0xFF000000;
+        for (unsigned shift = 0; shift < 24; shift += 8)
+        {
+            const std::uint32_t under = (pixel >> shift) & 0xFF;
+            const std::uint32_t over = (INK_COLOR >> shift) & 0xFF;
+            result |= ((under * (255 - alpha) + over * alpha + 127) / 255) << shift;
+        }
+        return result;
+    }
+
+private:
+    std::unordered_map<std::uint64_t, std::unique_ptr<Tile>> tiles_;
+    // The keys of the tiles changed since the previous takeDirtyRects()
+    std::unordered_set<std::uint64_t> dirtyTiles_;
+};
+
+
+/**
+ * Turns the samples of tablet tools into strokes of an InkLayer.
+ * The input path only pushes the samples into a lock-free ring ; they're smoothed and rasterized by the render path
+ *   once per frame, so a burst of samples never delays the input handling and vice versa.
+ */
+class StrokePipeline
+{
+public:
+    // ~3 seconds of the samples at 300 Hz
+    static constexpr std::size_t RING_CAPACITY = 1024;
+    // The radius of a stroke at the full pressure, in the surface pixels
+    static constexpr double MAX_RADIUS = 6;
+    // The weight of a new sample in the smoothed position and radius
+    static constexpr double SMOOTHING_FACTOR = 0.5;
+
+public: // ctors/dtor
+    StrokePipeline()
+        : samples_{ RING_CAPACITY }
+    {}
+
+public:
+    /** The input path. Drops the sample if the render path has fallen behind too much. */
+    void push(const StrokeSample& sample) noexcept
+    {
+        if (!samples_.tryPush(sample))
+            droppedSamples_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * The render path: rasterizes all the pending samples ; the tiles changed are collected by the ink
+     *   (see InkLayer::takeDirtyRects).
+     * @return the number of the samples rasterized
+     */
+    std::size_t process(InkLayer& ink)
+    {
+        std::size_t samplesCount = 0;
+        StrokeSample sample{};
+        while (samples_.tryPop(sample))
+        {
+            ++samplesCount;
+
+            const InkLayer::Point raw{ sample.x, sample.y, getRadius(sample) };
+
+            if ( (sample.phase == StrokeSample::Phase::Begin) || !last_.has_value() )
+            {
+                // A dot
+                ink.rasterizeSegment(raw, raw, sample.erases);
+                last_ = raw;
+            }
+            else
+            {
+                // Exponential smoothing removes the jitter of the sensor without noticeable lag at the high rates
+                const InkLayer::Point smoothed{
+                    last_->x + SMOOTHING_FACTOR * (raw.x - last_->x),
+                    last_->y + SMOOTHING_FACTOR * (raw.y - last_->y),
+                    last_->radius + SMOOTHING_FACTOR * (raw.radius - last_->radius)
+                };
+                ink.rasterizeSegment(*last_, smoothed, sample.erases);
+                last_ = smoothed;
+
+                // The stroke ends exactly where the tool has been lifted
+                if (sample.phase == StrokeSample::Phase::End)
+                    ink.rasterizeSegment(*last_, raw, sample.erases);
+            }
+
+            if (sample.phase == StrokeSample::Phase::End)
+                last_.reset();
+        }
+
+        if (const auto dropped = droppedSamples_.exchange(0, std::memory_order_relaxed); dropped > 0)
+            MY_LOG_WARN("StrokePipeline::process: ", dropped, " tablet sample(s) have been dropped.");
+
+        if (samplesCount > 0)
+            MY_LOG_TRACE("StrokePipeline::process: ", samplesCount, " sample(s) -> ", ink.getDirtyTilesCount(), " dirty tile(s).");
+
+        return samplesCount;
+    }
+
+private:
+    static double getRadius(const StrokeSample& sample) noexcept
+    {
+        // The more the tool is tilted, the wider its trace (like a pencil), up to twice
+        constexpr double degreesToRadians = std::numbers::pi / 180;
+        const double tilt = std::min(std::hypot(sample.tiltX, sample.tiltY), 60.0f) * degreesToRadians;
+        const double tiltFactor = 1 / std::cos(tilt);
+
+        return (0.2 + 0.8 * std::clamp(sample.pressure, 0.0f, 1.0f)) * MAX_RADIUS * tiltFactor * sample.contentPerSurfacePixel;
+    }
+
+private:
+    SpscRing<StrokeSample> samples_;
+    std::atomic<std::size_t> droppedSamples_{ 0 };
+
+    // The last point of the stroke in progress
+    std::optional<InkLayer::Point> last_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_STROKE_PIPELINE_H
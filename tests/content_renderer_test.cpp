@@ -0,0 +1,82 @@
+// Reaches every zoom kernel of renderContentTile through the zoom changes of ContentState (the keyboard steps, the
+//   restore and a pinch near a preset) and checks the kernels render the same pixels as renderContentTileGeneric.
+// Exits with a non-zero code on a failure.
+
+#include "content_state.h"      // ContentState
+#include "content_renderer.h"   // renderContentTile*, findContentTileKernel, MAIN_WINDOW_CONTENT_ID
+#include "tile_cache.h"         // TileKey, PersistentTileStore
+#include "zoom_kernels.h"       // ZoomKernel
+#include <vector>               // std::vector
+#include <utility>              // std::pair
+#include <cmath>                // std::sqrt
+#include <cstdint>              // std::uint32_t, std::int32_t
+#include <iostream>             // std::cerr, std::cout
+
+
+namespace
+{
+    int failuresCount = 0;
+
+    void check(const bool condition, const char* const what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << '\n';
+            ++failuresCount;
+        }
+    }
+
+    ContentState repeat(ContentState state, const int times, ContentState (ContentState::*step)(double) const)
+    {
+        for (int i = 0; i < times; ++i)
+            state = (state.*step)(ContentState::ZOOM_FACTOR);
+        return state;
+    }
+
+    /** state must be rendered via expected (nullptr for the generic renderer) with the same pixels as the generic one */
+    void checkRenderedVia(const ContentState& state, const ContentTileRenderer expected, const char* const what)
+    {
+        const double sideZoom = std::sqrt(state.viewportZoom);
+        check(findContentTileKernel(sideZoom) == expected, what);
+
+        std::vector<std::uint32_t> viaKernel(PersistentTileStore::TILE_PIXELS);
+        std::vector<std::uint32_t> viaGeneric(PersistentTileStore::TILE_PIXELS);
+        const std::pair<std::int32_t, std::int32_t> tiles[] = { { 0, 0 }, { -1, -3 }, { 5, 2 }, { -7, 11 } };
+        for (const auto& [tileX, tileY] : tiles)
+        {
+            const TileKey key{ MAIN_WINDOW_CONTENT_ID, TileKey::makeZoomBits(state.viewportZoom), tileX, tileY };
+            renderContentTile(key, sideZoom, viaKernel.data());
+            renderContentTileGeneric(key, sideZoom, viaGeneric.data());
+            check(viaKernel == viaGeneric, what);
+        }
+    }
+} // namespace
+
+
+int main()
+{
+    const ContentState initial;
+    checkRenderedVia(initial, &renderContentTileVia< ZoomKernel<1, 1> >, "100%: ZoomKernel<1, 1>");
+
+    checkRenderedVia(repeat(initial, 4, &ContentState::zoomedIn), &renderContentTileVia< ZoomKernel<2, 1> >, "4 steps in: ZoomKernel<2, 1>");
+    checkRenderedVia(repeat(initial, 8, &ContentState::zoomedIn), &renderContentTileVia< ZoomKernel<4, 1> >, "8 steps in: ZoomKernel<4, 1>");
+    checkRenderedVia(repeat(initial, 4, &ContentState::zoomedOut), &renderContentTileVia< ZoomKernel<1, 2> >, "4 steps out: ZoomKernel<1, 2>");
+
+    // Back and forth accumulates the rounding errors
+    const auto zoomedBack = repeat(repeat(initial, 7, &ContentState::zoomedIn), 3, &ContentState::zoomedOut);
+    checkRenderedVia(zoomedBack, &renderContentTileVia< ZoomKernel<2, 1> >, "7 steps in, 3 out: ZoomKernel<2, 1>");
+    checkRenderedVia(zoomedBack.restoredZoom(), &renderContentTileVia< ZoomKernel<1, 1> >, "restored: ZoomKernel<1, 1>");
+
+    // The pinch scale is the side one, so its square is applied to the zoom
+    checkRenderedVia(initial.zoomedAround(400, 300, 2.02 * 2.02), &renderContentTileVia< ZoomKernel<2, 1> >, "pinch near 200%: ZoomKernel<2, 1>");
+    checkRenderedVia(initial.zoomedAround(400, 300, 1.5 * 1.5), nullptr, "pinch to 150%: the generic renderer");
+    checkRenderedVia(repeat(initial, 1, &ContentState::zoomedIn), nullptr, "1 step in: the generic renderer");
+
+    if (failuresCount != 0)
+    {
+        std::cerr << failuresCount << " check(s) failed.\n";
+        return 1;
+    }
+    std::cout << "All the checks passed.\n";
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Feeds TouchContactTable and TouchGestureRecognizer the contacts of a few touch sequences and checks the slots they
+//   take and the pans, pinches and rotations recognized from them.
+// Exits with a non-zero code on a failure.
+
+#include "touch_gestures.h"     // TouchContactTable, TouchGestureRecognizer, TouchGestureStep
+#include <optional>             // std::optional
+#include <cmath>                // std::abs
+#include <numbers>              // std::numbers::pi
+#include <cstddef>              // std::size_t
+#include <cstdint>              // std::int32_t, std::uint64_t
+#include <iostream>             // std::cerr, std::cout
+
+
+namespace
+{
+    int failuresCount = 0;
+
+    void check(const bool condition, const char* const what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << '\n';
+            ++failuresCount;
+        }
+    }
+
+    bool isNear(const double actual, const double expected)
+    {
+        return (std::abs(actual - expected) < 1e-9);
+    }
+
+    /** step must be a gesture of contactsCount contacts with the given movement */
+    void checkStep(
+        const std::optional<TouchGestureStep>& step,
+        const std::size_t contactsCount,
+        const double panX, const double panY, const double scale, const double rotation,
+        const char* const what
+    ) {
+        check(step.has_value(), what);
+        if (!step.has_value())
+            return;
+
+        check(step->contactsCount == contactsCount, what);
+        check(isNear(step->panX, panX) && isNear(step->panY, panY), what);
+        check(isNear(step->scale, scale), what);
+        check(isNear(step->rotation, rotation), what);
+    }
+
+    void testContactSlots()
+    {
+        TouchContactTable contacts;
+
+        check(contacts.onDown(1, 10, 10) && contacts.onDown(2, 20, 20) && contacts.onDown(3, 30, 30), "3 contacts down");
+        check(!contacts.onDown(2, 25, 25), "the id of an active contact is rejected");
+        check(contacts.getActiveCount() == 3, "3 contacts are active");
+
+        const std::uint64_t generationBeforeUp = contacts.getLayoutGeneration();
+        contacts.onUp(1);
+        check(contacts.getActiveCount() == 2, "2 contacts are active after an up");
+        check(!contacts.getSlots()[0].isActive, "the up frees the slot of the contact");
+        check(contacts.getLayoutGeneration() != generationBeforeUp, "the up changes the layout generation");
+
+        check(contacts.onDown(4, 40, 40), "a contact down after the up");
+        check(contacts.getSlots()[0].isActive && (contacts.getSlots()[0].id == 4), "the new contact reuses the freed slot");
+        check(contacts.getSlots()[1].id == 2 && contacts.getSlots()[2].id == 3, "the other contacts keep their slots");
+
+        const std::uint64_t generationBeforeMotion = contacts.getLayoutGeneration();
+        contacts.onMotion(4, 45, 46);
+        check(isNear(contacts.getSlots()[0].x, 45) && isNear(contacts.getSlots()[0].y, 46), "a motion moves the contact");
+        check(contacts.getLayoutGeneration() == generationBeforeMotion, "a motion keeps the layout generation");
+
+        for (std::int32_t id = 5; contacts.getActiveCount() < TouchContactTable::MAX_CONTACTS; ++id)
+            check(contacts.onDown(id, 0, 0), "the contacts down until the table is full");
+        check(!contacts.onDown(100, 0, 0), "a contact down is ignored when all the slots are occupied");
+
+        contacts.onUp(3);
+        check(contacts.onDown(100, 0, 0) && (contacts.getSlots()[2].id == 100), "a full table reuses the freed slot");
+
+        contacts.clear();
+        check(contacts.getActiveCount() == 0, "no contacts are active after a clear");
+        check(contacts.onDown(1, 0, 0) && (contacts.getSlots()[0].id == 1), "a cleared table starts from the first slot");
+    }
+
+    void testPan()
+    {
+        TouchContactTable contacts;
+        TouchGestureRecognizer recognizer;
+
+        (void)contacts.onDown(1, 100, 100);
+        check(!recognizer.onFrame(contacts).has_value(), "pan: the first frame only starts the gesture");
+
+        contacts.onMotion(1, 110, 95);
+        checkStep(recognizer.onFrame(contacts), 1, 10, -5, 1, 0, "pan: a single contact pans");
+
+        check(!recognizer.onFrame(contacts).has_value(), "pan: a frame without motions is nothing to apply");
+
+        // Both contacts move by the same offset, so the distance and the angle between them are the same
+        (void)contacts.onDown(2, 200, 100);
+        check(!recognizer.onFrame(contacts).has_value(), "pan: a new contact restarts the gesture without a jump");
+        contacts.onMotion(1, 120, 115);
+        contacts.onMotion(2, 210, 120);
+        checkStep(recognizer.onFrame(contacts), 2, 10, 20, 1, 0, "pan: 2 contacts pan together");
+
+        contacts.onUp(1);
+        contacts.onUp(2);
+        check(!recognizer.onFrame(contacts).has_value(), "pan: no contacts is nothing to apply");
+    }
+
+    void testPinch()
+    {
+        TouchContactTable contacts;
+        TouchGestureRecognizer recognizer;
+
+        (void)contacts.onDown(1, 350, 300);
+        (void)contacts.onDown(2, 450, 300);
+        (void)recognizer.onFrame(contacts);
+
+        // Apart from the center: the distance doubles, the center and the angle stay
+        contacts.onMotion(1, 300, 300);
+        contacts.onMotion(2, 500, 300);
+        checkStep(recognizer.onFrame(contacts), 2, 0, 0, 2, 0, "pinch: the contacts moving apart zoom in");
+
+        contacts.onMotion(1, 375, 300);
+        contacts.onMotion(2, 425, 300);
+        checkStep(recognizer.onFrame(contacts), 2, 0, 0, 0.25, 0, "pinch: the contacts moving together zoom out");
+
+        // The fingers at the same point define no scale, so only the center moves
+        contacts.onMotion(1, 400, 300);
+        contacts.onMotion(2, 400, 300);
+        (void)recognizer.onFrame(contacts);
+        contacts.onMotion(1, 410, 300);
+        contacts.onMotion(2, 410, 300);
+        checkStep(recognizer.onFrame(contacts), 2, 10, 0, 1, 0, "pinch: the contacts at the same point only pan");
+    }
+
+    void testRotation()
+    {
+        TouchContactTable contacts;
+        TouchGestureRecognizer recognizer;
+
+        (void)contacts.onDown(1, 300, 300);
+        (void)contacts.onDown(2, 500, 300);
+        (void)recognizer.onFrame(contacts);
+
+        // A quarter turn around the center ; the y axis points down, so it's clockwise
+        contacts.onMotion(1, 400, 200);
+        contacts.onMotion(2, 400, 400);
+        checkStep(recognizer.onFrame(contacts), 2, 0, 0, 1, std::numbers::pi / 2, "rotation: a clockwise quarter turn");
+
+        // Across the discontinuity of atan2 the change is the shortest turn rather than almost a full one
+        contacts.onMotion(1, 500, 300);
+        contacts.onMotion(2, 300, 300);
+        checkStep(recognizer.onFrame(contacts), 2, 0, 0, 1, std::numbers::pi / 2, "rotation: the next quarter turn");
+        contacts.onMotion(1, 500, 301);
+        contacts.onMotion(2, 300, 299);
+        const auto step = recognizer.onFrame(contacts);
+        check(step.has_value() && (std::abs(step->rotation) < 0.1), "rotation: crossing the angle of pi is a small turn");
+
+        // A third contact doesn't drive the gesture, but changes the layout
+        (void)contacts.onDown(3, 0, 0);
+        check(!recognizer.onFrame(contacts).has_value(), "rotation: a third contact restarts the gesture");
+        contacts.onMotion(3, 50, 50);
+        check(!recognizer.onFrame(contacts).has_value(), "rotation: the third contact doesn't drive the gesture");
+    }
+} // namespace
+
+
+int main()
+{
+    testContactSlots();
+    testPan();
+    testPinch();
+    testRotation();
+
+    if (failuresCount != 0)
+    {
+        std::cerr << failuresCount << " check(s) failed.\n";
+        return 1;
+    }
+    std::cout << "All the checks passed.\n";
+    return 0;
+}
@@ -0,0 +1,420 @@
+#ifndef WAYLAND_INPUT_WINDOW_THREAD_SCHEDULING_H
+#define WAYLAND_INPUT_WINDOW_THREAD_SCHEDULING_H
+
+#include "utilities.h"          // MY_LOG_*, getEnvAsUnsigned
+#include <vector>               // std::vector
+#include <string>               // std::string, std::to_string
+#include <string_view>          // std::string_view
+#include <algorithm>            // std::find, std::sort, std::unique, std::clamp
+#include <cstdint>              // std::uint64_t, std::int32_t, std::uint32_t
+#include <cstdlib>              // std::getenv, std::strtol, std::strtoull
+#include <cstdio>               // std::FILE, std::fopen, std::fgets, std::fscanf, std::fclose
+#include <cerrno>               // errno
+#include <ctime>                // clock_gettime, CLOCK_MONOTONIC
+#include <system_error>         // std::error_code, std::system_category
+#include <csignal>              // sigaction, SIGXCPU
+#include <sched.h>              // sched_setscheduler, sched_setaffinity, cpu_set_t, CPU_*, SCHED_*
+#include <sys/resource.h>       // setpriority, setrlimit, PRIO_PROCESS, RLIMIT_RTTIME
+#include <sys/types.h>          // pid_t
+#include <unistd.h>             // gettid
+#ifdef WAYLAND_INPUT_WINDOW_HAS_SD_BUS
+#   include <systemd/sd-bus.h>  // sd_bus_*
+#endif // def WAYLAND_INPUT_WINDOW_HAS_SD_BUS
+
+
+/**
+ * Raises the priority of the main (event loop / input) thread and of the render workers, pins the workers to a CPU
+ *   set, and reports how long the threads have been runnable but not running (waiting for a CPU).
+ * The realtime policies are set directly if the process is allowed to (CAP_SYS_NICE or RLIMIT_RTPRIO), via rtkit
+ *   otherwise (if built with sd-bus) ; if both fail, the threads get a lower nice value (the same way).
+ * The workers get a lower realtime priority than the main thread, so the input is never delayed by the rendering.
+ * Configured by the environment:
+ *   $WAYLAND_INPUT_WINDOW_SCHED_POLICY    fifo, rr or nice ; nothing is changed if it's unset
+ *   $WAYLAND_INPUT_WINDOW_SCHED_PRIORITY  the realtime priority of the main thread, DEFAULT_REALTIME_PRIORITY by default
+ *   $WAYLAND_INPUT_WINDOW_SCHED_NICE      the nice value of the threads (if not realtime), DEFAULT_NICE by default
+ *   $WAYLAND_INPUT_WINDOW_RENDER_CPUS     the CPUs of the render workers, e.g. "2-5,8" ; only one logical CPU of
+ *                                         each physical core is used unless $WAYLAND_INPUT_WINDOW_RENDER_CPUS_SMT=1
+ */
+class ThreadScheduling
+{
+public:
+    enum class Policy
+    {
+        UNCHANGED,
+        FIFO,
+        RR,
+        NICE
+    };
+
+    static constexpr int DEFAULT_REALTIME_PRIORITY = 10;
+    static constexpr int DEFAULT_NICE = -10;
+    static constexpr std::uint64_t REPORT_PERIOD_FRAMES = 600;
+
+public: // ctors/dtor
+    ThreadScheduling() noexcept = default;
+
+    ThreadScheduling(const ThreadScheduling&) = delete;
+
+    ~ThreadScheduling() noexcept
+    {
+        report();
+    }
+
+public: // assignments
+    ThreadScheduling& operator=(const ThreadScheduling&) = delete;
+
+public:
+    void configureFromEnv()
+    {
+        const std::string_view policy = (std::getenv("WAYLAND_INPUT_WINDOW_SCHED_POLICY") != nullptr) ? std::getenv("WAYLAND_INPUT_WINDOW_SCHED_POLICY") : "";
+        if (policy == "fifo")
+            policy_ = Policy::FIFO;
+        else if (policy == "rr")
+            policy_ = Policy::RR;
+        else if (policy == "nice")
+            policy_ = Policy::NICE;
+        else if (!policy.empty())
+            MY_LOG_WARN("ThreadScheduling: unknown $WAYLAND_INPUT_WINDOW_SCHED_POLICY=\"", policy, "\" (fifo, rr or nice are expected), ignored.");
+
+        // The workers get one less, so at least 2
+        realtimePriority_ = static_cast<int>(std::clamp<unsigned long long>(
+            getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_SCHED_PRIORITY").value_or(DEFAULT_REALTIME_PRIORITY),
+            2,
+            static_cast<unsigned long long>(sched_get_priority_max(SCHED_FIFO))
+        ));
+
+        if (const char* const nice = std::getenv("WAYLAND_INPUT_WINDOW_SCHED_NICE"); nice != nullptr)
+            niceValue_ = std::clamp(static_cast<int>(std::strtol(nice, nullptr, 10)), -20, 19);
+
+        if (const char* const cpus = std::getenv("WAYLAND_INPUT_WINDOW_RENDER_CPUS"); cpus != nullptr)
+        {
+            renderCpus_ = parseCpuList(cpus);
+            if (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_RENDER_CPUS_SMT").value_or(0) == 0)
+                renderCpus_ = withoutSmtSiblings(renderCpus_);
+            if (renderCpus_.empty())
+                MY_LOG_WARN("ThreadScheduling: $WAYLAND_INPUT_WINDOW_RENDER_CPUS=\"", cpus, "\" contains no CPUs, the render workers aren't pinned.");
+        }
+    }
+
+    /** Must be called by the main thread */
+    void applyToMainThread()
+    {
+        const auto tid = gettid();
+        applyPolicy(tid, "main", realtimePriority_);
+        threads_.push_back(WatchedThread{ tid, "main", readSchedStat(tid) });
+        reportStartedAtNs_ = nowNs();
+    }
+
+    void applyToRenderWorkers(const std::vector<pid_t>& workerThreadIds)
+    {
+        for (const auto tid : workerThreadIds)
+        {
+            applyPolicy(tid, "render worker", realtimePriority_ - 1);
+            if (!renderCpus_.empty())
+                pinThread(tid, renderCpus_);
+            threads_.push_back(WatchedThread{ tid, "render worker", readSchedStat(tid) });
+        }
+        reportStartedAtNs_ = nowNs();
+    }
+
+    void onFrameEnd() noexcept
+    {
+        if (threads_.empty())
+            return;
+
+        if (++framesCount_ >= REPORT_PERIOD_FRAMES)
+        {
+            report();
+            for (auto& thread : threads_)
+                thread.atReportStart = readSchedStat(thread.tid);
+            reportStartedAtNs_ = nowNs();
+            framesCount_ = 0;
+        }
+    }
+
+    /** Logs the time each kind of the threads has been runnable but waiting for a CPU */
+    void report() const noexcept
+    {
+        if ( threads_.empty() || (framesCount_ == 0) )
+            return;
+
+        const double elapsedMs = static_cast<double>(nowNs() - reportStartedAtNs_) / 1e6;
+        MY_LOG_INFO("ThreadScheduling: the time runnable but not running over ", framesCount_, " frames (", elapsedMs, " ms):");
+
+        for (const char* const kind : { "main", "render worker" })
+        {
+            SchedStat total{};
+            std::size_t threadsCount = 0;
+            for (const auto& thread : threads_)
+            {
+                if (std::string_view{ thread.kind } != kind)
+                    continue;
+
+                // E.g. the thread has exited
+                const auto current = readSchedStat(thread.tid);
+                if (current.timeslices < thread.atReportStart.timeslices)
+                    continue;
+
+                total.runNs += current.runNs - thread.atReportStart.runNs;
+                total.waitNs += current.waitNs - thread.atReportStart.waitNs;
+                total.timeslices += current.timeslices - thread.atReportStart.timeslices;
+                ++threadsCount;
+            }
+            if (threadsCount == 0)
+                continue;
+
+            const double waitMs = static_cast<double>(total.waitNs) / 1e6;
+            MY_LOG_INFO(
+                "    ", kind, " (", threadsCount, " thread(s)): ",
+                "waited ", waitMs, " ms (", 100.0 * waitMs / elapsedMs / static_cast<double>(threadsCount), "% of the time), ",
+                waitMs / static_cast<double>(framesCount_), " ms per frame, ",
+                (total.timeslices == 0) ? 0.0 : static_cast<double>(total.waitNs) / 1e3 / static_cast<double>(total.timeslices), " us per timeslice ; ",
+                "ran ", static_cast<double>(total.runNs) / 1e6, " ms"
+            );
+        }
+    }
+
+public: // getters
+    [[nodiscard]] Policy getPolicy() const noexcept { return policy_; }
+    [[nodiscard]] const std::vector<int>& getRenderCpus() const noexcept { return renderCpus_; }
+
+public:
+    /** E.g. "0-3,8" -> {0, 1, 2, 3, 8} ; the malformed parts are skipped */
+    [[nodiscard]] static std::vector<int> parseCpuList(const std::string_view list)
+    {
+        std::vector<int> result;
+        std::size_t pos = 0;
+        while (pos < list.size())
+        {
+            auto end = list.find(',', pos);
+            if (end == std::string_view::npos)
+                end = list.size();
+
+            const std::string range{ list.substr(pos, end - pos) };
+            char* afterFirst = nullptr;
+            const long first = std::strtol(range.c_str(), &afterFirst, 10);
+            long last = first;
+            if ( (afterFirst != nullptr) && (*afterFirst == '-') )
+                last = std::strtol(afterFirst + 1, nullptr, 10);
+
+            if ( (afterFirst != range.c_str()) && (first >= 0) && (last >= first) && (last < CPU_SETSIZE) )
+            {
+                for (long cpu = first; cpu <= last; ++cpu)
+                    result.push_back(static_cast<int>(cpu));
+            }
+            pos = end + 1;
+        }
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    /** Keeps only the first logical CPU of each physical core (by the thread_siblings_list of the CPUs) */
+    [[nodiscard]] static std::vector<int> withoutSmtSiblings(const std::vector<int>& cpus)
+    {
+        std::vector<int> result;
+        std::vector<int> excluded;
+        for (const int cpu : cpus)
+        {
+            if (std::find(excluded.begin(), excluded.end(), cpu) != excluded.end())
+                continue;
+            result.push_back(cpu);
+
+            const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list";
+            std::FILE* const file = std::fopen(path.c_str(), "re");
+            if (file == nullptr)
+                continue;
+            char siblings[256] = {};
+            if (std::fgets(siblings, sizeof(siblings), file) != nullptr)
+            {
+                for (const int sibling : parseCpuList(siblings))
+                {
+                    if (sibling != cpu)
+                        excluded.push_back(sibling);
+                }
+            }
+            std::fclose(file);
+        }
+        return result;
+    }
+
+private:
+    struct SchedStat
+    {
+        // On a CPU
+        std::uint64_t runNs;
+        // Runnable, but waiting on a runqueue
+        std::uint64_t waitNs;
+        std::uint64_t timeslices;
+    };
+
+    struct WatchedThread
+    {
+        pid_t tid;
+        const char* kind;
+        SchedStat atReportStart;
+    };
+
+private:
+    [[nodiscard]] static std::uint64_t nowNs() noexcept
+    {
+        timespec now{};
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+
+    /** The zeros if the thread doesn't exist or the kernel doesn't provide it (CONFIG_SCHED_INFO) */
+    [[nodiscard]] static SchedStat readSchedStat(const pid_t tid) noexcept
+    {
+        SchedStat result{};
+
+        const auto path = "/proc/self/task/" + std::to_string(tid) + "/schedstat";
+        std::FILE* const file = std::fopen(path.c_str(), "re");
+        if (file == nullptr)
+            return result;
+        unsigned long long runNs = 0, waitNs = 0, timeslices = 0;
+        if (std::fscanf(file, "%llu %llu %llu", &runNs, &waitNs, &timeslices) == 3)
+            result = SchedStat{ runNs, waitNs, timeslices };
+        std::fclose(file);
+
+        return result;
+    }
+
+    void applyPolicy(const pid_t tid, const char* const kind, const int realtimePriority)
+    {
+        if (policy_ == Policy::UNCHANGED)
+            return;
+
+        if ( (policy_ == Policy::FIFO) || (policy_ == Policy::RR) )
+        {
+            const int policy = (policy_ == Policy::FIFO) ? SCHED_FIFO : SCHED_RR;
+            sched_param param{};
+            param.sched_priority = realtimePriority;
+            // The children (e.g. the helpers of the data transfers) shouldn't inherit it
+            if (sched_setscheduler(tid, policy | SCHED_RESET_ON_FORK, &param) == 0)
+            {
+                MY_LOG_INFO("ThreadScheduling: the ", kind, " thread ", tid, " is ", (policy == SCHED_FIFO) ? "SCHED_FIFO" : "SCHED_RR", " with priority ", realtimePriority, '.');
+                return;
+            }
+            const std::error_code sysErr{errno, std::system_category()};
+            MY_LOG_INFO("ThreadScheduling: sched_setscheduler(", tid, ") failed (errno=", sysErr, " \"", sysErr.message(), "\"), trying rtkit...");
+
+            if (requestViaRtkit(tid, true, realtimePriority))
+            {
+                MY_LOG_INFO("ThreadScheduling: the ", kind, " thread ", tid, " is realtime with priority ", realtimePriority, " via rtkit.");
+                return;
+            }
+        }
+
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), niceValue_) == 0)
+        {
+            MY_LOG_INFO("ThreadScheduling: the ", kind, " thread ", tid, " has nice ", niceValue_, '.');
+            return;
+        }
+        const std::error_code sysErr{errno, std::system_category()};
+
+        if (requestViaRtkit(tid, false, niceValue_))
+        {
+            MY_LOG_INFO("ThreadScheduling: the ", kind, " thread ", tid, " has nice ", niceValue_, " via rtkit.");
+            return;
+        }
+        MY_LOG_WARN("ThreadScheduling: failed to raise the priority of the ", kind, " thread ", tid, " (setpriority: errno=", sysErr, " \"", sysErr.message(), "\").");
+    }
+
+    static void pinThread(const pid_t tid, const std::vector<int>& cpus) noexcept
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (const int cpu : cpus)
+            CPU_SET(cpu, &cpuSet);
+
+        if (sched_setaffinity(tid, sizeof(cpuSet), &cpuSet) != 0)
+        {
+            const std::error_code sysErr{errno, std::system_category()};
+            MY_LOG_WARN("ThreadScheduling: failed to pin the thread ", tid, " (errno=", sysErr, " \"", sysErr.message(), "\").");
+        }
+    }
+
+#ifdef WAYLAND_INPUT_WINDOW_HAS_SD_BUS
+    /**
+     * rtkit (org.freedesktop.RealtimeKit1) grants the realtime priorities and the negative nice values to the
+     *   unprivileged desktop apps.
+     * It requires the realtime threads to limit their CPU time between the blocking calls (RLIMIT_RTTIME) ; once
+     *   exceeded (e.g. a stall), the thread gets SIGXCPU and goes back to SCHED_OTHER instead of being killed.
+     */
+    [[nodiscard]] static bool requestViaRtkit(const pid_t tid, const bool isRealtime, const int value) noexcept
+    {
+        static constexpr const char* SERVICE = "org.freedesktop.RealtimeKit1";
+        static constexpr const char* OBJECT = "/org/freedesktop/RealtimeKit1";
+        static constexpr const char* INTERFACE = "org.freedesktop.RealtimeKit1";
+
+        sd_bus* bus = nullptr;
+        if (const int err = sd_bus_open_system(&bus); err < 0)
+        {
+            MY_LOG_INFO("ThreadScheduling: can't connect to the system bus (", -err, ").");
+            return false;
+        }
+
+        sd_bus_error error = SD_BUS_ERROR_NULL;
+        int result = 0;
+        if (isRealtime)
+        {
+            std::int64_t maxRealtimeUs = 0;
+            if (sd_bus_get_property_trivial(bus, SERVICE, OBJECT, INTERFACE, "RTTimeUSecMax", &error, 'x', &maxRealtimeUs) >= 0)
+            {
+                const rlimit limit{ static_cast<rlim_t>(maxRealtimeUs), static_cast<rlim_t>(maxRealtimeUs) };
+                (void)setrlimit(RLIMIT_RTTIME, &limit);
+                installRealtimeLimitHandler();
+            }
+            sd_bus_error_free(&error);
+
+            result = sd_bus_call_method(bus, SERVICE, OBJECT, INTERFACE, "MakeThreadRealtime", &error, nullptr,
+                                        "tu", static_cast<std::uint64_t>(tid), static_cast<std::uint32_t>(value));
+        }
+        else
+        {
+            result = sd_bus_call_method(bus, SERVICE, OBJECT, INTERFACE, "MakeThreadHighPriority", &error, nullptr,
+                                        "ti", static_cast<std::uint64_t>(tid), static_cast<std::int32_t>(value));
+        }
+
+        if (result < 0)
+            MY_LOG_INFO("ThreadScheduling: rtkit has refused (", (error.message != nullptr) ? error.message : "?", ").");
+
+        sd_bus_error_free(&error);
+        sd_bus_unref(bus);
+        return (result >= 0);
+    }
+
+    static void installRealtimeLimitHandler() noexcept
+    {
+        struct sigaction action{};
+        action.sa_handler = [](int) {
+            const int savedErrno = errno;
+            const sched_param param{};
+            (void)sched_setscheduler(0, SCHED_OTHER, &param);
+            errno = savedErrno;
+        };
+        sigemptyset(&action.sa_mask);
+        (void)sigaction(SIGXCPU, &action, nullptr);
+    }
+#else
+    [[nodiscard]] static bool requestViaRtkit(pid_t, bool, int) noexcept
+    {
+        return false;
+    }
+#endif // def WAYLAND_INPUT_WINDOW_HAS_SD_BUS
+
+private:
+    Policy policy_ = Policy::UNCHANGED;
+    int realtimePriority_ = DEFAULT_REALTIME_PRIORITY;
+    int niceValue_ = DEFAULT_NICE;
+    std::vector<int> renderCpus_;
+
+    std::vector<WatchedThread> threads_;
+    std::uint64_t framesCount_ = 0;
+    std::uint64_t reportStartedAtNs_ = 0;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_THREAD_SCHEDULING_H
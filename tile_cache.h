@@ -0,0 +1,764 @@
+#ifndef WAYLAND_INPUT_WINDOW_TILE_CACHE_H
+#define WAYLAND_INPUT_WINDOW_TILE_CACHE_H
+
+#include "utilities.h"      // MY_LOG_*
+#include <cstdint>          // std::uint*_t, std::int*_t
+#include <cstddef>          // std::size_t, std::ptrdiff_t
+#include <cstring>          // std::memcpy, std::memcmp, std::memset
+#include <cstdlib>          // std::getenv
+#include <string>           // std::string
+#include <string_view>      // std::string_view
+#include <unordered_map>    // std::unordered_map
+#include <vector>           // std::vector
+#include <list>             // std::list
+#include <array>            // std::array
+#include <algorithm>        // std::min, std::fill_n, std::nth_element
+#include <limits>           // std::numeric_limits
+#include <system_error>     // std::system_error
+#include <stdexcept>        // std::runtime_error
+#include <sys/mman.h>       // mmap, munmap, madvise
+#include <sys/stat.h>       // mkdir
+#include <sys/file.h>       // flock
+#include <fcntl.h>          // open, fallocate, FALLOC_FL_*
+#include <unistd.h>         // close, ftruncate, sysconf
+#if defined(__SSE2__)
+    #include <immintrin.h>  // _mm*_set1_epi32, _mm*_storeu_si*
+#endif
+
+
+/** Identifies a single rendered tile of some content */
+struct TileKey
+{
+    // Identifies the content (and the version of its renderer) the tile has been rendered from
+    std::uint64_t contentId = 0;
+    // The bit representation of the zoom the tile has been rendered with (zoom levels are compared exactly)
+    std::uint64_t zoomBits = 0;
+    // The tile coordinates in the zoomed content space, in tiles
+    std::int32_t tileX = 0;
+    std::int32_t tileY = 0;
+
+public:
+    [[nodiscard]] static std::uint64_t makeZoomBits(const double zoom) noexcept
+    {
+        static_assert(sizeof(double) == sizeof(std::uint64_t));
+
+        std::uint64_t result = 0;
+        std::memcpy(&result, &zoom, sizeof(result));
+        return result;
+    }
+
+    /** FNV-1a of the content description. Change the description whenever the content renderer changes. */
+    [[nodiscard]] static constexpr std::uint64_t makeContentId(const std::string_view contentDescription) noexcept
+    {
+        std::uint64_t result = 0xCBF29CE484222325ULL;
+        for (const char c : contentDescription)
+        {
+            result ^= static_cast<unsigned char>(c);
+            result *= 0x100000001B3ULL;
+        }
+        return result;
+    }
+};
+
+inline bool operator==(const TileKey& lhs, const TileKey& rhs) noexcept
+{
+    return ( (lhs.contentId == rhs.contentId) &&
+             (lhs.zoomBits == rhs.zoomBits) &&
+             (lhs.tileX == rhs.tileX) &&
+             (lhs.tileY == rhs.tileY) );
+}
+
+inline bool operator!=(const TileKey& lhs, const TileKey& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+struct TileKeyHash
+{
+    std::size_t operator()(const TileKey& key) const noexcept
+    {
+        std::uint64_t result = key.contentId ^ (key.zoomBits * 0x9E3779B97F4A7C15ULL);
+        result ^= (static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.tileX)) << 32) |
+                  static_cast<std::uint32_t>(key.tileY);
+        result *= 0xFF51AFD7ED558CCDULL;
+        result ^= (result >> 33);
+        return static_cast<std::size_t>(result);
+    }
+};
+
+
+/**
+ * Content-addressed store of rendered tiles kept in a memory-mapped file, so it survives restarts of the app.
+ *
+ * File layout:
+ *   [Header][IndexEntry x capacity][padding up to a page boundary][tile pixels x capacity]
+ *
+ * Only the header and the compact index are read when the store is opened ; the pixels of a tile get paged in by
+ *   the kernel on demand, when the tile is actually requested. When the store is full, the least recently used tile
+ *   is replaced.
+ */
+class PersistentTileStore
+{
+public:
+    static constexpr std::size_t TILE_SIDE = 256;
+    // XRGB8888
+    static constexpr std::size_t BYTES_PER_PIXEL = 4;
+    static constexpr std::size_t TILE_PIXELS = TILE_SIDE * TILE_SIDE;
+    static constexpr std::size_t TILE_SIZE_BYTES = TILE_PIXELS * BYTES_PER_PIXEL;
+
+    static constexpr std::uint32_t DEFAULT_CAPACITY_TILES = 512;
+
+public: // ctors/dtor
+    /** $XDG_CACHE_HOME/WaylandInputWindow/tiles.bin (or $HOME/.cache/... if XDG_CACHE_HOME isn't set) */
+    [[nodiscard]] static std::string getDefaultPath() noexcept(false)
+    {
+        std::string cacheDir;
+        if (const char* const xdgCacheHome = std::getenv("XDG_CACHE_HOME"); (xdgCacheHome != nullptr) && (xdgCacheHome[0] == '/'))
+            cacheDir = xdgCacheHome;
+        else if (const char* const home = std::getenv("HOME"); (home != nullptr) && (home[0] != '\0'))
+            cacheDir = std::string{ home } + "/.cache";
+        else
+            throw std::runtime_error("PersistentTileStore::getDefaultPath: neither XDG_CACHE_HOME nor HOME are set");
+
+        return cacheDir + "/WaylandInputWindow/tiles.bin";
+    }
+
+    [[nodiscard]] static PersistentTileStore open(const std::string& filePath, const std::uint32_t capacityTiles) noexcept(false)
+    {
+        if (capacityTiles == 0)
+            throw std::logic_error("PersistentTileStore::open: capacityTiles == 0");
+
+        // 1. mkdir -p
+        for (std::size_t slashPos = filePath.find('/', 1); slashPos != std::string::npos; slashPos = filePath.find('/', slashPos + 1))
+        {
+            const std::string dirPath = filePath.substr(0, slashPos);
+            if ( (mkdir(dirPath.c_str(), S_IRWXU) != 0) && (errno != EEXIST) )
+                throw std::system_error(errno, std::system_category(), "PersistentTileStore::open: mkdir(\"" + dirPath + "\") failed");
+        }
+
+        // 2. open + flock (other instances of the app just run without the persistent cache)
+        const int fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (fd == -1)
+            throw std::system_error(errno, std::system_category(), "PersistentTileStore::open: open(\"" + filePath + "\") failed");
+
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+        {
+            const auto savedErrno = errno;
+            (void)close(fd);
+            throw std::system_error(savedErrno, std::system_category(), "PersistentTileStore::open: the file is in use by another process");
+        }
+
+        // 3. validating the header ; an incompatible file is just reinitialized
+        const std::size_t dataOffset = getDataOffset(capacityTiles);
+        const std::size_t fileSize = dataOffset + capacityTiles * TILE_SIZE_BYTES;
+
+        Header header{};
+        const bool isCompatible = (pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))) &&
+                                  (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) == 0) &&
+                                  (header.formatVersion == FORMAT_VERSION) &&
+                                  (header.tileSide == TILE_SIDE) &&
+                                  (header.bytesPerPixel == BYTES_PER_PIXEL) &&
+                                  (header.capacityTiles == capacityTiles);
+        if (!isCompatible)
+        {
+            MY_LOG_INFO("PersistentTileStore::open: (re)initializing the tiles cache file \"", filePath, "\"...");
+
+            // Dropping all the old content. The file is sparse, so its size doesn't cost any disk space by itself.
+            if ( (ftruncate(fd, 0) != 0) || (ftruncate(fd, static_cast<off_t>(fileSize)) != 0) )
+            {
+                const auto savedErrno = errno;
+                (void)close(fd);
+                throw std::system_error(savedErrno, std::system_category(), "PersistentTileStore::open: ftruncate failed");
+            }
+        }
+
+        // 4. mmap
+        auto* const mmappedAddr = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if ((mmappedAddr == MAP_FAILED) || (mmappedAddr == nullptr))
+        {
+            const auto savedErrno = errno;
+            (void)close(fd);
+            throw std::system_error(savedErrno, std::system_category(), "PersistentTileStore::open: mmap failed");
+        }
+
+        PersistentTileStore result{ fd, static_cast<std::byte*>(mmappedAddr), fileSize, capacityTiles };
+
+        if (!isCompatible)
+        {
+            auto& newHeader = result.getHeader();
+            std::memcpy(newHeader.magic, FILE_MAGIC, sizeof(newHeader.magic));
+            newHeader.formatVersion = FORMAT_VERSION;
+            newHeader.tileSide = TILE_SIDE;
+            newHeader.bytesPerPixel = BYTES_PER_PIXEL;
+            newHeader.capacityTiles = capacityTiles;
+            newHeader.useClock = 0;
+        }
+
+        // 5. loading the index
+        result.residentSlots_.assign(capacityTiles, false);
+        result.index_.reserve(capacityTiles);
+        for (std::uint32_t slot = capacityTiles; slot > 0; --slot)
+        {
+            const auto& entry = result.getIndexEntry(slot - 1);
+            if (entry.lastUsed == 0)
+                result.freeSlots_.push_back(slot - 1);
+            else
+                result.index_.insert_or_assign(entry.key, slot - 1);
+        }
+
+        MY_LOG_INFO("PersistentTileStore::open: \"", filePath, "\" contains ", result.index_.size(), " tile(s) out of ", capacityTiles, '.');
+
+        return result;
+    }
+
+    // isValid() == false
+    PersistentTileStore() noexcept
+        : PersistentTileStore(-1, nullptr, 0, 0)
+    {}
+
+    PersistentTileStore(const PersistentTileStore&) = delete;
+    PersistentTileStore(PersistentTileStore&& src) noexcept
+        : fd_{src.fd_}
+        , mmappedAddr_{src.mmappedAddr_}
+        , mmappedSize_{src.mmappedSize_}
+        , capacityTiles_{src.capacityTiles_}
+        , index_(std::move(src.index_))
+        , freeSlots_(std::move(src.freeSlots_))
+        , residentSlots_(std::move(src.residentSlots_))
+        , residentTilesCount_{src.residentTilesCount_}
+    {
+        src.fd_ = -1;
+        src.mmappedAddr_ = nullptr;
+        src.mmappedSize_ = 0;
+        src.capacityTiles_ = 0;
+        src.residentTilesCount_ = 0;
+    }
+
+    ~PersistentTileStore() noexcept
+    {
+        dispose();
+    }
+
+public: // assignments
+    PersistentTileStore& operator=(const PersistentTileStore&) = delete;
+    PersistentTileStore& operator=(PersistentTileStore&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            std::swap(fd_, rhs.fd_);
+            std::swap(mmappedAddr_, rhs.mmappedAddr_);
+            std::swap(mmappedSize_, rhs.mmappedSize_);
+            std::swap(capacityTiles_, rhs.capacityTiles_);
+            std::swap(index_, rhs.index_);
+            std::swap(freeSlots_, rhs.freeSlots_);
+            std::swap(residentSlots_, rhs.residentSlots_);
+            std::swap(residentTilesCount_, rhs.residentTilesCount_);
+        }
+
+        return *this;
+    }
+
+public: // getters
+    [[nodiscard]] bool isValid() const noexcept { return ( (fd_ != -1) && (mmappedAddr_ != nullptr) ); }
+
+    [[nodiscard]] std::size_t getTilesCount() const noexcept { return index_.size(); }
+    [[nodiscard]] std::uint32_t getCapacityTiles() const noexcept { return capacityTiles_; }
+
+public:
+    /**
+     * @return the pixels (TILE_SIDE x TILE_SIDE, XRGB8888) of the tile or nullptr if the store doesn't have it.
+     *         The pointer stays valid until the next call to store(), trimTo() or dispose().
+     */
+    [[nodiscard]] const std::uint32_t* find(const TileKey& key) noexcept
+    {
+        if (!isValid())
+            return nullptr;
+
+        const auto iter = index_.find(key);
+        if (iter == index_.end())
+            return nullptr;
+
+        getIndexEntry(iter->second).lastUsed = ++getHeader().useClock;
+        markResident(iter->second);
+        return getTilePixels(iter->second);
+    }
+
+    /** Unlike find() doesn't touch the tile, so it can be used to look ahead without affecting the eviction order */
+    [[nodiscard]] bool contains(const TileKey& key) const noexcept
+    {
+        return ( isValid() && (index_.count(key) != 0) );
+    }
+
+    /** Puts the tile into the store replacing the least recently used one if the store is full */
+    void store(const TileKey& key, const std::uint32_t* const pixels) noexcept
+    {
+        if (!isValid())
+            return;
+
+        std::uint32_t slot = 0;
+        if (const auto iter = index_.find(key); iter != index_.end())
+        {
+            slot = iter->second;
+        }
+        else
+        {
+            if (freeSlots_.empty())
+                (void)evictLeastRecentlyUsed();
+
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+            index_.insert_or_assign(key, slot);
+        }
+
+        auto& entry = getIndexEntry(slot);
+        // The entry is marked as free while the pixels are being written, so a crash in between doesn't leave
+        //   a valid entry pointing to garbage
+        entry.lastUsed = 0;
+        std::memcpy(getTilePixels(slot), pixels, TILE_SIZE_BYTES);
+        entry.key = key;
+        entry.lastUsed = ++getHeader().useClock;
+        markResident(slot);
+    }
+
+    /** The bytes of the tiles pixels mapped into the memory of the process since the last releaseResidentPages() */
+    [[nodiscard]] std::size_t getResidentBytes() const noexcept
+    {
+        return residentTilesCount_ * TILE_SIZE_BYTES;
+    }
+
+    /**
+     * Unmaps the tiles pixels from the memory of the process without losing them: they stay in the file and
+     *   will be paged in again on demand.
+     * @param bytesToFree the least recently used tiles are released first until at least this much is ; everything
+     *                    by default
+     * @return the number of resident bytes released
+     */
+    std::size_t releaseResidentPages(const std::size_t bytesToFree = std::numeric_limits<std::size_t>::max()) noexcept
+    {
+        const auto residentBytes = getResidentBytes();
+        if ( (residentBytes == 0) || (bytesToFree == 0) )
+            return 0;
+
+        const auto dataOffset = getDataOffset(capacityTiles_);
+        if (bytesToFree >= residentBytes)
+        {
+            (void)madvise(mmappedAddr_ + dataOffset, mmappedSize_ - dataOffset, MADV_DONTNEED);
+
+            residentSlots_.assign(residentSlots_.size(), false);
+            residentTilesCount_ = 0;
+            return residentBytes;
+        }
+
+        std::vector<std::uint32_t> residentSlots;
+        residentSlots.reserve(residentTilesCount_);
+        for (std::uint32_t slot = 0; slot < capacityTiles_; ++slot)
+        {
+            if (residentSlots_[slot])
+                residentSlots.push_back(slot);
+        }
+
+        // The tiles are page-aligned (the data offset is, and so is TILE_SIZE_BYTES), so each one is unmapped alone
+        const auto tilesToRelease = std::min(residentSlots.size(), (bytesToFree + TILE_SIZE_BYTES - 1) / TILE_SIZE_BYTES);
+        std::nth_element(
+            residentSlots.begin(), residentSlots.begin() + static_cast<std::ptrdiff_t>(tilesToRelease - 1), residentSlots.end(),
+            [this](const std::uint32_t lhs, const std::uint32_t rhs) { return (getIndexEntry(lhs).lastUsed < getIndexEntry(rhs).lastUsed); }
+        );
+        for (std::size_t i = 0; i < tilesToRelease; ++i)
+        {
+            const auto slot = residentSlots[i];
+            (void)madvise(getTilePixels(slot), TILE_SIZE_BYTES, MADV_DONTNEED);
+            residentSlots_[slot] = false;
+        }
+        residentTilesCount_ -= tilesToRelease;
+
+        return tilesToRelease * TILE_SIZE_BYTES;
+    }
+
+    /**
+     * Evicts the least recently used tiles until no more than maxTiles remain, and returns their disk blocks to
+     *   the filesystem.
+     * @return the number of tiles evicted
+     */
+    std::size_t trimTo(const std::size_t maxTiles) noexcept
+    {
+        std::size_t result = 0;
+        while (index_.size() > maxTiles)
+        {
+            const auto slot = evictLeastRecentlyUsed();
+            // Punching a hole keeps the file size but frees the disk space (and the page cache) of the tile
+            (void)fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                            static_cast<off_t>(getDataOffset(capacityTiles_) + slot * TILE_SIZE_BYTES),
+                            static_cast<off_t>(TILE_SIZE_BYTES));
+            ++result;
+        }
+        return result;
+    }
+
+    void dispose()
+    {
+        if (mmappedAddr_ != nullptr)
+        {
+            (void)munmap(mmappedAddr_, mmappedSize_);
+            mmappedAddr_ = nullptr;
+        }
+        mmappedSize_ = 0;
+        capacityTiles_ = 0;
+        index_.clear();
+        freeSlots_.clear();
+        residentSlots_.clear();
+        residentTilesCount_ = 0;
+
+        if (fd_ != -1)
+        {
+            // also releases the flock
+            (void)close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private: // on-disk structures
+    static constexpr char FILE_MAGIC[8] = { 'W', 'I', 'W', 'T', 'I', 'L', 'E', 'S' };
+    static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint32_t tileSide;
+        std::uint32_t bytesPerPixel;
+        std::uint32_t capacityTiles;
+        // Monotonic counter used for LRU ordering of the entries
+        std::uint64_t useClock;
+    };
+
+    struct IndexEntry
+    {
+        TileKey key;
+        // 0 means the slot is free
+        std::uint64_t lastUsed;
+    };
+    static_assert(sizeof(IndexEntry) == 32);
+
+    [[nodiscard]] static std::size_t getDataOffset(const std::uint32_t capacityTiles) noexcept
+    {
+        const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::size_t indexEnd = sizeof(Header) + capacityTiles * sizeof(IndexEntry);
+        return (indexEnd + pageSize - 1) / pageSize * pageSize;
+    }
+
+private:
+    PersistentTileStore(int fd, std::byte* mmappedAddr, std::size_t mmappedSize, std::uint32_t capacityTiles) noexcept
+        : fd_{fd}
+        , mmappedAddr_{mmappedAddr}
+        , mmappedSize_{mmappedSize}
+        , capacityTiles_{capacityTiles}
+    {}
+
+    [[nodiscard]] Header& getHeader() noexcept
+    {
+        return *reinterpret_cast<Header*>(mmappedAddr_);
+    }
+
+    [[nodiscard]] IndexEntry& getIndexEntry(const std::uint32_t slot) noexcept
+    {
+        return reinterpret_cast<IndexEntry*>(mmappedAddr_ + sizeof(Header))[slot];
+    }
+
+    [[nodiscard]] std::uint32_t* getTilePixels(const std::uint32_t slot) noexcept
+    {
+        return reinterpret_cast<std::uint32_t*>(mmappedAddr_ + getDataOffset(capacityTiles_) + slot * TILE_SIZE_BYTES);
+    }
+
+    void markResident(const std::uint32_t slot)
+    {
+        if (!residentSlots_[slot])
+        {
+            residentSlots_[slot] = true;
+            ++residentTilesCount_;
+        }
+    }
+
+    /** @return the slot freed */
+    std::uint32_t evictLeastRecentlyUsed() noexcept
+    {
+        // Linear scan over the compact index ; it only happens on misses of a full store
+        auto victim = index_.begin();
+        std::uint64_t victimLastUsed = std::numeric_limits<std::uint64_t>::max();
+        for (auto iter = index_.begin(); iter != index_.end(); ++iter)
+        {
+            if (const auto lastUsed = getIndexEntry(iter->second).lastUsed; lastUsed < victimLastUsed)
+            {
+                victim = iter;
+                victimLastUsed = lastUsed;
+            }
+        }
+
+        const auto slot = victim->second;
+        getIndexEntry(slot).lastUsed = 0;
+        if (residentSlots_[slot])
+        {
+            residentSlots_[slot] = false;
+            --residentTilesCount_;
+        }
+        index_.erase(victim);
+        freeSlots_.push_back(slot);
+
+        return slot;
+    }
+
+private:
+    int fd_;
+    std::byte* mmappedAddr_;
+    std::size_t mmappedSize_;
+    std::uint32_t capacityTiles_;
+
+    std::unordered_map<TileKey, std::uint32_t /* slot */, TileKeyHash> index_;
+    std::vector<std::uint32_t> freeSlots_;
+
+    // The slots whose pixels have been touched (hence mapped into the process) since the last releaseResidentPages()
+    std::vector<bool> residentSlots_;
+    std::size_t residentTilesCount_ = 0;
+};
+
+/** Fills count XRGB8888 pixels with the same value using the widest stores available */
+inline void fillPixels(std::uint32_t* dst, std::size_t count, const std::uint32_t pixel) noexcept
+{
+#if defined(__AVX2__)
+    const __m256i pixels8 = _mm256_set1_epi32(static_cast<int>(pixel));
+    for (; count >= 8; count -= 8, dst += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), pixels8);
+#endif
+#if defined(__SSE2__)
+    const __m128i pixels4 = _mm_set1_epi32(static_cast<int>(pixel));
+    for (; count >= 4; count -= 4, dst += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), pixels4);
+#endif
+    std::fill_n(dst, count, pixel);
+}
+
+
+/**
+ * A tile (PersistentTileStore::TILE_SIDE x TILE_SIDE, XRGB8888) compressed with a run-length encoding.
+ *
+ * Every row is a sequence of tokens. A token is a 32-bit word: the highest bit marks a literal sequence,
+ *   the rest 31 bits are the number of pixels. A run token is followed by the single pixel value to repeat,
+ *   a literal token is followed by the pixels themselves.
+ * A row identical to the previous one isn't stored again, but refers to the previous row's tokens.
+ */
+class CompressedTile
+{
+public:
+    static constexpr std::size_t TILE_SIDE = PersistentTileStore::TILE_SIDE;
+
+public:
+    [[nodiscard]] static CompressedTile encode(const std::uint32_t* const pixels)
+    {
+        CompressedTile result;
+        result.words_.reserve(TILE_SIDE * 4);
+
+        for (std::size_t y = 0; y < TILE_SIDE; ++y)
+        {
+            const std::uint32_t* const row = pixels + y * TILE_SIDE;
+
+            if ( (y > 0) && (std::memcmp(row, row - TILE_SIDE, TILE_SIDE * sizeof(*row)) == 0) )
+            {
+                result.rowOffsets_[y] = result.rowOffsets_[y - 1];
+                continue;
+            }
+
+            result.rowOffsets_[y] = static_cast<std::uint32_t>(result.words_.size());
+            result.encodeRow(row);
+        }
+
+        result.words_.shrink_to_fit();
+        return result;
+    }
+
+public:
+    /** The memory occupied by the tile */
+    [[nodiscard]] std::size_t getSizeBytes() const noexcept
+    {
+        return sizeof(*this) + words_.capacity() * sizeof(std::uint32_t);
+    }
+
+    /**
+     * Decodes the rectangle [srcX; srcX + rectWidth) x [srcY; srcY + rectHeight) of the tile into dst,
+     *   the destination rows are dstStrideBytes apart
+     */
+    void decodeRect(
+        const std::size_t srcX,
+        const std::size_t srcY,
+        const std::size_t rectWidth,
+        const std::size_t rectHeight,
+        std::byte* dst,
+        const std::size_t dstStrideBytes
+    ) const noexcept {
+        for (std::size_t y = srcY; y < srcY + rectHeight; ++y, dst += dstStrideBytes)
+        {
+            const std::uint32_t* token = words_.data() + rowOffsets_[y];
+            auto* dstPixel = reinterpret_cast<std::uint32_t*>(dst);
+            std::size_t toSkip = srcX;
+            std::size_t toWrite = rectWidth;
+
+            while (toWrite > 0)
+            {
+                const bool isLiteral = ( (*token & LITERAL_FLAG) != 0 );
+                const std::size_t count = (*token & COUNT_MASK);
+                const std::uint32_t* const payload = token + 1;
+                token = payload + (isLiteral ? count : 1);
+
+                if (toSkip >= count)
+                {
+                    toSkip -= count;
+                    continue;
+                }
+
+                const std::size_t n = std::min(count - toSkip, toWrite);
+                if (isLiteral)
+                    std::memcpy(dstPixel, payload + toSkip, n * sizeof(*dstPixel));
+                else
+                    fillPixels(dstPixel, n, *payload);
+
+                toSkip = 0;
+                toWrite -= n;
+                dstPixel += n;
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint32_t LITERAL_FLAG = 0x80000000U;
+    static constexpr std::uint32_t COUNT_MASK = ~LITERAL_FLAG;
+    // Shorter runs are cheaper to keep within literals
+    static constexpr std::size_t MIN_RUN_LENGTH = 3;
+
+    void encodeRow(const std::uint32_t* const row)
+    {
+        const auto getRunLength = [row](const std::size_t x) {
+            std::size_t result = 1;
+            while ( (x + result < TILE_SIDE) && (row[x + result] == row[x]) )
+                ++result;
+            return result;
+        };
+
+        std::size_t x = 0;
+        while (x < TILE_SIDE)
+        {
+            if (const auto runLength = getRunLength(x); runLength >= MIN_RUN_LENGTH)
+            {
+                words_.push_back(static_cast<std::uint32_t>(runLength));
+                words_.push_back(row[x]);
+                x += runLength;
+                continue;
+            }
+
+            // A literal sequence lasts until the next run long enough
+            const std::size_t literalBegin = x;
+            while ( (x < TILE_SIDE) && (getRunLength(x) < MIN_RUN_LENGTH) )
+                ++x;
+
+            words_.push_back(LITERAL_FLAG | static_cast<std::uint32_t>(x - literalBegin));
+            words_.insert(words_.end(), row + literalBegin, row + x);
+        }
+    }
+
+private:
+    std::array<std::uint32_t, TILE_SIDE> rowOffsets_ = {};
+    std::vector<std::uint32_t> words_;
+};
+
+
+/** In-memory LRU cache of compressed tiles bounded by the memory they occupy */
+class CompressedTileCache
+{
+public:
+    static constexpr std::size_t DEFAULT_BUDGET_BYTES = 32 * 1024 * 1024;
+
+public:
+    explicit CompressedTileCache(const std::size_t budgetBytes = DEFAULT_BUDGET_BYTES) noexcept
+        : budgetBytes_{budgetBytes}
+    {}
+
+public: // getters
+    [[nodiscard]] std::size_t getUsedBytes() const noexcept { return usedBytes_; }
+    [[nodiscard]] std::size_t getBudgetBytes() const noexcept { return budgetBytes_; }
+    [[nodiscard]] std::size_t getTilesCount() const noexcept { return lruList_.size(); }
+
+public:
+    /** @return nullptr if the tile isn't cached. The pointer stays valid until the next insert() or trimTo(). */
+    [[nodiscard]] const CompressedTile* find(const TileKey& key) noexcept
+    {
+        const auto iter = index_.find(key);
+        if (iter == index_.end())
+            return nullptr;
+
+        // Moving to the most recently used position
+        lruList_.splice(lruList_.begin(), lruList_, iter->second);
+        return &iter->second->second;
+    }
+
+    /** Unlike find() doesn't touch the tile, so it can be used to look ahead without affecting the eviction order */
+    [[nodiscard]] bool contains(const TileKey& key) const noexcept
+    {
+        return (index_.count(key) != 0);
+    }
+
+    /** Compresses the tile and caches it, evicting the least recently used tiles to keep within the budget */
+    const CompressedTile& insert(const TileKey& key, const std::uint32_t* const pixels)
+    {
+        if (const auto iter = index_.find(key); iter != index_.end())
+        {
+            usedBytes_ -= iter->second->second.getSizeBytes();
+            lruList_.erase(iter->second);
+            index_.erase(iter);
+        }
+
+        lruList_.emplace_front(key, CompressedTile::encode(pixels));
+        index_.insert_or_assign(key, lruList_.begin());
+        usedBytes_ += lruList_.front().second.getSizeBytes();
+
+        // The tile just inserted is never evicted
+        while ( (usedBytes_ > budgetBytes_) && (lruList_.size() > 1) )
+            evictLeastRecentlyUsed();
+
+        return lruList_.front().second;
+    }
+
+    /**
+     * Evicts the least recently used tiles until no more than maxBytes are used
+     * @return the number of bytes freed
+     */
+    std::size_t trimTo(const std::size_t maxBytes) noexcept
+    {
+        const auto usedBytesBefore = usedBytes_;
+        while ( (usedBytes_ > maxBytes) && !lruList_.empty() )
+            evictLeastRecentlyUsed();
+        return usedBytesBefore - usedBytes_;
+    }
+
+    void clear() noexcept
+    {
+        index_.clear();
+        lruList_.clear();
+        usedBytes_ = 0;
+    }
+
+private:
+    void evictLeastRecentlyUsed() noexcept
+    {
+        usedBytes_ -= lruList_.back().second.getSizeBytes();
+        index_.erase(lruList_.back().first);
+        lruList_.pop_back();
+    }
+
+private:
+    std::size_t budgetBytes_;
+    std::size_t usedBytes_ = 0;
+
+    // The most recently used tile is at the front
+    std::list< std::pair<TileKey, CompressedTile> > lruList_;
+    std::unordered_map<TileKey, decltype(lruList_)::iterator, TileKeyHash> index_;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_TILE_CACHE_H
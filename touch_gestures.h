@@ -0,0 +1,216 @@
+#ifndef WAYLAND_INPUT_WINDOW_TOUCH_GESTURES_H
+#define WAYLAND_INPUT_WINDOW_TOUCH_GESTURES_H
+
+#include <array>            // std::array
+#include <optional>         // std::optional
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::int32_t, std::uint64_t
+#include <cmath>            // std::hypot, std::atan2, std::remainder
+#include <numbers>          // std::numbers::pi
+
+
+/**
+ * The contacts of a touchscreen by their wl_touch ids.
+ * The number of the simultaneous contacts is small and bounded by the hardware, so they're kept in a fixed array of
+ *   slots which never allocates ; the ids are looked up linearly.
+ */
+class TouchContactTable
+{
+public:
+    static constexpr std::size_t MAX_CONTACTS = 10;
+
+    struct Contact
+    {
+        std::int32_t id = 0;
+        // Surface-local
+        double x = 0;
+        double y = 0;
+        bool isActive = false;
+    };
+
+public:
+    /** @return false if all the slots are occupied, the contact is ignored then */
+    bool onDown(const std::int32_t id, const double x, const double y) noexcept
+    {
+        if (findActive(id) != nullptr)
+            return false;
+
+        for (auto& contact : slots_)
+        {
+            if (!contact.isActive)
+            {
+                contact = Contact{ id, x, y, true };
+                ++activeCount_;
+                ++layoutGeneration_;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** Only the last position within a wl_touch::frame matters, so the motions are just stored */
+    void onMotion(const std::int32_t id, const double x, const double y) noexcept
+    {
+        if (auto* const contact = findActive(id); contact != nullptr)
+        {
+            contact->x = x;
+            contact->y = y;
+        }
+    }
+
+    void onUp(const std::int32_t id) noexcept
+    {
+        if (auto* const contact = findActive(id); contact != nullptr)
+        {
+            contact->isActive = false;
+            --activeCount_;
+            ++layoutGeneration_;
+        }
+    }
+
+    void clear() noexcept
+    {
+        for (auto& contact : slots_)
+            contact.isActive = false;
+        activeCount_ = 0;
+        ++layoutGeneration_;
+    }
+
+public: // getters
+    [[nodiscard]] std::size_t getActiveCount() const noexcept { return activeCount_; }
+    [[nodiscard]] const std::array<Contact, MAX_CONTACTS>& getSlots() const noexcept { return slots_; }
+    /** Changes whenever a contact is added or removed */
+    [[nodiscard]] std::uint64_t getLayoutGeneration() const noexcept { return layoutGeneration_; }
+
+private:
+    Contact* findActive(const std::int32_t id) noexcept
+    {
+        for (auto& contact : slots_)
+            if ( contact.isActive && (contact.id == id) )
+                return &contact;
+        return nullptr;
+    }
+
+private:
+    std::array<Contact, MAX_CONTACTS> slots_;
+    std::size_t activeCount_ = 0;
+    std::uint64_t layoutGeneration_ = 0;
+};
+
+
+/** The change of a touch gesture between two wl_touch::frame's */
+struct TouchGestureStep
+{
+    // The number of the contacts driving the gesture: 1 (pan) or 2 (pan, pinch and rotate)
+    std::size_t contactsCount = 0;
+    // The gesture center (the centroid of the contacts), surface-local
+    double centerX = 0;
+    double centerY = 0;
+    // The movement of the center
+    double panX = 0;
+    double panY = 0;
+    // The ratio of the distances between the 2 contacts ; always 1 for a single contact
+    double scale = 1;
+    // The change of the angle of the line through the 2 contacts in radians, clockwise (the y axis points down)
+    double rotation = 0;
+};
+
+
+/**
+ * Turns the contacts into 1-finger pans and 2-finger pinches/rotations. It's fed once per wl_touch::frame, so all
+ *   the motions within a frame are coalesced into a single step.
+ * Whenever the set of the contacts changes the gesture is restarted from their current positions, so adding or
+ *   lifting a finger never makes the content jump.
+ */
+class TouchGestureRecognizer
+{
+public:
+    /** @return an empty optional if there's nothing to apply */
+    std::optional<TouchGestureStep> onFrame(const TouchContactTable& contacts) noexcept
+    {
+        // Only the first 2 contacts (in the slots order) drive the gesture
+        const TouchContactTable::Contact* driving[2] = {};
+        std::size_t drivingCount = 0;
+        for (const auto& contact : contacts.getSlots())
+        {
+            if (!contact.isActive)
+                continue;
+            driving[drivingCount++] = &contact;
+            if (drivingCount == 2)
+                break;
+        }
+
+        if (drivingCount == 0)
+        {
+            reset();
+            return std::nullopt;
+        }
+
+        Sample current;
+        if (drivingCount == 1)
+        {
+            current.centerX = driving[0]->x;
+            current.centerY = driving[0]->y;
+        }
+        else
+        {
+            current.centerX = (driving[0]->x + driving[1]->x) / 2;
+            current.centerY = (driving[0]->y + driving[1]->y) / 2;
+            current.distance = std::hypot(driving[1]->x - driving[0]->x, driving[1]->y - driving[0]->y);
+            current.angle = std::atan2(driving[1]->y - driving[0]->y, driving[1]->x - driving[0]->x);
+        }
+
+        const auto layoutGeneration = contacts.getLayoutGeneration();
+        if ( !previous_.has_value() || (layoutGeneration != layoutGeneration_) )
+        {
+            previous_ = current;
+            layoutGeneration_ = layoutGeneration;
+            return std::nullopt;
+        }
+
+        TouchGestureStep step;
+        step.contactsCount = drivingCount;
+        step.centerX = current.centerX;
+        step.centerY = current.centerY;
+        step.panX = current.centerX - previous_->centerX;
+        step.panY = current.centerY - previous_->centerY;
+        // The fingers put (almost) at the same point don't define any scale or angle
+        if ( (drivingCount == 2) && (previous_->distance >= MIN_PINCH_DISTANCE) && (current.distance >= MIN_PINCH_DISTANCE) )
+        {
+            step.scale = current.distance / previous_->distance;
+            step.rotation = std::remainder(current.angle - previous_->angle, 2 * std::numbers::pi);
+        }
+
+        previous_ = current;
+
+        if ( (step.panX == 0) && (step.panY == 0) && (step.scale == 1) && (step.rotation == 0) )
+            return std::nullopt;
+
+        return step;
+    }
+
+    void reset() noexcept
+    {
+        previous_.reset();
+    }
+
+private:
+    // Surface-local pixels
+    static constexpr double MIN_PINCH_DISTANCE = 1;
+
+    struct Sample
+    {
+        double centerX = 0;
+        double centerY = 0;
+        double distance = 0;
+        double angle = 0;
+    };
+
+private:
+    std::optional<Sample> previous_;
+    std::uint64_t layoutGeneration_ = 0;
+};
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_TOUCH_GESTURES_H
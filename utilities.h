@@ -1,6 +1,8 @@
 #ifndef WAYLAND_INPUT_WINDOW_UTILITIES_H
 #define WAYLAND_INPUT_WINDOW_UTILITIES_H
 
+#include "flight_recorder.h" // FlightRecorder
+#include "app_clock.h"      // AppClock
 #include <type_traits>      // std::remove_cv_t, std::remove_reference_t, std::is_pointer_v, std::is_same_v
 #include <utility>          // std::move, std::forward, std::pair
 #include <optional>         // std::optional
@@ -10,17 +12,21 @@
 #include <chrono>           // std::chrono::*
 #include <ctime>            // std::localtime, std::strftime
 #include <thread>           // std::this_thread::get_id
+#include <mutex>            // std::mutex, std::lock_guard
+#include <algorithm>        // std::min
 #include <iostream>         // std::ostream, std::cerr
 #include <iomanip>          // std::setfill, std::setw, std::hex, std::setbase, std::left, std::right
 #include <sstream>          // std::ostringstream
 #include <cstdio>           // std::snprintf
 #include <cstddef>          // std::byte, std::size_t
+#include <cstdint>          // std::int64_t
 #include <cerrno>           // errno
+#include <cstdlib>          // std::getenv, std::strtoull
 #include <random>           // std::random_device, std::mt19937, std::uniform_int_distribution
 #include <sys/mman.h>       // shm_open, shm_unlink
 #include <sys/stat.h>       // S_IREAD, S_IWRITE
-#include <fcntl.h>          // O_CREAT, O_EXCL, O_RDWR
-#include <unistd.h>         // close
+#include <fcntl.h>          // O_CREAT, O_EXCL, O_RDWR, fallocate, FALLOC_FL_*
+#include <unistd.h>         // close, sysconf
 
 
 template<typename T>
@@ -130,6 +136,30 @@ WLResourceWrapper< std::decay_t<T> > makeWLResourceWrapperChecked(T&& resource,
 }
 
 
+/** floor(dividend / divisor) for a positive divisor */
+constexpr std::int64_t floorDiv(const std::int64_t dividend, const std::int64_t divisor) noexcept
+{
+    return (dividend >= 0) ? (dividend / divisor) : -((-dividend + divisor - 1) / divisor);
+}
+
+
+/** @return the value of the environment variable if it's set and is an unsigned decimal number ; std::nullopt otherwise */
+inline std::optional<unsigned long long> getEnvAsUnsigned(const char* const name) noexcept
+{
+    const char* const value = std::getenv(name);
+    if ( (value == nullptr) || (value[0] < '0') || (value[0] > '9') )
+        return std::nullopt;
+
+    char* valueEnd = nullptr;
+    errno = 0;
+    const auto result = std::strtoull(value, &valueEnd, 10);
+    if ( (errno != 0) || (*valueEnd != '\0') )
+        return std::nullopt;
+
+    return result;
+}
+
+
 /** RAII wrapper for shm_open + shm_unlink + mmap -> close  */
 class SharedMemoryBuffer
 {
@@ -196,6 +226,20 @@ public: // ctors/dtor
         return { shmFd, static_cast<std::byte*>(mmappedAddr), bufferSize };
     }
 
+    /** Maps an already existing shared memory object (e.g. a memfd). Takes the ownership of shmFd in any case. */
+    [[nodiscard]] static SharedMemoryBuffer map(int shmFd, std::size_t bufferSize) noexcept(false)
+    {
+        auto mmappedAddr = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        if ((mmappedAddr == MAP_FAILED) || (mmappedAddr == nullptr))
+        {
+            const auto savedErrno = errno;
+            close(shmFd);
+            throw std::system_error(savedErrno, std::system_category(), "mmap failed");
+        }
+
+        return { shmFd, static_cast<std::byte*>(mmappedAddr), bufferSize };
+    }
+
     // isValid() == false
     SharedMemoryBuffer() noexcept
         : SharedMemoryBuffer(-1, nullptr, 0)
@@ -258,6 +302,24 @@ public:
                                     "SharedMemoryBuffer::sync: msync failed (returned " + std::to_string(retVal) + ")");
     }
 
+    /**
+     * Returns the memory of the pages entirely within the range to the system: they read as zeros afterwards, in
+     *   every process mapping the buffer.
+     * @return the number of bytes released
+     */
+    std::size_t releasePages(const std::size_t offset, const std::size_t size) noexcept
+    {
+        const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const auto begin = (offset + pageSize - 1) / pageSize * pageSize;
+        const auto end = std::min(offset + size, bufferSize_) / pageSize * pageSize;
+        if ( !isValid() || (end <= begin) )
+            return 0;
+
+        if (fallocate(shmFd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(begin), static_cast<off_t>(end - begin)) != 0)
+            return 0;
+        return end - begin;
+    }
+
     void dispose()
     {
         if (mmappedAddr_ != nullptr)
@@ -331,9 +393,15 @@ namespace logging {
         const unsigned long srcFileLine,
         Ts&&... args
     ) {
-        const auto now = std::chrono::system_clock::now();
         char nowStrBuf[64] = {};
+        if (AppClock::isVirtual())
+        { // the virtual time since its start in the format V+SSSSSS.999, so the logs of the deterministic runs match
+            const auto sinceStartMs = std::chrono::duration_cast<std::chrono::milliseconds>(AppClock::now().time_since_epoch() - AppClock::VIRTUAL_EPOCH).count();
+            std::snprintf(nowStrBuf, sizeof(nowStrBuf) - 1, "V+%06lld.%03lld", static_cast<long long>(sinceStartMs / 1000), static_cast<long long>(sinceStartMs % 1000));
+        }
+        else
         { // writing the current date and time into nowStrBuf in the format YYYY-MM-DD HH:MM:SS.999
+            const auto now = std::chrono::system_clock::now();
             const auto nowTimeT = std::chrono::system_clock::to_time_t(now);
             if (const auto* nowTmLocal = std::localtime(&nowTimeT); nowTmLocal != nullptr)
             {
@@ -371,6 +439,87 @@ namespace logging {
     }
 
 
+    /**
+     * A token bucket limiting the messages of a single call site (see MY_LOG_*_RATE_LIMITED): BURST messages at once,
+     *   then RATE_PER_SECOND on average. The number of the messages suppressed meanwhile is appended to the next one
+     *   let through ; if no message gets through anymore, the limiter reports the number on its destruction at the exit.
+     * $WAYLAND_INPUT_WINDOW_LOG_RATE_LIMIT=0 disables the limiting, e.g. to debug an input device.
+     */
+    class RateLimiter
+    {
+    public:
+        static constexpr double BURST = 10;
+        static constexpr double RATE_PER_SECOND = 2;
+
+        /** Printed as " [N similar messages suppressed]", or as nothing if N == 0 */
+        struct Suppressed
+        {
+            std::uint64_t count;
+
+            friend std::ostream& operator<<(std::ostream& stream, const Suppressed& suppressed)
+            {
+                if (suppressed.count > 0)
+                    stream << " [" << suppressed.count << " similar messages suppressed]";
+                return stream;
+            }
+        };
+
+    public:
+        /** The level and the source location are only for the report of the suppressed messages at the destruction */
+        RateLimiter(const Level level, const std::string_view srcFileName, const unsigned long srcFileLine) noexcept
+            : level_{level}
+            , srcFileName_{srcFileName}
+            , srcFileLine_{srcFileLine}
+        {}
+
+        RateLimiter(const RateLimiter&) = delete;
+        RateLimiter& operator=(const RateLimiter&) = delete;
+
+        ~RateLimiter()
+        {
+            const std::lock_guard lock{ mutex_ };
+            if (suppressedCount_ > 0)
+                defaultLog(level_, srcFileName_, srcFileLine_, "At the exit, since the last message of this call site:", Suppressed{ suppressedCount_ });
+        }
+
+    public:
+        /** @return an empty optional if the message must be suppressed */
+        [[nodiscard]] std::optional<Suppressed> tryAcquire() noexcept
+        {
+            static const bool isEnabled = (getEnvAsUnsigned("WAYLAND_INPUT_WINDOW_LOG_RATE_LIMIT").value_or(1) != 0);
+            if (!isEnabled)
+                return Suppressed{ 0 };
+
+            const auto now = AppClock::now();
+
+            const std::lock_guard lock{ mutex_ };
+
+            if (lastRefillAt_.has_value())
+                tokens_ = std::min(BURST, tokens_ + std::chrono::duration<double>(now - *lastRefillAt_).count() * RATE_PER_SECOND);
+            lastRefillAt_ = now;
+
+            if (tokens_ < 1)
+            {
+                ++suppressedCount_;
+                return std::nullopt;
+            }
+
+            tokens_ -= 1;
+            return Suppressed{ std::exchange(suppressedCount_, 0) };
+        }
+
+    private:
+        const Level level_;
+        const std::string_view srcFileName_;
+        const unsigned long srcFileLine_;
+
+        std::mutex mutex_;
+        double tokens_ = BURST;
+        std::optional<AppClock::time_point> lastRefillAt_;
+        std::uint64_t suppressedCount_ = 0;
+    };
+
+
     #define LOGGING_THIS_FILE                                                                   \
     []() constexpr {                                                                            \
         constexpr std::string_view result = [] {                                                \
@@ -397,11 +546,24 @@ namespace logging {
     #define MY_LOG_WARN(...)  ::logging::defaultLog(::logging::Level::WARN,  LOGGING_THIS_FILE, __LINE__, __VA_ARGS__);
     #define MY_LOG_ERROR(...) ::logging::defaultLog(::logging::Level::ERROR, LOGGING_THIS_FILE, __LINE__, __VA_ARGS__);
 
+    // For the call sites which may fire at the rate of the input events ; each call site has its own limit
+    #define MY_LOG_RATE_LIMITED(LEVEL, ...)                                                                   \
+    {                                                                                                         \
+        static ::logging::RateLimiter rateLimiter_local{ LEVEL, LOGGING_THIS_FILE, __LINE__ };                \
+        if (const auto suppressed_local = rateLimiter_local.tryAcquire(); suppressed_local.has_value())       \
+            ::logging::defaultLog(LEVEL, LOGGING_THIS_FILE, __LINE__, __VA_ARGS__, *suppressed_local);        \
+    }
+
+    #define MY_LOG_INFO_RATE_LIMITED(...)  MY_LOG_RATE_LIMITED(::logging::Level::INFO,  __VA_ARGS__)
+    #define MY_LOG_WARN_RATE_LIMITED(...)  MY_LOG_RATE_LIMITED(::logging::Level::WARN,  __VA_ARGS__)
+    #define MY_LOG_ERROR_RATE_LIMITED(...) MY_LOG_RATE_LIMITED(::logging::Level::ERROR, __VA_ARGS__)
+
     #define MY_LOG_WLCALL_VALUELESS(FUNC_CALL)                                      \
     [&] {                                                                           \
         MY_LOG_TRACE(#FUNC_CALL, "...");                                            \
         (void)FUNC_CALL;                                                            \
         const auto savedErrno = errno;                                              \
+        ::FlightRecorder::record(::FlightRecorder::Kind::WL_CALL, #FUNC_CALL);      \
         MY_LOG_TRACE("    ... ", #FUNC_CALL, " finished.");                         \
         errno = savedErrno;                                                         \
     }()
@@ -418,6 +580,11 @@ namespace logging {
             auto result_local = FUNC_CALL;                                          \
             /* hoping that the assignment above hasn't touched errno */             \
             const auto savedErrno = errno;                                          \
+            ::FlightRecorder::record(                                               \
+                ::FlightRecorder::Kind::WL_CALL, #FUNC_CALL,                        \
+                ::FlightRecorder::toArg(result_local),                              \
+                static_cast<unsigned>(savedErrno)                                   \
+            );                                                                      \
             MY_LOG_TRACE("    ... ", #FUNC_CALL, " returned ", result_local, '.');  \
             errno = savedErrno;                                                     \
             return result_local;                                                    \
@@ -0,0 +1,261 @@
+#ifndef WAYLAND_INPUT_WINDOW_ZOOM_KERNELS_H
+#define WAYLAND_INPUT_WINDOW_ZOOM_KERNELS_H
+
+#include "utilities.h"      // floorDiv
+#include <cstdint>          // std::uint32_t, std::int32_t, std::int64_t, std::intmax_t
+#include <cstddef>          // std::size_t, std::byte
+#include <cstring>          // std::memcpy
+#include <algorithm>        // std::find_if, std::find_if_not, std::fill, std::min
+#include <cmath>            // std::llround
+#if defined(__SSE2__)
+    #include <immintrin.h>  // _mm_*
+#endif
+
+
+/**
+ * Resamples rows of pixels for a zoom ratio known at compile time.
+ *
+ * The zoomed pixel u shows the source pixel floor(u * Den / Num + 0.5). For the ratios supported here the mapping
+ *   is exact, so a zoomed row is either a replication of every source pixel Num times (zooming in) or every
+ *   Den-th source pixel (zooming out).
+ */
+template<std::intmax_t Num, std::intmax_t Den>
+struct ZoomKernel
+{
+    static_assert( (Num == 1) || (Den == 1), "Only integer zoom ratios and their reciprocals are supported" );
+    static_assert( (Num > 0) && ((Num & (Num - 1)) == 0), "Num must be a power of 2" );
+    static_assert( (Den > 0) && ((Den & (Den - 1)) == 0), "Den must be a power of 2" );
+
+    static constexpr double ZOOM = static_cast<double>(Num) / static_cast<double>(Den);
+
+    /** The source pixel shown by the zoomed pixel u */
+    [[nodiscard]] static constexpr std::int64_t toSource(const std::int64_t u) noexcept
+    {
+        if constexpr (Num == 1)
+            return u * Den;
+        else
+            return floorDiv(2 * u + Num, 2 * Num);
+    }
+
+    /** The number of the source pixels covered by count zoomed pixels starting at u0 */
+    [[nodiscard]] static constexpr std::size_t getSourceCount(const std::int64_t u0, const std::size_t count) noexcept
+    {
+        return static_cast<std::size_t>(toSource(u0 + static_cast<std::int64_t>(count) - 1) - toSource(u0) + 1);
+    }
+
+    /**
+     * dst[i] = src[toSource(u0 + i) - toSource(u0)] for i in [0; count).
+     * src must contain getSourceCount(u0, count) pixels.
+     */
+    static void resampleRow(const std::uint32_t* src, const std::int64_t u0, std::uint32_t* dst, const std::size_t count) noexcept
+    {
+        if constexpr ( (Num == 1) && (Den == 1) )
+        {
+            (void)u0;
+            std::memcpy(dst, src, count * sizeof(*dst));
+        }
+        else if constexpr (Den == 1)
+        {
+            std::size_t i = 0;
+
+            // The head: up to the first zoomed pixel which starts the replication of a source pixel
+            const std::int64_t src0 = toSource(u0);
+            for (; (i < count) && (floorDiv(u0 + static_cast<std::int64_t>(i) + Num / 2, Num) * Num != u0 + static_cast<std::int64_t>(i) + Num / 2); ++i)
+                dst[i] = src[toSource(u0 + static_cast<std::int64_t>(i)) - src0];
+
+            src += (i < count) ? (toSource(u0 + static_cast<std::int64_t>(i)) - src0) : 0;
+            dst += i;
+            std::size_t left = count - i;
+
+#if defined(__SSE2__)
+            // The body: 4 source pixels -> 4 * Num zoomed ones per iteration
+            for (; left >= 4 * Num; left -= 4 * Num, src += 4, dst += 4 * Num)
+            {
+                const __m128i srcPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                if constexpr (Num == 2)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), _mm_unpacklo_epi32(srcPixels, srcPixels));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi32(srcPixels, srcPixels));
+                }
+                else
+                {
+                    const __m128i broadcasts[4] = {
+                        _mm_shuffle_epi32(srcPixels, 0x00),
+                        _mm_shuffle_epi32(srcPixels, 0x55),
+                        _mm_shuffle_epi32(srcPixels, 0xAA),
+                        _mm_shuffle_epi32(srcPixels, 0xFF)
+                    };
+                    for (std::size_t lane = 0; lane < 4; ++lane)
+                        for (std::size_t copy = 0; copy < Num; copy += 4)
+                            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + lane * Num + copy), broadcasts[lane]);
+                }
+            }
+#endif
+
+            // The tail
+            for (std::size_t j = 0; j < left; ++j)
+                dst[j] = src[j / Num];
+        }
+        else
+        {
+            (void)u0;
+            std::size_t i = 0;
+
+#if defined(__SSE2__)
+            if constexpr (Den == 2)
+            {
+                // 8 source pixels -> 4 zoomed ones per iteration: picking the even lanes of 2 loads.
+                // The source has only 2 * count - 1 pixels, hence the last 8 loaded must end before that.
+                for (; i + 5 <= count; i += 4)
+                {
+                    const __m128 lo = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 0)));
+                    const __m128 hi = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 4)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))));
+                }
+            }
+#endif
+
+            for (; i < count; ++i)
+                dst[i] = src[i * Den];
+        }
+    }
+};
+
+
+/**
+ * Resamples an image by an arbitrary ratio (nearest neighbour): dst(x; y) = src(srcColumns[x]; srcRows[y]).
+ * The negative indices select the fill pixel. The indices must be non-decreasing apart from the negative ones, so each
+ *   row is split into the fill head, the gathered body and the fill tail ; the rows repeating the previous
+ *   source row are just copied.
+ */
+inline void resampleNearest(
+    const std::uint32_t* const src, const std::size_t srcStridePixels,
+    const std::int32_t* const srcColumns, const std::size_t dstWidth,
+    const std::int32_t* const srcRows, const std::size_t dstHeight,
+    std::byte* const dst, const std::size_t dstStrideBytes,
+    const std::uint32_t fill
+) {
+    const auto isCovered = [](const std::int32_t idx) { return (idx >= 0); };
+    const auto bodyBegin = static_cast<std::size_t>(std::find_if(srcColumns, srcColumns + dstWidth, isCovered) - srcColumns);
+    const auto bodyEnd = static_cast<std::size_t>(
+        std::find_if_not(srcColumns + bodyBegin, srcColumns + dstWidth, isCovered) - srcColumns
+    );
+
+    const std::uint32_t* prevDstRow = nullptr;
+    std::int32_t prevSrcRow = -1;
+
+    for (std::size_t y = 0; y < dstHeight; ++y)
+    {
+        auto* const dstRow = reinterpret_cast<std::uint32_t*>(dst + y * dstStrideBytes);
+
+        if ( (prevDstRow != nullptr) && (srcRows[y] == prevSrcRow) )
+        {
+            std::memcpy(dstRow, prevDstRow, dstWidth * sizeof(*dstRow));
+            continue;
+        }
+
+        if ( (srcRows[y] < 0) || (bodyBegin == bodyEnd) )
+        {
+            std::fill(dstRow, dstRow + dstWidth, fill);
+        }
+        else
+        {
+            const auto* const srcRow = src + static_cast<std::size_t>(srcRows[y]) * srcStridePixels;
+
+            std::fill(dstRow, dstRow + bodyBegin, fill);
+            for (std::size_t x = bodyBegin; x < bodyEnd; ++x)
+                dstRow[x] = srcRow[srcColumns[x]];
+            std::fill(dstRow + bodyEnd, dstRow + dstWidth, fill);
+        }
+
+        prevDstRow = dstRow;
+        prevSrcRow = srcRows[y];
+    }
+}
+
+
+/** A linear XRGB8888 image as a source of resampleAffineNearest */
+struct LinearImageView
+{
+    const std::uint32_t* pixels = nullptr;
+    std::size_t stridePixels = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+
+public: // getters
+    [[nodiscard]] std::size_t getWidth() const noexcept { return width; }
+    [[nodiscard]] std::size_t getHeight() const noexcept { return height; }
+    [[nodiscard]] std::uint32_t at(const std::size_t x, const std::size_t y) const noexcept { return pixels[y * stridePixels + x]; }
+};
+
+
+/** The destination pixel (x; y) shows the source point (u0 + x * dudx + y * dudy; v0 + x * dvdx + y * dvdy) */
+struct AffineSampling
+{
+    double u0 = 0;
+    double v0 = 0;
+    double dudx = 1;
+    double dvdx = 0;
+    double dudy = 0;
+    double dvdy = 1;
+};
+
+
+/**
+ * Resamples an image by an affine map, e.g. a rotation (nearest neighbour): dst(x; y) = src(floor(u); floor(v)), the
+ *   fill pixel outside of src. Only the rows [rowsBegin; rowsEnd) of dst are written, so the rows can be split
+ *   between threads. src provides getWidth(), getHeight() and at(x, y).
+ * The destination is walked in tiles of 64x8 pixels: whatever the angle is, the source footprint of a tile is a small
+ *   square, which stays in L1 (a dozen of blocks of a BlockedImage). u and v are stepped in 16.16 fixed point along
+ *   a row and computed exactly at the start of each one, so the error doesn't accumulate.
+ */
+template<typename Source>
+inline void resampleAffineNearest(
+    const Source& src, const AffineSampling& map,
+    std::byte* const dst, const std::size_t dstStrideBytes, const std::size_t dstWidth,
+    const std::size_t rowsBegin, const std::size_t rowsEnd,
+    const std::uint32_t fill
+) {
+    constexpr std::size_t TILE_WIDTH = 64;
+    constexpr std::size_t TILE_HEIGHT = 8;
+    constexpr double FIXED_ONE = 65536;
+
+    const auto toFixed = [](const double value) { return static_cast<std::int64_t>(std::llround(value * FIXED_ONE)); };
+    const std::int64_t dudx = toFixed(map.dudx);
+    const std::int64_t dvdx = toFixed(map.dvdx);
+    // The negative coordinates become huge ones, so a single unsigned comparison checks both bounds
+    const auto srcWidth = static_cast<std::uint64_t>(src.getWidth());
+    const auto srcHeight = static_cast<std::uint64_t>(src.getHeight());
+
+    for (std::size_t tileY = rowsBegin; tileY < rowsEnd; tileY += TILE_HEIGHT)
+    {
+        const std::size_t tileYEnd = std::min(tileY + TILE_HEIGHT, rowsEnd);
+
+        for (std::size_t tileX = 0; tileX < dstWidth; tileX += TILE_WIDTH)
+        {
+            const std::size_t tileXEnd = std::min(tileX + TILE_WIDTH, dstWidth);
+
+            for (std::size_t y = tileY; y < tileYEnd; ++y)
+            {
+                auto* const dstRow = reinterpret_cast<std::uint32_t*>(dst + y * dstStrideBytes);
+                const auto x0 = static_cast<double>(tileX);
+                const auto y0 = static_cast<double>(y);
+                std::int64_t u = toFixed(map.u0 + x0 * map.dudx + y0 * map.dudy);
+                std::int64_t v = toFixed(map.v0 + x0 * map.dvdx + y0 * map.dvdy);
+
+                for (std::size_t x = tileX; x < tileXEnd; ++x, u += dudx, v += dvdx)
+                {
+                    // The arithmetic shift is floor()
+                    const auto srcX = static_cast<std::uint64_t>(u >> 16);
+                    const auto srcY = static_cast<std::uint64_t>(v >> 16);
+                    dstRow[x] = ( (srcX < srcWidth) && (srcY < srcHeight) )
+                        ? src.at(static_cast<std::size_t>(srcX), static_cast<std::size_t>(srcY))
+                        : fill;
+                }
+            }
+        }
+    }
+}
+
+
+#endif // ndef WAYLAND_INPUT_WINDOW_ZOOM_KERNELS_H